@@ -3,16 +3,21 @@
 ///
 /// \brief Provides communications with the database server.
 ///
-/// This class handles all low-level communications to and from the actual MySQL database server.
-/// Any errors received from the server will generate a C++ exception, which will contain a message
-/// that describes the problem.
+/// This class handles all low-level communications to and from the database: a MySQL (or MariaDB)
+/// server, or a local SQLite file. Any errors received from the database will generate a C++
+/// exception, which will contain a message that describes the problem.
+///
+/// The calls to the client library are made through a `db_backend`, which is chosen from the host
+/// name when connecting. A host of the form "sqlite:PATH" opens a local SQLite file (or an
+/// in-memory SQLite database) instead of connecting to a server.
 ///
 
 
+#include <chrono>
 #include <string>
-#include <cstring>
 #include <stdexcept>
 #include "database.h"
+#include "gde_trace.h"
 
 
 /*
@@ -23,8 +28,7 @@ Constructor
 
 database::database()
 {
-	db_connected  = false;
-	db_connection = nullptr;
+	db_connected = false;
 }
 
 
@@ -49,7 +53,7 @@ database::~database()
 ///
 /// This member function allocates the required data structures and attempts to connect to the database.
 ///
-/// \param[in] host     database host name or IP address
+/// \param[in] host     database host name or IP address, or "sqlite:PATH" for an SQLite file
 /// \param[in] user     database user login ID
 /// \param[in] passwd   database user password
 /// \param[in] db_name  database name
@@ -63,14 +67,42 @@ void database::connect(std::string host, std::string user, std::string passwd, s
 	if (db_connected)
 		throw std::runtime_error("Database already connected");
 
-	db_connection = mysql_init(NULL);
-	if (db_connection == NULL)
-		throw std::runtime_error("Insufficient memory to allocate database connector");
-
-	if (NULL == mysql_real_connect(db_connection, host.c_str(), user.c_str(), passwd.c_str(), db_name.c_str(), 0, NULL, 0))
-		throw std::runtime_error(mysql_error(db_connection));
+	std::unique_ptr<db_backend> new_backend = db_backend::create(host);
+	new_backend->connect(host, user, passwd, db_name);
 
+	backend      = std::move(new_backend);
 	db_connected = true;
+	my_host      = host;
+	my_user      = user;
+	my_passwd    = passwd;
+	my_db_name   = db_name;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Connect to the same database as another connection
+///
+/// This member function opens a new, independent connection using the parameters of another
+/// connection, which must currently be open. It allows worker threads to have their own
+/// connections, since a single MySQL connection cannot be used by more than one thread at a time.
+/// The new connection uses the same change journal and query statistics as the other connection.
+/// It reaches the same data even if the other connection is to an in-memory SQLite database.
+///
+/// \param[in] other  an open database connection
+///
+/// \exception std::runtime_error thrown if the other connection is not open, or if the database
+///                               server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void database::connect(const database& other)
+{
+	if (!other.db_connected)
+		throw std::runtime_error("Database not connected");
+
+	connect(other.backend->shared_host(other.my_host), other.my_user, other.my_passwd, other.my_db_name);
+	my_change_journal = other.my_change_journal;
+	my_stats          = other.my_stats;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -84,14 +116,88 @@ void database::connect(std::string host, std::string user, std::string passwd, s
 
 void database::disconnect()
 {
+	if (open_stream != nullptr)
+		open_stream->close();
+
 	if (db_connected)
 	{
-		mysql_close(db_connection);
+		backend->disconnect();
+		backend.reset();
 		db_connected = false;
 	}
 }
 
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Execute database query, reading the results one row at a time
+///
+/// Use this version for a SELECT query that may return too many rows to hold in memory. The
+/// rows are not read here; call `stream.next_row()` to read each one. Until the stream has been
+/// read to the end or closed, no other query can be sent on this connection.
+///
+/// \param[in]  query    a single SQL statement (without a terminating semicolon)
+/// \param[out] stream   stream from which the results are read. Any query that it was already
+///                      reading is closed.
+///
+/// \exception std::runtime_error thrown if the database server reports an error, or another
+///                               stream is open on this connection
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void database::execute(std::string query, db_row_stream& stream)
+{
+	stream.close();
+	stream.my_num_cols = 0;
+	stream.my_row_num  = 0;
+	stream.col_desc_list.clear();
+
+	if (!db_connected)
+		throw std::runtime_error("No database connection");
+	if (open_stream != nullptr)
+		throw std::runtime_error("A row stream is already open on this database connection");
+
+	gde_trace_span span("database::execute (stream)", "sql");
+
+	db_query_timing timing;
+	timing.query = query;
+
+	// Start reading the result set, without copying it from the server.
+
+	unsigned int num_cols = send_query(query, false, timing);
+
+	// A query that does not produce a result set leaves the stream closed and empty.
+
+	if (num_cols == 0)
+	{
+		timing.rows = backend->affected_rows();
+		record_query(timing);
+		return;
+	}
+
+	try
+	{
+		backend->describe(stream.col_desc_list);
+	}
+	catch (...)
+	{
+		backend->free_result();
+		query_failed(timing);
+		throw;
+	}
+
+	stream.my_num_cols = num_cols;
+
+	stream.my_db = this;
+	open_stream  = &stream;
+
+	// The rest of the timing is added as the rows are read, and the query is recorded when the
+	// stream is closed.
+
+	stream_timing = timing;
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 ///
 /// \brief Execute database query
@@ -121,8 +227,6 @@ void database::disconnect()
 
 void database::execute(std::string query, std::vector <std::vector <std::string>>& result_set, unsigned int& num_rows, unsigned int& num_cols)
 {
-	MYSQL_RES *mysql_result = nullptr;
-
 	// Assume the query returns nothing.
 
 	num_rows = 0;
@@ -131,12 +235,7 @@ void database::execute(std::string query, std::vector <std::vector <std::string>
 
 	// Do the work.
 
-	execute_1 (query, result_set, nullptr, num_rows, num_cols, mysql_result);
-
-	// This version of this member function does not require any more information.
-	// Clean up.
-
-	if (mysql_result != nullptr) mysql_free_result(mysql_result);
+	execute_1 (query, result_set, nullptr, nullptr, num_rows, num_cols);
 }
 
 
@@ -155,9 +254,6 @@ void database::execute(std::string query, std::vector <std::vector <std::string>
 
 void database::execute(std::string query, db_row_set& row_set)
 {
-	MYSQL_RES   *mysql_result;
-	MYSQL_FIELD *mysql_fields;
-
 	// Prepare the base class for the database query.
 
 	row_set.clear();
@@ -166,154 +262,16 @@ void database::execute(std::string query, db_row_set& row_set)
 
 	row_set.setup_child_phase_1();
 
-	// Execute the query.
-
-	execute_1(query, row_set.result_set, &row_set.null_fields, row_set.my_num_rows, row_set.my_num_cols, mysql_result);
-
-	// Resize the column descriptor list.
-
-	row_set.col_desc_list.resize(row_set.my_num_cols);
-
-	// Copy the required information from the MySQL result-set into the column descriptions.
-
-	mysql_fields = mysql_fetch_fields(mysql_result);
-	for (unsigned int i = 0; i < row_set.my_num_cols; i++)
-	{
-		// Column name
-
-		if (mysql_fields[i].name != NULL)
-			row_set.col_desc_list[i].my_name = mysql_fields[i].name;
-
-		// Column name in the database (aliases are ignored)
-
-		if (mysql_fields[i].org_name != NULL)
-			row_set.col_desc_list[i].my_name_in_db = mysql_fields[i].org_name;
-
-		// Database table to which the column belongs
-
-		if (mysql_fields[i].table != NULL)
-			row_set.col_desc_list[i].my_table = mysql_fields[i].table;
-
-		// Data length
+	// Execute the query, and get the column descriptions and the rows.
 
-		row_set.col_desc_list[i].my_length = mysql_fields[i].length;
-
-		// Number of decimals for numeric data fields
-
-		row_set.col_desc_list[i].my_decimals = mysql_fields[i].decimals;
-
-		// Determine if nulls are allowed
-
-		row_set.col_desc_list[i].my_null_ok = (0 == (mysql_fields[i].flags & NOT_NULL_FLAG));
-
-		// Determine if this column is part of a primary key
-
-		row_set.col_desc_list[i].my_pri_key = (0 != (mysql_fields[i].flags & PRI_KEY_FLAG));
-
-		// Determine if this column auto-increments
-
-		row_set.col_desc_list[i].my_auto_inc = (0 != (mysql_fields[i].flags & AUTO_INCREMENT_FLAG));
-
-		// Data type
-
-		switch (mysql_fields[i].type)
-		{
-		case MYSQL_TYPE_TINY:
-			if (mysql_fields[i].flags & UNSIGNED_FLAG)
-				row_set.col_desc_list[i].my_type = DB_UNSIGNED_TINYINT;
-			else
-				row_set.col_desc_list[i].my_type = DB_TINYINT;
-			break;
-		case MYSQL_TYPE_SHORT:
-			if (mysql_fields[i].flags & UNSIGNED_FLAG)
-				row_set.col_desc_list[i].my_type = DB_UNSIGNED_SMALLINT;
-			else
-				row_set.col_desc_list[i].my_type = DB_SMALLINT;
-			break;
-		case MYSQL_TYPE_INT24:
-			if (mysql_fields[i].flags & UNSIGNED_FLAG)
-				row_set.col_desc_list[i].my_type = DB_UNSIGNED_MEDIUMINT;
-			else
-				row_set.col_desc_list[i].my_type = DB_MEDIUMINT;
-			break;
-		case MYSQL_TYPE_LONG:
-			if (mysql_fields[i].flags & UNSIGNED_FLAG)
-				row_set.col_desc_list[i].my_type = DB_UNSIGNED_INT;
-			else
-				row_set.col_desc_list[i].my_type = DB_INT;
-			break;
-		case MYSQL_TYPE_LONGLONG:
-			if (mysql_fields[i].flags & UNSIGNED_FLAG)
-				row_set.col_desc_list[i].my_type = DB_UNSIGNED_BIGINT;
-			else
-				row_set.col_desc_list[i].my_type = DB_BIGINT;
-			break;
-		case MYSQL_TYPE_DECIMAL:
-		case MYSQL_TYPE_NEWDECIMAL:
-			row_set.col_desc_list[i].my_type = DB_DECIMAL;
-			break;
-		case MYSQL_TYPE_FLOAT:
-			row_set.col_desc_list[i].my_type = DB_FLOAT;
-			break;
-		case MYSQL_TYPE_DOUBLE:
-			row_set.col_desc_list[i].my_type = DB_DOUBLE;
-			break;
-		case MYSQL_TYPE_BIT:
-			row_set.col_desc_list[i].my_type = DB_BIT;
-			break;
-		case MYSQL_TYPE_TIMESTAMP:
-			row_set.col_desc_list[i].my_type = DB_TIMESTAMP;
-			break;
-		case MYSQL_TYPE_DATE:
-			row_set.col_desc_list[i].my_type = DB_DATE;
-			break;
-		case MYSQL_TYPE_TIME:
-			row_set.col_desc_list[i].my_type = DB_TIME;
-			break;
-		case MYSQL_TYPE_DATETIME:
-			row_set.col_desc_list[i].my_type = DB_DATETIME;
-			break;
-		case MYSQL_TYPE_YEAR:
-			row_set.col_desc_list[i].my_type = DB_YEAR;
-			break;
-		case MYSQL_TYPE_STRING:
-			if (mysql_fields[i].charsetnr == 63)
-				row_set.col_desc_list[i].my_type = DB_BINARY;
-			else
-				row_set.col_desc_list[i].my_type = DB_CHAR;
-			break;
-		case MYSQL_TYPE_VAR_STRING:
-			if (mysql_fields[i].charsetnr == 63)
-				row_set.col_desc_list[i].my_type = DB_VARBINARY;
-			else
-			row_set.col_desc_list[i].my_type = DB_VARCHAR;
-			break;
-		case MYSQL_TYPE_BLOB:
-			if (mysql_fields[i].charsetnr == 63)
-				row_set.col_desc_list[i].my_type = DB_BLOB;
-			else
-				row_set.col_desc_list[i].my_type = DB_TEXT;
-			break;
-		case MYSQL_TYPE_SET:
-			row_set.col_desc_list[i].my_type = DB_SET;
-			break;
-		case MYSQL_TYPE_ENUM:
-			row_set.col_desc_list[i].my_type = DB_ENUM;
-			break;
-		case MYSQL_TYPE_GEOMETRY:
-			row_set.col_desc_list[i].my_type = DB_GEOMETRY;
-			break;
-		case MYSQL_TYPE_NULL:
-			row_set.col_desc_list[i].my_type = DB_NULL;
-			break;
-		default:
-			row_set.col_desc_list[i].my_type = DB_UNKNOWN_TYPE;
-		}
-	}
+	// If the row set asks for dictionary encoding, the columns with few distinct values are
+	// encoded as the rows are read.
 
-	// Clean up the MySQL data structures.
+	execute_1(query, row_set.result_set, &row_set.null_fields, &row_set.col_desc_list,
+	          row_set.my_num_rows, row_set.my_num_cols,
+	          row_set.dict_encoding ? &row_set : nullptr);
 
-	mysql_free_result(mysql_result);
+	row_set.end_encoding();
 
 	// Allow a child class to prepare its data structures using the query results.
 
@@ -381,11 +339,143 @@ unsigned int database::execute(std::string query)
 
 std::string database::escape_str(std::string str)
 {
-	char* esc_str = new char[strlen(str.c_str()) * 2 + 1];
-	unsigned int length = mysql_real_escape_string(db_connection, esc_str, str.c_str(), str.length());
-	std::string result(esc_str, length);
-	delete[] esc_str;
-	return result;
+	if (!db_connected)
+		throw std::runtime_error("No database connection");
+
+	return backend->escape_str(str);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Set the change journal table
+///
+/// When a change journal is set, classes that write to the database through this connection
+/// (such as `db_row_set_w`) record the table name and primary key of every altered row in it.
+/// See `gde_change_tracker` for the table layout.
+///
+/// \param[in] table  journal table name, or an empty string to stop recording changes
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void database::set_change_journal(std::string table)
+{
+	my_change_journal = table;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the change journal table
+///
+/// \return  journal table name, or an empty string if changes are not being recorded
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string database::change_journal() const
+{
+	return my_change_journal;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Set the query statistics
+///
+/// Each query sent on this connection is timed and recorded in the given statistics. New
+/// connections use `db_query_stats::shared()`.
+///
+/// \param[in] stats  statistics to record the queries in, or null to not record them
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void database::set_query_stats(db_query_stats* stats)
+{
+	my_stats = stats;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the query statistics
+///
+/// \return  statistics that the queries are recorded in, or null if they are not recorded
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+db_query_stats* database::query_stats() const
+{
+	return my_stats;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the name of the database backend
+///
+/// \return  "mysql" or "sqlite", or an empty string if not connected
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string database::backend_name() const
+{
+	return db_connected ? backend->name() : std::string();
+}
+
+
+
+// This private member function reads the next row of an unbuffered result set into a row stream.
+// The stream is closed at the end of the result set.
+
+bool database::fetch_row(db_row_stream& stream)
+{
+	// Reuse the strings from the previous row, so that their memory is not reallocated.
+
+	bool have_row;
+	try
+	{
+		have_row = backend->fetch_row(stream.row_data, stream.null_fields, stream_timing);
+	}
+	catch (...)
+	{
+		stream_timing.error = true;
+		stream.close();
+		throw;
+	}
+
+	if (!have_row)
+	{
+		stream.close();
+		return false;
+	}
+
+	stream.my_row_num++;
+	return true;
+}
+
+
+
+// This private member function frees the result set of a row stream. Any rows that have not been
+// read are discarded.
+
+void database::close_stream(db_row_stream& stream)
+{
+	if (open_stream == &stream)
+	{
+		backend->free_result();
+
+		stream_timing.rows = stream.my_row_num;
+		record_query(stream_timing);
+		stream_timing = db_query_timing();
+		open_stream   = nullptr;
+	}
+
+	stream.my_db = nullptr;
 }
 
 
@@ -396,25 +486,25 @@ void database::execute_1(
 			std::string query,
 			std::vector <std::vector <std::string>>& result_set,
 			std::vector <std::vector<bool>> *null_fields_ptr,
+			std::vector <db_col_desc> *col_desc_ptr,
 			unsigned int& num_rows,
 			unsigned int& num_cols,
-			MYSQL_RES *&result)
+			db_row_set* dict_row_set)
 {
-	MYSQL_ROW row;
+	gde_trace_span span("database::execute", "sql");
 
 	// We need to be connected to a database to continue.
 
 	if (!db_connected)
 		throw std::runtime_error("No database connection");
+	if (open_stream != nullptr)
+		throw std::runtime_error("Query sent while a row stream is open on this database connection");
 
-	// Execute the SQL query.
-
-	if (mysql_query(db_connection, query.c_str()) != 0)
-		throw std::runtime_error(mysql_error(db_connection));
-
-	// If the query produced a result set, then num_cols will be non-zero.
+	// Execute the SQL query. If it produced a result set, then num_cols will be non-zero.
 
-	num_cols = mysql_field_count(db_connection);
+	db_query_timing timing;
+	timing.query = query;
+	num_cols = send_query(query, true, timing);
 
 	if (num_cols == 0)
 	{
@@ -422,59 +512,106 @@ void database::execute_1(
 		// most non-SELECT queries that alter the database (such as INSERT, UPDATE, DELETE).
 		// In this case, set num_rows to the number of rows that were changed (affected).
 
-		num_rows = (unsigned int) mysql_affected_rows(db_connection);
+		num_rows = (unsigned int) backend->affected_rows();
+		timing.rows = num_rows;
+		record_query(timing);
+		return;
 	}
-	else
+
+	// Copy the column descriptions, and then the data in the result set to where it should go.
+	// The strings of each row are filled in place by the backend, or else passed to the row set
+	// that encodes them.
+
+	gde_trace_span copy_span("copy rows", "sql");
+
+	std::vector<std::string> row;
+	std::vector<bool>        null_row;
+	num_rows = 0;
+
+	try
 	{
-		// Get the result set from the database server.
+		if (col_desc_ptr != nullptr)
+			backend->describe(*col_desc_ptr);
 
-		result = mysql_store_result(db_connection);
-		if (result == NULL)
-			throw std::runtime_error(mysql_error(db_connection));
+		if (dict_row_set != nullptr)
+		{
+			while (backend->fetch_row(row, null_row, timing))
+			{
+				dict_row_set->encode_row(row, null_row);
+				num_rows++;
+			}
+		}
+		else
+		{
+			for (;;)
+			{
+				if (result_set.size() == num_rows)
+					result_set.emplace_back();
 
-		// Get the number of rows in the result set.
+				if (!backend->fetch_row(result_set[num_rows], null_row, timing))
+					break;
 
-		num_rows = (int)mysql_num_rows(result);
+				if (null_fields_ptr != nullptr)
+				{
+					if (null_fields_ptr->size() == num_rows)
+						null_fields_ptr->emplace_back();
+					(*null_fields_ptr)[num_rows].swap(null_row);
+				}
+				num_rows++;
+			}
+		}
+	}
+	catch (...)
+	{
+		backend->free_result();
+		query_failed(timing);
+		throw;
+	}
 
-		// If there are no rows in the result set, then just return.
+	result_set.resize(num_rows);
+	if (null_fields_ptr != nullptr)
+		null_fields_ptr->resize(num_rows);
 
-		if (num_rows == 0)
-			return;
+	timing.rows = num_rows;
+	record_query(timing);
+}
 
-		// Resize the data arrays to hold the correct number of rows.
 
-		if (null_fields_ptr != nullptr) (*null_fields_ptr).resize(num_rows);
-		result_set.resize(num_rows);
 
-		// Copy the data in the result set to where it should go.
+// This private member function sends a query to the database and waits for the reply. The
+// backend times each step. If the database reports an error, the failed query is recorded and
+// the exception is passed on.
 
-		for (unsigned int i = 0; i < num_rows; i++)
-		{
-			// Get one row of data from the result set.
+unsigned int database::send_query(const std::string& query, bool buffered, db_query_timing& timing)
+{
+	try
+	{
+		return backend->execute(query, buffered, timing);
+	}
+	catch (...)
+	{
+		query_failed(timing);
+		throw;
+	}
+}
 
-			row = mysql_fetch_row(result);
-			if (row == NULL)
-				throw std::runtime_error(mysql_error(db_connection));
 
-			// Resize the data arrays to hold the correct number of columns.
 
-			if (null_fields_ptr != nullptr) (*null_fields_ptr)[i].resize(num_cols);
-			result_set[i].resize(num_cols);
+// This private member function records a query in the query statistics, if there are any.
 
-			// Copy the data to the final location.
+void database::record_query(db_query_timing& timing)
+{
+	if (my_stats != nullptr)
+		my_stats->record(timing);
+}
 
-			for (unsigned int j = 0; j < num_cols; j++)
-			{
-				if (row[j] == nullptr)
-				{
-					if (null_fields_ptr != nullptr) (*null_fields_ptr)[i][j] = true;
-				}
-				else
-				{
-					if (null_fields_ptr != nullptr) (*null_fields_ptr)[i][j] = false;
-					result_set[i][j] = row[j];
-				}
-			}
-		}
-	}
+
+
+// This private member function records a query that failed. The caller passes on the exception
+// with the database's error message.
+
+void database::query_failed(db_query_timing& timing)
+{
+	timing.error = true;
+	record_query(timing);
 }
@@ -6,10 +6,12 @@
 #ifndef DATABASE_H
 #define DATABASE_H
 
+#include <memory>
 #include <string>
 #include <vector>
-#include <mysql.h>
+#include "db_backend.h"
 #include "db_row_set.h"
+#include "db_query_stats.h"
 
 class database
 {
@@ -18,25 +20,67 @@ public:
 	~database();
 
 	void         connect    (std::string host, std::string user, std::string passwd, std::string db_name);
+	void         connect    (const database& other);
 	void         disconnect ();
 	void         execute	(std::string query,
 							 std::vector <std::vector <std::string>>& result_set,
 							 unsigned int& num_rows,
 							 unsigned int& num_cols);
 	void         execute    (std::string query, db_row_set& row_set);
+	void         execute    (std::string query, db_row_stream& stream);
 	unsigned int execute    (std::string query);
 	std::string  escape_str (std::string str);
+
+	void         set_change_journal (std::string table);
+	std::string  change_journal     () const;
+
+	void            set_query_stats (db_query_stats* stats);
+	db_query_stats* query_stats     () const;
+
+	std::string     backend_name    () const;
 private:
+	friend class db_row_stream;
+
 	void execute_1(
 		std::string query,
 		std::vector <std::vector <std::string>>& result_set,
 		std::vector <std::vector<bool>> *null_fields_prt,
+		std::vector <db_col_desc> *col_desc_ptr,
 		unsigned int& num_rows,
 		unsigned int& num_cols,
-		MYSQL_RES *&result);
+		db_row_set* dict_row_set = nullptr);
+
+	bool fetch_row    (db_row_stream& stream);
+	void close_stream (db_row_stream& stream);
+
+	unsigned int send_query   (const std::string& query, bool buffered, db_query_timing& timing);
+	void         record_query (db_query_timing& timing);
+	void         query_failed (db_query_timing& timing);
+
+	std::unique_ptr<db_backend> backend;    // Client library of the connected database, or null
+	bool                        db_connected;
+
+	// Row stream that is reading an unbuffered result set, or null. No other query can be sent
+	// while it is open.
+
+	db_row_stream *open_stream = nullptr;
+
+	// Statistics that each query is recorded in, or null, and the timing of the query that the
+	// open row stream is reading.
+
+	db_query_stats  *my_stats = &db_query_stats::shared();
+	db_query_timing  stream_timing;
+
+	// Connection parameters, kept so that another connection can be opened to the same database.
+
+	std::string my_host;
+	std::string my_user;
+	std::string my_passwd;
+	std::string my_db_name;
+
+	// Name of the change journal table, or empty if changes are not recorded.
 
-	MYSQL *db_connection;
-	bool   db_connected;
+	std::string my_change_journal;
 };
 
 #endif
@@ -0,0 +1,80 @@
+///
+/// \class db_backend db_backend.h
+///
+/// \brief Interface to the client library of one kind of database
+///
+/// GenDat Explorer normally works with a MySQL (or MariaDB) server, through `db_mysql`. It can
+/// also work with a local SQLite file, through `db_sqlite`, so that the program and the
+/// benchmarks can be run without a server. The backend is chosen from the host name that is
+/// given to `database::connect()`: a host of the form "sqlite:PATH" selects SQLite, and any
+/// other host selects MySQL.
+///
+/// The `database` class is the only user of the backends. It keeps the parts that do not depend
+/// on the library: the row sets and row streams, the query statistics and the tracing.
+///
+
+
+#include "db_backend.h"
+#include "db_mysql.h"
+#include "db_sqlite.h"
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Create the backend for a host
+///
+/// \param[in]  host   database host name or IP address, or "sqlite:PATH" for an SQLite file
+///
+/// \return     a new backend, which is not yet connected
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::unique_ptr<db_backend> db_backend::create(const std::string& host)
+{
+    if (host.compare(0, db_sqlite::HOST_PREFIX.size(), db_sqlite::HOST_PREFIX) == 0)
+        return std::unique_ptr<db_backend>(new db_sqlite);
+    return std::unique_ptr<db_backend>(new db_mysql);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the host that opens another connection to the same database
+///
+/// `database::connect(const database&)` uses this to open the connections of worker threads. Most
+/// backends reach the same database again through the host they were connected with, which is
+/// what this default returns.
+///
+/// \param[in]  host   host that this backend was connected with
+///
+/// \return     host to connect another backend with
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string db_backend::shared_host(const std::string& host) const
+{
+    return host;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Fill in a column description. This is a friend of db_col_desc, so that the backends need not be.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_backend::set_col_desc(db_col_desc& col, const col_info& info)
+{
+    col.my_name       = info.name;
+    col.my_name_in_db = info.name_in_db;
+    col.my_table      = info.table;
+    col.my_type       = info.type;
+    col.my_length     = info.length;
+    col.my_decimals   = info.decimals;
+    col.my_null_ok    = info.null_ok;
+    col.my_pri_key    = info.pri_key;
+    col.my_auto_inc   = info.auto_inc;
+}
@@ -0,0 +1,70 @@
+///
+/// \file
+///
+
+#ifndef DB_BACKEND_H
+#define DB_BACKEND_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "db_query_stats.h"
+#include "db_row_set.h"
+
+
+///
+/// \brief Interface to the client library of one kind of database
+///
+/// The `database` class sends all of its queries through a backend, and does the rest of the work
+/// (row sets, row streams, query statistics and tracing) itself. A backend has one result set
+/// open at a time: after `execute` returns a non-zero number of columns, the rows are read with
+/// `fetch_row` until it returns false, or the result is discarded with `free_result`. The
+/// backend adds the time spent in each phase of the query, and the bytes returned, to the
+/// timing that it is given.
+///
+/// All of the member functions throw `std::runtime_error` with the library's error message if
+/// the library reports an error.
+///
+
+class db_backend
+{
+public:
+    virtual ~db_backend() {};
+
+    static std::unique_ptr<db_backend> create (const std::string& host);
+
+    virtual std::string   name          () const = 0;
+    virtual void          connect       (const std::string& host, const std::string& user,
+                                         const std::string& passwd, const std::string& db_name) = 0;
+    virtual void          disconnect    () = 0;
+    virtual unsigned int  execute       (const std::string& query, bool buffered, db_query_timing& timing) = 0;
+    virtual unsigned long affected_rows () = 0;
+    virtual void          describe      (std::vector<db_col_desc>& cols) = 0;
+    virtual bool          fetch_row     (std::vector<std::string>& row, std::vector<bool>& null_fields,
+                                         db_query_timing& timing) = 0;
+    virtual void          free_result   () = 0;
+    virtual std::string   escape_str    (const std::string& str) = 0;
+    virtual std::string   shared_host   (const std::string& host) const;
+
+protected:
+
+    // Backends are not friends of db_col_desc, so they fill in column descriptions through this.
+
+    struct col_info
+    {
+        std::string  name;
+        std::string  name_in_db;
+        std::string  table;
+        db_data_type type     = DB_UNKNOWN_TYPE;
+        unsigned int length   = 0;
+        unsigned int decimals = 0;
+        bool         null_ok  = true;
+        bool         pri_key  = false;
+        bool         auto_inc = false;
+    };
+
+    static void set_col_desc (db_col_desc& col, const col_info& info);
+};
+
+#endif
@@ -36,37 +36,59 @@
 
 void db_map::load_defs(database &db, std::string src_defs, std::string fld_defs)
 {
-
-    std::string query;
-    std::string fields;
-
-    std::vector< std::vector< std::string >> result_set;
+    std::vector< std::vector< std::string >> src_rows;
+    std::vector< std::vector< std::string >> fld_rows;
     unsigned int num_rows;
     unsigned int num_cols;
 
-    // Read the source definitions from the database.
+    // Read the source and field definitions from the database, with the columns in the order
+    // expected by the other version of this function.
+
+    db.execute ("SELECT id, name, description, version, code, db_table, derived_from, writable FROM " + src_defs,
+                src_rows, num_rows, num_cols);
+    db.execute ("SELECT id, source, code, name, db_field, writable FROM " + fld_defs,
+                fld_rows, num_rows, num_cols);
+
+    load_defs (src_rows, fld_rows);
+}
 
-    fields = "id, name, description, version, code, db_table, derived_from, writable";
-    query  = "SELECT " + fields + " FROM " + src_defs;
 
-    db.execute (query, result_set, num_rows, num_cols);
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Load source and field definitions from rows that have already been read
+///
+/// Any definitions loaded before are replaced.
+///
+/// \param[in]  src_rows   source definitions, with the columns id, name, description, version,
+///                        code, db_table, derived_from and writable
+/// \param[in]  fld_rows   field definitions, with the columns id, source, code, name, db_field and
+///                        writable
+///
+/// \exception std::runtime_error thrown if a field definition refers to a non-existent source
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_map::load_defs(const std::vector<std::vector<std::string>>& src_rows,
+                       const std::vector<std::vector<std::string>>& fld_rows)
+{
     // Set up the source definitions.
 
-    unsigned int num_sources = num_rows;
+    unsigned int num_sources = src_rows.size();
 
+    source_list.clear();
     source_list.resize(num_sources);
     for (unsigned int i=0; i<num_sources; i++)
     {
-        source_list[i].id           = result_set[i][0];
-        source_list[i].name         = result_set[i][1];
-        source_list[i].description  = result_set[i][2];
-        source_list[i].version      = result_set[i][3];
-        source_list[i].code         = result_set[i][4];
-        source_list[i].db_table     = result_set[i][5];
-        source_list[i].derived_from = result_set[i][6];
-
-        if (result_set[i][7] == "yes")
+        source_list[i].id           = src_rows[i][0];
+        source_list[i].name         = src_rows[i][1];
+        source_list[i].description  = src_rows[i][2];
+        source_list[i].version      = src_rows[i][3];
+        source_list[i].code         = src_rows[i][4];
+        source_list[i].db_table     = src_rows[i][5];
+        source_list[i].derived_from = src_rows[i][6];
+
+        if (src_rows[i][7] == "yes")
             source_list[i].writable = true;
         else
             source_list[i].writable = false;
@@ -89,18 +111,9 @@ void db_map::load_defs(database &db, std::string src_defs, std::string fld_defs)
                 }
         }
 
-    // Read the field definitions from the database.
-
-    fields = "id, source, code, name, db_field, writable";
-    query  = "SELECT " + fields + " FROM " + fld_defs;
-
-    result_set.clear();
-
-    db.execute (query, result_set, num_rows, num_cols);
-
     // Set up the source field definitions.
 
-    unsigned int num_field_defs = num_rows;
+    unsigned int num_field_defs = fld_rows.size();
 
     for (unsigned int i=0; i<num_field_defs; i++)
     {
@@ -108,7 +121,7 @@ void db_map::load_defs(database &db, std::string src_defs, std::string fld_defs)
 
         int source_num = -1;
         for (unsigned int j=0; j<num_sources; j++)
-            if (source_list[j].id == result_set[i][1])
+            if (source_list[j].id == fld_rows[i][1])
             {
                 source_num = j;
                 break;
@@ -122,9 +135,9 @@ void db_map::load_defs(database &db, std::string src_defs, std::string fld_defs)
 
         field_def new_field;
 
-        new_field.code     = result_set[i][2];
-        new_field.name     = result_set[i][3];
-        new_field.db_field = result_set[i][4];
+        new_field.code     = fld_rows[i][2];
+        new_field.name     = fld_rows[i][3];
+        new_field.db_field = fld_rows[i][4];
 
         // Add the new field to the source.
 
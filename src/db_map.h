@@ -19,6 +19,8 @@ public:
     virtual ~db_map() {};
 
     void             load_defs       (database &db, std::string src_defs, std::string fld_defs);
+    void             load_defs       (const std::vector<std::vector<std::string>>& src_rows,
+                                      const std::vector<std::vector<std::string>>& fld_rows);
     int              num_sources     () const;
     int              num_fields      (int source_num) const;
 
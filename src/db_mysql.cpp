@@ -0,0 +1,425 @@
+///
+/// \class db_mysql db_mysql.h
+///
+/// \brief Database backend for MySQL and MariaDB servers
+///
+/// This class holds all of the calls to the MySQL C API. Buffered results are copied from the
+/// server with `mysql_store_result()` before `execute` returns; unbuffered results are read one
+/// row at a time with `mysql_use_result()`, and no other query can be sent until they have been
+/// read or freed.
+///
+
+
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <mysql.h>
+
+#include "db_mysql.h"
+#include "gde_trace.h"
+
+
+// Milliseconds between two times.
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+
+
+db_mysql::~db_mysql()
+{
+    disconnect();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the name of the backend
+///
+/// \return     "mysql"
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string db_mysql::name() const
+{
+    return "mysql";
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Connect to a database server
+///
+/// \param[in] host     database host name or IP address
+/// \param[in] user     database user login ID
+/// \param[in] passwd   database user password
+/// \param[in] db_name  database name
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_mysql::connect(const std::string& host, const std::string& user, const std::string& passwd,
+                       const std::string& db_name)
+{
+    db_connection = mysql_init(NULL);
+    if (db_connection == NULL)
+        throw std::runtime_error("Insufficient memory to allocate database connector");
+
+    if (NULL == mysql_real_connect(db_connection, host.c_str(), user.c_str(), passwd.c_str(), db_name.c_str(), 0, NULL, 0))
+    {
+        std::string error = mysql_error(db_connection);
+        mysql_close(db_connection);
+        db_connection = nullptr;
+        throw std::runtime_error(error);
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Disconnect from the database server
+///
+/// Any result set that is being read is freed first.
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_mysql::disconnect()
+{
+    free_result();
+
+    if (db_connection != nullptr)
+    {
+        mysql_close(db_connection);
+        db_connection = nullptr;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Execute a query
+///
+/// The query is sent to the server, and the time to send it and the time waiting for the reply
+/// are timed separately. If the query produced a result set, then it is opened for reading
+/// with `fetch_row`.
+///
+/// \param[in]     query      a single SQL statement (without a terminating semicolon)
+/// \param[in]     buffered   true to copy the whole result set from the server now, false to
+///                           read it from the server one row at a time
+/// \param[in,out] timing     timing of the query
+///
+/// \return     number of columns in the result set, or zero if the query did not produce one
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int db_mysql::execute(const std::string& query, bool buffered, db_query_timing& timing)
+{
+    free_result();
+
+    {
+        gde_trace_span span("send query", "sql");
+
+        auto start = std::chrono::steady_clock::now();
+        int  error = mysql_send_query(db_connection, query.c_str(), query.length());
+        auto sent  = std::chrono::steady_clock::now();
+        timing.send_ms = elapsed_ms(start, sent);
+
+        if (error != 0)
+            throw_error();
+
+        error = mysql_read_query_result(db_connection);
+        timing.server_ms = elapsed_ms(sent, std::chrono::steady_clock::now());
+
+        if (error != 0)
+            throw_error();
+    }
+
+    // A query that does not produce a result set, such as INSERT, UPDATE or DELETE.
+
+    num_cols = mysql_field_count(db_connection);
+    if (num_cols == 0)
+        return 0;
+
+    if (buffered)
+    {
+        auto start = std::chrono::steady_clock::now();
+        {
+            gde_trace_span fetch_span("mysql_store_result", "sql");
+            result = mysql_store_result(db_connection);
+        }
+        timing.fetch_ms = elapsed_ms(start, std::chrono::steady_clock::now());
+    }
+    else
+    {
+        // Start reading the result set, without copying it from the server.
+
+        result = mysql_use_result(db_connection);
+    }
+
+    if (result == NULL)
+        throw_error();
+
+    return num_cols;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of rows changed by the last query
+///
+/// \return     number of rows inserted, updated or deleted
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned long db_mysql::affected_rows()
+{
+    return (unsigned long) mysql_affected_rows(db_connection);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Describe the columns of the result set
+///
+/// \param[out] cols   column descriptions, one for each column of the result set
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_mysql::describe(std::vector<db_col_desc>& cols)
+{
+    cols.clear();
+    cols.resize(num_cols);
+    if (result == nullptr)
+        return;
+
+    MYSQL_FIELD *mysql_fields = mysql_fetch_fields(result);
+    for (unsigned int i = 0; i < num_cols; i++)
+    {
+        col_info info;
+
+        // Column name, column name in the database (aliases are ignored), and the database table
+        // to which the column belongs
+
+        if (mysql_fields[i].name != NULL)
+            info.name = mysql_fields[i].name;
+        if (mysql_fields[i].org_name != NULL)
+            info.name_in_db = mysql_fields[i].org_name;
+        if (mysql_fields[i].table != NULL)
+            info.table = mysql_fields[i].table;
+
+        // Data length, and the number of decimals for numeric data fields
+
+        info.length   = mysql_fields[i].length;
+        info.decimals = mysql_fields[i].decimals;
+
+        // Nulls allowed, primary key and auto-increment
+
+        info.null_ok  = (0 == (mysql_fields[i].flags & NOT_NULL_FLAG));
+        info.pri_key  = (0 != (mysql_fields[i].flags & PRI_KEY_FLAG));
+        info.auto_inc = (0 != (mysql_fields[i].flags & AUTO_INCREMENT_FLAG));
+
+        // Data type
+
+        bool is_unsigned = (0 != (mysql_fields[i].flags & UNSIGNED_FLAG));
+        bool is_binary   = (mysql_fields[i].charsetnr == 63);
+
+        switch (mysql_fields[i].type)
+        {
+        case MYSQL_TYPE_TINY:
+            info.type = is_unsigned ? DB_UNSIGNED_TINYINT : DB_TINYINT;
+            break;
+        case MYSQL_TYPE_SHORT:
+            info.type = is_unsigned ? DB_UNSIGNED_SMALLINT : DB_SMALLINT;
+            break;
+        case MYSQL_TYPE_INT24:
+            info.type = is_unsigned ? DB_UNSIGNED_MEDIUMINT : DB_MEDIUMINT;
+            break;
+        case MYSQL_TYPE_LONG:
+            info.type = is_unsigned ? DB_UNSIGNED_INT : DB_INT;
+            break;
+        case MYSQL_TYPE_LONGLONG:
+            info.type = is_unsigned ? DB_UNSIGNED_BIGINT : DB_BIGINT;
+            break;
+        case MYSQL_TYPE_DECIMAL:
+        case MYSQL_TYPE_NEWDECIMAL:
+            info.type = DB_DECIMAL;
+            break;
+        case MYSQL_TYPE_FLOAT:
+            info.type = DB_FLOAT;
+            break;
+        case MYSQL_TYPE_DOUBLE:
+            info.type = DB_DOUBLE;
+            break;
+        case MYSQL_TYPE_BIT:
+            info.type = DB_BIT;
+            break;
+        case MYSQL_TYPE_TIMESTAMP:
+            info.type = DB_TIMESTAMP;
+            break;
+        case MYSQL_TYPE_DATE:
+            info.type = DB_DATE;
+            break;
+        case MYSQL_TYPE_TIME:
+            info.type = DB_TIME;
+            break;
+        case MYSQL_TYPE_DATETIME:
+            info.type = DB_DATETIME;
+            break;
+        case MYSQL_TYPE_YEAR:
+            info.type = DB_YEAR;
+            break;
+        case MYSQL_TYPE_STRING:
+            info.type = is_binary ? DB_BINARY : DB_CHAR;
+            break;
+        case MYSQL_TYPE_VAR_STRING:
+            info.type = is_binary ? DB_VARBINARY : DB_VARCHAR;
+            break;
+        case MYSQL_TYPE_BLOB:
+            info.type = is_binary ? DB_BLOB : DB_TEXT;
+            break;
+        case MYSQL_TYPE_SET:
+            info.type = DB_SET;
+            break;
+        case MYSQL_TYPE_ENUM:
+            info.type = DB_ENUM;
+            break;
+        case MYSQL_TYPE_GEOMETRY:
+            info.type = DB_GEOMETRY;
+            break;
+        case MYSQL_TYPE_NULL:
+            info.type = DB_NULL;
+            break;
+        default:
+            info.type = DB_UNKNOWN_TYPE;
+        }
+
+        set_col_desc(cols[i], info);
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Read the next row of the result set
+///
+/// The strings of the previous row are reused, so that their memory is not reallocated. The
+/// result set is freed at the end.
+///
+/// \param[out]    row           data of each column (empty if NULL)
+/// \param[out]    null_fields   true for each column that is NULL
+/// \param[in,out] timing        timing of the query
+///
+/// \return     true if a row was read, false at the end of the result set
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool db_mysql::fetch_row(std::vector<std::string>& row, std::vector<bool>& null_fields, db_query_timing& timing)
+{
+    if (result == nullptr)
+        return false;
+
+    auto      start      = std::chrono::steady_clock::now();
+    MYSQL_ROW mysql_row  = mysql_fetch_row(result);
+    auto      fetched    = std::chrono::steady_clock::now();
+    timing.fetch_ms += elapsed_ms(start, fetched);
+
+    if (mysql_row == NULL)
+    {
+        // The end of the result set, or an error while reading it.
+
+        bool failed = (mysql_errno(db_connection) != 0);
+        std::string error = failed ? mysql_error(db_connection) : "";
+        free_result();
+        if (failed)
+            throw std::runtime_error(error);
+        return false;
+    }
+
+    unsigned long *lengths = mysql_fetch_lengths(result);
+
+    row.resize(num_cols);
+    null_fields.resize(num_cols);
+
+    for (unsigned int j = 0; j < num_cols; j++)
+    {
+        if (mysql_row[j] == nullptr)
+        {
+            null_fields[j] = true;
+            row[j].clear();
+        }
+        else
+        {
+            null_fields[j] = false;
+            row[j].assign(mysql_row[j], lengths[j]);
+            timing.bytes += lengths[j];
+        }
+    }
+
+    timing.copy_ms += elapsed_ms(fetched, std::chrono::steady_clock::now());
+    return true;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Free the result set
+///
+/// Any rows that have not been read are discarded by the client library.
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_mysql::free_result()
+{
+    if (result != nullptr)
+    {
+        mysql_free_result(result);
+        result = nullptr;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Escape string
+///
+/// This member function encodes special characters in the input string to produce an escaped string
+/// that is safe to use in an SQL statement, taking into account the current character set of the
+/// database connection.
+///
+/// \param[in] str  string to be processed
+///
+/// \return  escaped string
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string db_mysql::escape_str(const std::string& str)
+{
+    std::vector<char> esc_str(str.length() * 2 + 1);
+    unsigned long length = mysql_real_escape_string(db_connection, esc_str.data(), str.c_str(), str.length());
+    return std::string(esc_str.data(), length);
+}
+
+
+
+// This private member function throws an exception with the server's error message.
+
+void db_mysql::throw_error()
+{
+    throw std::runtime_error(mysql_error(db_connection));
+}
@@ -0,0 +1,48 @@
+///
+/// \file
+///
+
+#ifndef DB_MYSQL_H
+#define DB_MYSQL_H
+
+#include <string>
+#include <vector>
+
+#include "db_backend.h"
+
+// The MySQL headers are only included by db_mysql.cpp, which needs its own compiler flags.
+
+struct st_mysql;
+struct st_mysql_res;
+
+
+class db_mysql : public db_backend
+{
+public:
+    db_mysql() {};
+    ~db_mysql();
+
+    db_mysql(const db_mysql&) = delete;
+    db_mysql& operator=(const db_mysql&) = delete;
+
+    std::string   name          () const;
+    void          connect       (const std::string& host, const std::string& user,
+                                 const std::string& passwd, const std::string& db_name);
+    void          disconnect    ();
+    unsigned int  execute       (const std::string& query, bool buffered, db_query_timing& timing);
+    unsigned long affected_rows ();
+    void          describe      (std::vector<db_col_desc>& cols);
+    bool          fetch_row     (std::vector<std::string>& row, std::vector<bool>& null_fields,
+                                 db_query_timing& timing);
+    void          free_result   ();
+    std::string   escape_str    (const std::string& str);
+
+private:
+    [[noreturn]] void throw_error ();
+
+    st_mysql     *db_connection = nullptr;
+    st_mysql_res *result        = nullptr;    // result set being read, or null
+    unsigned int  num_cols      = 0;          // number of columns in the result set
+};
+
+#endif
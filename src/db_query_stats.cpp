@@ -0,0 +1,652 @@
+///
+/// \class db_query_stats db_query_stats.h
+///
+/// \brief Collects timing statistics for database queries
+///
+/// Every database connection records each of its queries in the shared instance (see
+/// database::set_query_stats()), with the time spent in each phase of the query and the amount
+/// of data returned. The statistics kept are:
+///
+/// - the most recent queries, in a ring buffer,
+/// - for each distinct query fingerprint, the number of queries, the rows and bytes returned,
+///   and a histogram of the query times, and
+/// - the same totals for all of the queries.
+///
+/// A fingerprint is the query with its literal values replaced by '?', so that the queries that
+/// a panel sends with different keys are counted together. Queries that take longer than the
+/// slow-query threshold are passed to a handler, which normally writes them to the log.
+///
+/// All of the member functions may be called from any thread.
+///
+
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+
+#include "db_query_stats.h"
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the mean query time
+///
+/// \return     mean time in milliseconds, or zero if there were no queries
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double db_query_summary::mean_ms() const
+{
+    return (count == 0) ? 0 : total_ms / count;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Estimate a percentile of the query times
+///
+/// The estimate is the upper limit of the histogram bucket that holds the percentile, so it is
+/// at most twice the true value. It is never more than the longest time.
+///
+/// \param[in]  fraction   percentile, as a fraction (for example, 0.95)
+///
+/// \return     time in milliseconds, or zero if there were no queries
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double db_query_summary::percentile_ms(double fraction) const
+{
+    if (count == 0)
+        return 0;
+
+    unsigned long target = (unsigned long)std::ceil(fraction * count);
+    unsigned long sum    = 0;
+
+    for (int i = 0; i < NUM_BUCKETS; i++)
+    {
+        sum += histogram[i];
+        if (sum >= target && sum > 0)
+            return std::min(db_query_stats::bucket_limit(i), max_ms);
+    }
+    return max_ms;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Constructor
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+db_query_stats::db_query_stats()
+{
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the shared instance
+///
+/// New database connections record their queries here.
+///
+/// \return     the shared instance
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+db_query_stats& db_query_stats::shared()
+{
+    static db_query_stats stats;
+    return stats;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Turn the collection of statistics on or off
+///
+/// It is on by default.
+///
+/// \param[in]  enabled   true to collect statistics
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_query_stats::set_enabled(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    is_enabled = enabled;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Check whether statistics are being collected
+///
+/// \return     true if statistics are being collected
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool db_query_stats::enabled() const
+{
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    return is_enabled;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Set the number of recent queries that are kept
+///
+/// The default is 256. The queries already kept are dropped.
+///
+/// \param[in]  num_queries   number of queries
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_query_stats::set_ring_size(size_t num_queries)
+{
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    ring.clear();
+    ring_size = num_queries;
+    ring_next = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Set the maximum number of fingerprints that are counted separately
+///
+/// The default is 2000. Once this many fingerprints have been seen, queries with new
+/// fingerprints are counted under the fingerprint "(other)". This limits the memory used if a
+/// program builds queries that do not reduce to a few fingerprints.
+///
+/// \param[in]  num_fingerprints   number of fingerprints
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_query_stats::set_max_fingerprints(size_t num_fingerprints)
+{
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    max_fingerprints = num_fingerprints;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Set the slow-query threshold
+///
+/// The default is 1000 ms.
+///
+/// \param[in]  ms   queries that take at least this many milliseconds are passed to the
+///                  slow-query handler. Zero or less turns this off.
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_query_stats::set_slow_threshold(double ms)
+{
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    slow_ms = ms;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the slow-query threshold
+///
+/// \return     threshold in milliseconds, or zero or less if it is off
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double db_query_stats::slow_threshold() const
+{
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    return slow_ms;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Set the function that is called for each slow query
+///
+/// The handler is called on the thread that sent the query, without any lock held.
+///
+/// \param[in]  handler   function to call, or an empty function to call nothing
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_query_stats::set_slow_query_handler(std::function<void (const db_query_timing&)> handler)
+{
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    slow_handler = handler;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Record one query
+///
+/// The fingerprint of the query is set if it is empty, the query text is truncated to
+/// MAX_QUERY_LENGTH characters, and the total time and sequence number are set.
+///
+/// \param[in,out]  timing   timing of the query
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_query_stats::record(db_query_timing& timing)
+{
+    if (!enabled())
+        return;
+
+    // The fingerprint is made from the whole query, before it is truncated.
+
+    if (timing.fingerprint.empty())
+        timing.fingerprint = fingerprint(timing.query);
+    if (timing.query.size() > MAX_QUERY_LENGTH)
+        timing.query.replace(MAX_QUERY_LENGTH, std::string::npos, "...");
+
+    timing.total_ms = timing.send_ms + timing.server_ms + timing.fetch_ms + timing.copy_ms;
+
+    std::function<void (const db_query_timing&)> handler;
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+
+        timing.sequence = ++my_num_queries;
+
+        if (ring_size > 0)
+        {
+            if (ring.size() < ring_size)
+                ring.push_back(timing);
+            else
+                ring[ring_next] = timing;
+            ring_next = (ring_next + 1) % ring_size;
+        }
+
+        add_to_summary(all_queries, timing);
+
+        auto it = by_fingerprint.find(timing.fingerprint);
+        if (it == by_fingerprint.end())
+        {
+            std::string key = (by_fingerprint.size() < max_fingerprints) ? timing.fingerprint : "(other)";
+            it = by_fingerprint.emplace(key, db_query_summary()).first;
+            it->second.fingerprint = key;
+        }
+        add_to_summary(it->second, timing);
+
+        if (slow_ms > 0 && timing.total_ms >= slow_ms)
+            handler = slow_handler;
+    }
+
+    if (handler)
+        handler(timing);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Drop all of the statistics
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_query_stats::reset()
+{
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    ring.clear();
+    ring_next      = 0;
+    my_num_queries = 0;
+    all_queries    = db_query_summary();
+    by_fingerprint.clear();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of queries recorded
+///
+/// \return     number of queries since the statistics were reset
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned long db_query_stats::num_queries() const
+{
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    return my_num_queries;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the most recent queries
+///
+/// \param[out] timings   the queries in the ring buffer, oldest first
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_query_stats::recent(std::vector<db_query_timing>& timings) const
+{
+    std::lock_guard<std::mutex> lock(stats_mutex);
+
+    timings.clear();
+    timings.reserve(ring.size());
+
+    // Until the ring is full, ring_next is past the last entry, and the oldest entry is first.
+
+    size_t first = (ring.size() < ring_size) ? 0 : ring_next;
+    for (size_t i = 0; i < ring.size(); i++)
+        timings.push_back(ring[(first + i) % ring.size()]);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the statistics for each fingerprint
+///
+/// \param[out] summaries   one entry per fingerprint, in decreasing order of total time
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_query_stats::summary(std::vector<db_query_summary>& summaries) const
+{
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+
+        summaries.clear();
+        summaries.reserve(by_fingerprint.size());
+        for (const auto& entry : by_fingerprint)
+            summaries.push_back(entry.second);
+    }
+
+    std::sort(summaries.begin(), summaries.end(),
+              [] (const db_query_summary& a, const db_query_summary& b) { return a.total_ms > b.total_ms; });
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the statistics for all of the queries together
+///
+/// \return     statistics, with an empty fingerprint
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+db_query_summary db_query_stats::totals() const
+{
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    return all_queries;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Format the statistics as text
+///
+/// \param[in]  max_fingerprints   maximum number of fingerprints to list, starting with the one
+///                                with the largest total time
+///
+/// \return     report, one line per fingerprint after a line with the totals
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string db_query_stats::report(size_t max_fingerprints) const
+{
+    std::vector<db_query_summary> summaries;
+    summary(summaries);
+    db_query_summary all = totals();
+
+    char        line[200];
+    std::string text;
+
+    snprintf(line, sizeof(line), "%lu queries, %.1f ms total, mean %.2f ms, p95 %.2f ms, max %.2f ms, "
+             "%lu rows, %lu bytes, %lu errors\n", all.count, all.total_ms, all.mean_ms(),
+             all.percentile_ms(0.95), all.max_ms, all.rows, all.bytes, all.errors);
+    text += line;
+
+    for (size_t i = 0; i < summaries.size() && i < max_fingerprints; i++)
+    {
+        const db_query_summary& s = summaries[i];
+        snprintf(line, sizeof(line), "%8lu %10.1f ms  mean %8.2f  p95 %8.2f  max %8.2f  rows %8lu  ",
+                 s.count, s.total_ms, s.mean_ms(), s.percentile_ms(0.95), s.max_ms, s.rows);
+        text += line;
+        text += s.fingerprint.substr(0, 200);
+        text += "\n";
+    }
+    return text;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Make the fingerprint of a query
+///
+/// String and numeric literals are replaced with '?', white space is collapsed (and removed
+/// next to commas and parentheses), and words are converted to lower case (quoted identifiers
+/// are kept as they are). A list of literals, as in `IN (1, 2, 3)`, becomes `(?+)`, and repeated
+/// row lists, as in a multi-row INSERT, are reduced to one.
+///
+/// \param[in]  query   SQL statement
+///
+/// \return     fingerprint
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string db_query_stats::fingerprint(const std::string& query)
+{
+    std::string out;
+    size_t      n = query.size();
+    size_t      i = 0;
+
+    // Add a literal, merging it with any literals before it in the same list.
+
+    auto add_literal = [&out] ()
+    {
+        size_t end = out.find_last_not_of(' ');
+        if (end != std::string::npos && out[end] == ',')
+        {
+            size_t prev = out.find_last_not_of(' ', end - 1);
+            if (prev != std::string::npos && out[prev] == '?')
+            {
+                out.erase(prev + 1);
+                out += '+';
+                return;
+            }
+            if (prev != std::string::npos && prev > 0 && out[prev] == '+' && out[prev - 1] == '?')
+            {
+                out.erase(prev + 1);
+                return;
+            }
+        }
+        out += '?';
+    };
+
+    // Drop a parenthesized list that repeats the list before it.
+
+    auto close_list = [&out] ()
+    {
+        size_t open = out.rfind('(');
+        if (open == std::string::npos)
+            return;
+
+        std::string group = out.substr(open);
+        size_t comma = out.find_last_not_of(' ', open == 0 ? 0 : open - 1);
+        if (open == 0 || comma == std::string::npos || out[comma] != ',')
+            return;
+        size_t prev_end = out.find_last_not_of(' ', comma == 0 ? 0 : comma - 1);
+        if (prev_end == std::string::npos || prev_end + 1 < group.size())
+            return;
+        if (out.compare(prev_end + 1 - group.size(), group.size(), group) == 0)
+            out.erase(comma);
+    };
+
+    while (i < n)
+    {
+        unsigned char c = query[i];
+
+        if (std::isspace(c))
+        {
+            // Keep one space, except next to commas and parentheses, so that "(1, 2)" and
+            // "( 1,2 )" give the same fingerprint.
+
+            while (i < n && std::isspace((unsigned char)query[i]))
+                i++;
+            if (!out.empty() && out.back() != '(' && out.back() != ',' &&
+                i < n && query[i] != ',' && query[i] != ')')
+                out += ' ';
+        }
+        else if (c == '\'' || c == '"')
+        {
+            // Skip a string literal, allowing for backslash escapes and doubled quotes.
+
+            i++;
+            while (i < n)
+            {
+                if (query[i] == '\\')
+                    i += 2;
+                else if (query[i] == (char)c && i + 1 < n && query[i + 1] == (char)c)
+                    i += 2;
+                else if (query[i] == (char)c)
+                    break;
+                else
+                    i++;
+            }
+            i++;
+            add_literal();
+        }
+        else if (c == '`')
+        {
+            size_t end = query.find('`', i + 1);
+            if (end == std::string::npos)
+                end = n - 1;
+            out.append(query, i, end - i + 1);
+            i = end + 1;
+        }
+        else if (std::isalnum(c) || c == '_' || c == '$')
+        {
+            // A word that is all digits (and decimal points) is a number. Anything else, even if
+            // it starts with digits (like 1871_census_data), is a name or keyword.
+
+            size_t start = i;
+            bool   number = true;
+            while (i < n && (std::isalnum((unsigned char)query[i]) || query[i] == '_' || query[i] == '$' ||
+                             (number && query[i] == '.')))
+            {
+                // Allow an exponent, as in 1.5e-3.
+
+                if (number && (query[i] == 'e' || query[i] == 'E') && i > start && i + 1 < n &&
+                    (std::isdigit((unsigned char)query[i + 1]) ||
+                     ((query[i + 1] == '-' || query[i + 1] == '+') && i + 2 < n &&
+                      std::isdigit((unsigned char)query[i + 2]))))
+                {
+                    i += 2;
+                    continue;
+                }
+                if (!std::isdigit((unsigned char)query[i]) && query[i] != '.')
+                    number = false;
+                i++;
+            }
+            if (number)
+            {
+                add_literal();
+            }
+            else
+            {
+                for (size_t j = start; j < i; j++)
+                    out += (char)std::tolower((unsigned char)query[j]);
+            }
+        }
+        else
+        {
+            out += (char)c;
+            i++;
+            if (c == ')')
+                close_list();
+        }
+    }
+
+    size_t end = out.find_last_not_of(' ');
+    out.erase(end == std::string::npos ? 0 : end + 1);
+    return out;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Find the histogram bucket for a query time
+///
+/// Bucket 0 holds times under 1 microsecond, and bucket i (for i > 0) holds times from 2^(i-1)
+/// up to 2^i microseconds. The last bucket also holds all longer times.
+///
+/// \param[in]  ms   time in milliseconds
+///
+/// \return     bucket number
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int db_query_stats::bucket(double ms)
+{
+    double us = ms * 1000.0;
+    int    b  = 0;
+
+    while (us >= 1.0 && b < db_query_summary::NUM_BUCKETS - 1)
+    {
+        us /= 2.0;
+        b++;
+    }
+    return b;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the upper limit of a histogram bucket
+///
+/// \param[in]  bucket_num   bucket number
+///
+/// \return     upper limit in milliseconds
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double db_query_stats::bucket_limit(int bucket_num)
+{
+    return std::ldexp(1.0, bucket_num) / 1000.0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Add one query to a summary.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_query_stats::add_to_summary(db_query_summary& summary, const db_query_timing& timing)
+{
+    summary.count++;
+    if (timing.error)
+        summary.errors++;
+    summary.total_ms  += timing.total_ms;
+    summary.server_ms += timing.server_ms;
+    summary.max_ms     = std::max(summary.max_ms, timing.total_ms);
+    summary.rows      += timing.rows;
+    summary.bytes     += timing.bytes;
+    summary.histogram[bucket(timing.total_ms)]++;
+}
@@ -0,0 +1,116 @@
+///
+/// \file
+///
+
+#ifndef DB_QUERY_STATS_H
+#define DB_QUERY_STATS_H
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+///
+/// \brief Timing of one database query
+///
+/// The time spent on a query is split into phases. For queries read with a db_row_stream, the
+/// fetch and copy times are summed over all of the rows, and the query is recorded when the
+/// stream is closed.
+///
+
+class db_query_timing
+{
+public:
+    std::string    query;              ///< SQL statement (long statements are truncated)
+    std::string    fingerprint;        ///< normalized statement (see db_query_stats::fingerprint)
+    unsigned long  sequence  = 0;      ///< number of the query since the statistics were reset
+    double         send_ms   = 0;      ///< time to send the statement to the server
+    double         server_ms = 0;      ///< time waiting for the server to execute it and reply
+    double         fetch_ms  = 0;      ///< time to transfer the result set from the server
+    double         copy_ms   = 0;      ///< time to copy the result set into the caller's structures
+    double         total_ms  = 0;      ///< sum of the above
+    unsigned long  rows      = 0;      ///< rows returned (or affected, for statements without results)
+    unsigned long  bytes     = 0;      ///< bytes of data returned
+    bool           error     = false;  ///< true if the server reported an error
+};
+
+
+
+///
+/// \brief Statistics for all of the queries with the same fingerprint
+///
+
+class db_query_summary
+{
+public:
+    static const int NUM_BUCKETS = 32;                ///< number of latency histogram buckets
+
+    std::string    fingerprint;                       ///< normalized statement
+    unsigned long  count     = 0;                     ///< number of queries
+    unsigned long  errors    = 0;                     ///< number of queries that failed
+    double         total_ms  = 0;                     ///< total time
+    double         max_ms    = 0;                     ///< longest time
+    double         server_ms = 0;                     ///< total time waiting for the server
+    unsigned long  rows      = 0;                     ///< total rows returned or affected
+    unsigned long  bytes     = 0;                     ///< total bytes returned
+    unsigned long  histogram[NUM_BUCKETS] = {};       ///< latency histogram (see db_query_stats::bucket)
+
+    double  mean_ms       () const;
+    double  percentile_ms (double fraction) const;
+};
+
+
+
+class db_query_stats
+{
+public:
+    db_query_stats ();
+
+    static db_query_stats& shared ();
+
+    void     set_enabled            (bool enabled);
+    bool     enabled                () const;
+    void     set_ring_size          (size_t num_queries);
+    void     set_max_fingerprints   (size_t num_fingerprints);
+    void     set_slow_threshold     (double ms);
+    double   slow_threshold         () const;
+    void     set_slow_query_handler (std::function<void (const db_query_timing&)> handler);
+
+    void     record   (db_query_timing& timing);
+    void     reset    ();
+
+    unsigned long num_queries () const;
+    void     recent   (std::vector<db_query_timing>& timings) const;
+    void     summary  (std::vector<db_query_summary>& summaries) const;
+    db_query_summary totals () const;
+    std::string report (size_t max_fingerprints = 20) const;
+
+    static std::string fingerprint  (const std::string& query);
+    static int         bucket       (double ms);
+    static double      bucket_limit (int bucket_num);
+
+    static const size_t MAX_QUERY_LENGTH = 1000;
+
+private:
+    mutable std::mutex                                 stats_mutex;
+    bool                                               is_enabled       = true;
+    double                                             slow_ms          = 1000;
+    size_t                                             max_fingerprints = 2000;
+    std::function<void (const db_query_timing&)>       slow_handler;
+
+    // The most recent queries. ring_next is the slot that will be written next.
+
+    std::vector<db_query_timing>                       ring;
+    size_t                                             ring_size        = 256;
+    size_t                                             ring_next        = 0;
+
+    unsigned long                                      my_num_queries   = 0;
+    db_query_summary                                   all_queries;
+    std::unordered_map<std::string, db_query_summary>  by_fingerprint;
+
+    static void add_to_summary (db_query_summary& summary, const db_query_timing& timing);
+};
+
+#endif
@@ -6,10 +6,33 @@
 /// metadata needed to use those data. All of the data and metadata held in this class were
 /// obtained from the database server and cannot be changed.
 ///
+/// Columns that repeat a few values in many rows, such as county, sex or marital status, can be
+/// dictionary encoded when the row set is loaded (see `set_dict_encoding()`). Each distinct value
+/// is then held once, with a 16- or 32-bit code for each row, and filters and groupings can
+/// compare the codes instead of the strings.
+///
 
 
 #include <stdexcept>
+#include <unordered_map>
 #include "db_row_set.h"
+#include "database.h"
+#include "db_snapshot.h"
+
+
+// Get the number of bytes a string has allocated outside of the string object. Short strings
+// are held inside the object, and allocate nothing.
+
+static size_t string_heap_size(const std::string& str)
+{
+	const char* data = str.data();
+	const char* self = reinterpret_cast<const char*>(&str);
+
+	if (data >= self && data < self + sizeof(std::string))
+		return 0;
+	else
+		return str.capacity() + 1;
+}
 
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -81,16 +104,29 @@ bool db_row_set::get_data(unsigned int row, unsigned int col, std::string& data)
 	if ((row >= my_num_rows) || (col >= my_num_cols))
 		throw std::logic_error("Row or column number out of range in db_row_set::get_data");
 
+	if (my_snapshot)
+		return my_snapshot->get_data(row, col, data);
+
 	if (null_fields[row][col])
 	{
 		data.clear();
 		return false;
 	}
-	else
+	else if (field_index.empty())
 	{
 		data = result_set[row][col];
 		return true;
 	}
+	else if (field_index[col] >= 0)
+	{
+		data = result_set[row][field_index[col]];
+		return true;
+	}
+	else
+	{
+		data = dict_columns[col].values[get_code(row, col)];
+		return true;
+	}
 }
 
 
@@ -118,6 +154,51 @@ db_col_desc const * db_row_set::col_desc(unsigned col) const
 
 
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Estimate the memory held by the row set
+///
+/// The estimate counts the data, the null flags and the column descriptors, including the space
+/// allocated for each string. It does not count the overhead of the memory allocator, or the
+/// pages of a snapshot, which are mapped from the file and shared with other processes.
+///
+/// \return     approximate number of bytes
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t db_row_set::memory_used() const
+{
+	size_t bytes = sizeof(*this) + col_desc_list.capacity() * sizeof(db_col_desc);
+
+	for (const db_col_desc& desc : col_desc_list)
+		bytes += string_heap_size(desc.my_name) + string_heap_size(desc.my_name_in_db) + string_heap_size(desc.my_table);
+
+	bytes += null_fields.capacity() * sizeof(std::vector<bool>);
+	for (const std::vector<bool>& row : null_fields)
+		bytes += row.capacity() / 8;
+
+	bytes += result_set.capacity() * sizeof(std::vector<std::string>);
+	for (const std::vector<std::string>& row : result_set)
+	{
+		bytes += row.capacity() * sizeof(std::string);
+		for (const std::string& field : row)
+			bytes += string_heap_size(field);
+	}
+
+	bytes += field_index.capacity() * sizeof(int) + dict_columns.capacity() * sizeof(dict_column);
+	for (const dict_column& dict : dict_columns)
+	{
+		bytes += dict.values.capacity() * sizeof(std::string);
+		for (const std::string& value : dict.values)
+			bytes += string_heap_size(value);
+		bytes += dict.codes_16.capacity() * sizeof(uint16_t) + dict.codes_32.capacity() * sizeof(uint32_t);
+	}
+
+	return bytes;
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 ///
 /// \brief Clear the row_set
@@ -142,4 +223,628 @@ void db_row_set::clear()
 	// Clear the data.
 
 	result_set.clear();
+	my_snapshot.reset();
+
+	// Clear the dictionaries.
+
+	field_index.clear();
+	dict_columns.clear();
+	num_plain_cols = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Load the row set from a snapshot
+///
+/// The row set replaces its data and column descriptors with those of the snapshot. The fields
+/// are read from the snapshot file as they are needed, so loading takes the same time for any
+/// number of rows. The snapshot stays open while the row set uses it.
+///
+/// A snapshot is not linked to the database tables it was taken from, so its rows are read-only.
+/// A `db_row_set_w` loaded from a snapshot locks all of its columns and refuses every write.
+///
+/// \param[in]  snapshot   snapshot opened with `db_snapshot::open()`
+///
+/// \exception std::logic_error thrown if the snapshot is null
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_row_set::load_snapshot(std::shared_ptr<const db_snapshot> snapshot)
+{
+	if (!snapshot)
+		throw std::logic_error("Null snapshot in db_row_set::load_snapshot");
+
+	clear();
+	setup_child_phase_1();
+
+	my_num_rows   = snapshot->num_rows();
+	my_num_cols   = snapshot->num_cols();
+	for (unsigned int col = 0; col < my_num_cols; col++)
+		col_desc_list.push_back(*snapshot->col_desc(col));
+	my_snapshot   = snapshot;
+
+	setup_child_phase_2();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Check if the row set was loaded from a snapshot
+///
+/// \return true if the data is read from a snapshot, false if it is the result of a query
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool db_row_set::is_snapshot() const
+{
+	return my_snapshot != nullptr;
+}
+
+
+
+///
+/// \class db_row_stream db_row_set.h
+/// \brief Reads the result of a database query one row at a time.
+///
+/// A `db_row_set` holds the entire result set in memory, which is not practical when a query
+/// returns every record in a large source. This class is opened with `database::execute()`, and
+/// only holds the current row. The rows are sent by the database server as they are read,
+/// so the memory used does not depend on the number of rows.
+///
+/// While a stream is open, no other query can be sent on the same database connection. Read to
+/// the end of the result set, or call `close()`, before using the connection again. Use another
+/// connection (see `database::connect()`) to run queries while the rows are being read.
+///
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Destructor
+///
+/// Any rows that have not been read are discarded.
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+db_row_stream::~db_row_stream()
+{
+	close();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of columns in the result set.
+///
+/// \return number of columns
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int db_row_stream::num_cols() const
+{
+	return my_num_cols;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of rows read so far.
+///
+/// \return number of rows, including the current row
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned long db_row_stream::row_num() const
+{
+	return my_row_num;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get column name
+///
+/// \param[in]  col   column number
+///
+/// \return name of the column
+///
+/// \exception std::out_of_range thrown if the column number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string db_row_stream::col_name(unsigned int col) const
+{
+	if (col < my_num_cols)
+		return col_desc_list[col].name();
+	else
+		throw std::out_of_range("Bad column number in db_row_stream::col_name");
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get column descriptor
+///
+/// \param[in]  col   column number
+///
+/// \return pointer to the column descriptor
+///
+/// \exception std::out_of_range thrown if the column number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+db_col_desc const * db_row_stream::col_desc(unsigned int col) const
+{
+	if (col < my_num_cols)
+		return &col_desc_list[col];
+	else
+		throw std::out_of_range("Bad column number in db_row_stream::col_desc");
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Read the next row
+///
+/// The stream is closed when the end of the result set is reached.
+///
+/// \return     True if a row was read. False if there are no more rows.
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool db_row_stream::next_row()
+{
+	if (my_db == nullptr)
+	{
+		row_data.clear();
+		return false;
+	}
+
+	return my_db->fetch_row(*this);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the contents of one data field in the current row
+///
+/// \param[in]  col   column number
+/// \param[out] data  contents of the data field
+///
+/// \return     True if the data field was set. False if the data field was null (empty).
+///
+/// \exception std::logic_error thrown if there is no current row, or the column number is out
+///                             of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool db_row_stream::get_data(unsigned int col, std::string& data) const
+{
+	if (row_data.empty())
+		throw std::logic_error("No current row in db_row_stream::get_data");
+	if (col >= my_num_cols)
+		throw std::logic_error("Column number out of range in db_row_stream::get_data");
+
+	if (null_fields[col])
+	{
+		data.clear();
+		return false;
+	}
+	else
+	{
+		data = row_data[col];
+		return true;
+	}
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Determine if there may be more rows to read.
+///
+/// \return True if the stream is open
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool db_row_stream::is_open() const
+{
+	return my_db != nullptr;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Close the stream
+///
+/// Any rows that have not been read are discarded, and the database connection can be used
+/// for other queries again. The column descriptions are kept.
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_row_stream::close()
+{
+	if (my_db != nullptr)
+		my_db->close_stream(*this);
+
+	row_data.clear();
+	null_fields.clear();
+}
+
+
+
+//**************************************************************************************************
+// Dictionary encoding
+//**************************************************************************************************
+
+// A column is dictionary encoded if it has at most one distinct value for this many rows, so that
+// each value is repeated several times on average. Smaller row sets are not encoded, and the
+// columns to encode are chosen on the first MIN_DICT_ROWS rows of larger ones.
+
+static const unsigned int ROWS_PER_DICT_VALUE = 4;
+static const unsigned int MIN_DICT_ROWS       = 64;
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Turn dictionary encoding on or off
+///
+/// If dictionary encoding is on, then each column with few distinct values is dictionary encoded
+/// when the row set is next loaded from the database. The setting is kept when the row set is
+/// cleared or loaded again. Row sets loaded from a snapshot are not encoded.
+///
+/// \param[in]  enable   true to encode columns, false to store each field as a string
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_row_set::set_dict_encoding(bool enable)
+{
+	dict_encoding = enable;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Determine if a column is dictionary encoded
+///
+/// \param[in]  col   column number
+///
+/// \return     True if the column holds a code for each row, and a list of the distinct values
+///
+/// \exception std::out_of_range thrown if the column number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool db_row_set::is_dict_encoded(unsigned int col) const
+{
+	if (col >= my_num_cols)
+		throw std::out_of_range("Bad column number in db_row_set::is_dict_encoded");
+
+	return !field_index.empty() && field_index[col] < 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of distinct values in a dictionary-encoded column
+///
+/// \param[in]  col   column number
+///
+/// \return     number of distinct values, not counting NULL, or zero if the column is not
+///             dictionary encoded
+///
+/// \exception std::out_of_range thrown if the column number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int db_row_set::dict_size(unsigned int col) const
+{
+	return is_dict_encoded(col) ? dict_columns[col].values.size() : 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get one of the distinct values of a dictionary-encoded column
+///
+/// \param[in]  col    column number
+/// \param[in]  code   code of the value, less than `dict_size(col)`
+///
+/// \return     the value
+///
+/// \exception std::out_of_range thrown if the column number or the code is out of range, or the
+///                              column is not dictionary encoded
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string const & db_row_set::dict_value(unsigned int col, unsigned int code) const
+{
+	if (code >= dict_size(col))
+		throw std::out_of_range("Bad code in db_row_set::dict_value");
+
+	return dict_columns[col].values[code];
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the code of one data field in a dictionary-encoded column
+///
+/// Two fields of the same column have the same code if and only if they have the same value, so
+/// the codes can be compared instead of the values. NULL fields have the code `dict_size(col)`,
+/// one more than the code of the last value.
+///
+/// \param[in]  row   row number
+/// \param[in]  col   column number
+///
+/// \return     code of the data field
+///
+/// \exception std::logic_error thrown if the row or column number is out of range, or the column
+///                             is not dictionary encoded
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int db_row_set::get_code(unsigned int row, unsigned int col) const
+{
+	if ((row >= my_num_rows) || !is_dict_encoded(col))
+		throw std::logic_error("Row out of range or column not encoded in db_row_set::get_code");
+
+	const dict_column& dict = dict_columns[col];
+
+	if (null_fields[row][col])
+		return dict.values.size();
+	else if (!dict.codes_16.empty())
+		return dict.codes_16[row];
+	else
+		return dict.codes_32[row];
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Find the code of a value in a dictionary-encoded column
+///
+/// \param[in]  col     column number
+/// \param[in]  value   value to look for
+/// \param[out] code    code of the value, if it was found
+///
+/// \return     True if the value is in the column. False if no row has the value, or the column is
+///             not dictionary encoded.
+///
+/// \exception std::out_of_range thrown if the column number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool db_row_set::find_code(unsigned int col, const std::string& value, unsigned int& code) const
+{
+	if (!is_dict_encoded(col))
+		return false;
+
+	const std::vector<std::string>& values = dict_columns[col].values;
+	for (unsigned int i = 0; i < values.size(); i++)
+	{
+		if (values[i] == value)
+		{
+			code = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+
+// This private member function is called by database::execute for each row that is read, if
+// dictionary encoding is on. The fields are taken from row and null_row, which are left for the
+// next row to be read into.
+//
+// The first MIN_DICT_ROWS rows are stored as they are, and then the columns with few enough distinct
+// values are encoded. From then on, the fields of the encoded columns are looked up in the
+// dictionaries as they arrive, so only one copy of each distinct value is ever held. A column
+// that gets too many distinct values is decoded back into the rows.
+
+void db_row_set::encode_row(std::vector<std::string>& row, std::vector<bool>& null_row)
+{
+	null_fields.emplace_back();
+	null_fields.back().swap(null_row);
+
+	if (field_index.empty())
+	{
+		result_set.emplace_back();
+		result_set.back().swap(row);
+
+		if (result_set.size() == MIN_DICT_ROWS)
+			encode_columns();
+		return;
+	}
+
+	const std::vector<bool>& nulls = null_fields.back();
+
+	result_set.emplace_back(num_plain_cols);
+	std::vector<std::string>& fields = result_set.back();
+
+	unsigned int num_rows   = result_set.size();
+	unsigned int max_values = num_rows / ROWS_PER_DICT_VALUE;
+
+	for (unsigned int col = 0; col < my_num_cols; col++)
+	{
+		if (field_index[col] >= 0)
+		{
+			fields[field_index[col]].swap(row[col]);
+			continue;
+		}
+
+		dict_column& dict = dict_columns[col];
+		uint32_t     code = 0;
+
+		if (!nulls[col])
+		{
+			auto found = dict.lookup.find(row[col]);
+			if (found != dict.lookup.end())
+				code = found->second;
+			else
+			{
+				code = dict.values.size();
+				dict.lookup.emplace(row[col], code);
+				dict.values.push_back(row[col]);
+			}
+		}
+		dict.codes_32.push_back(code);
+
+		if (dict.values.size() > max_values)
+			decode_column(col);
+	}
+}
+
+
+
+// This private member function encodes the columns of the rows that were stored before encoding
+// started. The fields of the encoded columns are removed from the rows of result_set, and
+// field_index gives the position of the other columns in the shortened rows.
+
+void db_row_set::encode_columns()
+{
+	dict_columns.resize(my_num_cols);
+	field_index.resize(my_num_cols);
+	num_plain_cols = 0;
+
+	for (unsigned int col = 0; col < my_num_cols; col++)
+	{
+		if (encode_column(col))
+			field_index[col] = -1;
+		else
+			field_index[col] = num_plain_cols++;
+	}
+
+	for (std::vector<std::string>& row : result_set)
+	{
+		std::vector<std::string> fields(num_plain_cols);
+		for (unsigned int col = 0; col < my_num_cols; col++)
+		{
+			if (field_index[col] >= 0)
+				fields[field_index[col]].swap(row[col]);
+		}
+		row.swap(fields);
+	}
+}
+
+
+
+// This private member function builds the dictionary of one column of the stored rows, if the
+// column has few enough distinct values. It returns true if the column was encoded.
+
+bool db_row_set::encode_column(unsigned int col)
+{
+	unsigned int num_rows   = result_set.size();
+	unsigned int max_values = num_rows / ROWS_PER_DICT_VALUE;
+	dict_column& dict       = dict_columns[col];
+
+	for (unsigned int row = 0; row < num_rows; row++)
+	{
+		uint32_t code = 0;
+
+		if (!null_fields[row][col])
+		{
+			const std::string& value = result_set[row][col];
+			auto               found = dict.lookup.find(value);
+			if (found != dict.lookup.end())
+				code = found->second;
+			else if (dict.values.size() < max_values)
+			{
+				code = dict.values.size();
+				dict.lookup.emplace(value, code);
+				dict.values.push_back(value);
+			}
+			else
+			{
+				dict = dict_column();
+				return false;
+			}
+		}
+		dict.codes_32.push_back(code);
+	}
+
+	return true;
+}
+
+
+
+// This private member function stores the fields of an encoded column in the rows again, after
+// the last plain field of each row, and drops the dictionary.
+
+void db_row_set::decode_column(unsigned int col)
+{
+	dict_column& dict = dict_columns[col];
+
+	for (size_t row = 0; row < result_set.size(); row++)
+	{
+		if (null_fields[row][col])
+			result_set[row].emplace_back();
+		else
+			result_set[row].push_back(dict.values[dict.codes_32[row]]);
+	}
+
+	dict = dict_column();
+	field_index[col] = num_plain_cols++;
+}
+
+
+
+// This private member function is called by database::execute after the last row, if dictionary
+// encoding is on. Columns with too many distinct values for the final number of rows are decoded,
+// and the codes of the others are packed into 16 bits if they fit.
+
+void db_row_set::end_encoding()
+{
+	if (field_index.empty())
+		return;
+
+	unsigned int max_values = result_set.size() / ROWS_PER_DICT_VALUE;
+	bool         any_dict   = false;
+
+	for (unsigned int col = 0; col < my_num_cols; col++)
+	{
+		if (field_index[col] >= 0)
+			continue;
+
+		dict_column& dict = dict_columns[col];
+		if (dict.values.size() > max_values)
+		{
+			decode_column(col);
+			continue;
+		}
+
+		std::unordered_map<std::string, uint32_t>().swap(dict.lookup);
+		if (dict.values.size() <= 0x10000)
+		{
+			dict.codes_16.assign(dict.codes_32.begin(), dict.codes_32.end());
+			std::vector<uint32_t>().swap(dict.codes_32);
+		}
+		else
+			dict.codes_32.shrink_to_fit();
+		any_dict = true;
+	}
+
+	// The rows keep their field order, so field_index is still needed when no column is encoded.
+
+	if (!any_dict)
+		dict_columns.clear();
 }
@@ -6,9 +6,15 @@
 #ifndef DB_ROW_SET_H
 #define DB_ROW_SET_H
 
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+class database;
+class db_snapshot;
+
 ///
 /// \brief Data types
 ///
@@ -84,6 +90,10 @@ private:
 	bool         my_auto_inc = false;
 
 	friend class database;
+	friend class db_backend;
+	friend class db_row_set;
+	friend class db_snapshot;
+	friend class gendat_bench;
 };
 
 
@@ -91,12 +101,24 @@ private:
 class db_row_set
 {
 	friend class database;
+	friend class gendat_bench;
 
 public:
 	unsigned int  num_rows () const;
 	unsigned int  num_cols () const;
 	std::string   col_name (unsigned int col) const;
 	bool          get_data (unsigned int row, unsigned int col, std::string& data) const;
+	size_t        memory_used () const;
+	void          load_snapshot (std::shared_ptr<const db_snapshot> snapshot);
+	bool          is_snapshot () const;
+
+	void          set_dict_encoding (bool enable);
+	bool          is_dict_encoded (unsigned int col) const;
+	unsigned int  dict_size  (unsigned int col) const;
+	unsigned int  get_code   (unsigned int row, unsigned int col) const;
+	bool          find_code  (unsigned int col, const std::string& value, unsigned int& code) const;
+
+	std::string const & dict_value (unsigned int col, unsigned int code) const;
 
 	db_col_desc const * col_desc(unsigned int col) const;
 
@@ -105,6 +127,24 @@ private:
 	virtual void setup_child_phase_2() {};
 
 	void clear();
+	void encode_row(std::vector<std::string>& row, std::vector<bool>& null_row);
+	void encode_columns();
+	bool encode_column(unsigned int col);
+	void decode_column(unsigned int col);
+	void end_encoding();
+
+	// Distinct values of a dictionary-encoded column, and the code of each row. The codes are
+	// held in 16 bits if there are few enough values, or else in 32 bits. While the rows are
+	// being loaded, the codes are in 32 bits and lookup gives the code of each value.
+
+	struct dict_column
+	{
+		std::vector <std::string> values;
+		std::vector <uint16_t>    codes_16;
+		std::vector <uint32_t>    codes_32;
+
+		std::unordered_map <std::string, uint32_t> lookup;
+	};
 
 	unsigned int              my_num_cols = 0;            // Number of columns in this row set
 	unsigned int              my_num_rows = 0;            // Number of rows in this row set
@@ -112,6 +152,46 @@ private:
 
 	std::vector <std::vector <bool>>        null_fields;  // True if the data field is NULL
 	std::vector <std::vector <std::string>> result_set;   // Result set from database query
+
+	std::shared_ptr<const db_snapshot>      my_snapshot;  // Snapshot that holds the data, or null
+
+	bool                      dict_encoding = false;      // True if columns are encoded when loaded
+	std::vector <int>         field_index;                // Index of each column in the rows of result_set, or -1
+	                                                      // if it is dictionary encoded (empty if none are)
+	std::vector <dict_column> dict_columns;               // Dictionary of each column (empty if not encoded)
+	unsigned int              num_plain_cols = 0;         // Number of fields in each row of result_set, while encoding
+};
+
+
+
+class db_row_stream
+{
+	friend class database;
+
+public:
+	db_row_stream() {};
+	~db_row_stream();
+
+	db_row_stream(const db_row_stream&) = delete;
+	db_row_stream& operator=(const db_row_stream&) = delete;
+
+	unsigned int  num_cols () const;
+	unsigned long row_num  () const;
+	std::string   col_name (unsigned int col) const;
+	bool          next_row ();
+	bool          get_data (unsigned int col, std::string& data) const;
+	bool          is_open  () const;
+	void          close    ();
+
+	db_col_desc const * col_desc(unsigned int col) const;
+
+private:
+	database                 *my_db       = nullptr;    // Connection the rows are read from, or null if closed
+	unsigned int              my_num_cols = 0;          // Number of columns in the result set
+	unsigned long             my_row_num  = 0;          // Number of rows read so far
+	std::vector <db_col_desc> col_desc_list;            // List of column descriptors
+	std::vector <bool>        null_fields;              // True if the data field in the current row is NULL
+	std::vector <std::string> row_data;                 // Current row
 };
 
 #endif
@@ -12,6 +12,8 @@
 #include <vector>
 #include <map>
 #include "db_row_set_w.h"
+#include "gde_change_tracker.h"
+#include "gde_trace.h"
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -373,6 +375,8 @@ bool db_row_set_w::delete_row(unsigned int row, std::string& error_msg)
 
 void db_row_set_w::write_to_db(database& db)
 {
+    gde_trace_span span("db_row_set_w::write_to_db", "sql");
+
     for (auto i = altered_rows.begin(); i != altered_rows.end(); i++)
     {
         switch (i->second.row_state)
@@ -422,6 +426,21 @@ void db_row_set_w::set_null_subst_off()
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of rows with changes not yet written to the database
+///
+/// \return number of rows that write_to_db() would update, insert or delete
+///
+////////////////////////////////////////////////////////////////////////////////
+
+unsigned int db_row_set_w::num_pending_writes() const
+{
+    return altered_rows.size();
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////////////
 ///
 /// \brief Initialize, phase 1
@@ -453,6 +472,7 @@ void db_row_set_w::setup_child_phase_1()
     // be writable.
 
     row_set_is_writable = false;
+    row_ins_del_allowed = false;
 }
 
 
@@ -467,12 +487,22 @@ void db_row_set_w::setup_child_phase_1()
 /// the base class.
 ///
 /// If the database query returned a non-empty row set, then initialize the
-/// data structures.
+/// data structures. A row set loaded from a snapshot has no link to the
+/// database, so all of its columns are permanently locked.
 ///
 ////////////////////////////////////////////////////////////////////////////////
 
 void db_row_set_w::setup_child_phase_2()
 {
+    if (is_snapshot())
+    {
+        // The column descriptors of a snapshot still name the tables and
+        // primary keys, but there is no way to write the changes back.
+
+        col_locks.assign(num_cols(), DB_LOCKED_PERM);
+        return;
+    }
+
     if ((num_rows() > 0) & (num_cols() > 0))
     {
         // Resize the list of column locks, with default state unlocked.
@@ -633,6 +663,9 @@ void db_row_set_w::update_altered_row(unsigned int row, row_map_element *p_alt_r
 
             if (altered_fields)
             {
+                std::vector<std::pair<std::string, std::string>> old_key_cols;
+                std::vector<std::pair<std::string, std::string>> new_key_cols;
+
                 for (unsigned int j = 0; j < p_table->keys.size(); j++)
                 {
                     unsigned int col = p_table->keys[j];
@@ -640,6 +673,14 @@ void db_row_set_w::update_altered_row(unsigned int row, row_map_element *p_alt_r
                     std::string key;
                     db_row_set::get_data(row, col, key);
 
+                    // Keep the old and new values of the whole key for the change journal.
+
+                    old_key_cols.emplace_back(col_desc(col)->name_in_db(), key);
+                    if (p_alt_row->field_needs_update[col])
+                        new_key_cols.emplace_back(col_desc(col)->name_in_db(), p_alt_row->field_value[col]);
+                    else
+                        new_key_cols.emplace_back(col_desc(col)->name_in_db(), key);
+
                     // Add this column in the primary key to the query.
 
                     if (j == 0)
@@ -653,9 +694,42 @@ void db_row_set_w::update_altered_row(unsigned int row, row_map_element *p_alt_r
                     query += col_desc(col)->name_in_db() + " = \'" + db.escape_str(key) + "\'";
                 }
 
-                // Execute the query.
+                // Execute the query. If the connection has a change journal, then the change is
+                // recorded in the same transaction, so that an edit is never saved without its
+                // journal entry. If the primary key itself was changed, then both the old and new
+                // keys are recorded.
+
+                unsigned int affected_rows;
 
-                unsigned int affected_rows = db.execute(query);
+                if (db.change_journal().empty())
+                {
+                    affected_rows = db.execute(query);
+                }
+                else
+                {
+                    std::string old_rec_key = gde_change_tracker::compound_key(old_key_cols);
+                    std::string new_rec_key = gde_change_tracker::compound_key(new_key_cols);
+
+                    db.execute("START TRANSACTION");
+                    try
+                    {
+                        affected_rows = db.execute(query);
+                        if (affected_rows)
+                        {
+                            query = "INSERT INTO " + db.change_journal() + " (table_name, rec_key, operation) VALUES "
+                                    "(\'" + db.escape_str(p_table->name) + "\', \'" + db.escape_str(old_rec_key) + "\', \'U\')";
+                            if (new_rec_key != old_rec_key)
+                                query += ", (\'" + db.escape_str(p_table->name) + "\', \'" + db.escape_str(new_rec_key) + "\', \'U\')";
+                            db.execute(query);
+                        }
+                        db.execute("COMMIT");
+                    }
+                    catch (const std::exception&)
+                    {
+                        try { db.execute("ROLLBACK"); } catch (const std::exception&) {}
+                        throw;
+                    }
+                }
 
                 // If the query succeeded, then mark the fields as not needing update.
 
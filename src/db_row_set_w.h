@@ -25,6 +25,7 @@ public:
     void write_to_db (database& db);
     void set_null_subst_on  ();
     void set_null_subst_off ();
+    unsigned int num_pending_writes () const;
 
 private:
 
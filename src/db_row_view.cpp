@@ -0,0 +1,667 @@
+///
+/// \class db_row_view db_row_view.h
+///
+/// \brief Sorted and filtered view of a row set
+///
+/// A view lists rows of a row set in a chosen order, leaving out the rows that a filter rejects,
+/// without changing the row set or querying the database again. The result is a vector of row
+/// numbers in the row set, which a grid can show in place of the row set's own order.
+///
+/// A sort has one or more keys. Each key is sorted stably, from the last key to the first, so
+/// rows that are equal in every key keep their order from before the sort. NULL comes before
+/// every value in an ascending sort, and after every value in a descending sort, as in MySQL.
+///
+/// Values are compared according to the type of the column:
+///
+/// - Integer, decimal, floating-point, year, date, datetime and timestamp columns are compared as
+///   numbers. Each value is turned into a 64-bit key that sorts in the same order, and the keys
+///   are sorted with a radix sort, which uses several threads for large row sets.
+/// - Other columns are compared as text, with `collate()`: letters are compared without regard
+///   to case or accents, as in the default MySQL collation.
+/// - In a dictionary-encoded column (see `db_row_set::set_dict_encoding()`), only the distinct
+///   values are compared; the rows are then radix sorted by the rank of their value.
+///
+/// The row set must not be changed or destroyed while the view is used. After the row set is
+/// loaded again, call `refresh()`.
+///
+
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include "db_row_view.h"
+#include "gde_trace.h"
+
+
+// Row sets smaller than this are radix sorted with one thread, since starting the threads would
+// take longer than the sort.
+
+static const size_t PARALLEL_MIN_ROWS = 65536;
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Constructor
+///
+/// The view starts with all rows of the row set, in their own order.
+///
+/// \param[in]  row_set   rows to show, which must stay unchanged while the view is used
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+db_row_view::db_row_view(const db_row_set& row_set) : my_row_set(row_set)
+{
+    refresh();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Set the number of threads used by the radix sort
+///
+/// \param[in]  num_threads   number of threads, or 0 to use one thread per processor core
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_row_view::set_num_threads(unsigned int num_threads)
+{
+    my_num_threads = num_threads;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Rebuild the view from the row set
+///
+/// The filter and the sort keys are applied again to the rows of the row set, in their own order.
+/// This must be called after the row set is loaded again.
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_row_view::refresh()
+{
+    gde_trace_span span("db_row_view::refresh", "db");
+
+    my_rows.clear();
+    for (unsigned int row = 0; row < my_row_set.num_rows(); row++)
+    {
+        if (!my_filter || my_filter(my_row_set, row))
+            my_rows.push_back(row);
+    }
+
+    for (auto key = my_sort_keys.rbegin(); key != my_sort_keys.rend(); ++key)
+        sort_by_key(*key);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Show only the rows accepted by a filter
+///
+/// The filter replaces any earlier filter. The rows are sorted again by the current sort keys.
+///
+/// \param[in]  filter   function that returns true for each row to show
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_row_view::set_filter(predicate filter)
+{
+    my_filter = filter;
+    refresh();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Show only the rows with a given value in a column
+///
+/// In a dictionary-encoded column, the codes of the rows are compared instead of the values.
+/// NULL fields never match.
+///
+/// \param[in]  col     column number
+/// \param[in]  value   value to match exactly
+///
+/// \exception std::out_of_range thrown if the column number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_row_view::filter_equal(unsigned int col, const std::string& value)
+{
+    if (col >= my_row_set.num_cols())
+        throw std::out_of_range("Bad column number in db_row_view::filter_equal");
+
+    if (my_row_set.is_dict_encoded(col))
+    {
+        unsigned int code;
+        if (!my_row_set.find_code(col, value, code))
+            code = my_row_set.dict_size(col) + 1;      // matches no row, not even NULL
+
+        set_filter([col, code] (const db_row_set& row_set, unsigned int row)
+        {
+            return row_set.get_code(row, col) == code;
+        });
+    }
+    else
+    {
+        std::string data;
+        set_filter([col, value, data] (const db_row_set& row_set, unsigned int row) mutable
+        {
+            return row_set.get_data(row, col, data) && data == value;
+        });
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Show all rows
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_row_view::clear_filter()
+{
+    set_filter(predicate());
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Sort the rows
+///
+/// The rows shown are sorted by the keys, the first key first. The sort is stable, so rows that
+/// are equal in every key stay in the order they were in.
+///
+/// \param[in]  keys   sort keys
+///
+/// \exception std::out_of_range thrown if a column number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_row_view::sort(const std::vector<db_sort_key>& keys)
+{
+    gde_trace_span span("db_row_view::sort", "db");
+
+    for (const db_sort_key& key : keys)
+    {
+        if (key.col >= my_row_set.num_cols())
+            throw std::out_of_range("Bad column number in db_row_view::sort");
+    }
+
+    my_sort_keys = keys;
+    for (auto key = my_sort_keys.rbegin(); key != my_sort_keys.rend(); ++key)
+        sort_by_key(*key);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Show the rows in the order of the row set
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_row_view::clear_sort()
+{
+    my_sort_keys.clear();
+    refresh();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the current sort keys
+///
+/// \return     sort keys, the first key first, or an empty vector if the rows are not sorted
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const std::vector<db_sort_key>& db_row_view::sort_keys() const
+{
+    return my_sort_keys;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the rows shown
+///
+/// \return     the row set row number of each row of the view, in order
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const std::vector<unsigned int>& db_row_view::rows() const
+{
+    return my_rows;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of rows shown
+///
+/// \return     number of rows
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int db_row_view::num_rows() const
+{
+    return my_rows.size();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the row set row of a row of the view
+///
+/// \param[in]  index   row number in the view
+///
+/// \return     row number in the row set
+///
+/// \exception std::out_of_range thrown if the row number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int db_row_view::row(unsigned int index) const
+{
+    if (index >= my_rows.size())
+        throw std::out_of_range("Bad row number in db_row_view::row");
+
+    return my_rows[index];
+}
+
+
+
+//**************************************************************************************************
+// Comparing values
+//**************************************************************************************************
+
+// Base letters of the characters U+00C0 to U+00FF, which are encoded in UTF-8 as C3 80 to C3 BF.
+// The characters that are not letters (multiplication and division signs) are kept as they are.
+
+static const char* const latin_1_letters[64] =
+{
+    "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i",
+    "d", "n", "o", "o", "o", "o", "o", nullptr, "o", "u", "u", "u", "u", "y", "th", "ss",
+    "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i",
+    "d", "n", "o", "o", "o", "o", "o", nullptr, "o", "u", "u", "u", "u", "y", "th", "y"
+};
+
+
+
+// Get the key that a string is sorted by: lower case, without accents on Latin-1 letters.
+
+static std::string collation_key(const std::string& str)
+{
+    std::string key;
+    key.reserve(str.size());
+
+    for (size_t i = 0; i < str.size(); i++)
+    {
+        unsigned char c = str[i];
+        if (c >= 'A' && c <= 'Z')
+            key += (char)(c - 'A' + 'a');
+        else if (c == 0xc3 && i + 1 < str.size() && ((unsigned char) str[i+1] & 0xc0) == 0x80 &&
+                 latin_1_letters[(unsigned char) str[i+1] & 0x3f] != nullptr)
+            key += latin_1_letters[(unsigned char) str[++i] & 0x3f];
+        else
+            key += (char) c;
+    }
+    return key;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Compare two strings in the order used to sort text
+///
+/// Upper and lower case letters, and letters with and without accents (in the Latin-1 range),
+/// compare equal, so "macdonald" and "MacDonald" sort together. Strings that are equal in that
+/// way are ordered by their bytes, so that the order does not depend on the order of the rows.
+///
+/// \param[in]  a   first string, in UTF-8
+/// \param[in]  b   second string, in UTF-8
+///
+/// \return     less than, equal to, or greater than zero if `a` sorts before, with, or after `b`
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int db_row_view::collate(const std::string& a, const std::string& b)
+{
+    int result = collation_key(a).compare(collation_key(b));
+    return (result != 0) ? result : a.compare(b);
+}
+
+
+
+// Get a 64-bit key that sorts in the same order as a numeric, date or time value. Return false if
+// the column type is not compared as a number.
+
+static bool numeric_key(db_data_type type, const std::string& value, uint64_t& key)
+{
+    switch (type)
+    {
+    case DB_TINYINT:
+    case DB_SMALLINT:
+    case DB_MEDIUMINT:
+    case DB_INT:
+    case DB_BIGINT:
+        key = (uint64_t) std::strtoll(value.c_str(), nullptr, 10) ^ ((uint64_t) 1 << 63);
+        return true;
+
+    case DB_UNSIGNED_TINYINT:
+    case DB_UNSIGNED_SMALLINT:
+    case DB_UNSIGNED_MEDIUMINT:
+    case DB_UNSIGNED_INT:
+    case DB_UNSIGNED_BIGINT:
+    case DB_YEAR:
+        key = std::strtoull(value.c_str(), nullptr, 10);
+        return true;
+
+    case DB_DECIMAL:
+    case DB_FLOAT:
+    case DB_DOUBLE:
+    {
+        // Flip the sign bit of positive numbers, and every bit of negative numbers, so that
+        // the bit patterns sort as unsigned integers.
+
+        double number = std::strtod(value.c_str(), nullptr);
+        memcpy(&key, &number, sizeof(key));
+        key = (key & ((uint64_t) 1 << 63)) ? ~key : (key | ((uint64_t) 1 << 63));
+        return true;
+    }
+
+    case DB_DATE:
+    case DB_DATETIME:
+    case DB_TIMESTAMP:
+
+        // The digits, read as one number: 2019-01-05 10:00:00 is 20190105100000.
+
+        key = 0;
+        for (char c : value)
+        {
+            if (c >= '0' && c <= '9')
+                key = key * 10 + (c - '0');
+        }
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+
+
+//**************************************************************************************************
+// Sorting
+//**************************************************************************************************
+
+// This private member function sorts the rows shown by one key, stably. The keys are read from
+// the row set in its own order, which is much faster than reading them in the order of the view
+// once it has been sorted, and then gathered in the order of the view.
+
+void db_row_view::sort_by_key(const db_sort_key& key)
+{
+    unsigned int      num_rows = my_row_set.num_rows();
+    std::vector<char> in_view(num_rows, 0);
+    std::vector<char> is_null(num_rows, 0);
+    for (unsigned int row : my_rows)
+        in_view[row] = 1;
+
+    std::vector<unsigned int> null_rows;
+    std::vector<unsigned int> value_rows;
+    std::vector<uint64_t>     row_keys;
+
+    if (int_keys(key.col, in_view, is_null, row_keys))
+    {
+        std::vector<uint64_t> keys;
+        keys.reserve(my_rows.size());
+        value_rows.reserve(my_rows.size());
+
+        for (unsigned int row : my_rows)
+        {
+            if (is_null[row])
+                null_rows.push_back(row);
+            else
+            {
+                value_rows.push_back(row);
+                keys.push_back(key.descending ? ~row_keys[row] : row_keys[row]);
+            }
+        }
+        radix_sort(keys, value_rows);
+    }
+    else
+    {
+        // Text: sort by the collation keys, then by the bytes.
+
+        std::vector<std::string> values(num_rows);
+        std::vector<std::string> coll_keys(num_rows);
+
+        for (unsigned int row = 0; row < num_rows; row++)
+        {
+            if (!in_view[row])
+                continue;
+            if (my_row_set.get_data(row, key.col, values[row]))
+                coll_keys[row] = collation_key(values[row]);
+            else
+                is_null[row] = 1;
+        }
+
+        for (unsigned int row : my_rows)
+            (is_null[row] ? null_rows : value_rows).push_back(row);
+
+        bool descending = key.descending;
+        std::stable_sort(value_rows.begin(), value_rows.end(), [&] (unsigned int a, unsigned int b)
+        {
+            int result = coll_keys[a].compare(coll_keys[b]);
+            if (result == 0)
+                result = values[a].compare(values[b]);
+            return descending ? (result > 0) : (result < 0);
+        });
+    }
+
+    // NULL first in an ascending sort, last in a descending sort.
+
+    my_rows.clear();
+    if (key.descending)
+    {
+        my_rows.insert(my_rows.end(), value_rows.begin(), value_rows.end());
+        my_rows.insert(my_rows.end(), null_rows.begin(), null_rows.end());
+    }
+    else
+    {
+        my_rows.insert(my_rows.end(), null_rows.begin(), null_rows.end());
+        my_rows.insert(my_rows.end(), value_rows.begin(), value_rows.end());
+    }
+}
+
+
+
+// This private member function gets an integer sort key for each row in the view, if the column
+// can be sorted by integer keys: numeric and date columns, and dictionary-encoded columns, whose
+// key is the rank of the value. The keys are indexed by row set row number, and NULL rows are
+// marked in `is_null`. It returns false, and does nothing, for other columns.
+
+bool db_row_view::int_keys(unsigned int col, const std::vector<char>& in_view, std::vector<char>& is_null,
+                           std::vector<uint64_t>& row_keys) const
+{
+    unsigned int num_rows = my_row_set.num_rows();
+    db_data_type type     = my_row_set.col_desc(col)->type();
+    uint64_t     key;
+    bool         numeric  = numeric_key(type, "", key);
+
+    if (my_row_set.is_dict_encoded(col))
+    {
+        // Rank the distinct values.
+
+        unsigned int             dict_size = my_row_set.dict_size(col);
+        std::vector<uint64_t>    value_keys(dict_size);
+        std::vector<std::string> coll_keys;
+
+        for (unsigned int code = 0; code < dict_size; code++)
+        {
+            if (numeric)
+                numeric_key(type, my_row_set.dict_value(col, code), value_keys[code]);
+            else
+                coll_keys.push_back(collation_key(my_row_set.dict_value(col, code)));
+        }
+
+        std::vector<unsigned int> order(dict_size);
+        for (unsigned int code = 0; code < dict_size; code++)
+            order[code] = code;
+
+        std::sort(order.begin(), order.end(), [&] (unsigned int a, unsigned int b)
+        {
+            if (numeric && value_keys[a] != value_keys[b])
+                return value_keys[a] < value_keys[b];
+            if (!numeric)
+            {
+                int result = coll_keys[a].compare(coll_keys[b]);
+                if (result != 0)
+                    return result < 0;
+            }
+            return my_row_set.dict_value(col, a) < my_row_set.dict_value(col, b);
+        });
+
+        std::vector<uint64_t> rank(dict_size + 1);
+        for (unsigned int i = 0; i < dict_size; i++)
+            rank[order[i]] = i;
+
+        row_keys.assign(num_rows, 0);
+        for (unsigned int row = 0; row < num_rows; row++)
+        {
+            if (!in_view[row])
+                continue;
+
+            unsigned int code = my_row_set.get_code(row, col);
+            row_keys[row] = rank[code];
+            is_null[row]  = (code == dict_size);
+        }
+        return true;
+    }
+
+    if (!numeric)
+        return false;
+
+    row_keys.assign(num_rows, 0);
+    std::string data;
+    for (unsigned int row = 0; row < num_rows; row++)
+    {
+        if (!in_view[row])
+            continue;
+
+        if (my_row_set.get_data(row, col, data))
+            numeric_key(type, data, row_keys[row]);
+        else
+            is_null[row] = 1;
+    }
+    return true;
+}
+
+
+
+// Run a function once for each thread number, in parallel.
+
+template <typename Function>
+static void run_threads(unsigned int num_threads, Function function)
+{
+    std::vector<std::thread> threads;
+    for (unsigned int t = 1; t < num_threads; t++)
+        threads.push_back(std::thread(function, t));
+
+    function(0);
+
+    for (std::thread& th : threads)
+        th.join();
+}
+
+
+
+// This private member function sorts the rows by their keys, with a least significant digit radix
+// sort, one byte at a time. The sort is stable. Bytes that are the same in every key are skipped.
+// With several threads, each thread counts and moves one part of the rows; moving the parts in
+// thread order keeps the sort stable.
+
+void db_row_view::radix_sort(std::vector<uint64_t>& keys, std::vector<unsigned int>& rows) const
+{
+    size_t num_rows = keys.size();
+    if (num_rows < 2)
+        return;
+
+    uint64_t all_or  = 0;
+    uint64_t all_and = ~(uint64_t) 0;
+    for (uint64_t key : keys)
+    {
+        all_or  |= key;
+        all_and &= key;
+    }
+    uint64_t differ = all_or ^ all_and;
+
+    unsigned int num_threads = my_num_threads;
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    if (num_rows < PARALLEL_MIN_ROWS)
+        num_threads = 1;
+
+    size_t part_size = (num_rows + num_threads - 1) / num_threads;
+
+    std::vector<uint64_t>                   keys_out(num_rows);
+    std::vector<unsigned int>               rows_out(num_rows);
+    std::vector<std::array<size_t, 256>>    counts(num_threads);
+
+    for (unsigned int shift = 0; shift < 64; shift += 8)
+    {
+        if (((differ >> shift) & 0xff) == 0)
+            continue;
+
+        run_threads(num_threads, [&] (unsigned int t)
+        {
+            size_t end = std::min(num_rows, (t + 1) * part_size);
+            counts[t].fill(0);
+            for (size_t i = t * part_size; i < end; i++)
+                counts[t][(keys[i] >> shift) & 0xff]++;
+        });
+
+        // Where each thread puts the rows with each byte value.
+
+        size_t position = 0;
+        for (unsigned int byte = 0; byte < 256; byte++)
+        {
+            for (unsigned int t = 0; t < num_threads; t++)
+            {
+                size_t count     = counts[t][byte];
+                counts[t][byte]  = position;
+                position        += count;
+            }
+        }
+
+        run_threads(num_threads, [&] (unsigned int t)
+        {
+            size_t end = std::min(num_rows, (t + 1) * part_size);
+            for (size_t i = t * part_size; i < end; i++)
+            {
+                size_t to    = counts[t][(keys[i] >> shift) & 0xff]++;
+                keys_out[to] = keys[i];
+                rows_out[to] = rows[i];
+            }
+        });
+
+        keys.swap(keys_out);
+        rows.swap(rows_out);
+    }
+}
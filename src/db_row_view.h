@@ -0,0 +1,71 @@
+///
+/// \file
+///
+
+#ifndef DB_ROW_VIEW_H
+#define DB_ROW_VIEW_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "db_row_set.h"
+
+
+///
+/// \brief One key of a row sort
+///
+
+class db_sort_key
+{
+public:
+    db_sort_key (unsigned int col, bool descending = false) : col(col), descending(descending) {}
+
+    unsigned int  col;          ///< column number
+    bool          descending;   ///< true to sort from the largest value down
+};
+
+
+
+class db_row_view
+{
+public:
+    typedef std::function<bool (const db_row_set& row_set, unsigned int row)> predicate;
+
+    db_row_view (const db_row_set& row_set);
+
+    db_row_view (const db_row_view&) = delete;
+    db_row_view& operator= (const db_row_view&) = delete;
+
+    void          set_num_threads (unsigned int num_threads);
+
+    void          refresh       ();
+    void          set_filter    (predicate filter);
+    void          filter_equal  (unsigned int col, const std::string& value);
+    void          clear_filter  ();
+    void          sort          (const std::vector<db_sort_key>& keys);
+    void          clear_sort    ();
+
+    const std::vector<db_sort_key>&  sort_keys () const;
+    const std::vector<unsigned int>& rows      () const;
+
+    unsigned int  num_rows      () const;
+    unsigned int  row           (unsigned int index) const;
+
+    static int    collate       (const std::string& a, const std::string& b);
+
+private:
+    const db_row_set&          my_row_set;
+    predicate                  my_filter;           // empty if all rows are shown
+    std::vector<db_sort_key>   my_sort_keys;
+    std::vector<unsigned int>  my_rows;             // row set row of each view row
+    unsigned int               my_num_threads = 0;
+
+    void          sort_by_key   (const db_sort_key& key);
+    bool          int_keys      (unsigned int col, const std::vector<char>& in_view, std::vector<char>& is_null,
+                                 std::vector<uint64_t>& row_keys) const;
+    void          radix_sort    (std::vector<uint64_t>& keys, std::vector<unsigned int>& rows) const;
+};
+
+#endif
@@ -0,0 +1,956 @@
+///
+/// \class db_snapshot db_snapshot.h
+///
+/// \brief Read-only copy of a query result in a memory-mapped file
+///
+/// Tables such as `1871_census_data` change rarely, but are browsed constantly. A snapshot holds
+/// the result of a query in a file, in a form that can be used without reading it first: the
+/// file is mapped into memory, and the fields are found from the row and column numbers. So
+/// opening a snapshot takes the same time for any number of rows, only the pages that are used
+/// are read from the disk, and the pages are shared by every process that has the file open.
+/// Use `db_row_set::load_snapshot()` to browse a snapshot like the result of a query.
+///
+/// The file holds each column in its own segment, with one of two encodings:
+///
+/// - Plain: the values end to end, with the offset of each row's value (and one more for the end).
+/// - Dictionary: the distinct values, with their offsets, and a code for each row (one, two or four
+///   bytes). This is used when it is smaller, which is usual for columns with few distinct values,
+///   such as county or religion.
+///
+/// Each column also has a bitmap of the NULL fields, and the column descriptions of the query are
+/// kept, so that a row set loaded from a snapshot describes its columns in the same way as one
+/// loaded from the database.
+///
+/// A snapshot is written from a row stream, so the rows are never all held in memory; each column
+/// is collected in temporary files until the end. The file is written under a temporary name and
+/// renamed at the end, so a process that has the old snapshot open keeps its copy, and no process
+/// sees a partly written file. The file uses the byte order of the computer that wrote it, and
+/// cannot be opened on a computer with a different byte order.
+///
+/// Opening a snapshot checks that the segments lie inside the file, but not every offset in them;
+/// those are checked as the fields are read, and a damaged file causes a `std::runtime_error`.
+///
+
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "db_snapshot.h"
+#include "database.h"
+#include "gde_trace.h"
+
+
+//**************************************************************************************************
+// File layout
+//**************************************************************************************************
+
+static const char     SNAPSHOT_MAGIC[8]   = { 'G', 'D', 'S', 'N', 'A', 'P', '\r', '\n' };
+static const uint32_t SNAPSHOT_VERSION    = 1;
+static const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+
+// The file starts with this header, followed by the column directory (one `snapshot_column` for
+// each column). The segments of the columns, and the strings, follow. Every segment starts at a
+// multiple of 8 bytes.
+
+struct snapshot_header
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t num_rows;
+    uint32_t num_cols;
+    uint32_t reserved;
+    int64_t  created;
+    uint64_t strings_offset;    // name, name in the database and table of each column, then the query
+    uint64_t strings_length;
+    uint64_t file_length;
+};
+
+enum snapshot_encoding
+{
+    ENCODING_PLAIN = 0,
+    ENCODING_DICT  = 1
+};
+
+enum snapshot_col_flags
+{
+    COL_NULL_OK  = 1,
+    COL_PRI_KEY  = 2,
+    COL_AUTO_INC = 4
+};
+
+struct snapshot_column
+{
+    uint64_t null_offset;       // null bitmap, one bit for each row
+    uint64_t offsets_offset;    // plain: num_rows + 1 offsets; dictionary: dict_count + 1 offsets
+    uint64_t data_offset;       // plain: the values; dictionary: the distinct values
+    uint64_t data_length;
+    uint64_t codes_offset;      // dictionary: the code of each row
+    uint32_t encoding;
+    uint32_t code_width;        // bytes per code
+    uint32_t dict_count;        // number of distinct values
+    uint32_t type;              // from db_col_desc
+    uint32_t length;
+    uint32_t decimals;
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+// Columns with more distinct values than this are not dictionary encoded.
+
+static const uint32_t MAX_DICT_SIZE = 65536;
+
+
+
+static uint64_t load_u64(const char* ptr)
+{
+    uint64_t value;
+    memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+
+
+
+static uint32_t load_code(const char* ptr, uint32_t width)
+{
+    switch (width)
+    {
+    case 1:
+        return (unsigned char) *ptr;
+    case 2:
+    {
+        uint16_t value;
+        memcpy(&value, ptr, sizeof(value));
+        return value;
+    }
+    default:
+    {
+        uint32_t value;
+        memcpy(&value, ptr, sizeof(value));
+        return value;
+    }
+    }
+}
+
+
+
+//**************************************************************************************************
+// Writing
+//**************************************************************************************************
+
+// Output file, with its position and error handling.
+
+class snapshot_file
+{
+public:
+    snapshot_file(const std::string& name) : file_name(name)
+    {
+        file = fopen(name.c_str(), "wb");
+        if (file == nullptr)
+            throw std::runtime_error("Cannot create " + name + ": " + strerror(errno));
+    }
+
+    ~snapshot_file()
+    {
+        if (file != nullptr)
+            fclose(file);
+    }
+
+    snapshot_file(const snapshot_file&) = delete;
+    snapshot_file& operator=(const snapshot_file&) = delete;
+
+    void write(const void* data, size_t length)
+    {
+        if (length > 0 && fwrite(data, 1, length, file) != length)
+            failed();
+        pos += length;
+    }
+
+    // Pad to a multiple of 8 bytes, and return the position.
+
+    uint64_t align()
+    {
+        static const char zeros[8] = {};
+        write(zeros, (8 - pos % 8) % 8);
+        return pos;
+    }
+
+    void write_string(const std::string& str)
+    {
+        uint32_t length = str.size();
+        write(&length, sizeof(length));
+        write(str.data(), length);
+    }
+
+    void rewrite(uint64_t offset, const void* data, size_t length)
+    {
+        if (fseek(file, offset, SEEK_SET) != 0 || fwrite(data, 1, length, file) != length)
+            failed();
+    }
+
+    void close()
+    {
+        bool error = (ferror(file) != 0);
+        error     |= (fclose(file) != 0);
+        file       = nullptr;
+        if (error)
+            throw std::runtime_error("Error writing " + file_name);
+    }
+
+    uint64_t position() const
+    {
+        return pos;
+    }
+
+private:
+    [[noreturn]] void failed()
+    {
+        throw std::runtime_error("Error writing " + file_name + ": " + strerror(errno));
+    }
+
+    FILE*       file = nullptr;
+    std::string file_name;
+    uint64_t    pos  = 0;
+};
+
+
+
+// Values of one column, as they are read from the query. They are kept in temporary files, since
+// the whole table may not fit in memory. The dictionary of distinct values is kept in memory until
+// it becomes too large.
+
+class snapshot_col_writer
+{
+public:
+    snapshot_col_writer();
+    ~snapshot_col_writer();
+
+    snapshot_col_writer(const snapshot_col_writer&) = delete;
+    snapshot_col_writer& operator=(const snapshot_col_writer&) = delete;
+
+    void add   (unsigned int row, bool is_set, const std::string& value);
+    void write (snapshot_file& out, unsigned int num_rows, snapshot_column& entry);
+    bool dict_encoded () const { return use_dict; }
+
+private:
+    static void put  (FILE* file, const void* data, size_t length);
+    static void copy (FILE* file, snapshot_file& out);
+
+    FILE*                                     data_file   = nullptr;   // values, end to end
+    FILE*                                     length_file = nullptr;   // length of each value
+    FILE*                                     code_file   = nullptr;   // dictionary code of each value
+    uint64_t                                  data_length = 0;
+    std::vector<uint8_t>                      nulls;
+    bool                                      use_dict    = true;
+    std::unordered_map<std::string, uint32_t> dict;
+    std::vector<const std::string*>           dict_values;             // keys of `dict`, by code
+    uint64_t                                  dict_length = 0;
+};
+
+
+
+snapshot_col_writer::snapshot_col_writer()
+{
+    data_file   = tmpfile();
+    length_file = tmpfile();
+    code_file   = tmpfile();
+    if (data_file == nullptr || length_file == nullptr || code_file == nullptr)
+    {
+        std::string error = strerror(errno);
+        this->~snapshot_col_writer();
+        throw std::runtime_error("Cannot create a temporary file: " + error);
+    }
+}
+
+
+
+snapshot_col_writer::~snapshot_col_writer()
+{
+    for (FILE** file : { &data_file, &length_file, &code_file })
+    {
+        if (*file != nullptr)
+            fclose(*file);
+        *file = nullptr;
+    }
+}
+
+
+
+void snapshot_col_writer::put(FILE* file, const void* data, size_t length)
+{
+    if (length > 0 && fwrite(data, 1, length, file) != length)
+        throw std::runtime_error(std::string("Error writing a temporary file: ") + strerror(errno));
+}
+
+
+
+void snapshot_col_writer::copy(FILE* file, snapshot_file& out)
+{
+    char   buffer[65536];
+    size_t length;
+
+    rewind(file);
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        out.write(buffer, length);
+
+    if (ferror(file))
+        throw std::runtime_error(std::string("Error reading a temporary file: ") + strerror(errno));
+}
+
+
+
+// Add the value of the column in the next row.
+
+void snapshot_col_writer::add(unsigned int row, bool is_set, const std::string& value)
+{
+    if (row % 8 == 0)
+        nulls.push_back(0);
+
+    uint32_t length = 0;
+    if (is_set)
+        length = value.size();
+    else
+        nulls.back() |= 1 << (row % 8);
+
+    put(length_file, &length, sizeof(length));
+    put(data_file, value.data(), length);
+    data_length += length;
+
+    if (!use_dict)
+        return;
+
+    // NULL fields have code zero; the null bitmap tells them apart.
+
+    uint32_t code = 0;
+    if (is_set)
+    {
+        auto found = dict.find(value);
+        if (found != dict.end())
+            code = found->second;
+        else if (dict.size() < MAX_DICT_SIZE)
+        {
+            code = dict.size();
+            dict_values.push_back(&dict.emplace(value, code).first->first);
+            dict_length += length;
+        }
+        else
+        {
+            // Too many distinct values. The codes written so far are not used.
+
+            use_dict = false;
+            dict.clear();
+            dict_values.clear();
+            return;
+        }
+    }
+
+    put(code_file, &code, sizeof(code));
+}
+
+
+
+// Write the segments of the column, in the encoding that is smaller, and fill in its entry in the
+// column directory.
+
+void snapshot_col_writer::write(snapshot_file& out, unsigned int num_rows, snapshot_column& entry)
+{
+    uint32_t dict_count = dict_values.size();
+    uint32_t code_width = (dict_count <= 0x100) ? 1 : (dict_count <= 0x10000) ? 2 : 4;
+
+    uint64_t plain_size = 8 * (uint64_t)(num_rows + 1) + data_length;
+    uint64_t dict_size  = code_width * (uint64_t) num_rows + 8 * (uint64_t)(dict_count + 1) + dict_length;
+
+    use_dict = use_dict && dict_size < plain_size;
+
+    // Null bitmap
+
+    entry.null_offset = out.align();
+    out.write(nulls.data(), nulls.size());
+
+    if (use_dict)
+    {
+        entry.encoding   = ENCODING_DICT;
+        entry.code_width = code_width;
+        entry.dict_count = dict_count;
+
+        // Offsets and values of the distinct values
+
+        entry.offsets_offset = out.align();
+        uint64_t offset = 0;
+        out.write(&offset, sizeof(offset));
+        for (const std::string* value : dict_values)
+        {
+            offset += value->size();
+            out.write(&offset, sizeof(offset));
+        }
+
+        entry.data_offset = out.position();
+        entry.data_length = dict_length;
+        for (const std::string* value : dict_values)
+            out.write(value->data(), value->size());
+
+        // Codes, narrowed to the code width
+
+        entry.codes_offset = out.align();
+
+        uint32_t codes[4096];
+        char     narrow[4096 * 4];
+        size_t   count;
+        rewind(code_file);
+        while ((count = fread(codes, sizeof(codes[0]), 4096, code_file)) > 0)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                if (code_width == 1)
+                    narrow[i] = (char) codes[i];
+                else if (code_width == 2)
+                {
+                    uint16_t code = codes[i];
+                    memcpy(narrow + 2 * i, &code, 2);
+                }
+                else
+                    memcpy(narrow + 4 * i, &codes[i], 4);
+            }
+            out.write(narrow, count * code_width);
+        }
+    }
+    else
+    {
+        entry.encoding = ENCODING_PLAIN;
+
+        // Offset of each value, from the lengths
+
+        entry.offsets_offset = out.align();
+
+        uint32_t lengths[4096];
+        uint64_t offsets[4096];
+        uint64_t offset = 0;
+        size_t   count;
+        out.write(&offset, sizeof(offset));
+        rewind(length_file);
+        while ((count = fread(lengths, sizeof(lengths[0]), 4096, length_file)) > 0)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                offset    += lengths[i];
+                offsets[i] = offset;
+            }
+            out.write(offsets, count * sizeof(offsets[0]));
+        }
+
+        entry.data_offset = out.position();
+        entry.data_length = data_length;
+        copy(data_file, out);
+    }
+
+    if (ferror(code_file) || ferror(length_file))
+        throw std::runtime_error(std::string("Error reading a temporary file: ") + strerror(errno));
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Write a snapshot
+///
+/// The query is read with a row stream, so another connection must be used if a stream is
+/// already open on this one. An existing snapshot with the same file name is replaced.
+///
+/// \param[in]  db          database connection
+/// \param[in]  query       SELECT query
+/// \param[in]  file_name   snapshot file
+///
+/// \return     number of rows written
+///
+/// \exception std::runtime_error thrown if the database server reports an error, the query does
+///                               not return a result set, or the file cannot be written
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int db_snapshot::write(database& db, const std::string& query, const std::string& file_name)
+{
+    gde_trace_span span("db_snapshot::write", "snapshot");
+
+    db_row_stream stream;
+    db.execute(query, stream);
+    if (!stream.is_open())
+        throw std::runtime_error("The query for a snapshot must return a result set");
+
+    // Collect the values of each column.
+
+    unsigned int num_cols = stream.num_cols();
+    std::vector<std::unique_ptr<snapshot_col_writer>> columns;
+    for (unsigned int col = 0; col < num_cols; col++)
+        columns.emplace_back(new snapshot_col_writer);
+
+    unsigned int num_rows = 0;
+    std::string  value;
+    while (stream.next_row())
+    {
+        for (unsigned int col = 0; col < num_cols; col++)
+        {
+            bool is_set = stream.get_data(col, value);
+            columns[col]->add(num_rows, is_set, value);
+        }
+        num_rows++;
+    }
+
+    // Write the header and the column directory (which are filled in at the end), then the
+    // segments of each column, then the strings.
+
+    std::string   temp_name = file_name + ".tmp";
+    snapshot_file out(temp_name);
+
+    try
+    {
+        snapshot_header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+        header.version    = SNAPSHOT_VERSION;
+        header.byte_order = SNAPSHOT_BYTE_ORDER;
+        header.num_rows   = num_rows;
+        header.num_cols   = num_cols;
+        header.created    = time(nullptr);
+
+        std::vector<snapshot_column> entries(num_cols);
+        memset(entries.data(), 0, entries.size() * sizeof(snapshot_column));
+
+        out.write(&header, sizeof(header));
+        out.write(entries.data(), entries.size() * sizeof(snapshot_column));
+
+        for (unsigned int col = 0; col < num_cols; col++)
+        {
+            const db_col_desc* desc = stream.col_desc(col);
+            snapshot_column&   entry = entries[col];
+
+            entry.type     = desc->type();
+            entry.length   = desc->length();
+            entry.decimals = desc->decimals();
+            entry.flags    = (desc->null_ok()     ? COL_NULL_OK  : 0) |
+                             (desc->is_pri_key()  ? COL_PRI_KEY  : 0) |
+                             (desc->is_auto_inc() ? COL_AUTO_INC : 0);
+
+            columns[col]->write(out, num_rows, entry);
+            columns[col].reset();
+        }
+
+        header.strings_offset = out.align();
+        for (unsigned int col = 0; col < num_cols; col++)
+        {
+            out.write_string(stream.col_desc(col)->name());
+            out.write_string(stream.col_desc(col)->name_in_db());
+            out.write_string(stream.col_desc(col)->table());
+        }
+        out.write_string(query);
+        header.strings_length = out.position() - header.strings_offset;
+        header.file_length    = out.position();
+
+        out.rewrite(0, &header, sizeof(header));
+        out.rewrite(sizeof(header), entries.data(), entries.size() * sizeof(snapshot_column));
+        out.close();
+    }
+    catch (...)
+    {
+        remove(temp_name.c_str());
+        throw;
+    }
+
+    if (rename(temp_name.c_str(), file_name.c_str()) != 0)
+    {
+        std::string error = strerror(errno);
+        remove(temp_name.c_str());
+        throw std::runtime_error("Cannot rename " + temp_name + " to " + file_name + ": " + error);
+    }
+
+    return num_rows;
+}
+
+
+
+//**************************************************************************************************
+// Reading
+//**************************************************************************************************
+
+// Throw an exception for a damaged snapshot.
+
+[[noreturn]] static void corrupt(const std::string& file_name)
+{
+    throw std::runtime_error(file_name + " is not a valid snapshot file");
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Open a snapshot
+///
+/// The file is mapped into memory, and stays mapped until the last pointer to the snapshot is
+/// released. Replacing the file with `write()` does not change a snapshot that is open.
+///
+/// \param[in]  file_name   snapshot file
+///
+/// \return     the snapshot
+///
+/// \exception std::runtime_error thrown if the file cannot be opened, or is not a valid snapshot
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<const db_snapshot> db_snapshot::open(const std::string& file_name)
+{
+    gde_trace_span span("db_snapshot::open", "snapshot");
+
+    int fd = ::open(file_name.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Cannot open " + file_name + ": " + strerror(errno));
+
+    struct stat info;
+    if (fstat(fd, &info) != 0)
+    {
+        std::string error = strerror(errno);
+        ::close(fd);
+        throw std::runtime_error("Cannot open " + file_name + ": " + error);
+    }
+
+    size_t size = info.st_size;
+    if (size < sizeof(snapshot_header))
+    {
+        ::close(fd);
+        corrupt(file_name);
+    }
+
+    void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+        throw std::runtime_error("Cannot map " + file_name + ": " + strerror(errno));
+
+    std::shared_ptr<db_snapshot> snapshot(new db_snapshot);
+    snapshot->my_data = static_cast<const char*>(data);
+    snapshot->my_size = size;
+
+    // Check the header and the column directory.
+
+    snapshot_header header;
+    memcpy(&header, data, sizeof(header));
+
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 || header.version != SNAPSHOT_VERSION)
+        corrupt(file_name);
+    if (header.byte_order != SNAPSHOT_BYTE_ORDER)
+        throw std::runtime_error(file_name + " was written on a computer with a different byte order");
+    if (header.file_length != size || header.num_rows > 0xffffffffu ||
+        header.num_cols > (size - sizeof(header)) / sizeof(snapshot_column) ||
+        header.strings_offset > size || header.strings_length > size - header.strings_offset)
+        corrupt(file_name);
+
+    uint64_t num_rows = header.num_rows;
+    snapshot->my_num_rows = num_rows;
+    snapshot->my_created  = header.created;
+    snapshot->my_columns  = reinterpret_cast<const snapshot_column*>(snapshot->my_data + sizeof(header));
+
+    // Check that each segment is in the file, 8-byte segments are aligned, and the last offset
+    // is the end of the values.
+
+    auto in_file = [size] (uint64_t offset, uint64_t length)
+    {
+        return offset <= size && length <= size - offset;
+    };
+
+    for (uint32_t col = 0; col < header.num_cols; col++)
+    {
+        const snapshot_column& entry = snapshot->my_columns[col];
+        uint64_t num_offsets = (entry.encoding == ENCODING_DICT) ? entry.dict_count + 1ull : num_rows + 1;
+
+        bool ok = in_file(entry.null_offset, (num_rows + 7) / 8) &&
+                  in_file(entry.offsets_offset, num_offsets * 8) && entry.offsets_offset % 8 == 0 &&
+                  in_file(entry.data_offset, entry.data_length);
+
+        if (entry.encoding == ENCODING_DICT)
+            ok = ok && (entry.code_width == 1 || entry.code_width == 2 || entry.code_width == 4) &&
+                 in_file(entry.codes_offset, num_rows * entry.code_width);
+        else
+            ok = ok && entry.encoding == ENCODING_PLAIN;
+
+        if (!ok || load_u64(snapshot->my_data + entry.offsets_offset + (num_offsets - 1) * 8) != entry.data_length)
+            corrupt(file_name);
+    }
+
+    // Read the column descriptions and the query.
+
+    const char* strings     = snapshot->my_data + header.strings_offset;
+    const char* strings_end = strings + header.strings_length;
+
+    auto read_string = [&] ()
+    {
+        uint32_t length;
+        if (strings_end - strings < (ptrdiff_t) sizeof(length))
+            corrupt(file_name);
+        memcpy(&length, strings, sizeof(length));
+        strings += sizeof(length);
+        if ((uint64_t)(strings_end - strings) < length)
+            corrupt(file_name);
+        strings += length;
+        return std::string(strings - length, length);
+    };
+
+    snapshot->col_desc_list.resize(header.num_cols);
+    for (uint32_t col = 0; col < header.num_cols; col++)
+    {
+        const snapshot_column& entry = snapshot->my_columns[col];
+        db_col_desc&           desc  = snapshot->col_desc_list[col];
+
+        desc.my_name       = read_string();
+        desc.my_name_in_db = read_string();
+        desc.my_table      = read_string();
+        desc.my_type       = (entry.type <= DB_UNKNOWN_TYPE) ? (db_data_type) entry.type : DB_UNKNOWN_TYPE;
+        desc.my_length     = entry.length;
+        desc.my_decimals   = entry.decimals;
+        desc.my_null_ok    = (entry.flags & COL_NULL_OK)  != 0;
+        desc.my_pri_key    = (entry.flags & COL_PRI_KEY)  != 0;
+        desc.my_auto_inc   = (entry.flags & COL_AUTO_INC) != 0;
+    }
+    snapshot->my_query = read_string();
+
+    return snapshot;
+}
+
+
+
+db_snapshot::~db_snapshot()
+{
+    if (my_data != nullptr)
+        munmap(const_cast<char*>(my_data), my_size);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of rows in the snapshot.
+///
+/// \return number of rows
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int db_snapshot::num_rows() const
+{
+    return my_num_rows;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of columns in the snapshot.
+///
+/// \return number of columns
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int db_snapshot::num_cols() const
+{
+    return col_desc_list.size();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the query that the snapshot was written from.
+///
+/// \return SQL query
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string db_snapshot::query() const
+{
+    return my_query;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the time that the snapshot was written.
+///
+/// \return time in seconds since the epoch
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+time_t db_snapshot::created() const
+{
+    return my_created;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the size of the snapshot file.
+///
+/// \return number of bytes mapped
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t db_snapshot::file_size() const
+{
+    return my_size;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get column descriptor
+///
+/// \param[in]  col   column number
+///
+/// \return pointer to the column descriptor
+///
+/// \exception std::out_of_range thrown if the column number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+db_col_desc const * db_snapshot::col_desc(unsigned int col) const
+{
+    if (col < col_desc_list.size())
+        return &col_desc_list[col];
+    else
+        throw std::out_of_range("Bad column number in db_snapshot::col_desc");
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the contents of one data field
+///
+/// \param[in]  row   row number
+/// \param[in]  col   column number
+/// \param[out] data  contents of the data field
+///
+/// \return     True if the data field was set. False if the data field was null (empty).
+///
+/// \exception std::logic_error   thrown if the row or column number is out of range
+/// \exception std::runtime_error thrown if the snapshot file is damaged
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool db_snapshot::get_data(unsigned int row, unsigned int col, std::string& data) const
+{
+    const char* field;
+    size_t      length;
+
+    if (!get_field(row, col, field, length))
+    {
+        data.clear();
+        return false;
+    }
+
+    data.assign(field, length);
+    return true;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the contents of one data field, without copying it
+///
+/// \param[in]  row     row number
+/// \param[in]  col     column number
+/// \param[out] data    start of the data field in the mapped file (not null-terminated), or null
+///                     if the data field is NULL
+/// \param[out] length  length of the data field
+///
+/// \return     True if the data field was set. False if the data field was null (empty).
+///
+/// \exception std::logic_error   thrown if the row or column number is out of range
+/// \exception std::runtime_error thrown if the snapshot file is damaged
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool db_snapshot::get_field(unsigned int row, unsigned int col, const char*& data, size_t& length) const
+{
+    if ((row >= my_num_rows) || (col >= col_desc_list.size()))
+        throw std::logic_error("Row or column number out of range in db_snapshot::get_field");
+
+    const snapshot_column& entry = my_columns[col];
+
+    if (my_data[entry.null_offset + row / 8] & (1 << (row % 8)))
+    {
+        data   = nullptr;
+        length = 0;
+        return false;
+    }
+
+    // The offsets of the value: the row's own, or its dictionary entry's.
+
+    uint64_t index = row;
+    if (entry.encoding == ENCODING_DICT)
+    {
+        index = load_code(my_data + entry.codes_offset + (uint64_t) row * entry.code_width, entry.code_width);
+        if (index >= entry.dict_count)
+            throw std::runtime_error("Bad dictionary code in snapshot");
+    }
+
+    const char* offsets = my_data + entry.offsets_offset + index * 8;
+    uint64_t    start   = load_u64(offsets);
+    uint64_t    end     = load_u64(offsets + 8);
+    if (start > end || end > entry.data_length)
+        throw std::runtime_error("Bad value offset in snapshot");
+
+    data   = my_data + entry.data_offset + start;
+    length = end - start;
+    return true;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Determine if a column is dictionary encoded
+///
+/// \param[in]  col   column number
+///
+/// \return     True if the column holds a code for each row, and a list of the distinct values
+///
+/// \exception std::out_of_range thrown if the column number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool db_snapshot::is_dict_encoded(unsigned int col) const
+{
+    if (col >= col_desc_list.size())
+        throw std::out_of_range("Bad column number in db_snapshot::is_dict_encoded");
+
+    return my_columns[col].encoding == ENCODING_DICT;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of distinct values in a dictionary-encoded column
+///
+/// \param[in]  col   column number
+///
+/// \return     number of distinct values, not counting NULL, or zero if the column is not
+///             dictionary encoded
+///
+/// \exception std::out_of_range thrown if the column number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int db_snapshot::dict_size(unsigned int col) const
+{
+    if (col >= col_desc_list.size())
+        throw std::out_of_range("Bad column number in db_snapshot::dict_size");
+
+    return (my_columns[col].encoding == ENCODING_DICT) ? my_columns[col].dict_count : 0;
+}
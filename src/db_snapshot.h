@@ -0,0 +1,57 @@
+///
+/// \file
+///
+
+#ifndef DB_SNAPSHOT_H
+#define DB_SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "db_row_set.h"
+
+class database;
+struct snapshot_column;
+
+
+class db_snapshot
+{
+public:
+    ~db_snapshot();
+
+    db_snapshot(const db_snapshot&) = delete;
+    db_snapshot& operator=(const db_snapshot&) = delete;
+
+    static unsigned int write (database& db, const std::string& query, const std::string& file_name);
+    static std::shared_ptr<const db_snapshot> open (const std::string& file_name);
+
+    unsigned int  num_rows  () const;
+    unsigned int  num_cols  () const;
+    std::string   query     () const;
+    time_t        created   () const;
+    size_t        file_size () const;
+
+    db_col_desc const * col_desc (unsigned int col) const;
+
+    bool          get_data  (unsigned int row, unsigned int col, std::string& data) const;
+    bool          get_field (unsigned int row, unsigned int col, const char*& data, size_t& length) const;
+    bool          is_dict_encoded (unsigned int col) const;
+    unsigned int  dict_size (unsigned int col) const;
+
+private:
+    db_snapshot() {};
+
+    const char                *my_data     = nullptr;   // Mapped file
+    size_t                     my_size     = 0;         // Size of the mapped file
+    unsigned int               my_num_rows = 0;         // Number of rows in the snapshot
+    const snapshot_column     *my_columns  = nullptr;   // Column directory, in the mapped file
+    std::vector <db_col_desc>  col_desc_list;           // List of column descriptors
+    std::string                my_query;                // Query that the snapshot was written from
+    time_t                     my_created  = 0;         // Time that the snapshot was written
+};
+
+#endif
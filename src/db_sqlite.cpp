@@ -0,0 +1,1428 @@
+///
+/// \class db_sqlite db_sqlite.h
+///
+/// \brief Database backend for a local SQLite file
+///
+/// This backend opens an SQLite file in the program's own process, so that GenDat Explorer, the
+/// command line tool and the benchmarks can be run without a database server. It is selected
+/// by giving a host of the form "sqlite:PATH" to `database::connect()`:
+///
+/// - If PATH is a directory, then the database name selects the file NAME.db in it.
+/// - Otherwise PATH is the database file, which is created if it does not exist.
+/// - If PATH is empty or ":memory:", then the database is held in memory. It is shared by the
+///   connections that `database::connect(const database&)` opens from this one (for worker
+///   threads), and is deleted when the last of them is closed.
+/// - If PATH is ":memory:NAME", then the database is held in memory, and shared by every
+///   connection in the process that uses the same NAME.
+///
+/// The user and password are not used. The other databases that are referenced by name (such as
+/// `phpgedview`.`pgv_individuals`) are the files NAME.db in the same directory, which are
+/// attached when they are first used. Those of an in-memory database are held in memory too.
+///
+/// The rest of the program sends MySQL SQL, so the statements that SQLite does not accept are
+/// translated before they are run:
+///
+/// - START TRANSACTION becomes BEGIN IMMEDIATE, which takes the write lock at once. Two worker
+///   threads that write in parallel then wait for each other's transactions, instead of failing
+///   with "database is locked" when both try to upgrade a read lock. TRUNCATE TABLE becomes
+///   DELETE FROM.
+/// - SET, LOCK TABLES and UNLOCK TABLES are ignored.
+/// - SHOW TABLES [LIKE] and DESCRIBE are answered from the SQLite catalog, with the same
+///   columns as MySQL.
+/// - CREATE DATABASE attaches a new file.
+/// - In CREATE TABLE, the KEY, INDEX and UNIQUE clauses become separate CREATE INDEX statements,
+///   an AUTO_INCREMENT column becomes an INTEGER PRIMARY KEY AUTOINCREMENT, ENUM and SET columns
+///   become text, and the table options, character sets, collations, comments and ON UPDATE
+///   clauses are removed.
+/// - LOAD DATA INFILE reads a file in the default MySQL format (tab-separated fields, one row
+///   per line, backslash escapes and \\N for NULL), and inserts its rows in one transaction.
+/// - Identifiers that start with a digit, such as 1871_census_data, are quoted.
+///
+/// The declared MySQL types are kept by SQLite, so `describe` can report the same data types,
+/// lengths and flags as the MySQL backend for columns that are read directly from a table.
+///
+
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <sqlite3.h>
+
+#include "db_sqlite.h"
+#include "gde_trace.h"
+
+
+const std::string db_sqlite::HOST_PREFIX = "sqlite:";
+
+// Prefix of the path of an in-memory database, and the number of unnamed ones opened so far.
+
+static const std::string MEMORY_PREFIX = ":memory:";
+static std::atomic<unsigned int> num_memory_dbs(0);
+
+
+// Milliseconds between two times.
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+
+
+//**************************************************************************************************
+// SQL text helpers
+//**************************************************************************************************
+
+static bool is_word_char(char c)
+{
+    return isalnum((unsigned char) c) || c == '_' || c == '$';
+}
+
+
+
+static std::string to_upper(std::string str)
+{
+    for (char& c : str)
+        c = toupper((unsigned char) c);
+    return str;
+}
+
+
+
+// Skip a quoted string or identifier that starts at `pos`, and return the position after it.
+// A doubled quote character stands for itself. Backslashes are not escapes in SQLite, and
+// `escape_str` does not add them.
+
+static size_t skip_quoted(const std::string& sql, size_t pos)
+{
+    char quote = sql[pos++];
+    while (pos < sql.size())
+    {
+        if (sql[pos] == quote)
+        {
+            if (pos + 1 < sql.size() && sql[pos + 1] == quote)
+                pos += 2;
+            else
+                return pos + 1;
+        }
+        else
+            pos++;
+    }
+    return sql.size();
+}
+
+
+
+static size_t skip_space(const std::string& sql, size_t pos)
+{
+    while (pos < sql.size() && isspace((unsigned char) sql[pos]))
+        pos++;
+    return pos;
+}
+
+
+
+// Read the next token: a word, a quoted string or identifier, or a single punctuation character.
+
+static std::string next_token(const std::string& sql, size_t& pos)
+{
+    pos = skip_space(sql, pos);
+    if (pos >= sql.size())
+        return "";
+
+    size_t start = pos;
+    if (sql[pos] == '\'' || sql[pos] == '"' || sql[pos] == '`')
+        pos = skip_quoted(sql, pos);
+    else if (is_word_char(sql[pos]))
+    {
+        while (pos < sql.size() && is_word_char(sql[pos]))
+            pos++;
+    }
+    else
+        pos++;
+
+    return sql.substr(start, pos - start);
+}
+
+
+
+// Read the next token, and return it in upper case if it is a word.
+
+static std::string next_keyword(const std::string& sql, size_t& pos)
+{
+    return to_upper(next_token(sql, pos));
+}
+
+
+
+// Remove the quotes from an identifier or string.
+
+static std::string unquote(const std::string& token)
+{
+    if (token.size() < 2)
+        return token;
+
+    char quote = token[0];
+    if ((quote != '\'' && quote != '"' && quote != '`') || token.back() != quote)
+        return token;
+
+    std::string result;
+    for (size_t i = 1; i + 1 < token.size(); i++)
+    {
+        result += token[i];
+        if (token[i] == quote && token[i + 1] == quote)
+            i++;
+    }
+    return result;
+}
+
+
+
+static std::string quote_identifier(const std::string& name)
+{
+    std::string result = "\"";
+    for (char c : name)
+    {
+        result += c;
+        if (c == '"')
+            result += c;
+    }
+    return result + "\"";
+}
+
+
+
+static std::string quote_string(const std::string& str)
+{
+    std::string result = "'";
+    for (char c : str)
+    {
+        result += c;
+        if (c == '\'')
+            result += c;
+    }
+    return result + "'";
+}
+
+
+
+// Read a possibly qualified name (`schema`.`table`) starting at `pos`. The schema is empty if the
+// name is not qualified.
+
+static void read_name(const std::string& sql, size_t& pos, std::string& schema, std::string& table)
+{
+    schema.clear();
+    table = unquote(next_token(sql, pos));
+
+    size_t after = skip_space(sql, pos);
+    if (after < sql.size() && sql[after] == '.')
+    {
+        pos    = after + 1;
+        schema = table;
+        table  = unquote(next_token(sql, pos));
+    }
+}
+
+
+
+static std::string qualified_name(const std::string& schema, const std::string& table)
+{
+    return schema.empty() ? quote_identifier(table) : quote_identifier(schema) + "." + quote_identifier(table);
+}
+
+
+
+// Split a list at the commas that are not inside parentheses or quotes.
+
+static std::vector<std::string> split_list(const std::string& list)
+{
+    std::vector<std::string> items;
+    size_t start = 0;
+    int    depth = 0;
+
+    for (size_t pos = 0; pos < list.size(); )
+    {
+        char c = list[pos];
+        if (c == '\'' || c == '"' || c == '`')
+        {
+            pos = skip_quoted(list, pos);
+            continue;
+        }
+
+        if (c == '(')
+            depth++;
+        else if (c == ')')
+            depth--;
+        else if (c == ',' && depth == 0)
+        {
+            items.push_back(list.substr(start, pos - start));
+            start = pos + 1;
+        }
+        pos++;
+    }
+
+    items.push_back(list.substr(start));
+    return items;
+}
+
+
+
+// Find the parenthesis that closes the one at `open`.
+
+static size_t closing_paren(const std::string& sql, size_t open)
+{
+    int depth = 0;
+    for (size_t pos = open; pos < sql.size(); )
+    {
+        if (sql[pos] == '\'' || sql[pos] == '"' || sql[pos] == '`')
+        {
+            pos = skip_quoted(sql, pos);
+            continue;
+        }
+        if (sql[pos] == '(')
+            depth++;
+        else if (sql[pos] == ')' && --depth == 0)
+            return pos;
+        pos++;
+    }
+    return std::string::npos;
+}
+
+
+
+// Split a script into statements at the semicolons that are not inside quotes or comments.
+// Empty statements are skipped.
+
+static std::vector<std::string> split_statements(const std::string& sql)
+{
+    std::vector<std::string> statements;
+    std::string              statement;
+
+    for (size_t pos = 0; pos < sql.size(); )
+    {
+        char c = sql[pos];
+        size_t end = pos + 1;
+
+        if (c == '\'' || c == '"' || c == '`')
+            end = skip_quoted(sql, pos);
+        else if (c == '-' && sql.compare(pos, 2, "--") == 0)
+        {
+            end = sql.find('\n', pos);
+            pos = end = (end == std::string::npos) ? sql.size() : end;
+            continue;
+        }
+        else if (c == '/' && sql.compare(pos, 2, "/*") == 0)
+        {
+            end = sql.find("*/", pos + 2);
+            pos = (end == std::string::npos) ? sql.size() : end + 2;
+            statement += ' ';
+            continue;
+        }
+        else if (c == ';')
+        {
+            if (skip_space(statement, 0) < statement.size())
+                statements.push_back(statement);
+            statement.clear();
+            pos++;
+            continue;
+        }
+
+        statement.append(sql, pos, end - pos);
+        pos = end;
+    }
+
+    if (skip_space(statement, 0) < statement.size())
+        statements.push_back(statement);
+    return statements;
+}
+
+
+
+// Quote the identifiers that start with a digit, such as 1871_census_data, which SQLite would
+// read as a number followed by a name. Numbers, including ones with exponents or in hex, are left
+// alone.
+
+static std::string quote_digit_names(const std::string& sql)
+{
+    std::string result;
+    result.reserve(sql.size());
+
+    for (size_t pos = 0; pos < sql.size(); )
+    {
+        char c = sql[pos];
+        if (c == '\'' || c == '"' || c == '`')
+        {
+            size_t end = skip_quoted(sql, pos);
+            result.append(sql, pos, end - pos);
+            pos = end;
+        }
+        else if (is_word_char(c))
+        {
+            size_t end = pos;
+            while (end < sql.size() && is_word_char(sql[end]))
+                end++;
+            std::string word = sql.substr(pos, end - pos);
+
+            bool is_name = false;
+            if (isdigit((unsigned char) c) && !(word.size() > 2 && word[0] == '0' && (word[1] == 'x' || word[1] == 'X')))
+            {
+                size_t digits = word.find_first_not_of("0123456789");
+                bool exponent = digits != std::string::npos && (word[digits] == 'e' || word[digits] == 'E') &&
+                                word.find_first_not_of("0123456789", digits + 1) == std::string::npos;
+                is_name = (digits != std::string::npos && !exponent);
+            }
+
+            result += is_name ? quote_identifier(word) : word;
+            pos = end;
+        }
+        else
+            result += sql[pos++];
+    }
+
+    return result;
+}
+
+
+
+// Remove a clause made of the given keywords, with an optional argument (a name or a quoted
+// string), from a column definition. `keywords` is upper case and single-spaced.
+
+static void remove_clause(std::string& def, const std::string& keywords, bool has_argument)
+{
+    std::string upper = to_upper(def);
+    size_t      found = std::string::npos;
+
+    for (size_t pos = 0; (pos = upper.find(keywords.substr(0, keywords.find(' ')), pos)) != std::string::npos; pos++)
+    {
+        if (pos > 0 && is_word_char(upper[pos - 1]))
+            continue;
+
+        // Match each keyword in turn, allowing any amount of space between them.
+
+        size_t end = pos;
+        size_t k   = 0;
+        bool   ok  = true;
+        while (k < keywords.size() && ok)
+        {
+            size_t k_end = keywords.find(' ', k);
+            if (k_end == std::string::npos)
+                k_end = keywords.size();
+
+            end = skip_space(upper, end);
+            ok  = (upper.compare(end, k_end - k, keywords, k, k_end - k) == 0) &&
+                  (end + k_end - k >= upper.size() || !is_word_char(upper[end + k_end - k]));
+            end += k_end - k;
+            k    = k_end + 1;
+        }
+
+        if (ok)
+        {
+            found = pos;
+            if (has_argument)
+            {
+                size_t arg = skip_space(def, end);
+                if (arg < def.size() && def[arg] == '=')
+                    arg++;
+                next_token(def, arg);
+                end = arg;
+            }
+            def.erase(found, end - found);
+            upper = to_upper(def);
+            pos   = found;
+        }
+    }
+}
+
+
+
+//**************************************************************************************************
+// Data types
+//**************************************************************************************************
+
+// Convert a declared column type, such as "SMALLINT UNSIGNED" or "DECIMAL(8,1)", into a data type,
+// length and number of decimals, in the way that MySQL reports them.
+
+static void parse_decltype(const char *decltype_str, db_data_type& type, unsigned int& length, unsigned int& decimals)
+{
+    std::string decl = to_upper(decltype_str);
+    size_t      pos  = 0;
+    std::string word = next_token(decl, pos);
+
+    // Length and decimals, from the parentheses after the type name
+
+    size_t paren = decl.find('(');
+    if (paren != std::string::npos)
+    {
+        length = strtoul(decl.c_str() + paren + 1, nullptr, 10);
+        size_t comma = decl.find(',', paren);
+        if (comma != std::string::npos)
+            decimals = strtoul(decl.c_str() + comma + 1, nullptr, 10);
+    }
+
+    bool is_unsigned = (decl.find("UNSIGNED") != std::string::npos);
+
+    static const struct { const char *name; db_data_type type; db_data_type unsigned_type; unsigned int width; } types[] =
+    {
+        { "TINYINT",    DB_TINYINT,    DB_UNSIGNED_TINYINT,    4  },
+        { "BOOL",       DB_TINYINT,    DB_UNSIGNED_TINYINT,    1  },
+        { "BOOLEAN",    DB_TINYINT,    DB_UNSIGNED_TINYINT,    1  },
+        { "SMALLINT",   DB_SMALLINT,   DB_UNSIGNED_SMALLINT,   6  },
+        { "MEDIUMINT",  DB_MEDIUMINT,  DB_UNSIGNED_MEDIUMINT,  9  },
+        { "INT",        DB_INT,        DB_UNSIGNED_INT,        11 },
+        { "INTEGER",    DB_BIGINT,     DB_UNSIGNED_BIGINT,     20 },
+        { "BIGINT",     DB_BIGINT,     DB_UNSIGNED_BIGINT,     20 },
+        { "DECIMAL",    DB_DECIMAL,    DB_DECIMAL,             0  },
+        { "NUMERIC",    DB_DECIMAL,    DB_DECIMAL,             0  },
+        { "FLOAT",      DB_FLOAT,      DB_FLOAT,               12 },
+        { "DOUBLE",     DB_DOUBLE,     DB_DOUBLE,              22 },
+        { "REAL",       DB_DOUBLE,     DB_DOUBLE,              22 },
+        { "BIT",        DB_BIT,        DB_BIT,                 1  },
+        { "TIMESTAMP",  DB_TIMESTAMP,  DB_TIMESTAMP,           19 },
+        { "DATE",       DB_DATE,       DB_DATE,                10 },
+        { "TIME",       DB_TIME,       DB_TIME,                10 },
+        { "DATETIME",   DB_DATETIME,   DB_DATETIME,            19 },
+        { "YEAR",       DB_YEAR,       DB_YEAR,                4  },
+        { "CHAR",       DB_CHAR,       DB_CHAR,                1  },
+        { "VARCHAR",    DB_VARCHAR,    DB_VARCHAR,             0  },
+        { "BINARY",     DB_BINARY,     DB_BINARY,              1  },
+        { "VARBINARY",  DB_VARBINARY,  DB_VARBINARY,           0  },
+        { "TINYTEXT",   DB_TEXT,       DB_TEXT,                255 },
+        { "TEXT",       DB_TEXT,       DB_TEXT,                65535 },
+        { "MEDIUMTEXT", DB_TEXT,       DB_TEXT,                16777215 },
+        { "LONGTEXT",   DB_TEXT,       DB_TEXT,                4294967295u },
+        { "TINYBLOB",   DB_BLOB,       DB_BLOB,                255 },
+        { "BLOB",       DB_BLOB,       DB_BLOB,                65535 },
+        { "MEDIUMBLOB", DB_BLOB,       DB_BLOB,                16777215 },
+        { "LONGBLOB",   DB_BLOB,       DB_BLOB,                4294967295u },
+        { "ENUM",       DB_ENUM,       DB_ENUM,                0  },
+        { "SET",        DB_SET,        DB_SET,                 0  },
+        { "GEOMETRY",   DB_GEOMETRY,   DB_GEOMETRY,            0  },
+    };
+
+    type = DB_UNKNOWN_TYPE;
+    for (const auto& t : types)
+    {
+        if (word == t.name)
+        {
+            type = is_unsigned ? t.unsigned_type : t.type;
+            if (paren == std::string::npos)
+                length = (is_unsigned && t.width > 1 && t.type != t.unsigned_type) ? t.width - 1 : t.width;
+            break;
+        }
+    }
+}
+
+
+
+db_sqlite::~db_sqlite()
+{
+    disconnect();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the name of the backend
+///
+/// \return     "sqlite"
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string db_sqlite::name() const
+{
+    return "sqlite";
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Open a database file
+///
+/// \param[in] host     "sqlite:PATH", where PATH is a database file, a directory of them, or
+///                     ":memory:" or ":memory:NAME" for an in-memory database
+/// \param[in] user     not used
+/// \param[in] passwd   not used
+/// \param[in] db_name  database name, which selects the file NAME.db if PATH is a directory
+///
+/// \exception std::runtime_error thrown if the file cannot be opened
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_sqlite::connect(const std::string& host, const std::string& user, const std::string& passwd,
+                        const std::string& db_name)
+{
+    std::string path  = host.substr(HOST_PREFIX.size());
+    int         flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+    struct stat info;
+
+    my_db_name = db_name.empty() ? "main" : db_name;
+    my_memory_name.clear();
+
+    if (path.empty() || path.compare(0, MEMORY_PREFIX.size(), MEMORY_PREFIX) == 0)
+    {
+        // A plain ":memory:" database would be private to this connection, so every in-memory
+        // database is given a name in SQLite's memdb file system, where it can be shared.
+
+        my_dir.clear();
+        my_memory_name = (path.size() > MEMORY_PREFIX.size()) ? path.substr(MEMORY_PREFIX.size()) :
+                         "gendat_" + std::to_string(++num_memory_dbs);
+        path   = memory_uri(my_memory_name);
+        flags |= SQLITE_OPEN_URI;
+    }
+    else if (stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode))
+    {
+        if (db_name.empty())
+            throw std::runtime_error("No database name given for the SQLite directory " + path);
+        my_dir = path;
+        path  += "/" + db_name + ".db";
+    }
+    else
+    {
+        size_t slash = path.rfind('/');
+        my_dir = (slash == std::string::npos) ? "." : path.substr(0, slash + (slash == 0));
+    }
+
+    if (sqlite3_open_v2(path.c_str(), &db_connection, flags, nullptr) != SQLITE_OK)
+    {
+        std::string error = (db_connection != nullptr) ? sqlite3_errmsg(db_connection) : "out of memory";
+        sqlite3_close(db_connection);
+        db_connection = nullptr;
+        throw std::runtime_error("Cannot open " + path + ": " + error);
+    }
+
+    // Another connection to the same file, such as a worker thread's, waits for a lock instead of
+    // failing, and readers do not block the writer.
+
+    sqlite3_busy_timeout(db_connection, 10000);
+    if (!my_dir.empty())
+        run("PRAGMA journal_mode = WAL");
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Close the database file
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_sqlite::disconnect()
+{
+    free_result();
+
+    if (db_connection != nullptr)
+    {
+        sqlite3_close(db_connection);
+        db_connection = nullptr;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Execute a query
+///
+/// The query is translated from MySQL SQL, and run. It may be a script of several statements,
+/// such as the load.sql written by gendat-gen. If the last statement produces a result set, then
+/// its first row is read, and the rest are read with `fetch_row`. SQLite reads the rows on
+/// demand, so buffered and unbuffered queries are run in the same way. The time taken is counted
+/// as server time.
+///
+/// \param[in]     query      an SQL statement or script
+/// \param[in]     buffered   not used
+/// \param[in,out] timing     timing of the query
+///
+/// \return     number of columns in the result set, or zero if the query did not produce one
+///
+/// \exception std::runtime_error thrown if SQLite reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int db_sqlite::execute(const std::string& query, bool buffered, db_query_timing& timing)
+{
+    free_result();
+    changes = 0;
+
+    gde_trace_span span("sqlite query", "sql");
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::string> statements = split_statements(query);
+    unsigned int             num_cols   = 0;
+
+    try
+    {
+        for (size_t i = 0; i < statements.size(); i++)
+        {
+            std::string sql = translate(statements[i]);
+
+            // Each translated statement may become several SQLite statements, such as a CREATE
+            // TABLE and its indexes.
+
+            size_t offset = 0;
+            while (offset < sql.size())
+            {
+                size_t        used = 0;
+                sqlite3_stmt *stmt = prepare(sql.substr(offset), &used);
+                offset += used;
+                if (stmt == nullptr)
+                    break;
+
+                bool last = (i + 1 == statements.size()) && skip_space(sql, offset) >= sql.size();
+                if (last && sqlite3_column_count(stmt) > 0)
+                {
+                    result   = stmt;
+                    num_cols = sqlite3_column_count(stmt);
+                    int rc   = sqlite3_step(stmt);
+                    if (rc != SQLITE_ROW && rc != SQLITE_DONE)
+                        throw_error();
+                    row_pending = (rc == SQLITE_ROW);
+                    break;
+                }
+
+                int before = sqlite3_total_changes(db_connection);
+                int rc;
+                while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+                    ;
+                if (rc != SQLITE_DONE)
+                {
+                    std::string error = sqlite3_errmsg(db_connection);
+                    sqlite3_finalize(stmt);
+                    throw std::runtime_error(error);
+                }
+                sqlite3_finalize(stmt);
+                changes = sqlite3_total_changes(db_connection) - before;
+            }
+        }
+    }
+    catch (...)
+    {
+        free_result();
+        timing.server_ms = elapsed_ms(start, std::chrono::steady_clock::now());
+        throw;
+    }
+
+    timing.server_ms = elapsed_ms(start, std::chrono::steady_clock::now());
+    return num_cols;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of rows changed by the last query
+///
+/// \return     number of rows inserted, updated or deleted by the last statement of the query
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned long db_sqlite::affected_rows()
+{
+    return changes;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Describe the columns of the result set
+///
+/// Columns that are read directly from a table are described from their declared types and the
+/// table's definition. The type of a column that is computed, such as COUNT(*), is taken from its
+/// value in the first row.
+///
+/// \param[out] cols   column descriptions, one for each column of the result set
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_sqlite::describe(std::vector<db_col_desc>& cols)
+{
+    cols.clear();
+    if (result == nullptr)
+        return;
+
+    int num_cols = sqlite3_column_count(result);
+    cols.resize(num_cols);
+
+    for (int i = 0; i < num_cols; i++)
+    {
+        col_info info;
+
+        const char *name     = sqlite3_column_name(result, i);
+        const char *origin   = sqlite3_column_origin_name(result, i);
+        const char *table    = sqlite3_column_table_name(result, i);
+        const char *schema   = sqlite3_column_database_name(result, i);
+        const char *decltype_str = sqlite3_column_decltype(result, i);
+
+        if (name != nullptr)
+            info.name = name;
+        if (origin != nullptr)
+            info.name_in_db = origin;
+        if (table != nullptr)
+            info.table = table;
+
+        if (decltype_str != nullptr)
+            parse_decltype(decltype_str, info.type, info.length, info.decimals);
+        else if (row_pending)
+        {
+            switch (sqlite3_column_type(result, i))
+            {
+            case SQLITE_INTEGER: info.type = DB_BIGINT; info.length = 21; break;
+            case SQLITE_FLOAT:   info.type = DB_DOUBLE; info.length = 22; break;
+            case SQLITE_TEXT:    info.type = DB_VARCHAR;                  break;
+            case SQLITE_BLOB:    info.type = DB_BLOB;                     break;
+            default:             info.type = DB_NULL;
+            }
+        }
+
+        // Nulls allowed, primary key and auto-increment, from the table's definition
+
+        if (origin != nullptr && table != nullptr)
+        {
+            int not_null = 0;
+            int pri_key  = 0;
+            int auto_inc = 0;
+            if (SQLITE_OK == sqlite3_table_column_metadata(db_connection, schema, table, origin,
+                                                           nullptr, nullptr, &not_null, &pri_key, &auto_inc))
+            {
+                info.null_ok  = (not_null == 0) && (pri_key == 0);
+                info.pri_key  = (pri_key != 0);
+                info.auto_inc = (auto_inc != 0);
+            }
+        }
+
+        set_col_desc(cols[i], info);
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Read the next row of the result set
+///
+/// The strings of the previous row are reused, so that their memory is not reallocated. The
+/// statement is finalized at the end of the result set.
+///
+/// \param[out]    row           data of each column (empty if NULL)
+/// \param[out]    null_fields   true for each column that is NULL
+/// \param[in,out] timing        timing of the query
+///
+/// \return     true if a row was read, false at the end of the result set
+///
+/// \exception std::runtime_error thrown if SQLite reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool db_sqlite::fetch_row(std::vector<std::string>& row, std::vector<bool>& null_fields, db_query_timing& timing)
+{
+    if (result == nullptr)
+        return false;
+
+    if (!row_pending)
+    {
+        free_result();
+        return false;
+    }
+
+    // Copy the row that the last step produced.
+
+    auto start    = std::chrono::steady_clock::now();
+    int  num_cols = sqlite3_column_count(result);
+
+    row.resize(num_cols);
+    null_fields.resize(num_cols);
+
+    for (int j = 0; j < num_cols; j++)
+    {
+        if (sqlite3_column_type(result, j) == SQLITE_NULL)
+        {
+            null_fields[j] = true;
+            row[j].clear();
+        }
+        else
+        {
+            const char *data   = (const char*) sqlite3_column_text(result, j);
+            int         length = sqlite3_column_bytes(result, j);
+            null_fields[j] = false;
+            row[j].assign(data, length);
+            timing.bytes += length;
+        }
+    }
+
+    // Step to the next row, so that the end of the result set is known.
+
+    auto copied = std::chrono::steady_clock::now();
+    int  rc     = sqlite3_step(result);
+    timing.copy_ms  += elapsed_ms(start, copied);
+    timing.fetch_ms += elapsed_ms(copied, std::chrono::steady_clock::now());
+
+    if (rc != SQLITE_ROW && rc != SQLITE_DONE)
+    {
+        std::string error = sqlite3_errmsg(db_connection);
+        free_result();
+        throw std::runtime_error(error);
+    }
+
+    row_pending = (rc == SQLITE_ROW);
+    return true;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Free the result set
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void db_sqlite::free_result()
+{
+    if (result != nullptr)
+    {
+        sqlite3_finalize(result);
+        result = nullptr;
+    }
+    row_pending = false;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Escape string
+///
+/// This member function doubles the single quotes in the input string, so that it is safe to use
+/// in a quoted string in an SQL statement.
+///
+/// \param[in] str  string to be processed
+///
+/// \return  escaped string
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string db_sqlite::escape_str(const std::string& str)
+{
+    std::string quoted = quote_string(str);
+    return quoted.substr(1, quoted.size() - 2);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the host that opens another connection to the same database
+///
+/// For a file, this is the host that was given. For an in-memory database, it is
+/// "sqlite::memory:NAME", with the name that the database was given when it was opened.
+///
+/// \param[in]  host   host that this backend was connected with
+///
+/// \return     host to connect another backend with
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string db_sqlite::shared_host(const std::string& host) const
+{
+    return my_memory_name.empty() ? host : HOST_PREFIX + MEMORY_PREFIX + my_memory_name;
+}
+
+
+
+// This private member function makes the URI of a named database in SQLite's memdb file system.
+// A name that starts with a slash is shared by all of the connections in the process.
+
+std::string db_sqlite::memory_uri(const std::string& name)
+{
+    return "file:/" + name + "?vfs=memdb";
+}
+
+
+
+// This private member function attaches the database with the given name, from the file NAME.db
+// in the directory of the main file. If the main database is in memory, then so is the attached
+// one, with a name made from both, so that it is shared in the same way. It does nothing if the
+// database is already attached.
+
+void db_sqlite::attach(const std::string& schema)
+{
+    sqlite3_stmt *stmt = prepare("PRAGMA database_list");
+    bool attached = false;
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        const char *name = (const char*) sqlite3_column_text(stmt, 1);
+        if (name != nullptr && sqlite3_stricmp(name, schema.c_str()) == 0)
+            attached = true;
+    }
+    sqlite3_finalize(stmt);
+
+    if (!attached)
+    {
+        std::string file = my_memory_name.empty() ? my_dir + "/" + schema + ".db" :
+                                                    memory_uri(my_memory_name + "_" + schema);
+        run("ATTACH DATABASE " + quote_string(file) + " AS " + quote_identifier(schema));
+    }
+}
+
+
+
+// This private member function translates one MySQL statement into SQLite SQL. Statements that
+// are run here (CREATE DATABASE and LOAD DATA) or ignored (SET) return an empty string.
+
+std::string db_sqlite::translate(const std::string& query)
+{
+    std::string sql = quote_digit_names(query);
+
+    size_t      pos     = 0;
+    std::string keyword = next_keyword(sql, pos);
+
+    if (keyword == "SET" || keyword == "LOCK" || keyword == "UNLOCK")
+        return "";
+
+    if (keyword == "START")
+        return "BEGIN IMMEDIATE";
+
+    if (keyword == "TRUNCATE")
+    {
+        size_t after = pos;
+        if (next_keyword(sql, after) == "TABLE")
+            pos = after;
+        return "DELETE FROM" + sql.substr(pos);
+    }
+
+    if (keyword == "SHOW")
+    {
+        size_t after = pos;
+        if (next_keyword(sql, after) == "TABLES")
+        {
+            std::string select = "SELECT name AS " + quote_identifier("Tables_in_" + my_db_name) +
+                                 " FROM sqlite_master WHERE type = 'table' AND name NOT LIKE 'sqlite\\_%' ESCAPE '\\'";
+            if (next_keyword(sql, after) == "LIKE")
+                select += " AND name LIKE " + next_token(sql, after);
+            return select + " ORDER BY name";
+        }
+    }
+
+    if (keyword == "DESCRIBE" || keyword == "DESC")
+    {
+        std::string schema;
+        std::string table;
+        read_name(sql, pos, schema, table);
+        if (!schema.empty())
+            attach(schema);
+
+        return "SELECT name AS Field, lower(type) AS Type, "
+               "CASE WHEN \"notnull\" OR pk THEN 'NO' ELSE 'YES' END AS \"Null\", "
+               "CASE WHEN pk THEN 'PRI' ELSE '' END AS \"Key\", "
+               "dflt_value AS \"Default\", '' AS Extra "
+               "FROM pragma_table_info(" + quote_string(table) +
+               (schema.empty() ? "" : ", " + quote_string(schema)) + ") ORDER BY cid";
+    }
+
+    if (keyword == "CREATE")
+    {
+        size_t after = pos;
+        std::string object = next_keyword(sql, after);
+
+        if (object == "DATABASE" || object == "SCHEMA")
+        {
+            std::string name = next_token(sql, after);
+            if (to_upper(name) == "IF")
+            {
+                next_token(sql, after);
+                next_token(sql, after);
+                name = next_token(sql, after);
+            }
+            attach(unquote(name));
+            return "";
+        }
+
+        if (object == "TABLE" || object == "TEMPORARY")
+        {
+            std::vector<std::string> indexes;
+            std::string create = create_table(sql, indexes);
+            for (const std::string& index : indexes)
+                create += ";\n" + index;
+            return create;
+        }
+    }
+
+    if (keyword == "LOAD")
+    {
+        // LOAD DATA [LOCAL] INFILE 'file' [REPLACE | IGNORE] INTO TABLE name [options]
+
+        std::string word;
+        while (!(word = next_keyword(sql, pos)).empty() && word != "INFILE")
+            ;
+        std::string file_name = unquote(next_token(sql, pos));
+        while (!(word = next_keyword(sql, pos)).empty() && word != "TABLE")
+            ;
+
+        std::string schema;
+        std::string table;
+        read_name(sql, pos, schema, table);
+        if (!schema.empty())
+            attach(schema);
+
+        changes = load_data(file_name, qualified_name(schema, table));
+        return "";
+    }
+
+    return sql;
+}
+
+
+
+// This private member function translates a MySQL CREATE TABLE statement. The KEY, INDEX and
+// UNIQUE clauses are returned as separate CREATE INDEX statements.
+
+std::string db_sqlite::create_table(const std::string& query, std::vector<std::string>& indexes)
+{
+    size_t open  = query.find('(');
+    size_t close = (open == std::string::npos) ? open : closing_paren(query, open);
+    if (close == std::string::npos)
+        return query;
+
+    // The table name is the last token before the column list.
+
+    size_t      pos   = 0;
+    size_t      name_start = 0;
+    std::string token;
+    while (pos < open && !(token = next_token(query, pos)).empty())
+    {
+        std::string upper = to_upper(token);
+        if (upper == "CREATE" || upper == "TEMPORARY" || upper == "TABLE" || upper == "IF" ||
+            upper == "NOT" || upper == "EXISTS")
+            name_start = pos;
+    }
+
+    size_t      name_pos = name_start;
+    std::string schema;
+    std::string table;
+    read_name(query, name_pos, schema, table);
+    if (!schema.empty())
+        attach(schema);
+
+    // Translate each column definition, and collect the keys.
+
+    std::vector<std::string> defs = split_list(query.substr(open + 1, close - open - 1));
+    std::vector<std::string> columns;
+    std::string              auto_inc_col;
+    std::string              primary_key;
+    int                      key_num = 0;
+
+    for (std::string def : defs)
+    {
+        size_t      def_pos = 0;
+        std::string first   = next_keyword(def, def_pos);
+
+        bool unique = false;
+        if (first == "UNIQUE")
+        {
+            unique = true;
+            size_t after = def_pos;
+            std::string next = next_keyword(def, after);
+            if (next == "KEY" || next == "INDEX")
+                def_pos = after;
+            first = "KEY";
+        }
+        else if (first == "FULLTEXT" || first == "SPATIAL")
+            continue;
+
+        if (first == "PRIMARY")
+        {
+            primary_key = def;
+            continue;
+        }
+
+        if (first == "KEY" || first == "INDEX")
+        {
+            // [name] (col [(length)], ...)
+
+            size_t      paren    = def.find('(', def_pos);
+            std::string key_name = unquote(next_token(def, def_pos));
+            if (key_name == "(")
+                key_name = "k" + std::to_string(++key_num);
+            if (paren == std::string::npos)
+                continue;
+
+            std::vector<std::string> key_cols = split_list(def.substr(paren + 1, closing_paren(def, paren) - paren - 1));
+            std::string col_list;
+            for (std::string col : key_cols)
+            {
+                size_t prefix = col.find('(');
+                if (prefix != std::string::npos)
+                    col.erase(prefix, closing_paren(col, prefix) - prefix + 1);
+                col_list += (col_list.empty() ? "" : ", ") + col.substr(skip_space(col, 0));
+            }
+
+            indexes.push_back(std::string("CREATE ") + (unique ? "UNIQUE " : "") + "INDEX IF NOT EXISTS " +
+                              qualified_name(schema, table + "_" + key_name) + " ON " +
+                              quote_identifier(table) + " (" + col_list + ")");
+            continue;
+        }
+
+        if (first == "CONSTRAINT" || first == "FOREIGN" || first == "CHECK")
+        {
+            columns.push_back(def);
+            continue;
+        }
+
+        // A column: name type [attributes]
+
+        size_t type_pos = def_pos;
+        std::string type = next_keyword(def, type_pos);
+        if (type == "ENUM" || type == "SET")
+        {
+            size_t paren = def.find('(', type_pos);
+            size_t end   = (paren == std::string::npos) ? type_pos : closing_paren(def, paren) + 1;
+            def.replace(def_pos, end - def_pos, " " + type + " TEXT");
+        }
+
+        remove_clause(def, "ON UPDATE", true);
+        remove_clause(def, "CHARACTER SET", true);
+        remove_clause(def, "CHARSET", true);
+        remove_clause(def, "COLLATE", true);
+        remove_clause(def, "COMMENT", true);
+
+        std::string upper = to_upper(def);
+        size_t auto_inc = upper.find("AUTO_INCREMENT");
+        if (auto_inc != std::string::npos)
+        {
+            size_t name_end = 0;
+            auto_inc_col = unquote(next_token(def, name_end));
+            def = def.substr(0, name_end) + " INTEGER PRIMARY KEY AUTOINCREMENT";
+        }
+
+        columns.push_back(def);
+    }
+
+    // SQLite only numbers a column automatically if it is the primary key, so an AUTO_INCREMENT
+    // column replaces the table's primary key. MySQL requires it to be the first column of a key.
+
+    if (!primary_key.empty())
+    {
+        size_t paren = primary_key.find('(');
+        std::vector<std::string> key_cols = split_list(primary_key.substr(paren + 1, closing_paren(primary_key, paren) - paren - 1));
+        if (auto_inc_col.empty())
+            columns.push_back(primary_key);
+        else if (key_cols.size() > 1 || unquote(key_cols[0].substr(skip_space(key_cols[0], 0))) != auto_inc_col)
+            indexes.push_back("CREATE UNIQUE INDEX IF NOT EXISTS " + qualified_name(schema, table + "_primary") +
+                              " ON " + quote_identifier(table) + " " + primary_key.substr(paren));
+    }
+
+    std::string create = query.substr(0, name_start) + " " + qualified_name(schema, table) + " (";
+    for (size_t i = 0; i < columns.size(); i++)
+        create += (i == 0 ? "" : ",") + columns[i];
+    return create + ")";
+}
+
+
+
+// This private member function reads a file in the default format of MySQL's LOAD DATA INFILE,
+// and inserts its rows into a table in one transaction. It returns the number of rows.
+
+unsigned long db_sqlite::load_data(const std::string& file_name, const std::string& table)
+{
+    gde_trace_span span("load data", "sql");
+
+    FILE *file = fopen(file_name.c_str(), "rb");
+    if (file == nullptr)
+        throw std::runtime_error("Cannot open " + file_name + ": " + strerror(errno));
+
+    sqlite3_stmt *stmt     = nullptr;
+    unsigned long num_rows = 0;
+
+    try
+    {
+        sqlite3_stmt *columns  = prepare("SELECT * FROM " + table);
+        int           num_cols = sqlite3_column_count(columns);
+        sqlite3_finalize(columns);
+
+        std::string insert = "INSERT INTO " + table + " VALUES (";
+        for (int i = 0; i < num_cols; i++)
+            insert += (i == 0) ? "?" : ", ?";
+        stmt = prepare(insert + ")");
+
+        run("SAVEPOINT load_data");
+
+        std::string field;
+        int         col     = 0;
+        bool        is_null = false;
+        bool        in_row  = false;
+        int         c;
+
+        std::vector<char> buffer(1 << 16);
+        size_t            buf_pos = 0;
+        size_t            buf_len = 0;
+
+        auto next_char = [&]() -> int
+        {
+            if (buf_pos == buf_len)
+            {
+                buf_len = fread(buffer.data(), 1, buffer.size(), file);
+                buf_pos = 0;
+                if (buf_len == 0)
+                    return EOF;
+            }
+            return (unsigned char) buffer[buf_pos++];
+        };
+
+        auto bind_field = [&]()
+        {
+            if (col < num_cols)
+            {
+                if (is_null)
+                    sqlite3_bind_null(stmt, col + 1);
+                else
+                    sqlite3_bind_text(stmt, col + 1, field.data(), field.size(), SQLITE_TRANSIENT);
+            }
+            col++;
+            field.clear();
+            is_null = false;
+        };
+
+        auto insert_row = [&]()
+        {
+            bind_field();
+            for (; col < num_cols; col++)
+                sqlite3_bind_null(stmt, col + 1);
+            if (sqlite3_step(stmt) != SQLITE_DONE)
+                throw_error(file_name + " line " + std::to_string(num_rows + 1));
+            sqlite3_reset(stmt);
+            num_rows++;
+            col    = 0;
+            in_row = false;
+        };
+
+        while ((c = next_char()) != EOF)
+        {
+            if (c == '\n')
+            {
+                insert_row();
+                continue;
+            }
+
+            in_row = true;
+            if (c == '\t')
+                bind_field();
+            else if (c == '\\')
+            {
+                c = next_char();
+                switch (c)
+                {
+                case 'N': is_null = true;   break;
+                case '0': field += '\0';    break;
+                case 'b': field += '\b';    break;
+                case 'n': field += '\n';    break;
+                case 'r': field += '\r';    break;
+                case 't': field += '\t';    break;
+                case 'Z': field += '\x1a';  break;
+                case EOF:                   break;
+                default:  field += (char) c;
+                }
+            }
+            else
+                field += (char) c;
+        }
+
+        if (in_row)
+            insert_row();
+
+        if (ferror(file))
+            throw std::runtime_error("Error reading " + file_name);
+
+        run("RELEASE load_data");
+    }
+    catch (...)
+    {
+        fclose(file);
+        sqlite3_finalize(stmt);
+        if (!sqlite3_get_autocommit(db_connection))
+        {
+            sqlite3_exec(db_connection, "ROLLBACK TO load_data", nullptr, nullptr, nullptr);
+            sqlite3_exec(db_connection, "RELEASE load_data", nullptr, nullptr, nullptr);
+        }
+        throw;
+    }
+
+    fclose(file);
+    sqlite3_finalize(stmt);
+    return num_rows;
+}
+
+
+
+// This private member function prepares a statement. If it refers to a database that has not been
+// attached yet, then the database is attached and the statement is prepared again. It returns
+// null if the text has no statement (only spaces or comments), and sets `used` to the length of
+// the text that was read.
+
+sqlite3_stmt* db_sqlite::prepare(const std::string& sql, size_t *used)
+{
+    sqlite3_stmt *stmt = nullptr;
+    const char   *end  = nullptr;
+
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        if (sqlite3_prepare_v2(db_connection, sql.c_str(), sql.size() + 1, &stmt, &end) == SQLITE_OK)
+        {
+            if (used != nullptr)
+                *used = end - sql.c_str();
+            return stmt;
+        }
+
+        // "unknown database NAME" or "no such table: NAME.TABLE"
+
+        std::string error = sqlite3_errmsg(db_connection);
+        std::string schema;
+        if (error.compare(0, 17, "unknown database ") == 0)
+            schema = error.substr(17);
+        else if (error.compare(0, 15, "no such table: ") == 0 && error.find('.') != std::string::npos)
+            schema = error.substr(15, error.find('.') - 15);
+
+        // A database in memory may have been created by another connection, so it is always
+        // attached. If it was not, then it is empty and the statement fails again.
+
+        struct stat info;
+        if (attempt > 0 || schema.empty() ||
+            (my_memory_name.empty() && stat((my_dir + "/" + schema + ".db").c_str(), &info) != 0))
+            throw std::runtime_error(error);
+
+        attach(schema);
+    }
+
+    throw_error();
+}
+
+
+
+// This private member function runs a statement that does not return rows.
+
+void db_sqlite::run(const std::string& sql)
+{
+    char *error = nullptr;
+    if (sqlite3_exec(db_connection, sql.c_str(), nullptr, nullptr, &error) != SQLITE_OK)
+    {
+        std::string message = (error != nullptr) ? error : sqlite3_errmsg(db_connection);
+        sqlite3_free(error);
+        throw std::runtime_error(message);
+    }
+}
+
+
+
+// This private member function throws an exception with SQLite's error message.
+
+void db_sqlite::throw_error(const std::string& context)
+{
+    std::string error = sqlite3_errmsg(db_connection);
+    throw std::runtime_error(context.empty() ? error : context + ": " + error);
+}
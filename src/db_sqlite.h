@@ -0,0 +1,60 @@
+///
+/// \file
+///
+
+#ifndef DB_SQLITE_H
+#define DB_SQLITE_H
+
+#include <string>
+#include <vector>
+
+#include "db_backend.h"
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+
+class db_sqlite : public db_backend
+{
+public:
+    db_sqlite() {};
+    ~db_sqlite();
+
+    db_sqlite(const db_sqlite&) = delete;
+    db_sqlite& operator=(const db_sqlite&) = delete;
+
+    static const std::string HOST_PREFIX;
+
+    std::string   name          () const;
+    void          connect       (const std::string& host, const std::string& user,
+                                 const std::string& passwd, const std::string& db_name);
+    void          disconnect    ();
+    unsigned int  execute       (const std::string& query, bool buffered, db_query_timing& timing);
+    unsigned long affected_rows ();
+    void          describe      (std::vector<db_col_desc>& cols);
+    bool          fetch_row     (std::vector<std::string>& row, std::vector<bool>& null_fields,
+                                 db_query_timing& timing);
+    void          free_result   ();
+    std::string   escape_str    (const std::string& str);
+    std::string   shared_host   (const std::string& host) const;
+
+private:
+    static std::string memory_uri (const std::string& name);
+    void          attach        (const std::string& schema);
+    std::string   translate     (const std::string& query);
+    std::string   create_table  (const std::string& query, std::vector<std::string>& indexes);
+    unsigned long load_data     (const std::string& file_name, const std::string& table);
+    sqlite3_stmt* prepare       (const std::string& sql, size_t *used = nullptr);
+    void          run           (const std::string& sql);
+    [[noreturn]] void throw_error (const std::string& context = "");
+
+    sqlite3      *db_connection = nullptr;
+    sqlite3_stmt *result        = nullptr;    // statement whose rows are being read, or null
+    bool          row_pending   = false;      // true if `result` has a row that has not been read
+    unsigned long changes       = 0;          // rows changed by the last query
+    std::string   my_dir;                     // directory of the main database file, or empty if in memory
+    std::string   my_memory_name;             // name of the in-memory database, or empty for a file
+    std::string   my_db_name;                 // name of the main database
+};
+
+#endif
@@ -0,0 +1,1084 @@
+///
+/// \class gde_census_households gde_census.h
+///
+/// \brief Reconstructs households from a census table
+///
+/// A census table such as `1871_census_data` has one row for each person enumerated, in the
+/// order of district, sub-district, page and line, but no table of the households themselves.
+/// At most, it has a family number or a relation to the head of the household on each row.
+/// This class reads each sub-district in that order and splits it into households
+/// in a single pass. A new household starts at:
+///
+/// - the start of a sub-district;
+/// - a new family number, if the table has a family number column (`family` by default);
+/// - otherwise, a person whose relation is "head", if the table has a relation column
+///   (`relation` by default);
+/// - otherwise, an adult whose surname differs from that of the current head.
+///
+/// A household may continue from one page to the next. Within each household, the head is the
+/// person whose relation is "head", or otherwise the first person. The spouse and children are
+/// taken from the relation column if there is one. Otherwise, the spouse is the next person if
+/// they are an adult of the other sex with the same surname, and the children are the persons
+/// with the head's surname who are young enough to be the children of the head (and spouse).
+///
+/// The result is a list of persons, in which the members of each household are consecutive,
+/// and a list of households that index their head, spouse and children. Households can be
+/// looked up by the names of the head and spouse, and the lists can be written to two tables
+/// for use in SQL queries:
+///
+/// | Household table   | Contents                                            |
+/// |-------------------|-----------------------------------------------------|
+/// | household_id      | household number (primary key)                      |
+/// | district          | census district                                     |
+/// | sub_district      | census sub-district                                 |
+/// | page, line        | where the household starts                          |
+/// | num_persons       | number of members                                   |
+/// | head_key          | record key of the head                              |
+/// | head_surname      | surname of the head                                 |
+/// | head_surname_norm | normalized surname of the head                      |
+/// | head_given        | given name(s) of the head                           |
+/// | head_age          | age of the head, or NULL                            |
+/// | spouse_key        | record key of the spouse, or NULL                   |
+/// | spouse_given      | given name(s) of the spouse, or NULL                |
+/// | spouse_age        | age of the spouse, or NULL                          |
+/// | num_children      | number of children of the head                      |
+/// | youngest_child    | age of the youngest child, or NULL                  |
+/// | oldest_child      | age of the oldest child, or NULL                    |
+///
+/// | Member table      | Contents                                            |
+/// |-------------------|-----------------------------------------------------|
+/// | household_id      | household number                                    |
+/// | member_no         | position within the household, from 0               |
+/// | rec_key           | record key in the census table                      |
+/// | role              | HEAD, SPOUSE, CHILD or OTHER                        |
+/// | age               | age, or NULL                                        |
+///
+/// The sub-districts are processed in parallel. Each worker thread reads its sub-districts
+/// through its own database connection, with a `db_row_stream`, so that only one row at a time
+/// is held in memory besides the results.
+///
+
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "gde_census.h"
+#include "gde_string_match.h"
+
+
+// Number of rows in each multi-row INSERT statement.
+
+static const unsigned int INSERT_BATCH_SIZE = 500;
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the code of a household role, as used in the member table
+///
+/// \param[in]  role   household role
+///
+/// \return     "HEAD", "SPOUSE", "CHILD" or "OTHER"
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string census_role_code(gde_census_role role)
+{
+    switch (role)
+    {
+    case gde_census_role::HEAD:
+        return "HEAD";
+    case gde_census_role::SPOUSE:
+        return "SPOUSE";
+    case gde_census_role::CHILD:
+        return "CHILD";
+    default:
+        return "OTHER";
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Constructor
+///
+/// \param[in]  census_table   name of the census table
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gde_census_households::gde_census_households(std::string census_table) :
+    my_table(census_table)
+{
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Set the names of the columns of the census table
+///
+/// \param[in]  columns   column names
+///
+/// \exception std::logic_error thrown if a required column name is empty
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_census_households::set_columns(const gde_census_columns& columns)
+{
+    if (columns.key.empty() || columns.district.empty() || columns.sub_district.empty() ||
+            columns.page.empty() || columns.line.empty() || columns.surname.empty() ||
+            columns.given.empty())
+        throw std::logic_error("Required column missing in gde_census_households::set_columns");
+
+    my_columns = columns;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Set the number of worker threads used by `build()`
+///
+/// \param[in]  num_threads   number of threads, or 0 to use one thread per processor core
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_census_households::set_num_threads(unsigned int num_threads)
+{
+    my_num_threads = num_threads;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Set the age from which a person is taken to be an adult
+///
+/// When there is neither a family number nor a relation column, only an adult with a new
+/// surname starts a new household, so that a child with another surname stays in the household
+/// in which they were enumerated. The default is 16.
+///
+/// \param[in]  age   age in years
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_census_households::set_adult_age(int age)
+{
+    adult_age = age;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Set the minimum age difference between a parent and a child
+///
+/// The default is 14 years.
+///
+/// \param[in]  age   age in years
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_census_households::set_min_parent_age(int age)
+{
+    min_parent_age = age;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Reconstruct the households of the whole census
+///
+/// Any previous results are cleared. The sub-districts are shared out among the worker
+/// threads. The calling thread uses the given connection, and every other worker opens its
+/// own connection to the same database. The households are numbered in the order of
+/// district and sub-district, whatever the number of threads.
+///
+/// \param[in]  db   database connection, which must currently be open
+///
+/// \return     number of households
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int gde_census_households::build(database& db)
+{
+    clear();
+    find_columns(db);
+
+    db_row_set districts;
+    db.execute("SELECT DISTINCT " + my_columns.district + ", " + my_columns.sub_district +
+               " FROM " + my_table + " ORDER BY " + my_columns.district + ", " +
+               my_columns.sub_district, districts);
+
+    size_t num_units = districts.num_rows();
+    std::vector<unit_result> results(num_units);
+
+    unsigned int num_threads = my_num_threads;
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    num_threads = std::max(1u, std::min(num_threads, (unsigned int) num_units));
+
+    std::atomic<size_t> next_unit(0);
+    std::mutex          error_mutex;
+    std::string         error_msg;
+
+    auto worker = [&](database* worker_db)
+    {
+        database    own_db;
+        std::string district;
+        std::string sub_district;
+
+        try
+        {
+            if (worker_db == nullptr)
+            {
+                own_db.connect(db);
+                worker_db = &own_db;
+            }
+
+            size_t u;
+            while ((u = next_unit++) < num_units)
+            {
+                districts.get_data(u, 0, district);
+                districts.get_data(u, 1, sub_district);
+                segment_unit(*worker_db, district, sub_district, results[u]);
+            }
+        }
+        catch (const std::exception& e)
+        {
+            // Stop the other workers, and keep the first error for the caller.
+
+            next_unit = num_units;
+
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (error_msg.empty())
+                error_msg = e.what();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int t=1; t<num_threads; t++)
+        threads.push_back(std::thread(worker, nullptr));
+    worker(&db);
+    for (std::thread& th : threads)
+        th.join();
+
+    if (!error_msg.empty())
+        throw std::runtime_error(error_msg);
+
+    for (unit_result& result : results)
+    {
+        append_unit(result);
+        result = unit_result();
+    }
+
+    whole_census = true;
+    return household_list.size();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Reconstruct the households of one sub-district
+///
+/// The households are added to any that were already found. Call `clear()` first to start
+/// again. `write_to_db()` then replaces only the households of the sub-districts that were
+/// built in this way, unless `build()` has been called since the last `clear()`.
+///
+/// \param[in]  db             database connection, which must currently be open
+/// \param[in]  district       census district
+/// \param[in]  sub_district   census sub-district
+///
+/// \return     number of households added
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int gde_census_households::build_district(database& db, const std::string& district,
+                                                   const std::string& sub_district)
+{
+    find_columns(db);
+
+    unit_result result;
+    segment_unit(db, district, sub_district, result);
+    append_unit(result);
+    built_units.push_back(std::make_pair(district, sub_district));
+    return result.households.size();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Remove all households
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_census_households::clear()
+{
+    person_list.clear();
+    household_list.clear();
+    child_list.clear();
+    key_index.clear();
+    head_index.clear();
+    built_units.clear();
+    whole_census = false;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of households
+///
+/// \return     number of households
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int gde_census_households::num_households() const
+{
+    return household_list.size();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of persons in all households
+///
+/// \return     number of persons
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int gde_census_households::num_persons() const
+{
+    return person_list.size();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get a household
+///
+/// \param[in]  household_num   household number
+///
+/// \return     the household
+///
+/// \exception std::out_of_range thrown if the household number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const gde_census_household& gde_census_households::household(int household_num) const
+{
+    test_input(household_num);
+    return household_list[household_num];
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get a person
+///
+/// \param[in]  person_num   index in the person list
+///
+/// \return     the person
+///
+/// \exception std::out_of_range thrown if the person number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const gde_census_person& gde_census_households::person(int person_num) const
+{
+    if (person_num < 0 || person_num >= (int) person_list.size())
+        throw std::out_of_range("Person number in gde_census_households::person is out of range");
+    return person_list[person_num];
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get a child of the head of a household
+///
+/// \param[in]  household_num   household number
+/// \param[in]  child_num       child number, from 0 to `num_children - 1`
+///
+/// \return     the child, as an index in the person list
+///
+/// \exception std::out_of_range thrown if the household or child number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int gde_census_households::child(int household_num, int child_num) const
+{
+    test_input(household_num);
+
+    const gde_census_household& h = household_list[household_num];
+    if (child_num < 0 || child_num >= h.num_children)
+        throw std::out_of_range("Child number in gde_census_households::child is out of range");
+    return child_list[h.first_child + child_num];
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Find a person by the key of their census record
+///
+/// \param[in]  key   primary key of the census record
+///
+/// \return     index in the person list, or -1 if the record is not in any household
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int gde_census_households::find_person(const std::string& key) const
+{
+    auto it = key_index.find(key);
+    if (it == key_index.end())
+        return -1;
+    return it->second;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Find households by the name of the head
+///
+/// The surname is normalized before it is compared. The given name matches if it is the start
+/// of the head's given name(s), ignoring case.
+///
+/// \param[in]  surname      surname of the head
+/// \param[in]  given        start of the given name(s), or an empty string to match any
+/// \param[out] households   numbers of the matching households
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_census_households::find_heads(const std::string& surname, const std::string& given,
+                                       std::vector<int>& households) const
+{
+    households.clear();
+
+    auto it = head_index.find(gde_string_match::normalize_name(surname));
+    if (it == head_index.end())
+        return;
+
+    for (int h : it->second)
+        if (given_match(person_list[household_list[h].head].given, given))
+            households.push_back(h);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Find households by the names of a couple
+///
+/// Use this to find the household of a couple named in a marriage record, for example.
+///
+/// \param[in]  surname        surname of the head
+/// \param[in]  head_given     start of the given name(s) of the head, or an empty string
+/// \param[in]  spouse_given   start of the given name(s) of the spouse, or an empty string
+/// \param[out] households     numbers of the matching households, all of which have a spouse
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_census_households::find_couples(const std::string& surname, const std::string& head_given,
+                                         const std::string& spouse_given,
+                                         std::vector<int>& households) const
+{
+    find_heads(surname, head_given, households);
+
+    size_t n = 0;
+    for (int h : households)
+    {
+        int spouse = household_list[h].spouse;
+        if (spouse >= 0 && given_match(person_list[spouse].given, spouse_given))
+            households[n++] = h;
+    }
+    households.resize(n);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Create the household and member tables, if they do not already exist
+///
+/// \param[in]  db                database connection, which must currently be open
+/// \param[in]  household_table   name of the household table
+/// \param[in]  member_table      name of the member table
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_census_households::create_tables(database& db, std::string household_table,
+                                          std::string member_table) const
+{
+    db.execute("CREATE TABLE IF NOT EXISTS " + household_table + " ("
+               "household_id INT UNSIGNED NOT NULL, "
+               "district VARCHAR(32) NOT NULL, "
+               "sub_district VARCHAR(32) NOT NULL, "
+               "page VARCHAR(16) NOT NULL, "
+               "line VARCHAR(16) NOT NULL, "
+               "num_persons SMALLINT UNSIGNED NOT NULL, "
+               "head_key VARCHAR(64) NOT NULL, "
+               "head_surname VARCHAR(100) NOT NULL, "
+               "head_surname_norm VARCHAR(100) NOT NULL, "
+               "head_given VARCHAR(100) NOT NULL, "
+               "head_age SMALLINT UNSIGNED NULL, "
+               "spouse_key VARCHAR(64) NULL, "
+               "spouse_given VARCHAR(100) NULL, "
+               "spouse_age SMALLINT UNSIGNED NULL, "
+               "num_children SMALLINT UNSIGNED NOT NULL, "
+               "youngest_child SMALLINT UNSIGNED NULL, "
+               "oldest_child SMALLINT UNSIGNED NULL, "
+               "PRIMARY KEY (household_id), "
+               "KEY (head_surname_norm, head_given), "
+               "KEY (head_surname_norm, spouse_given), "
+               "KEY (district, sub_district, page))");
+
+    db.execute("CREATE TABLE IF NOT EXISTS " + member_table + " ("
+               "household_id INT UNSIGNED NOT NULL, "
+               "member_no SMALLINT UNSIGNED NOT NULL, "
+               "rec_key VARCHAR(64) NOT NULL, "
+               "role VARCHAR(8) NOT NULL, "
+               "age SMALLINT UNSIGNED NULL, "
+               "PRIMARY KEY (household_id, member_no), "
+               "KEY (rec_key))");
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Write the households to the household and member tables
+///
+/// The tables are created if required. If the households were found by `build()`, then the
+/// previous contents of the tables are replaced, and the households are numbered from 0.
+/// Otherwise, only the households of the sub-districts given to `build_district()` are
+/// replaced, and the new households are numbered from one more than the highest household
+/// number left in the table.
+///
+/// \param[in]  db                database connection, which must currently be open
+/// \param[in]  household_table   name of the household table
+/// \param[in]  member_table      name of the member table
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_census_households::write_to_db(database& db, std::string household_table,
+                                        std::string member_table) const
+{
+    create_tables(db, household_table, member_table);
+
+    auto number = [](int value) -> std::string
+    {
+        return value < 0 ? std::string("NULL") : std::to_string(value);
+    };
+
+    db.execute("START TRANSACTION");
+    try
+    {
+        size_t first_id = 0;
+        if (whole_census)
+        {
+            db.execute("DELETE FROM " + household_table);
+            db.execute("DELETE FROM " + member_table);
+        }
+        else
+        {
+            for (const std::pair<std::string, std::string>& unit : built_units)
+            {
+                std::string condition = " WHERE district = '" + db.escape_str(unit.first) + "'"
+                                        " AND sub_district = '" + db.escape_str(unit.second) + "'";
+                db.execute("DELETE FROM " + member_table + " WHERE household_id IN "
+                           "(SELECT household_id FROM " + household_table + condition + ")");
+                db.execute("DELETE FROM " + household_table + condition);
+            }
+
+            db_row_set  row_set;
+            std::string max_id;
+            db.execute("SELECT MAX(household_id) FROM " + household_table, row_set);
+            if (row_set.num_rows() > 0 && row_set.get_data(0, 0, max_id) && !max_id.empty())
+                first_id = std::stoul(max_id) + 1;
+        }
+
+        std::string query;
+        for (size_t h=0; h<household_list.size(); h++)
+        {
+            const gde_census_household& hh   = household_list[h];
+            const gde_census_person&    head = person_list[hh.head];
+
+            if (h % INSERT_BATCH_SIZE == 0)
+                query = "INSERT INTO " + household_table +
+                        " (household_id, district, sub_district, page, line, num_persons, head_key,"
+                        " head_surname, head_surname_norm, head_given, head_age, spouse_key,"
+                        " spouse_given, spouse_age, num_children, youngest_child, oldest_child) VALUES ";
+            else
+                query += ", ";
+
+            int youngest = -1;
+            int oldest   = -1;
+            for (int c=0; c<hh.num_children; c++)
+            {
+                int age = person_list[child_list[hh.first_child + c]].age;
+                if (age < 0)
+                    continue;
+                if (youngest < 0 || age < youngest)
+                    youngest = age;
+                if (age > oldest)
+                    oldest = age;
+            }
+
+            query += "(" + std::to_string(first_id + h) + ", '" +
+                     db.escape_str(hh.district) + "', '" +
+                     db.escape_str(hh.sub_district) + "', '" +
+                     db.escape_str(hh.page) + "', '" +
+                     db.escape_str(hh.line) + "', " +
+                     std::to_string(hh.num_persons) + ", '" +
+                     db.escape_str(head.key) + "', '" +
+                     db.escape_str(head.surname) + "', '" +
+                     db.escape_str(gde_string_match::normalize_name(head.surname)) + "', '" +
+                     db.escape_str(head.given) + "', " +
+                     number(head.age) + ", ";
+
+            if (hh.spouse >= 0)
+            {
+                const gde_census_person& spouse = person_list[hh.spouse];
+                query += "'" + db.escape_str(spouse.key) + "', '" + db.escape_str(spouse.given) +
+                         "', " + number(spouse.age) + ", ";
+            }
+            else
+                query += "NULL, NULL, NULL, ";
+
+            query += std::to_string(hh.num_children) + ", " + number(youngest) + ", " +
+                     number(oldest) + ")";
+
+            if (h % INSERT_BATCH_SIZE == INSERT_BATCH_SIZE - 1 || h == household_list.size() - 1)
+                db.execute(query);
+        }
+
+        for (size_t p=0; p<person_list.size(); p++)
+        {
+            const gde_census_person& person = person_list[p];
+
+            if (p % INSERT_BATCH_SIZE == 0)
+                query = "INSERT INTO " + member_table +
+                        " (household_id, member_no, rec_key, role, age) VALUES ";
+            else
+                query += ", ";
+
+            query += "(" + std::to_string(first_id + person.household) + ", " +
+                     std::to_string(p - household_list[person.household].first_person) + ", '" +
+                     db.escape_str(person.key) + "', '" +
+                     census_role_code(person.role) + "', " +
+                     number(person.age) + ")";
+
+            if (p % INSERT_BATCH_SIZE == INSERT_BATCH_SIZE - 1 || p == person_list.size() - 1)
+                db.execute(query);
+        }
+
+        db.execute("COMMIT");
+    }
+    catch (const std::exception&)
+    {
+        try { db.execute("ROLLBACK"); } catch (const std::exception&) {}
+        throw;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Work out which of the optional columns the census table has. The others are left out of the
+// queries, as if their names were empty.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_census_households::find_columns(database& db)
+{
+    auto lower_case = [](std::string text) -> std::string
+    {
+        for (char& c : text)
+            c = std::tolower((unsigned char) c);
+        return text;
+    };
+
+    db_row_set               fields;
+    std::string              field;
+    std::vector<std::string> names;
+
+    db.execute("DESCRIBE " + my_table, fields);
+    for (unsigned int row=0; row<fields.num_rows(); row++)
+    {
+        fields.get_data(row, 0, field);
+        names.push_back(lower_case(field));
+    }
+
+    auto check = [&](std::string& column)
+    {
+        if (std::find(names.begin(), names.end(), lower_case(column)) == names.end())
+            column.clear();
+    };
+
+    table_columns = my_columns;
+    check(table_columns.family);
+    check(table_columns.relation);
+    check(table_columns.sex);
+    check(table_columns.age);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Make the query that reads one sub-district in enumeration order. Missing optional columns are
+// replaced with empty strings, so that every column has a fixed position:
+//
+//     0 key, 1 page, 2 line, 3 family, 4 relation, 5 surname, 6 given, 7 sex, 8 age
+//
+// The page and line are sorted as numbers, whatever their column type.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_census_households::unit_query(database& db, const std::string& district,
+                                              const std::string& sub_district) const
+{
+    auto column = [](const std::string& name) -> std::string
+    {
+        return name.empty() ? std::string("''") : name;
+    };
+
+    const gde_census_columns& c = table_columns;
+
+    return "SELECT " + c.key + ", " + c.page + ", " + c.line + ", " +
+           column(c.family) + ", " + column(c.relation) + ", " +
+           c.surname + ", " + c.given + ", " + column(c.sex) + ", " + column(c.age) +
+           " FROM " + my_table +
+           " WHERE " + c.district + " = '" + db.escape_str(district) + "'"
+           " AND " + c.sub_district + " = '" + db.escape_str(sub_district) + "'"
+           " ORDER BY " + c.page + " + 0, " + c.line + " + 0";
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Read one sub-district and split it into households. This is a small state machine: between
+// households, every row starts a household; within a household, each row either continues it
+// or closes it and starts the next one.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_census_households::segment_unit(database& db, const std::string& district,
+                                         const std::string& sub_district, unit_result& result) const
+{
+    enum class state { BETWEEN_HOUSEHOLDS, IN_HOUSEHOLD };
+
+    bool has_family   = !table_columns.family.empty();
+    bool has_relation = !table_columns.relation.empty();
+
+    db_row_stream stream;
+    db.execute(unit_query(db, district, sub_district), stream);
+
+    state                    current = state::BETWEEN_HOUSEHOLDS;
+    std::string              page;
+    std::string              line;
+    std::string              family;
+    std::string              relation;
+    std::string              data;
+    std::string              current_family;
+    std::string              head_surname;      // normalized surname of the current head
+    std::vector<std::string> relations;         // relation of each member of the current household
+
+    while (stream.next_row())
+    {
+        gde_census_person person;
+
+        stream.get_data(0, person.key);
+        stream.get_data(1, page);
+        stream.get_data(2, line);
+        stream.get_data(3, family);
+        stream.get_data(4, relation);
+        stream.get_data(5, person.surname);
+        stream.get_data(6, person.given);
+
+        if (stream.get_data(7, data) && !data.empty())
+        {
+            char c = std::toupper((unsigned char) data[0]);
+            if (c == 'M' || c == 'F')
+                person.sex = c;
+        }
+        if (stream.get_data(8, data))
+            person.age = parse_age(data);
+
+        for (char& c : relation)
+            c = std::tolower((unsigned char) c);
+
+        std::string surname = gde_string_match::normalize_name(person.surname);
+
+        // Decide whether this person starts a new household.
+
+        bool starts_household = true;
+        if (current == state::IN_HOUSEHOLD)
+        {
+            if (has_family)
+                starts_household = (!family.empty() && family != current_family);
+            else if (has_relation)
+                starts_household = (relation.compare(0, 4, "head") == 0);
+            else
+                starts_household = (surname != head_surname && person.age >= adult_age);
+        }
+
+        if (starts_household)
+        {
+            if (current == state::IN_HOUSEHOLD)
+                close_household(result, relations);
+
+            gde_census_household household;
+            household.district     = district;
+            household.sub_district = sub_district;
+            household.page         = page;
+            household.line         = line;
+            household.first_person = result.persons.size();
+            result.households.push_back(household);
+
+            relations.clear();
+            current_family = family;
+            head_surname   = surname;
+            current        = state::IN_HOUSEHOLD;
+        }
+
+        person.household = result.households.size() - 1;
+        result.persons.push_back(person);
+        result.households.back().num_persons++;
+        relations.push_back(relation);
+    }
+
+    if (current == state::IN_HOUSEHOLD)
+        close_household(result, relations);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Find the head, spouse and children of the last household in a unit, and set the roles of
+// its members. The relations are in lower case, one for each member.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_census_households::close_household(unit_result& result,
+                                            const std::vector<std::string>& relations) const
+{
+    gde_census_household& household = result.households.back();
+    gde_census_person*    members   = &result.persons[household.first_person];
+    int                   n         = household.num_persons;
+
+    auto relation_is = [&](int k, std::initializer_list<const char*> words) -> bool
+    {
+        for (const char* word : words)
+            if (relations[k].compare(0, std::strlen(word), word) == 0)
+                return true;
+        return false;
+    };
+
+    // The head is the person recorded as head, or the first person.
+
+    int head = 0;
+    for (int k=0; k<n; k++)
+        if (relation_is(k, { "head" }))
+        {
+            head = k;
+            break;
+        }
+
+    // The spouse is the person recorded as wife or husband. If there are no relations, it is
+    // the person after the head, if they are an adult of the other sex with the same surname.
+
+    std::string head_surname = gde_string_match::normalize_name(members[head].surname);
+
+    int spouse = -1;
+    for (int k=0; k<n; k++)
+        if (k != head && relation_is(k, { "wife", "husband", "spouse" }))
+        {
+            spouse = k;
+            break;
+        }
+
+    if (spouse < 0 && head + 1 < n && relations[head + 1].empty())
+    {
+        const gde_census_person& h = members[head];
+        const gde_census_person& s = members[head + 1];
+
+        if (h.sex != 'U' && s.sex != 'U' && h.sex != s.sex &&
+                (s.age < 0 || s.age >= adult_age) &&
+                (h.age < 0 || s.age < 0 || std::abs(h.age - s.age) <= 25) &&
+                gde_string_match::normalize_name(s.surname) == head_surname)
+            spouse = head + 1;
+    }
+
+    // The children are the persons recorded as son or daughter. Without relations, they are the
+    // persons with the head's surname who are young enough.
+
+    household.head = household.first_person + head;
+    members[head].role = gde_census_role::HEAD;
+    if (spouse >= 0)
+    {
+        household.spouse = household.first_person + spouse;
+        members[spouse].role = gde_census_role::SPOUSE;
+    }
+
+    for (int k=0; k<n; k++)
+    {
+        if (k == head || k == spouse)
+            continue;
+
+        const gde_census_person& p = members[k];
+        bool is_child;
+
+        if (!relations[k].empty())
+            is_child = relation_is(k, { "son", "daughter", "child", "step" }) &&
+                       relations[k].find("law") == std::string::npos;
+        else
+        {
+            int head_age   = members[head].age;
+            int spouse_age = (spouse >= 0 ? members[spouse].age : -1);
+
+            is_child = (p.age >= 0 && gde_string_match::normalize_name(p.surname) == head_surname);
+            if (is_child && head_age >= 0)
+                is_child = (p.age <= head_age - min_parent_age);
+            if (is_child && head_age < 0)
+                is_child = (p.age < adult_age);
+            if (is_child && spouse_age >= 0)
+                is_child = (p.age <= spouse_age - min_parent_age);
+        }
+
+        if (is_child)
+        {
+            if (household.num_children == 0)
+                household.first_child = result.children.size();
+            household.num_children++;
+            result.children.push_back(household.first_person + k);
+            members[k].role = gde_census_role::CHILD;
+        }
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Append the households of one unit to the main lists, and add them to the indexes.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_census_households::append_unit(unit_result& result)
+{
+    int person_offset    = person_list.size();
+    int household_offset = household_list.size();
+    int child_offset     = child_list.size();
+
+    for (gde_census_person& person : result.persons)
+    {
+        person.household += household_offset;
+        key_index[person.key] = person_list.size();
+        person_list.push_back(std::move(person));
+    }
+
+    for (int child : result.children)
+        child_list.push_back(child + person_offset);
+
+    for (gde_census_household& household : result.households)
+    {
+        household.first_person += person_offset;
+        household.head         += person_offset;
+        if (household.spouse >= 0)
+            household.spouse += person_offset;
+        if (household.first_child >= 0)
+            household.first_child += child_offset;
+
+        head_index[gde_string_match::normalize_name(person_list[household.head].surname)].
+            push_back(household_list.size());
+        household_list.push_back(std::move(household));
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Convert an age to whole years. Ages of infants are often given in months ("3m") or as a
+// fraction of a year ("3/12"), and are taken to be 0. Returns -1 if there is no age.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int gde_census_households::parse_age(const std::string& age)
+{
+    size_t i = 0;
+    while (i < age.size() && age[i] == ' ')
+        i++;
+    if (i == age.size() || !std::isdigit((unsigned char) age[i]))
+        return -1;
+
+    int years = 0;
+    while (i < age.size() && std::isdigit((unsigned char) age[i]))
+        years = years * 10 + (age[i++] - '0');
+
+    if (i < age.size() && (age[i] == '/' || age[i] == 'm' || age[i] == 'M'))
+        return 0;
+    return years;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Check whether a given name starts with a prefix, ignoring case. An empty prefix matches any
+// name.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool gde_census_households::given_match(const std::string& given, const std::string& prefix)
+{
+    if (prefix.size() > given.size())
+        return false;
+
+    for (size_t i=0; i<prefix.size(); i++)
+        if (std::tolower((unsigned char) given[i]) != std::tolower((unsigned char) prefix[i]))
+            return false;
+    return true;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Make sure the household number is valid.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_census_households::test_input(int household_num) const
+{
+    if (household_num < 0 || household_num >= (int) household_list.size())
+        throw std::out_of_range("Household number in gde_census_households:: is out of range");
+}
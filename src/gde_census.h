@@ -0,0 +1,175 @@
+///
+/// \file
+///
+
+#ifndef GDE_CENSUS_H
+#define GDE_CENSUS_H
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "database.h"
+#include "db_row_set.h"
+
+
+///
+/// \brief Names of the columns of a census table
+///
+/// An empty name means that the table does not have that column. Only the key, district,
+/// sub-district, page, line, surname and given name columns are required. The optional columns
+/// are looked up in the table (with DESCRIBE) when the households are built, and any that the
+/// table does not have are ignored.
+///
+
+class gde_census_columns
+{
+public:
+    std::string  key          = "id";                ///< primary key
+    std::string  district     = "district_id";       ///< census district
+    std::string  sub_district = "sub_district_id";   ///< census sub-district
+    std::string  page         = "page";              ///< page number within the sub-district
+    std::string  line         = "line";              ///< line number on the page
+    std::string  family       = "family";            ///< family or household number, if recorded
+    std::string  relation     = "relation";          ///< relation to the head of the household, if recorded
+    std::string  surname      = "surname";           ///< surname
+    std::string  given        = "given_name";        ///< given name(s)
+    std::string  sex          = "sex";               ///< sex
+    std::string  age          = "age";               ///< age in years
+};
+
+
+
+///
+/// \brief Role of a person within a census household
+///
+
+enum class gde_census_role
+{
+    HEAD,      ///< head of the household
+    SPOUSE,    ///< spouse of the head
+    CHILD,     ///< child of the head
+    OTHER      ///< anyone else (relative, servant, boarder, ...)
+};
+
+std::string census_role_code (gde_census_role role);
+
+
+
+///
+/// \brief One person enumerated in a census
+///
+
+class gde_census_person
+{
+public:
+    std::string      key;                              ///< primary key of the census record
+    std::string      surname;                          ///< surname, as recorded
+    std::string      given;                            ///< given name(s), as recorded
+    char             sex       = 'U';                  ///< 'M', 'F' or 'U' (unknown)
+    int              age       = -1;                   ///< age in years, or -1 if unknown
+    gde_census_role  role      = gde_census_role::OTHER; ///< role within the household
+    int              household = -1;                   ///< household number
+};
+
+
+
+///
+/// \brief One household reconstructed from a census
+///
+/// The members of a household are consecutive in the person list, in the order in which they
+/// were enumerated.
+///
+
+class gde_census_household
+{
+public:
+    std::string  district;              ///< census district
+    std::string  sub_district;          ///< census sub-district
+    std::string  page;                  ///< page on which the household starts
+    std::string  line;                  ///< line on which the household starts
+    int          first_person = -1;     ///< first member in the person list
+    int          num_persons  = 0;      ///< number of members
+    int          head         = -1;     ///< head, as an index in the person list
+    int          spouse       = -1;     ///< spouse of the head, or -1
+    int          first_child  = -1;     ///< first child in the child list, or -1
+    int          num_children = 0;      ///< number of children of the head
+};
+
+
+
+class gde_census_households
+{
+public:
+    gde_census_households (std::string census_table = "1871_census_data");
+
+    void         set_columns        (const gde_census_columns& columns);
+    void         set_num_threads    (unsigned int num_threads);
+    void         set_adult_age      (int age);
+    void         set_min_parent_age (int age);
+
+    unsigned int build           (database& db);
+    unsigned int build_district  (database& db, const std::string& district,
+                                  const std::string& sub_district);
+    void         clear           ();
+
+    int          num_households  () const;
+    int          num_persons     () const;
+    const gde_census_household& household (int household_num) const;
+    const gde_census_person&    person    (int person_num) const;
+    int          child           (int household_num, int child_num) const;
+
+    int          find_person     (const std::string& key) const;
+    void         find_heads      (const std::string& surname, const std::string& given,
+                                  std::vector<int>& households) const;
+    void         find_couples    (const std::string& surname, const std::string& head_given,
+                                  const std::string& spouse_given, std::vector<int>& households) const;
+
+    void         create_tables   (database& db, std::string household_table = "census_household",
+                                  std::string member_table = "census_member") const;
+    void         write_to_db     (database& db, std::string household_table = "census_household",
+                                  std::string member_table = "census_member") const;
+
+private:
+
+    // Households found in one sub-district. Each sub-district is segmented on its own, and the
+    // results are then appended to the main lists.
+
+    struct unit_result
+    {
+        std::vector<gde_census_person>    persons;
+        std::vector<gde_census_household> households;
+        std::vector<int>                  children;
+    };
+
+    std::string                       my_table;
+    gde_census_columns                my_columns;
+    gde_census_columns                table_columns;   // my_columns, without those the table does not have
+    unsigned int                      my_num_threads  = 0;
+    int                               adult_age       = 16;
+    int                               min_parent_age  = 14;
+
+    std::vector<gde_census_person>    person_list;
+    std::vector<gde_census_household> household_list;
+    std::vector<int>                  child_list;
+
+    std::unordered_map<std::string, int>              key_index;    // record key -> person
+    std::unordered_map<std::string, std::vector<int>> head_index;   // normalized head surname -> households
+
+    bool                                              whole_census = false;   // built by build()
+    std::vector<std::pair<std::string, std::string>> built_units;             // built by build_district()
+
+    void         find_columns  (database& db);
+    std::string  unit_query    (database& db, const std::string& district,
+                                const std::string& sub_district) const;
+    void         segment_unit  (database& db, const std::string& district,
+                                const std::string& sub_district, unit_result& result) const;
+    void         close_household (unit_result& result, const std::vector<std::string>& relations) const;
+    void         append_unit   (unit_result& result);
+    static int   parse_age     (const std::string& age);
+    static bool  given_match   (const std::string& given, const std::string& prefix);
+    void         test_input    (int household_num) const;
+};
+
+#endif
@@ -0,0 +1,534 @@
+///
+/// \class gde_change_tracker gde_change_tracker.h
+///
+/// \brief Keeps derived tables up to date with changes to the GenDat sources
+///
+/// Derived tables and indexes, such as the person mention table, go out of date as soon as
+/// anyone edits a source record, and rebuilding them from scratch is expensive. Instead, every
+/// edit is recorded in a change journal table:
+///
+/// | Column     | Contents                                              |
+/// |------------|-------------------------------------------------------|
+/// | change_id  | auto-increment primary key, in order of the changes   |
+/// | table_name | database table that was changed                       |
+/// | rec_key    | primary key of the changed record (see below)         |
+/// | operation  | U (update) or I (insert)                              |
+/// | changed_at | time of the change                                    |
+///
+/// The journal is written by `db_row_set_w::write_to_db()`, when a journal has been set for
+/// the database connection (see `database::set_change_journal()`), by the PHP edit pages, and
+/// by the PHP functions `db_update_data()` and `db_insert_data()`. The PHP code writes to the
+/// journal named by `$change_journal` in config.php, if that table exists. Each journal entry
+/// is written in the same transaction as the change itself.
+///
+/// A state table holds a high-water mark for each derived table: the last journal entry that
+/// has been applied to it. `refresh()` passes only the keys of the records that have changed
+/// since then to each derived table, so the cost of keeping the tables up to date is
+/// proportional to the number of edits rather than to the size of the sources.
+///
+/// With several writers, AUTO_INCREMENT ids do not become visible in order: an edit that is
+/// still being committed may hold a lower id than one that has already been committed. So the
+/// high-water mark only moves up to the first missing id, and the entries after it are applied
+/// again by the next refresh (applying an entry twice does no harm, since the derived table just
+/// reads the record again). A missing id whose next entry is more than `GAP_TIMEOUT_S` seconds
+/// old is taken to be a rolled-back insert, and skipped.
+///
+/// A key of a single column is stored as it is. A key of several columns is stored as
+/// "&COL=VALUE&COL=VALUE", with any '%', '&' or '=' in the names and values written as "%25",
+/// "%26" and "%3D" (see `compound_key()` and `split_key()`).
+///
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <set>
+#include <string>
+
+#include "gde_change_tracker.h"
+#include "db_row_set.h"
+
+
+// Maximum number of keys passed to a derived table in one call.
+
+static const unsigned int REFRESH_BATCH_SIZE = 500;
+
+// Number of seconds after which a missing journal id is no longer waited for.
+
+static const long GAP_TIMEOUT_S = 300;
+
+
+
+// Convert a timestamp ("YYYY-MM-DD HH:MM:SS") to a number of seconds, or return -1 if it is not
+// in that form.
+
+static long long timestamp_seconds(const std::string& timestamp)
+{
+    int year, month, day, hour, minute, second;
+    if (sscanf(timestamp.c_str(), "%d-%d-%d %d:%d:%d", &year, &month, &day, &hour, &minute, &second) != 6)
+        return -1;
+
+    // Days since 1970-01-01 in the proleptic Gregorian calendar.
+
+    year -= (month <= 2);
+    long long era  = (year >= 0 ? year : year - 399) / 400;
+    long long yoe  = year - era * 400;
+    long long doy  = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    long long doe  = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    long long days = era * 146097 + doe - 719468;
+
+    return ((days * 24 + hour) * 60 + minute) * 60 + second;
+}
+
+
+
+// Encode the characters that separate the parts of a compound key.
+
+static std::string encode_key_part(const std::string& part)
+{
+    std::string encoded;
+    for (char c : part)
+    {
+        if (c == '%')
+            encoded += "%25";
+        else if (c == '&')
+            encoded += "%26";
+        else if (c == '=')
+            encoded += "%3D";
+        else
+            encoded += c;
+    }
+    return encoded;
+}
+
+
+
+static std::string decode_key_part(const std::string& part)
+{
+    std::string decoded;
+    for (size_t i=0; i<part.size(); i++)
+    {
+        if (part[i] == '%' && i + 2 < part.size())
+        {
+            std::string code = part.substr(i + 1, 2);
+            if (code == "25" || code == "26" || code == "3D" || code == "3d")
+            {
+                decoded += (code == "25") ? '%' : (code == "26") ? '&' : '=';
+                i += 2;
+                continue;
+            }
+        }
+        decoded += part[i];
+    }
+    return decoded;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Constructor
+///
+/// \param[in]  journal   name of the change journal table
+/// \param[in]  state     name of the table that holds the high-water marks
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gde_change_tracker::gde_change_tracker(std::string journal, std::string state) :
+    my_journal(journal),
+    my_state(state)
+{
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the name of the change journal table
+///
+/// \return     table name
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_change_tracker::journal_table() const
+{
+    return my_journal;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Create the change journal and state tables, if they do not already exist
+///
+/// \param[in]  db   database connection, which must currently be open
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_change_tracker::create_tables(database& db) const
+{
+    db.execute("CREATE TABLE IF NOT EXISTS " + my_journal + " ("
+               "change_id BIGINT UNSIGNED NOT NULL AUTO_INCREMENT, "
+               "table_name VARCHAR(64) NOT NULL, "
+               "rec_key VARCHAR(255) NOT NULL, "
+               "operation CHAR(1) NOT NULL, "
+               "changed_at TIMESTAMP NOT NULL DEFAULT CURRENT_TIMESTAMP, "
+               "PRIMARY KEY (change_id), "
+               "KEY (table_name, change_id))");
+
+    db.execute("CREATE TABLE IF NOT EXISTS " + my_state + " ("
+               "derived_name VARCHAR(64) NOT NULL, "
+               "last_change_id BIGINT UNSIGNED NOT NULL, "
+               "refreshed_at TIMESTAMP NOT NULL DEFAULT CURRENT_TIMESTAMP ON UPDATE CURRENT_TIMESTAMP, "
+               "PRIMARY KEY (derived_name))");
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Determine if the change journal table exists
+///
+/// \param[in]  db   database connection, which must currently be open
+///
+/// \return     `true` if the table exists
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool gde_change_tracker::journal_exists(database& db) const
+{
+    db_row_set row_set;
+    db.execute("SHOW TABLES LIKE '" + db.escape_str(my_journal) + "'", row_set);
+    return row_set.num_rows() > 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Add a derived table to the list of tables that are kept up to date
+///
+/// \param[in]  derived   pointer to the derived table, which must stay in existence for the
+///                       lifetime of this object
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_change_tracker::add_derived(gde_derived_table* derived)
+{
+    derived_list.push_back(derived);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the journal id up to which every change has been committed
+///
+/// Call this before a derived table is rebuilt from scratch, and pass the result to
+/// `mark_current()` once the rebuild has finished. Changes that are committed during the rebuild
+/// then have higher ids, and are applied again by the next refresh, whether or not the rebuild
+/// saw them.
+///
+/// \param[in]  db   database connection, which must currently be open
+///
+/// \return     journal id, or 0 if the journal is empty
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned long long gde_change_tracker::safe_mark(database& db) const
+{
+    std::string now = current_time(db);
+
+    // Every entry up to the lowest high-water mark has been committed, since the marks only
+    // move past committed entries.
+
+    db_row_set         row_set;
+    std::string        data;
+    unsigned long long mark = 0;
+
+    db.execute("SELECT MIN(last_change_id) FROM " + my_state, row_set);
+    if (row_set.num_rows() > 0 && row_set.get_data(0, 0, data))
+        mark = std::stoull(data);
+
+    db.execute("SELECT change_id, changed_at FROM " + my_journal + " WHERE change_id > " +
+               std::to_string(mark) + " ORDER BY change_id", row_set);
+    return advance_mark(row_set, mark, now);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Mark a derived table as up to date
+///
+/// Call this after a derived table has been rebuilt from scratch, so that the changes already
+/// in the journal are not applied to it again.
+///
+/// \param[in]  db          database connection, which must currently be open
+/// \param[in]  derived     pointer to the derived table
+/// \param[in]  change_id   result of `safe_mark()`, called before the rebuild started
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_change_tracker::mark_current(database& db, gde_derived_table* derived,
+                                      unsigned long long change_id) const
+{
+    set_high_water(db, derived, change_id);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Apply the changes in the journal to all of the derived tables
+///
+/// For each derived table, the distinct keys of the records changed since its high-water mark
+/// are passed to `gde_derived_table::refresh_keys()`, in batches. The high-water mark is then
+/// moved forward, up to the first journal id that may still be being committed.
+///
+/// \param[in]  db   database connection, which must currently be open
+///
+/// \return     total number of keys passed to the derived tables
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int gde_change_tracker::refresh(database& db) const
+{
+    unsigned int num_keys = 0;
+    std::string  now      = current_time(db);
+
+    for (gde_derived_table* derived : derived_list)
+    {
+        unsigned long long hwm = high_water_mark(db, derived);
+
+        db_row_set row_set;
+        db.execute("SELECT change_id, changed_at, table_name, rec_key FROM " + my_journal +
+                   " WHERE change_id > " + std::to_string(hwm) + " ORDER BY change_id", row_set);
+        if (row_set.num_rows() == 0)
+            continue;
+
+        unsigned long long mark = advance_mark(row_set, hwm, now);
+
+        // Group the distinct keys by table, and pass them on in batches.
+
+        std::map<std::string, std::set<std::string>> changed;
+        std::string table;
+        std::string key;
+
+        for (unsigned int row=0; row<row_set.num_rows(); row++)
+        {
+            row_set.get_data(row, 2, table);
+            row_set.get_data(row, 3, key);
+            changed[table].insert(key);
+        }
+
+        for (auto& tk : changed)
+        {
+            if (!derived->depends_on(tk.first))
+                continue;
+
+            std::vector<std::string> keys(tk.second.begin(), tk.second.end());
+            for (size_t first=0; first<keys.size(); first+=REFRESH_BATCH_SIZE)
+            {
+                size_t last = std::min(keys.size(), first + REFRESH_BATCH_SIZE);
+                std::vector<std::string> batch(keys.begin() + first, keys.begin() + last);
+                derived->refresh_keys(db, tk.first, batch);
+                num_keys += batch.size();
+            }
+        }
+
+        if (mark > hwm)
+            set_high_water(db, derived, mark);
+    }
+
+    return num_keys;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Delete journal entries that have been applied to every derived table
+///
+/// Only the high-water marks in the state table are considered, so a derived table that has
+/// never been refreshed or marked current does not hold back the purge.
+///
+/// \param[in]  db   database connection, which must currently be open
+///
+/// \return     number of journal entries deleted
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int gde_change_tracker::purge(database& db) const
+{
+    db_row_set  row_set;
+    std::string data;
+
+    db.execute("SELECT MIN(last_change_id) FROM " + my_state, row_set);
+    if (row_set.num_rows() == 0 || !row_set.get_data(0, 0, data))
+        return 0;
+
+    return db.execute("DELETE FROM " + my_journal + " WHERE change_id <= " + data);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Make the journal key of a record with a key of several columns
+///
+/// \param[in]  cols   name and value of each column of the primary key
+///
+/// \return     key to store in the journal: the value itself for a key of one column, or
+///             "&COL=VALUE&COL=VALUE" for a key of several columns
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_change_tracker::compound_key(const std::vector<std::pair<std::string, std::string>>& cols)
+{
+    if (cols.size() == 1)
+        return cols[0].second;
+
+    std::string rec_key;
+    for (const auto& col : cols)
+        rec_key += "&" + encode_key_part(col.first) + "=" + encode_key_part(col.second);
+    return rec_key;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Split a journal key into the columns of the primary key
+///
+/// \param[in]  rec_key   key from the journal
+/// \param[out] cols      name and value of each column, if the key has several columns
+///
+/// \return     `true` if the key has several columns, or `false` if it is the value of a single
+///             column (and `cols` is empty)
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool gde_change_tracker::split_key(const std::string& rec_key, std::vector<std::pair<std::string, std::string>>& cols)
+{
+    cols.clear();
+    if (rec_key.empty() || rec_key[0] != '&')
+        return false;
+
+    size_t pos = 1;
+    while (pos <= rec_key.size())
+    {
+        size_t end = rec_key.find('&', pos);
+        if (end == std::string::npos)
+            end = rec_key.size();
+
+        std::string part   = rec_key.substr(pos, end - pos);
+        size_t      equals = part.find('=');
+        if (equals == std::string::npos)
+            cols.emplace_back(decode_key_part(part), "");
+        else
+            cols.emplace_back(decode_key_part(part.substr(0, equals)), decode_key_part(part.substr(equals + 1)));
+        pos = end + 1;
+    }
+    return true;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Get the high-water mark of a derived table, or 0 if it has never been refreshed.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned long long gde_change_tracker::high_water_mark(database& db, const gde_derived_table* derived) const
+{
+    db_row_set  row_set;
+    std::string data;
+
+    db.execute("SELECT last_change_id FROM " + my_state + " WHERE derived_name = '" +
+               db.escape_str(derived->derived_name()) + "'", row_set);
+    if (row_set.num_rows() == 0 || !row_set.get_data(0, 0, data))
+        return 0;
+    return std::stoull(data);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Store the high-water mark of a derived table.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_change_tracker::set_high_water(database& db, const gde_derived_table* derived,
+                                        unsigned long long change_id) const
+{
+    db.execute("REPLACE INTO " + my_state + " (derived_name, last_change_id) VALUES ('" +
+               db.escape_str(derived->derived_name()) + "', " + std::to_string(change_id) + ")");
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Move a high-water mark forward over the journal entries, which are in the rows of the row set
+// (change_id and changed_at, in order of change_id). The mark stops before the first missing id,
+// unless the entry after it is more than GAP_TIMEOUT_S seconds older than `now`.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned long long gde_change_tracker::advance_mark(const db_row_set& entries, unsigned long long mark,
+                                                    const std::string& now) const
+{
+    long long   now_s = timestamp_seconds(now);
+    std::string data;
+
+    for (unsigned int row=0; row<entries.num_rows(); row++)
+    {
+        entries.get_data(row, 0, data);
+        unsigned long long change_id = std::stoull(data);
+        if (change_id <= mark)
+            continue;
+
+        if (change_id != mark + 1)
+        {
+            entries.get_data(row, 1, data);
+            long long changed_s = timestamp_seconds(data);
+            if (now_s >= 0 && changed_s >= 0 && now_s - changed_s < GAP_TIMEOUT_S)
+                break;
+        }
+        mark = change_id;
+    }
+    return mark;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Get the current time of the database server, in the same form as the changed_at column.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_change_tracker::current_time(database& db) const
+{
+    db_row_set  row_set;
+    std::string data;
+
+    db.execute("SELECT CURRENT_TIMESTAMP", row_set);
+    if (row_set.num_rows() > 0)
+        row_set.get_data(0, 0, data);
+    return data;
+}
@@ -0,0 +1,77 @@
+///
+/// \file
+///
+
+#ifndef GDE_CHANGE_TRACKER_H
+#define GDE_CHANGE_TRACKER_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "database.h"
+
+
+///
+/// \brief Interface for tables and indexes that are derived from the GenDat sources
+///
+/// A derived table is kept up to date by `gde_change_tracker`, which passes it the keys of the
+/// source records that have changed since its last refresh.
+///
+
+class gde_derived_table
+{
+public:
+    virtual ~gde_derived_table() {};
+
+    /// Unique name, used to store the high-water mark of the derived table.
+
+    virtual std::string derived_name () const = 0;
+
+    /// Determine if the derived table is built (in part) from a database table.
+
+    virtual bool depends_on (const std::string& db_table) const = 0;
+
+    /// Bring the derived table up to date for some records in a database table. A key may
+    /// belong to a record that has since been deleted.
+
+    virtual void refresh_keys (database& db, const std::string& db_table,
+                               const std::vector<std::string>& keys) = 0;
+};
+
+
+
+class gde_change_tracker
+{
+public:
+    gde_change_tracker (std::string journal = "z_change_journal", std::string state = "z_change_state");
+
+    std::string         journal_table  () const;
+    void                create_tables  (database& db) const;
+    bool                journal_exists (database& db) const;
+
+    void                add_derived    (gde_derived_table* derived);
+    unsigned long long  safe_mark      (database& db) const;
+    void                mark_current   (database& db, gde_derived_table* derived,
+                                        unsigned long long change_id) const;
+    unsigned int        refresh        (database& db) const;
+    unsigned int        purge          (database& db) const;
+
+    static std::string  compound_key   (const std::vector<std::pair<std::string, std::string>>& cols);
+    static bool         split_key      (const std::string& rec_key,
+                                        std::vector<std::pair<std::string, std::string>>& cols);
+
+private:
+    std::string                      my_journal;
+    std::string                      my_state;
+    std::vector<gde_derived_table*>  derived_list;
+
+    unsigned long long high_water_mark (database& db, const gde_derived_table* derived) const;
+    void               set_high_water  (database& db, const gde_derived_table* derived,
+                                        unsigned long long change_id) const;
+    unsigned long long advance_mark    (const db_row_set& entries, unsigned long long mark,
+                                        const std::string& now) const;
+    std::string        current_time    (database& db) const;
+};
+
+#endif
@@ -0,0 +1,635 @@
+///
+/// \class gde_facets gde_facets.h
+///
+/// \brief Counts the rows of a result by the values of several columns
+///
+/// After a search, the user wants to see how the results are spread over the years, counties,
+/// communities and sources before looking at individual rows. This class counts the rows of a
+/// loaded row set by the values of each of several columns (the facets), without querying the
+/// database again.
+///
+/// `aggregate()` reads the row set once, and gives each row a small integer code for each facet.
+/// Dictionary-encoded columns (see `db_row_set::set_dict_encoding()`) already have codes, which
+/// are used as they are; the values of other columns are looked up in a hash table. All later
+/// work is done with the codes.
+///
+/// The user narrows the result by selecting values of the facets. A row matches if, for each facet
+/// with selected values, its value is one of them. The count of a value is the number of rows
+/// with that value that match the selections of the other facets, so that the counts of a facet
+/// show what selecting each of its values would give.
+///
+/// Each row holds a mask of the facets that reject it. Selecting or deselecting a value only
+/// visits the rows whose mask changes (normally, the rows with that value), and adjusts the counts
+/// of those rows, so the counts are kept up to date without aggregating again.
+///
+/// The row set must not be changed or destroyed while this object is used.
+///
+
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "gde_facets.h"
+#include "gde_trace.h"
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Constructor
+///
+/// \param[in]  row_set   rows to count, which must stay unchanged while this object is used
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gde_facets::gde_facets(const db_row_set& row_set) : my_row_set(row_set)
+{
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Add a facet, by column name
+///
+/// \param[in]  col_name   name of a column of the row set
+///
+/// \return     facet number
+///
+/// \exception std::runtime_error thrown if the row set has no column with that name
+/// \exception std::logic_error   thrown if there are already `MAX_FACETS` facets
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int gde_facets::add_facet(const std::string& col_name)
+{
+    for (unsigned int col = 0; col < my_row_set.num_cols(); col++)
+    {
+        if (my_row_set.col_name(col) == col_name)
+            return add_facet(col);
+    }
+    throw std::runtime_error("Column " + col_name + " is not in the search result");
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Add a facet, by column number
+///
+/// The counts are not available until `aggregate()` is called.
+///
+/// \param[in]  col   column number
+///
+/// \return     facet number
+///
+/// \exception std::out_of_range thrown if the column number is out of range
+/// \exception std::logic_error  thrown if there are already `MAX_FACETS` facets
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int gde_facets::add_facet(unsigned int col)
+{
+    if (col >= my_row_set.num_cols())
+        throw std::out_of_range("Bad column number in gde_facets::add_facet");
+    if (facets.size() >= MAX_FACETS)
+        throw std::logic_error("Too many facets in gde_facets::add_facet");
+
+    facets.emplace_back();
+    facets.back().col = col;
+    aggregated        = false;
+
+    return facets.size() - 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Count the rows by the values of each facet
+///
+/// This must be called after the facets are added, and again if the row set is loaded again.
+/// Any selected values are deselected.
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_facets::aggregate()
+{
+    gde_trace_span span("gde_facets::aggregate", "facets");
+
+    unsigned int num_rows = my_row_set.num_rows();
+
+    // Values found so far in the columns that are not dictionary encoded, with their codes.
+    // Dictionary-encoded columns use the codes of the row set, in which NULL is `dict_size()`.
+
+    struct facet_source
+    {
+        bool                                      is_dict;
+        std::unordered_map<std::string, uint32_t> codes;
+        std::vector<std::string>                  values;
+        bool                                      has_null = false;
+    };
+    std::vector<facet_source> sources(facets.size());
+
+    for (unsigned int f = 0; f < facets.size(); f++)
+    {
+        facet_source& source = sources[f];
+        unsigned int  col    = facets[f].col;
+
+        facets[f].codes.assign(num_rows, 0);
+        source.is_dict = my_row_set.is_dict_encoded(col);
+        if (source.is_dict)
+        {
+            for (unsigned int code = 0; code < my_row_set.dict_size(col); code++)
+                source.values.push_back(my_row_set.dict_value(col, code));
+        }
+    }
+
+    // Find the code of each facet in each row, in one pass over the rows.
+
+    std::string data;
+    for (unsigned int row = 0; row < num_rows; row++)
+    {
+        for (unsigned int f = 0; f < facets.size(); f++)
+        {
+            facet_source& source = sources[f];
+            unsigned int  col    = facets[f].col;
+            uint32_t      code;
+
+            if (source.is_dict)
+            {
+                code = my_row_set.get_code(row, col);
+                if (code == source.values.size())
+                    source.has_null = true;
+            }
+            else if (!my_row_set.get_data(row, col, data))
+            {
+                code            = UINT32_MAX;
+                source.has_null = true;
+            }
+            else
+            {
+                auto found = source.codes.find(data);
+                if (found != source.codes.end())
+                    code = found->second;
+                else
+                {
+                    code = source.values.size();
+                    source.codes.emplace(data, code);
+                    source.values.push_back(data);
+                }
+            }
+            facets[f].codes[row] = code;
+        }
+    }
+
+    // Sort the values of each facet, count them, and list the rows of each value.
+
+    for (unsigned int f = 0; f < facets.size(); f++)
+    {
+        facet& fac = facets[f];
+        sort_values(fac, sources[f].values, sources[f].has_null);
+
+        unsigned int num_values = fac.values.size();
+        fac.counts.assign(num_values, 0);
+        for (uint32_t code : fac.codes)
+            fac.counts[code]++;
+
+        fac.row_start.assign(num_values + 1, 0);
+        for (unsigned int value = 0; value < num_values; value++)
+            fac.row_start[value + 1] = fac.row_start[value] + fac.counts[value];
+
+        std::vector<uint32_t> next(fac.row_start.begin(), fac.row_start.end() - 1);
+        fac.rows.resize(num_rows);
+        for (uint32_t row = 0; row < num_rows; row++)
+            fac.rows[next[fac.codes[row]]++] = row;
+
+        fac.selected.assign(num_values, false);
+        fac.num_selected = 0;
+    }
+
+    reject_mask.assign(num_rows, 0);
+    my_num_matches = num_rows;
+    aggregated     = true;
+}
+
+
+
+// This private member function sorts the values of a facet, and changes the codes of the rows to
+// match. Codes beyond the end of `raw_values` are NULL, and are sorted last. Values are compared
+// as numbers if the column has a numeric type.
+
+void gde_facets::sort_values(facet& fac, std::vector<std::string>& raw_values, bool has_null)
+{
+    db_data_type type    = my_row_set.col_desc(fac.col)->type();
+    bool         numeric = (type >= DB_TINYINT && type <= DB_DOUBLE) || type == DB_YEAR;
+
+    std::vector<double> numbers;
+    if (numeric)
+    {
+        for (const std::string& value : raw_values)
+            numbers.push_back(std::strtod(value.c_str(), nullptr));
+    }
+
+    std::vector<uint32_t> order(raw_values.size());
+    for (uint32_t i = 0; i < order.size(); i++)
+        order[i] = i;
+
+    std::sort(order.begin(), order.end(), [&] (uint32_t a, uint32_t b)
+    {
+        if (numeric && numbers[a] != numbers[b])
+            return numbers[a] < numbers[b];
+        return raw_values[a] < raw_values[b];
+    });
+
+    std::vector<uint32_t> remap(raw_values.size());
+    fac.values.clear();
+    fac.values.reserve(raw_values.size() + 1);
+    for (uint32_t i = 0; i < order.size(); i++)
+    {
+        remap[order[i]] = i;
+        fac.values.push_back(std::move(raw_values[order[i]]));
+    }
+
+    uint32_t null_code = fac.values.size();
+    fac.has_null       = has_null;
+    if (has_null)
+        fac.values.emplace_back();
+
+    for (uint32_t& code : fac.codes)
+        code = (code < remap.size()) ? remap[code] : null_code;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of facets
+///
+/// \return     number of facets
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int gde_facets::num_facets() const
+{
+    return facets.size();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the column of a facet
+///
+/// \param[in]  facet   facet number
+///
+/// \return     column number in the row set
+///
+/// \exception std::out_of_range thrown if the facet number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int gde_facets::facet_col(unsigned int facet) const
+{
+    if (facet >= facets.size())
+        throw std::out_of_range("Bad facet number in gde_facets::facet_col");
+
+    return facets[facet].col;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of distinct values of a facet
+///
+/// \param[in]  facet   facet number
+///
+/// \return     number of values, including NULL if any row is NULL
+///
+/// \exception std::out_of_range thrown if the facet number is out of range
+/// \exception std::logic_error  thrown if `aggregate()` has not been called since the last
+///                              facet was added
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int gde_facets::num_values(unsigned int facet) const
+{
+    check_facet(facet, "num_values");
+    return facets[facet].values.size();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get one of the values of a facet
+///
+/// \param[in]  facet   facet number
+/// \param[in]  value   value number, from 0 to `num_values(facet) - 1`
+///
+/// \return     the value, or an empty string for NULL
+///
+/// \exception std::out_of_range thrown if the facet or value number is out of range
+/// \exception std::logic_error  thrown if `aggregate()` has not been called
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_facets::value(unsigned int facet, unsigned int value) const
+{
+    check_facet(facet, "value");
+    return facets[facet].values.at(value);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Determine if a value of a facet is NULL
+///
+/// \param[in]  facet   facet number
+/// \param[in]  value   value number
+///
+/// \return     true if the value stands for the NULL fields (it is always the last value)
+///
+/// \exception std::out_of_range thrown if the facet or value number is out of range
+/// \exception std::logic_error  thrown if `aggregate()` has not been called
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool gde_facets::value_is_null(unsigned int facet, unsigned int value) const
+{
+    check_facet(facet, "value_is_null");
+
+    const struct facet& fac = facets[facet];
+    if (value >= fac.values.size())
+        throw std::out_of_range("Bad value number in gde_facets::value_is_null");
+
+    return fac.has_null && value == fac.values.size() - 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of rows with a value
+///
+/// Only the rows that match the selections of the other facets are counted. The selection of
+/// this facet does not change its own counts.
+///
+/// \param[in]  facet   facet number
+/// \param[in]  value   value number
+///
+/// \return     number of rows
+///
+/// \exception std::out_of_range thrown if the facet or value number is out of range
+/// \exception std::logic_error  thrown if `aggregate()` has not been called
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int gde_facets::count(unsigned int facet, unsigned int value) const
+{
+    check_facet(facet, "count");
+    return facets[facet].counts.at(value);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Find a value of a facet
+///
+/// \param[in]  facet   facet number
+/// \param[in]  value   value to look for (NULL cannot be found this way)
+/// \param[out] index   value number, if found
+///
+/// \return     true if some row has the value
+///
+/// \exception std::out_of_range thrown if the facet number is out of range
+/// \exception std::logic_error  thrown if `aggregate()` has not been called
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool gde_facets::find_value(unsigned int facet, const std::string& value, unsigned int& index) const
+{
+    check_facet(facet, "find_value");
+
+    const struct facet& fac = facets[facet];
+    unsigned int num_values = fac.values.size() - (fac.has_null ? 1 : 0);
+    for (unsigned int i = 0; i < num_values; i++)
+    {
+        if (fac.values[i] == value)
+        {
+            index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Select or deselect a value of a facet
+///
+/// If no value of a facet is selected, the facet accepts every row. Otherwise, it accepts only the
+/// rows with one of the selected values. The counts of the other facets are updated.
+///
+/// \param[in]  facet      facet number
+/// \param[in]  value      value number
+/// \param[in]  selected   true to select the value, false to deselect it
+///
+/// \exception std::out_of_range thrown if the facet or value number is out of range
+/// \exception std::logic_error  thrown if `aggregate()` has not been called
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_facets::select(unsigned int facet, unsigned int value, bool selected)
+{
+    check_facet(facet, "select");
+
+    struct facet& fac = facets[facet];
+    if (value >= fac.values.size())
+        throw std::out_of_range("Bad value number in gde_facets::select");
+    if (fac.selected[value] == selected)
+        return;
+
+    unsigned int old_num_selected = fac.num_selected;
+    fac.selected[value] = selected;
+    fac.num_selected   += selected ? 1 : -1;
+
+    // Find the rows whose acceptance by this facet changes. If this is the first value selected,
+    // or the last deselected, those are the rows of all the other values; otherwise, they are the
+    // rows of this value.
+
+    uint32_t bit      = (uint32_t) 1 << facet;
+    bool     all_vals = (old_num_selected == 0 || fac.num_selected == 0);
+
+    for (unsigned int val = 0; val < fac.values.size(); val++)
+    {
+        if (all_vals ? (val == value) : (val != value))
+            continue;
+
+        bool accept = (fac.num_selected == 0 || fac.selected[val]);
+        for (uint32_t i = fac.row_start[val]; i < fac.row_start[val + 1]; i++)
+        {
+            uint32_t row  = fac.rows[i];
+            uint32_t mask = accept ? (reject_mask[row] & ~bit) : (reject_mask[row] | bit);
+            update_row(row, mask);
+        }
+    }
+}
+
+
+
+// This private member function changes the mask of facets that reject a row, and updates the
+// counts. A row is counted in a facet if no other facet rejects it.
+
+void gde_facets::update_row(uint32_t row, uint32_t new_mask)
+{
+    uint32_t old_mask = reject_mask[row];
+    if (old_mask == new_mask)
+        return;
+
+    reject_mask[row] = new_mask;
+
+    for (unsigned int f = 0; f < facets.size(); f++)
+    {
+        uint32_t others = ~((uint32_t) 1 << f);
+        bool     was    = (old_mask & others) == 0;
+        bool     is     = (new_mask & others) == 0;
+        if (was != is)
+            facets[f].counts[facets[f].codes[row]] += is ? 1 : -1;
+    }
+
+    if (old_mask == 0)
+        my_num_matches--;
+    else if (new_mask == 0)
+        my_num_matches++;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Determine if a value of a facet is selected
+///
+/// \param[in]  facet   facet number
+/// \param[in]  value   value number
+///
+/// \return     true if the value is selected
+///
+/// \exception std::out_of_range thrown if the facet or value number is out of range
+/// \exception std::logic_error  thrown if `aggregate()` has not been called
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool gde_facets::is_selected(unsigned int facet, unsigned int value) const
+{
+    check_facet(facet, "is_selected");
+    return facets[facet].selected.at(value);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Deselect all values of a facet
+///
+/// \param[in]  facet   facet number
+///
+/// \exception std::out_of_range thrown if the facet number is out of range
+/// \exception std::logic_error  thrown if `aggregate()` has not been called
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_facets::clear_selection(unsigned int facet)
+{
+    check_facet(facet, "clear_selection");
+
+    struct facet& fac = facets[facet];
+    if (fac.num_selected == 0)
+        return;
+
+    fac.selected.assign(fac.values.size(), false);
+    fac.num_selected = 0;
+
+    uint32_t bit = (uint32_t) 1 << facet;
+    for (uint32_t row = 0; row < reject_mask.size(); row++)
+        update_row(row, reject_mask[row] & ~bit);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of rows that match the selections of all the facets
+///
+/// \return     number of rows
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int gde_facets::num_matches() const
+{
+    return aggregated ? my_num_matches : my_row_set.num_rows();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Determine if a row matches the selections of all the facets
+///
+/// \param[in]  row   row number
+///
+/// \return     true if no facet rejects the row
+///
+/// \exception std::out_of_range thrown if the row number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool gde_facets::row_matches(unsigned int row) const
+{
+    if (row >= my_row_set.num_rows())
+        throw std::out_of_range("Bad row number in gde_facets::row_matches");
+
+    return !aggregated || reject_mask[row] == 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the rows that match the selections of all the facets
+///
+/// \return     row numbers, in increasing order
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<unsigned int> gde_facets::matching_rows() const
+{
+    std::vector<unsigned int> rows;
+    rows.reserve(num_matches());
+
+    for (unsigned int row = 0; row < my_row_set.num_rows(); row++)
+    {
+        if (!aggregated || reject_mask[row] == 0)
+            rows.push_back(row);
+    }
+    return rows;
+}
+
+
+
+// This private member function checks a facet number, and that the counts are up to date.
+
+void gde_facets::check_facet(unsigned int facet, const char* func) const
+{
+    if (facet >= facets.size())
+        throw std::out_of_range(std::string("Bad facet number in gde_facets::") + func);
+    if (!aggregated)
+        throw std::logic_error(std::string("gde_facets::aggregate must be called before gde_facets::") + func);
+}
@@ -0,0 +1,75 @@
+///
+/// \file
+///
+
+#ifndef GDE_FACETS_H
+#define GDE_FACETS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "db_row_set.h"
+
+
+class gde_facets
+{
+public:
+    gde_facets (const db_row_set& row_set);
+
+    gde_facets (const gde_facets&) = delete;
+    gde_facets& operator= (const gde_facets&) = delete;
+
+    static const unsigned int MAX_FACETS = 32;
+
+    unsigned int  add_facet       (const std::string& col_name);
+    unsigned int  add_facet       (unsigned int col);
+    void          aggregate       ();
+
+    unsigned int  num_facets      () const;
+    unsigned int  facet_col       (unsigned int facet) const;
+    unsigned int  num_values      (unsigned int facet) const;
+    std::string   value           (unsigned int facet, unsigned int value) const;
+    bool          value_is_null   (unsigned int facet, unsigned int value) const;
+    unsigned int  count           (unsigned int facet, unsigned int value) const;
+    bool          find_value      (unsigned int facet, const std::string& value, unsigned int& index) const;
+
+    void          select          (unsigned int facet, unsigned int value, bool selected = true);
+    bool          is_selected     (unsigned int facet, unsigned int value) const;
+    void          clear_selection (unsigned int facet);
+
+    unsigned int  num_matches     () const;
+    bool          row_matches     (unsigned int row) const;
+    std::vector<unsigned int> matching_rows () const;
+
+private:
+
+    // One facet. The values are sorted (numerically for numeric columns), with NULL last. The
+    // rows of each value are listed together in `rows`, from `row_start[value]` up to
+    // `row_start[value + 1]`, so that a change to the selection only visits the rows affected.
+
+    struct facet
+    {
+        unsigned int               col;
+        std::vector<std::string>   values;
+        bool                       has_null     = false;   // true if the last value is NULL
+        std::vector<uint32_t>      codes;                  // value of each row
+        std::vector<unsigned int>  counts;                 // rows of each value that match the other facets
+        std::vector<uint32_t>      row_start;
+        std::vector<uint32_t>      rows;
+        std::vector<bool>          selected;
+        unsigned int               num_selected = 0;       // no value selected means all are
+    };
+
+    const db_row_set&      my_row_set;
+    std::vector<facet>     facets;
+    std::vector<uint32_t>  reject_mask;                    // bit f of a row is set if facet f rejects it
+    unsigned int           my_num_matches = 0;
+    bool                   aggregated     = false;
+
+    void          check_facet     (unsigned int facet, const char* func) const;
+    void          sort_values     (facet& fac, std::vector<std::string>& raw_values, bool has_null);
+    void          update_row      (uint32_t row, uint32_t new_mask);
+};
+
+#endif
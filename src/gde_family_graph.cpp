@@ -0,0 +1,500 @@
+///
+/// \class gde_family_graph gde_family_graph.h
+///
+/// \brief In-memory graph of the families in a PhpGedView database
+///
+/// The PHP function `pgv_get_children()` finds a person's children by scanning every `i_gedcom`
+/// record for a matching FAMC line, so walking through several generations means several full
+/// table scans. This class instead reads the `pgv_individuals` and `pgv_families` tables once
+/// and holds the family relationships in memory.
+///
+/// Each PhpGedView individual ID (such as "I123") is given a dense person number, from 0 to
+/// `num_persons()` - 1. The parent, child and spouse edges are stored as compressed sparse row
+/// adjacency lists: one array holding the neighbours of every person, in person order, and a
+/// second array holding the position of the first neighbour of each person. Finding all of the
+/// descendants of a person is then a short walk through these arrays.
+///
+/// The graph can also be built without a database: call `add_person()` and `add_family()`,
+/// and then `build()`.
+///
+
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "gde_family_graph.h"
+#include "gde_gedcom.h"
+#include "db_row_set.h"
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Load the graph from a PhpGedView database
+///
+/// Individuals are read from `pgv_individuals`, with their sex taken from the SEX line of the
+/// `i_gedcom` record. Families are read from `pgv_families`, with the husband and wife from the
+/// `f_husb` and `f_wife` fields and the children from the CHIL lines of the `f_gedcom` record.
+///
+/// \param[in]  db       database connection, which must currently be open
+/// \param[in]  prefix   prefix of the PhpGedView table names (normally the database name and
+///                      a period)
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_family_graph::load(database& db, std::string prefix)
+{
+    clear();
+
+    db_row_set        row_set;
+    gde_gedcom_record record;
+    std::string       id;
+    std::string       gedcom;
+    std::string       sex;
+
+    // Individuals
+
+    db.execute("SELECT i_id, i_gedcom FROM " + prefix + "pgv_individuals", row_set);
+    for (unsigned int row=0; row<row_set.num_rows(); row++)
+    {
+        row_set.get_data(row, 0, id);
+        row_set.get_data(row, 1, gedcom);
+
+        record.parse(gedcom);
+        record.value(sex, "SEX");
+        add_person(id, sex.empty() ? 'U' : sex[0]);
+    }
+
+    // Families
+
+    std::string              husband;
+    std::string              wife;
+    std::vector<std::string> child_ids;
+    std::vector<int>         lines;
+
+    db.execute("SELECT f_husb, f_wife, f_gedcom FROM " + prefix + "pgv_families", row_set);
+    for (unsigned int row=0; row<row_set.num_rows(); row++)
+    {
+        row_set.get_data(row, 0, husband);
+        row_set.get_data(row, 1, wife);
+        row_set.get_data(row, 2, gedcom);
+
+        record.parse(gedcom);
+        record.find_all("CHIL", lines);
+
+        child_ids.clear();
+        for (int l : lines)
+        {
+            gde_str_ref child = gde_gedcom_record::pointer(record.get_line(l).value);
+            if (!child.empty())
+                child_ids.push_back(child.str());
+        }
+
+        add_family(husband, wife, child_ids);
+    }
+
+    build();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Remove all persons and families from the graph
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_family_graph::clear()
+{
+    id_list.clear();
+    sex_list.clear();
+    id_map.clear();
+    parent_csr = csr_list();
+    child_csr  = csr_list();
+    spouse_csr = csr_list();
+    parent_child_edges.clear();
+    spouse_edges.clear();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Add a person to the graph
+///
+/// If the person is already in the graph, then only the sex is updated (unless it is 'U').
+///
+/// \param[in]  pgv_id   PhpGedView individual ID
+/// \param[in]  sex      'M', 'F' or 'U' (unknown)
+///
+/// \return     person number
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int gde_family_graph::add_person(const std::string& pgv_id, char sex)
+{
+    auto it = id_map.find(pgv_id);
+    if (it != id_map.end())
+    {
+        if (sex != 'U')
+            sex_list[it->second] = sex;
+        return it->second;
+    }
+
+    int person = id_list.size();
+    id_list.push_back(pgv_id);
+    sex_list.push_back(sex);
+    id_map[pgv_id] = person;
+    return person;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Add a family to the graph
+///
+/// Any persons who are not yet in the graph are added. The changes take effect when `build()`
+/// is called.
+///
+/// \param[in]  husband    PhpGedView ID of the husband, or an empty string if unknown
+/// \param[in]  wife       PhpGedView ID of the wife, or an empty string if unknown
+/// \param[in]  children   PhpGedView IDs of the children
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_family_graph::add_family(const std::string& husband, const std::string& wife,
+                                  const std::vector<std::string>& children)
+{
+    int h = husband.empty() ? -1 : add_person(husband);
+    int w = wife.empty()    ? -1 : add_person(wife);
+
+    if (h >= 0 && w >= 0)
+        spouse_edges.push_back(std::make_pair(h, w));
+
+    for (const std::string& child_id : children)
+    {
+        int c = add_person(child_id);
+        if (h >= 0)
+            parent_child_edges.push_back(std::make_pair(h, c));
+        if (w >= 0)
+            parent_child_edges.push_back(std::make_pair(w, c));
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Build the adjacency lists
+///
+/// This must be called after persons and families have been added, and before the graph is
+/// used.
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_family_graph::build()
+{
+    int n = id_list.size();
+
+    // Parent to child, and child to parent.
+
+    make_csr(n, parent_child_edges, child_csr);
+
+    std::vector<std::pair<int, int>> reversed;
+    reversed.reserve(parent_child_edges.size());
+    for (const std::pair<int, int>& e : parent_child_edges)
+        reversed.push_back(std::make_pair(e.second, e.first));
+    make_csr(n, reversed, parent_csr);
+
+    // Spouses, in both directions.
+
+    std::vector<std::pair<int, int>> both;
+    both.reserve(2 * spouse_edges.size());
+    for (const std::pair<int, int>& e : spouse_edges)
+    {
+        both.push_back(e);
+        both.push_back(std::make_pair(e.second, e.first));
+    }
+    make_csr(n, both, spouse_csr);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of persons in the graph
+///
+/// \return     number of persons
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int gde_family_graph::num_persons() const
+{
+    return id_list.size();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Find a person by PhpGedView ID
+///
+/// \param[in]  pgv_id   PhpGedView individual ID
+///
+/// \return     person number, or -1 if the person is not in the graph
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int gde_family_graph::find_person(const std::string& pgv_id) const
+{
+    auto it = id_map.find(pgv_id);
+    return (it == id_map.end()) ? -1 : it->second;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the PhpGedView ID of a person
+///
+/// \param[in]  person   person number
+///
+/// \return     PhpGedView individual ID
+///
+/// \exception std::out_of_range thrown if the person number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_family_graph::pgv_id(int person) const
+{
+    test_input(person);
+    return id_list[person];
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the sex of a person
+///
+/// \param[in]  person   person number
+///
+/// \return     'M', 'F' or 'U' (unknown)
+///
+/// \exception std::out_of_range thrown if the person number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+char gde_family_graph::sex(int person) const
+{
+    test_input(person);
+    return sex_list[person];
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the parents of a person
+///
+/// \param[in]  person   person number
+///
+/// \return     range of person numbers
+///
+/// \exception std::out_of_range thrown if the person number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gde_person_range gde_family_graph::parents(int person) const
+{
+    test_input(person);
+    return range(parent_csr, person);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the children of a person
+///
+/// \param[in]  person   person number
+///
+/// \return     range of person numbers
+///
+/// \exception std::out_of_range thrown if the person number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gde_person_range gde_family_graph::children(int person) const
+{
+    test_input(person);
+    return range(child_csr, person);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the spouses of a person
+///
+/// \param[in]  person   person number
+///
+/// \return     range of person numbers
+///
+/// \exception std::out_of_range thrown if the person number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gde_person_range gde_family_graph::spouses(int person) const
+{
+    test_input(person);
+    return range(spouse_csr, person);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Find all of the ancestors of a person
+///
+/// The ancestors are listed generation by generation: parents, then grandparents, and so on.
+/// Each ancestor is listed once, even if they can be reached along more than one line.
+///
+/// \param[in]  person            person number
+/// \param[out] result            person numbers of the ancestors
+/// \param[in]  max_generations   number of generations to search, or -1 for no limit
+///
+/// \exception std::out_of_range thrown if the person number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_family_graph::ancestors(int person, std::vector<int>& result, int max_generations) const
+{
+    test_input(person);
+    traverse(person, parent_csr, result, max_generations);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Find all of the descendants of a person
+///
+/// The descendants are listed generation by generation: children, then grandchildren, and so
+/// on. Each descendant is listed once.
+///
+/// \param[in]  person            person number
+/// \param[out] result            person numbers of the descendants
+/// \param[in]  max_generations   number of generations to search, or -1 for no limit
+///
+/// \exception std::out_of_range thrown if the person number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_family_graph::descendants(int person, std::vector<int>& result, int max_generations) const
+{
+    test_input(person);
+    traverse(person, child_csr, result, max_generations);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Turn a list of edges into a compressed sparse row adjacency list, with the neighbours of each
+// node sorted and without duplicates.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_family_graph::make_csr(int num_nodes, std::vector<std::pair<int, int>>& edges, csr_list& csr)
+{
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    csr.start.assign(num_nodes + 1, 0);
+    csr.list.resize(edges.size());
+
+    for (size_t i=0; i<edges.size(); i++)
+    {
+        csr.start[edges[i].first + 1]++;
+        csr.list[i] = edges[i].second;
+    }
+    for (int p=0; p<num_nodes; p++)
+        csr.start[p + 1] += csr.start[p];
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Get the neighbours of a person. Persons added since the last build() have none.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gde_person_range gde_family_graph::range(const csr_list& csr, int person)
+{
+    if (person + 1 >= (int) csr.start.size())
+        return gde_person_range(nullptr, nullptr);
+
+    const int* base = csr.list.data();
+    return gde_person_range(base + csr.start[person], base + csr.start[person + 1]);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Breadth-first walk along one kind of edge.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_family_graph::traverse(int person, const csr_list& csr, std::vector<int>& result,
+                                int max_generations) const
+{
+    result.clear();
+    if (max_generations == 0)
+        return;
+
+    std::vector<bool> visited(id_list.size(), false);
+    visited[person] = true;
+
+    for (int p : range(csr, person))
+        if (!visited[p])
+        {
+            visited[p] = true;
+            result.push_back(p);
+        }
+
+    // Each pass of this loop adds the next generation.
+
+    size_t gen_start = 0;
+    for (int gen=1; gen_start < result.size() && (max_generations < 0 || gen < max_generations); gen++)
+    {
+        size_t gen_end = result.size();
+        for (size_t i=gen_start; i<gen_end; i++)
+            for (int p : range(csr, result[i]))
+                if (!visited[p])
+                {
+                    visited[p] = true;
+                    result.push_back(p);
+                }
+        gen_start = gen_end;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Make sure the person number is valid.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_family_graph::test_input(int person) const
+{
+    if (person < 0 || person >= (int) id_list.size())
+        throw std::out_of_range("Person number in gde_family_graph:: is out of range");
+}
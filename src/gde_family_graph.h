@@ -0,0 +1,92 @@
+///
+/// \file
+///
+
+#ifndef GDE_FAMILY_GRAPH_H
+#define GDE_FAMILY_GRAPH_H
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "database.h"
+
+
+///
+/// \brief Range of person numbers in the family graph
+///
+/// This refers directly to the graph's internal arrays, and can be used in a range-based for
+/// loop. It is only valid until the graph is changed.
+///
+
+class gde_person_range
+{
+public:
+    gde_person_range (const int* first, const int* last) : my_first(first), my_last(last) {}
+
+    const int* begin () const { return my_first; }
+    const int* end   () const { return my_last; }
+    size_t     size  () const { return my_last - my_first; }
+    bool       empty () const { return my_first == my_last; }
+
+private:
+    const int* my_first;
+    const int* my_last;
+};
+
+
+
+class gde_family_graph
+{
+public:
+    void             load           (database& db, std::string prefix = "phpgedview.");
+    void             clear          ();
+    int              add_person     (const std::string& pgv_id, char sex = 'U');
+    void             add_family     (const std::string& husband, const std::string& wife,
+                                     const std::vector<std::string>& children);
+    void             build          ();
+
+    int              num_persons    () const;
+    int              find_person    (const std::string& pgv_id) const;
+    std::string      pgv_id         (int person) const;
+    char             sex            (int person) const;
+
+    gde_person_range parents        (int person) const;
+    gde_person_range children       (int person) const;
+    gde_person_range spouses        (int person) const;
+
+    void             ancestors      (int person, std::vector<int>& result, int max_generations = -1) const;
+    void             descendants    (int person, std::vector<int>& result, int max_generations = -1) const;
+
+private:
+
+    // Compressed sparse row adjacency list: the neighbours of person p are
+    // list[start[p]] to list[start[p+1]-1].
+
+    struct csr_list
+    {
+        std::vector<int> start;
+        std::vector<int> list;
+    };
+
+    std::vector<std::string>             id_list;
+    std::vector<char>                    sex_list;
+    std::unordered_map<std::string, int> id_map;
+
+    csr_list parent_csr;
+    csr_list child_csr;
+    csr_list spouse_csr;
+
+    // Edges collected by add_family(), until build() is called.
+
+    std::vector<std::pair<int, int>> parent_child_edges;
+    std::vector<std::pair<int, int>> spouse_edges;
+
+    static void make_csr   (int num_nodes, std::vector<std::pair<int, int>>& edges, csr_list& csr);
+    static gde_person_range range (const csr_list& csr, int person);
+    void        traverse   (int person, const csr_list& csr, std::vector<int>& result, int max_generations) const;
+    void        test_input (int person) const;
+};
+
+#endif
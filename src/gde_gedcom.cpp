@@ -0,0 +1,1075 @@
+///
+/// \class gde_gedcom_record gde_gedcom.h
+///
+/// \brief Parses one GEDCOM record into a tree of tagged lines
+///
+/// A GEDCOM record is a sequence of lines of the form
+///
+///     level [@xref@] tag [value]
+///
+/// where each line is subordinate to the nearest preceding line with a lower level number. This
+/// class splits a record into its lines and links them into a tree, so that values can be looked
+/// up by a path of tags, such as BIRT / DATE. It is the C++ equivalent of the PHP functions
+/// `parse_gedcom()` and `parse_gedcom_xref()` in pgv_connect.php, but the record is parsed only
+/// once, however many values are looked up.
+///
+/// The parser does not copy the text. Each line holds references (`gde_str_ref`) to its xref,
+/// tag and value within the original text, which must therefore stay unchanged for as long as
+/// the parsed record is used. The line list is reused from one call of `parse()` to the next, so
+/// once it has grown to the size of the largest record no more memory is allocated.
+///
+/// The text may be a complete record that starts with a level 0 line (as in the `i_gedcom` and
+/// `f_gedcom` fields of PhpGedView) or just a set of level 1 lines. Lines may end in LF or CR LF.
+///
+
+
+///
+/// \class gde_gedcom_reader gde_gedcom.h
+///
+/// \brief Reads the records of a GEDCOM file, one at a time
+///
+/// The file is read in large blocks into a buffer, and each call to `next()` parses the next
+/// level 0 record directly from the buffer. Files of any size can be processed without loading
+/// them into memory, and without copying the text of each record.
+///
+
+
+///
+/// \class gde_gedcom_writer gde_gedcom.h
+///
+/// \brief Writes a GEDCOM file
+///
+/// Lines are built directly in a buffer, which is written to the file whenever it fills up, so
+/// a file of any size can be written without holding it in memory. Values are written as
+/// GEDCOM text: "@" is doubled, line breaks become CONT lines, and long values are split into
+/// CONC lines (never in the middle of a UTF-8 character or just before a space).
+///
+
+
+#include <algorithm>
+#include <cctype>
+#include <ctime>
+#include <stdexcept>
+
+#include "gde_gedcom.h"
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Parse a GEDCOM record
+///
+/// Lines that do not start with a level number are ignored. If the level number jumps by more
+/// than one, then the line is still made subordinate to the preceding line.
+///
+/// \param[in]  text     GEDCOM text, which must remain unchanged while this record is in use
+/// \param[in]  length   length of the text
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_gedcom_record::parse(const char* text, size_t length)
+{
+    line_list.clear();
+    level_stack.clear();
+
+    const char* p   = text;
+    const char* end = text + length;
+
+    while (p < end)
+    {
+        // Find the end of this line, and drop any CR before the LF.
+
+        const char* eol = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (eol == nullptr)
+            eol = end;
+        const char* e = eol;
+        if (e > p && e[-1] == '\r')
+            e--;
+
+        const char* q = p;
+        p = eol + 1;
+
+        while (q < e && (*q == ' ' || *q == '\t'))
+            q++;
+        if (q == e || !std::isdigit((unsigned char) *q))
+            continue;
+
+        // Level number
+
+        line ln;
+        ln.level = 0;
+        while (q < e && std::isdigit((unsigned char) *q))
+            ln.level = 10 * ln.level + (*q++ - '0');
+        while (q < e && *q == ' ')
+            q++;
+
+        // Optional cross-reference ID
+
+        if (q < e && *q == '@')
+        {
+            const char* at = static_cast<const char*>(std::memchr(q + 1, '@', e - q - 1));
+            if (at != nullptr)
+            {
+                ln.xref = gde_str_ref(q + 1, at - q - 1);
+                q = at + 1;
+                while (q < e && *q == ' ')
+                    q++;
+            }
+        }
+
+        // Tag, and the value after a single space delimiter
+
+        const char* tag = q;
+        while (q < e && *q != ' ')
+            q++;
+        ln.tag = gde_str_ref(tag, q - tag);
+        if (q < e)
+            q++;
+        ln.value = gde_str_ref(q, e - q);
+
+        // Link the line into the tree. Close any open lines at this level or below; the last
+        // one closed (if any) is the previous sibling of this line.
+
+        int line_num = line_list.size();
+        int prev     = -1;
+        while (!level_stack.empty() && line_list[level_stack.back()].level >= ln.level)
+        {
+            prev = level_stack.back();
+            level_stack.pop_back();
+        }
+
+        ln.parent       = level_stack.empty() ? -1 : level_stack.back();
+        ln.first_child  = -1;
+        ln.next_sibling = -1;
+
+        if (prev >= 0)
+            line_list[prev].next_sibling = line_num;
+        else if (ln.parent >= 0)
+            line_list[ln.parent].first_child = line_num;
+
+        level_stack.push_back(line_num);
+        line_list.push_back(ln);
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Parse a GEDCOM record
+///
+/// \param[in]  text   GEDCOM text, which must remain unchanged while this record is in use
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_gedcom_record::parse(const std::string& text)
+{
+    parse(text.data(), text.size());
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of lines in the record
+///
+/// \return     number of lines
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t gde_gedcom_record::num_lines() const
+{
+    return line_list.size();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get one line of the record
+///
+/// \param[in]  line_num   line number, starting from 0
+///
+/// \return     reference to the line
+///
+/// \exception std::out_of_range thrown if the line number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const gde_gedcom_record::line& gde_gedcom_record::get_line(int line_num) const
+{
+    test_input(line_num);
+    return line_list[line_num];
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the cross-reference ID of the record
+///
+/// \return     ID from the level 0 line (such as "I123"), or an empty reference
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gde_str_ref gde_gedcom_record::xref() const
+{
+    if (line_list.empty() || line_list[0].level != 0)
+        return gde_str_ref();
+    return line_list[0].xref;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the record type
+///
+/// \return     tag from the level 0 line (such as "INDI" or "FAM"), or an empty reference
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gde_str_ref gde_gedcom_record::tag() const
+{
+    if (line_list.empty() || line_list[0].level != 0)
+        return gde_str_ref();
+    return line_list[0].tag;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Find a line by its path of tags
+///
+/// For example, `find("BIRT", "DATE")` finds the DATE line within the first BIRT structure of
+/// the record. Only the first match at each level is considered, as in the PHP function
+/// `parse_gedcom()`.
+///
+/// \param[in]  tag_1   level 1 tag
+/// \param[in]  tag_2   level 2 tag (optional)
+/// \param[in]  tag_3   level 3 tag (optional)
+///
+/// \return     line number, or -1 if the line was not found
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int gde_gedcom_record::find(const char* tag_1, const char* tag_2, const char* tag_3) const
+{
+    int l = first_top_line();
+    while (l >= 0 && line_list[l].tag != tag_1)
+        l = line_list[l].next_sibling;
+
+    if (l >= 0 && tag_2 != nullptr)
+        l = find_child(l, tag_2);
+    if (l >= 0 && tag_3 != nullptr)
+        l = find_child(l, tag_3);
+    return l;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Find the first subordinate line with a given tag
+///
+/// \param[in]  line_num   line number of the superior line
+/// \param[in]  tag        tag to look for
+///
+/// \return     line number, or -1 if the line was not found
+///
+/// \exception std::out_of_range thrown if the line number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int gde_gedcom_record::find_child(int line_num, const char* tag) const
+{
+    test_input(line_num);
+
+    int l = line_list[line_num].first_child;
+    while (l >= 0 && line_list[l].tag != tag)
+        l = line_list[l].next_sibling;
+    return l;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Find all of the level 1 lines with a given tag
+///
+/// This is used for tags that may be repeated, such as CHIL in a family record.
+///
+/// \param[in]  tag         tag to look for
+/// \param[out] line_nums   line numbers of the matching lines
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_gedcom_record::find_all(const char* tag, std::vector<int>& line_nums) const
+{
+    line_nums.clear();
+    for (int l = first_top_line(); l >= 0; l = line_list[l].next_sibling)
+        if (line_list[l].tag == tag)
+            line_nums.push_back(l);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get a value by its path of tags
+///
+/// Unlike the PHP function `parse_gedcom()`, only the value of the line itself is returned, and
+/// not the text of its subordinate lines. Any CONC and CONT lines are joined to the value.
+///
+/// \param[out] data    the value, or an empty string if the line was not found
+/// \param[in]  tag_1   level 1 tag
+/// \param[in]  tag_2   level 2 tag (optional)
+/// \param[in]  tag_3   level 3 tag (optional)
+///
+/// \return     `true` if the line was found
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool gde_gedcom_record::value(std::string& data, const char* tag_1, const char* tag_2,
+                              const char* tag_3) const
+{
+    int l = find(tag_1, tag_2, tag_3);
+    if (l < 0)
+    {
+        data.clear();
+        return false;
+    }
+
+    data = full_value(l);
+    return true;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get a cross-reference pointer by its path of tags
+///
+/// This is the equivalent of the PHP function `parse_gedcom_xref()`.
+///
+/// \param[out] data    the pointer without its '@' delimiters, or an empty string
+/// \param[in]  tag_1   level 1 tag
+/// \param[in]  tag_2   level 2 tag (optional)
+/// \param[in]  tag_3   level 3 tag (optional)
+///
+/// \return     `true` if the line was found and its value contains a pointer
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool gde_gedcom_record::xref_value(std::string& data, const char* tag_1, const char* tag_2,
+                                   const char* tag_3) const
+{
+    int l = find(tag_1, tag_2, tag_3);
+    gde_str_ref ptr = (l >= 0) ? pointer(line_list[l].value) : gde_str_ref();
+
+    data = ptr.str();
+    return !ptr.empty();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the value of a line, with any CONC and CONT lines joined to it
+///
+/// \param[in]  line_num   line number
+///
+/// \return     the value
+///
+/// \exception std::out_of_range thrown if the line number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_gedcom_record::full_value(int line_num) const
+{
+    test_input(line_num);
+
+    std::string data = line_list[line_num].value.str();
+    for (int l = line_list[line_num].first_child; l >= 0; l = line_list[l].next_sibling)
+    {
+        if (line_list[l].tag == "CONC")
+            data.append(line_list[l].value.ptr, line_list[l].value.len);
+        else if (line_list[l].tag == "CONT")
+        {
+            data += '\n';
+            data.append(line_list[l].value.ptr, line_list[l].value.len);
+        }
+    }
+    return data;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Find the cross-reference pointer in a line value
+///
+/// \param[in]  value   line value, such as "@I123@"
+///
+/// \return     the pointer without its '@' delimiters, or an empty reference
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gde_str_ref gde_gedcom_record::pointer(gde_str_ref value)
+{
+    const char* end = value.ptr + value.len;
+    const char* at1 = static_cast<const char*>(std::memchr(value.ptr, '@', value.len));
+    if (at1 == nullptr)
+        return gde_str_ref();
+
+    const char* at2 = static_cast<const char*>(std::memchr(at1 + 1, '@', end - at1 - 1));
+    if (at2 == nullptr)
+        return gde_str_ref();
+
+    return gde_str_ref(at1 + 1, at2 - at1 - 1);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Get the first line below the level 0 line, or the first line if there is no level 0 line.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int gde_gedcom_record::first_top_line() const
+{
+    if (line_list.empty())
+        return -1;
+    if (line_list[0].level == 0)
+        return line_list[0].first_child;
+    return 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Make sure the line number is valid.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_gedcom_record::test_input(int line_num) const
+{
+    if (line_num < 0 || line_num >= (int) line_list.size())
+        throw std::out_of_range("Line number in gde_gedcom_record:: is out of range");
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Constructor
+///
+/// \param[in]  buffer_size   initial size of the read buffer, in bytes. The buffer grows if a
+///                           single record does not fit.
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gde_gedcom_reader::gde_gedcom_reader(size_t buffer_size) :
+    buffer(std::max(buffer_size, (size_t) 256))
+{
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Destructor
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gde_gedcom_reader::~gde_gedcom_reader()
+{
+    close();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Open a GEDCOM file
+///
+/// \param[in]  file_name   file name
+///
+/// \exception std::runtime_error thrown if the file cannot be opened
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_gedcom_reader::open(const std::string& file_name)
+{
+    close();
+
+    file = std::fopen(file_name.c_str(), "rb");
+    if (file == nullptr)
+        throw std::runtime_error("Unable to open GEDCOM file " + file_name);
+
+    buf_begin      = 0;
+    buf_end        = 0;
+    at_eof         = false;
+    my_num_records = 0;
+
+    // Skip a UTF-8 byte order mark.
+
+    fill_buffer();
+    if (buf_end >= 3 && std::memcmp(&buffer[0], "\xEF\xBB\xBF", 3) == 0)
+        buf_begin = 3;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Close the GEDCOM file
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_gedcom_reader::close()
+{
+    if (file != nullptr)
+    {
+        std::fclose(file);
+        file = nullptr;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Read the next record
+///
+/// The record refers to text in the read buffer, so it is only valid until the next call.
+///
+/// \param[out] record   the next record
+///
+/// \return     `true` if a record was read, or `false` at the end of the file
+///
+/// \exception std::runtime_error thrown if the file is not open
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool gde_gedcom_reader::next(gde_gedcom_record& record)
+{
+    if (file == nullptr)
+        throw std::runtime_error("GEDCOM file not open in gde_gedcom_reader::next");
+
+    for (;;)
+    {
+        // Skip blank lines between records.
+
+        while (buf_begin < buf_end && std::isspace((unsigned char) buffer[buf_begin]))
+            buf_begin++;
+        if (buf_begin == buf_end && !fill_buffer())
+            return false;
+        if (buf_begin == buf_end)
+            continue;
+
+        // A record ends where the next level 0 line starts. If that's not in the buffer yet,
+        // then read some more of the file.
+
+        size_t end = find_record_end(buf_begin);
+        if (end == std::string::npos)
+        {
+            if (!at_eof && fill_buffer())
+                continue;
+            end = buf_end;
+        }
+
+        record.parse(&buffer[buf_begin], end - buf_begin);
+        buf_begin = end;
+        my_num_records++;
+        return true;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of records read so far
+///
+/// \return     number of records
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t gde_gedcom_reader::num_records() const
+{
+    return my_num_records;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Find the start of the next level 0 line after the one at position "from", or return npos if
+// it can't be found in the data that are in the buffer.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t gde_gedcom_reader::find_record_end(size_t from) const
+{
+    const char* base = &buffer[0];
+    const char* p    = base + from;
+    const char* end  = base + buf_end;
+
+    for (;;)
+    {
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (nl == nullptr)
+            return std::string::npos;
+
+        const char* q = nl + 1;
+        while (q < end && (*q == ' ' || *q == '\t' || *q == '\r' || *q == '\n'))
+            q++;
+
+        // Two more characters are needed to recognize "0 ".
+
+        if (end - q < 2)
+            return std::string::npos;
+        if (q[0] == '0' && (q[1] == ' ' || q[1] == '\r' || q[1] == '\n'))
+            return nl + 1 - base;
+
+        p = nl + 1;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Move the unparsed data to the start of the buffer, grow the buffer if it's full, and read
+// more of the file. Returns false if nothing more could be read.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool gde_gedcom_reader::fill_buffer()
+{
+    if (at_eof)
+        return false;
+
+    if (buf_begin > 0)
+    {
+        std::memmove(&buffer[0], &buffer[buf_begin], buf_end - buf_begin);
+        buf_end  -= buf_begin;
+        buf_begin = 0;
+    }
+    if (buf_end == buffer.size())
+        buffer.resize(2 * buffer.size());
+
+    size_t n = std::fread(&buffer[buf_end], 1, buffer.size() - buf_end, file);
+    buf_end += n;
+    if (n == 0)
+        at_eof = true;
+    return n > 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Constructor
+///
+/// \param[in]  buffer_size   size of the output buffer, in bytes
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gde_gedcom_writer::gde_gedcom_writer(size_t buffer_size) :
+    buffer(std::max(buffer_size, (size_t) 1024))
+{
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Destructor
+///
+/// Any buffered data is written. Call `close()` first to find out whether that succeeded.
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gde_gedcom_writer::~gde_gedcom_writer()
+{
+    try
+    {
+        close();
+    }
+    catch (const std::runtime_error&)
+    {
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Create a GEDCOM file
+///
+/// An existing file with the same name is replaced.
+///
+/// \param[in]  file_name   file name
+///
+/// \exception std::runtime_error thrown if the file cannot be created
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_gedcom_writer::open(const std::string& file_name)
+{
+    close();
+
+    file = std::fopen(file_name.c_str(), "wb");
+    if (file == nullptr)
+        throw std::runtime_error("Unable to create GEDCOM file " + file_name);
+
+    my_file_name     = file_name;
+    buf_end          = 0;
+    my_bytes_written = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Write any buffered data and close the file
+///
+/// \exception std::runtime_error thrown if the data cannot be written
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_gedcom_writer::close()
+{
+    if (file == nullptr)
+        return;
+
+    std::FILE* f = file;
+    bool ok = true;
+    try
+    {
+        flush();
+    }
+    catch (const std::runtime_error&)
+    {
+        ok = false;
+    }
+
+    file = nullptr;
+    if (std::fclose(f) != 0 || !ok)
+        throw std::runtime_error("Unable to write GEDCOM file " + my_file_name);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Write the buffered data to the file
+///
+/// \exception std::runtime_error thrown if the data cannot be written
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_gedcom_writer::flush()
+{
+    if (file == nullptr || buf_end == 0)
+        return;
+
+    size_t n = buf_end;
+    buf_end = 0;
+    if (std::fwrite(&buffer[0], 1, n, file) != n)
+        throw std::runtime_error("Unable to write GEDCOM file " + my_file_name);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Write the header record
+///
+/// The header declares GEDCOM 5.5.1 in UTF-8, and is followed by the submitter record that it
+/// refers to.
+///
+/// \param[in]  submitter   name of the person or organization that made the file
+///
+/// \exception std::runtime_error thrown if the data cannot be written
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_gedcom_writer::write_header(const std::string& submitter)
+{
+    static const char* const month_names[] =
+        { "JAN", "FEB", "MAR", "APR", "MAY", "JUN", "JUL", "AUG", "SEP", "OCT", "NOV", "DEC" };
+
+    std::time_t now = std::time(nullptr);
+    std::tm*    today = std::localtime(&now);
+
+    write_record("", "HEAD");
+    write_line(1, "SOUR", "GENDAT");
+    write_line(2, "NAME", "GenDat Explorer");
+    if (today != nullptr)
+        write_line(1, "DATE", std::to_string(today->tm_mday) + " " + month_names[today->tm_mon] +
+                              " " + std::to_string(today->tm_year + 1900));
+    write_pointer(1, "SUBM", "U1");
+    write_line(1, "GEDC");
+    write_line(2, "VERS", "5.5.1");
+    write_line(2, "FORM", "LINEAGE-LINKED");
+    write_line(1, "CHAR", "UTF-8");
+
+    write_record("U1", "SUBM");
+    write_line(1, "NAME", submitter.empty() ? std::string("GenDat") : submitter);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Write the trailer record, which must be the last record in the file
+///
+/// \exception std::runtime_error thrown if the data cannot be written
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_gedcom_writer::write_trailer()
+{
+    write_record("", "TRLR");
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Start a new record
+///
+/// \param[in]  xref    cross-reference ID, without the '@' delimiters, or empty for none
+/// \param[in]  tag     record type, such as INDI
+/// \param[in]  value   optional value
+///
+/// \exception std::runtime_error thrown if the data cannot be written
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_gedcom_writer::write_record(const std::string& xref, const char* tag, const std::string& value)
+{
+    if (xref.empty())
+    {
+        put_text(0, tag, value);
+        return;
+    }
+
+    put("0 @", 3);
+    put(xref);
+    put("@ ", 2);
+    put_text(-1, tag, value);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Write one line, with a text value
+///
+/// \param[in]  level   level number (1 or more)
+/// \param[in]  tag     tag
+/// \param[in]  value   value, or empty for none
+///
+/// \exception std::runtime_error thrown if the data cannot be written
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_gedcom_writer::write_line(int level, const char* tag, const std::string& value)
+{
+    put_text(level, tag, value);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Write one line, with a pointer to another record
+///
+/// \param[in]  level   level number (1 or more)
+/// \param[in]  tag     tag, such as FAMC
+/// \param[in]  xref    cross-reference ID of the other record, without the '@' delimiters
+///
+/// \exception std::runtime_error thrown if the data cannot be written
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_gedcom_writer::write_pointer(int level, const char* tag, const std::string& xref)
+{
+    put_level(level);
+    put(tag, std::strlen(tag));
+    put(" @", 2);
+    put(xref);
+    put("@\n", 2);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of bytes written so far
+///
+/// \return     number of bytes, including any that are still in the buffer
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t gde_gedcom_writer::bytes_written() const
+{
+    return my_bytes_written;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Add data to the buffer, writing the buffer to the file whenever it is full.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_gedcom_writer::put(const char* data, size_t length)
+{
+    if (file == nullptr)
+        throw std::runtime_error("GEDCOM file not open");
+
+    my_bytes_written += length;
+    while (length > 0)
+    {
+        if (buf_end == buffer.size())
+            flush();
+
+        size_t n = std::min(length, buffer.size() - buf_end);
+        std::memcpy(&buffer[buf_end], data, n);
+        buf_end += n;
+        data    += n;
+        length  -= n;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Add a level number and a space to the buffer.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_gedcom_writer::put_level(int level)
+{
+    char text[16];
+    int  n = 0;
+
+    if (level >= 10)
+        text[n++] = (char) ('0' + (level / 10) % 10);
+    text[n++] = (char) ('0' + level % 10);
+    text[n++] = ' ';
+    put(text, n);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Add part of a text value to the buffer, doubling each '@'.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_gedcom_writer::put_value(const char* data, size_t length)
+{
+    const char* end = data + length;
+    while (data < end)
+    {
+        const char* at = static_cast<const char*>(std::memchr(data, '@', end - data));
+        if (at == nullptr)
+        {
+            put(data, end - data);
+            return;
+        }
+
+        put(data, at + 1 - data);
+        put("@", 1);
+        data = at + 1;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Write a line with a text value, adding CONT and CONC lines as required. A level of -1 means
+// that the level and xref have already been written.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_gedcom_writer::put_text(int level, const char* tag, const std::string& value)
+{
+    // The whole line must fit in 255 characters. Allow for the level, tag and doubled '@'s.
+
+    static const size_t MAX_PART = 200;
+
+    if (level >= 0)
+        put_level(level);
+    put(tag, std::strlen(tag));
+
+    int    sub_level  = (level < 0 ? 0 : level) + 1;
+    size_t line_start = 0;
+    bool   first      = true;
+
+    do
+    {
+        size_t line_end = value.find('\n', line_start);
+        if (line_end == std::string::npos)
+            line_end = value.size();
+
+        // Drop a CR that ends the line.
+
+        size_t text_end = line_end;
+        if (text_end > line_start && value[text_end - 1] == '\r')
+            text_end--;
+
+        size_t part_start = line_start;
+        do
+        {
+            size_t part_end = text_end;
+            if (part_end - part_start > MAX_PART)
+            {
+                // Do not split a UTF-8 character, or leave a space at the start of the next
+                // part, where some programs would drop it.
+
+                part_end = part_start + MAX_PART;
+                while (part_end > part_start + 1 &&
+                        (((unsigned char) value[part_end] & 0xC0) == 0x80 || value[part_end] == ' '))
+                    part_end--;
+            }
+
+            if (!first)
+            {
+                put("\n", 1);
+                put_level(sub_level);
+                if (part_start == line_start)
+                    put("CONT", 4);
+                else
+                    put("CONC", 4);
+            }
+            if (part_end > part_start)
+            {
+                put(" ", 1);
+                put_value(value.data() + part_start, part_end - part_start);
+            }
+
+            first      = false;
+            part_start = part_end;
+        }
+        while (part_start < text_end);
+
+        line_start = line_end + 1;
+    }
+    while (line_start <= value.size());
+
+    put("\n", 1);
+}
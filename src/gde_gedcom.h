@@ -0,0 +1,154 @@
+///
+/// \file
+///
+
+#ifndef GDE_GEDCOM_H
+#define GDE_GEDCOM_H
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+///
+/// \brief Reference to part of a string, which is not copied
+///
+/// This serves the same purpose as the C++17 `std::string_view`. The referenced characters
+/// must stay in existence for as long as the reference is used.
+///
+
+class gde_str_ref
+{
+public:
+    const char* ptr = nullptr;   ///< first character
+    size_t      len = 0;         ///< number of characters
+
+    gde_str_ref () {}
+    gde_str_ref (const char* p, size_t n) : ptr(p), len(n) {}
+
+    bool        empty () const { return len == 0; }
+    std::string str   () const { return std::string(ptr, len); }
+
+    bool operator== (const char* s) const
+    {
+        return std::strlen(s) == len && (len == 0 || std::memcmp(ptr, s, len) == 0);
+    }
+    bool operator!= (const char* s) const { return !(*this == s); }
+};
+
+
+
+///
+/// \brief One GEDCOM record, parsed into a tree of tagged lines
+///
+
+class gde_gedcom_record
+{
+public:
+
+    ///
+    /// \brief One line of a GEDCOM record
+    ///
+
+    struct line
+    {
+        int          level;          ///< level number
+        gde_str_ref  xref;           ///< cross-reference ID, without the '@' delimiters
+        gde_str_ref  tag;            ///< tag
+        gde_str_ref  value;          ///< line value
+        int          parent;         ///< index of the parent line, or -1
+        int          first_child;    ///< index of the first subordinate line, or -1
+        int          next_sibling;   ///< index of the next line with the same parent, or -1
+    };
+
+    void         parse       (const char* text, size_t length);
+    void         parse       (const std::string& text);
+    void         parse       (std::string&& text) = delete;   // the text must outlive the record
+
+    size_t       num_lines   () const;
+    const line&  get_line    (int line_num) const;
+    gde_str_ref  xref        () const;
+    gde_str_ref  tag         () const;
+
+    int          find        (const char* tag_1, const char* tag_2 = nullptr,
+                              const char* tag_3 = nullptr) const;
+    int          find_child  (int line_num, const char* tag) const;
+    void         find_all    (const char* tag, std::vector<int>& line_nums) const;
+
+    bool         value       (std::string& data, const char* tag_1, const char* tag_2 = nullptr,
+                              const char* tag_3 = nullptr) const;
+    bool         xref_value  (std::string& data, const char* tag_1, const char* tag_2 = nullptr,
+                              const char* tag_3 = nullptr) const;
+    std::string  full_value  (int line_num) const;
+
+    static gde_str_ref pointer (gde_str_ref value);
+
+private:
+    std::vector<line> line_list;
+    std::vector<int>  level_stack;   // open lines while parsing, kept to avoid reallocation
+
+    int  first_top_line () const;
+    void test_input     (int line_num) const;
+};
+
+
+
+class gde_gedcom_reader
+{
+public:
+    gde_gedcom_reader  (size_t buffer_size = 1 << 20);
+    ~gde_gedcom_reader ();
+
+    void   open        (const std::string& file_name);
+    void   close       ();
+    bool   next        (gde_gedcom_record& record);
+    size_t num_records () const;
+
+private:
+    std::FILE*         file = nullptr;
+    std::vector<char>  buffer;
+    size_t             buf_begin = 0;    // start of the unparsed data in the buffer
+    size_t             buf_end   = 0;    // end of the valid data in the buffer
+    bool               at_eof    = false;
+    size_t             my_num_records = 0;
+
+    size_t find_record_end (size_t from) const;
+    bool   fill_buffer     ();
+};
+
+
+
+class gde_gedcom_writer
+{
+public:
+    gde_gedcom_writer  (size_t buffer_size = 1 << 16);
+    ~gde_gedcom_writer ();
+
+    void   open          (const std::string& file_name);
+    void   close         ();
+    void   flush         ();
+
+    void   write_header  (const std::string& submitter);
+    void   write_trailer ();
+    void   write_record  (const std::string& xref, const char* tag, const std::string& value = "");
+    void   write_line    (int level, const char* tag, const std::string& value = "");
+    void   write_pointer (int level, const char* tag, const std::string& xref);
+
+    size_t bytes_written () const;
+
+private:
+    std::FILE*         file = nullptr;
+    std::string        my_file_name;
+    std::vector<char>  buffer;
+    size_t             buf_end = 0;      // end of the data in the buffer
+    size_t             my_bytes_written = 0;
+
+    void   put         (const char* data, size_t length);
+    void   put         (const std::string& data) { put(data.data(), data.size()); }
+    void   put_level   (int level);
+    void   put_value   (const char* data, size_t length);
+    void   put_text    (int level, const char* tag, const std::string& value);
+};
+
+#endif
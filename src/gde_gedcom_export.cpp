@@ -0,0 +1,1008 @@
+///
+/// \class gde_gedcom_export gde_gedcom_export.h
+///
+/// \brief Exports GenDat source records to a GEDCOM file
+///
+/// Like `gde_mention_extractor`, this class uses the GenDat field codes in a `gde_source_map`
+/// to find out which database columns describe each person in a source record (for example,
+/// GF_SURN is the surname of the groom's father, and BIRT_DATE is the date of the principal's
+/// birth). Each record is then written as:
+///
+/// - one INDI record for each named person, with their name, sex, events and facts;
+/// - one FAM record for each family that the record shows: the principal and their parents,
+///   the groom or bride and their parents, and the couple in a marriage or divorce record;
+/// - a citation of the source on every event and person, with the record key as the page.
+///
+/// One SOUR record is written for each source, before its first record.
+///
+/// The records are read with a `db_row_stream` and written with a `gde_gedcom_writer`, so only
+/// one record is held in memory at a time, whatever the size of the export. Each person is
+/// written as they appear in the record; persons that appear in several records are not merged.
+///
+/// Use one object for each GEDCOM file, since it numbers the cross-reference IDs and keeps
+/// track of which SOUR records have been written.
+///
+
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <initializer_list>
+#include <stdexcept>
+
+#include "gde_gedcom_export.h"
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Constructor
+///
+/// The constructor examines the field codes of every GenDat source and works out how to build
+/// GEDCOM records from its rows.
+///
+/// \param[in]  source_map   object containing the GenDat source definitions
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gde_gedcom_export::gde_gedcom_export(const gde_source_map& source_map) :
+    my_source_map(source_map)
+{
+    plan_list.resize(my_source_map.num_sources());
+    source_written.resize(my_source_map.num_sources(), false);
+
+    for (int i=0; i<my_source_map.num_sources(); i++)
+    {
+        source_plan& plan = plan_list[i];
+        plan.record_event.event = my_source_map.src_type(i);
+
+        // A source whose code is not a GEDCOM event is written as EVEN, with the code as its
+        // TYPE (or the source name, if there is no code).
+
+        if (std::string(gedcom_tag(plan.record_event.event)) == "EVEN")
+        {
+            plan.event_type = my_source_map.src_code(i);
+            if (plan.event_type.empty())
+                plan.event_type = my_source_map.src_name(i);
+        }
+
+        for (int j=0; j<my_source_map.num_fields(i); j++)
+        {
+            gde_relation rel      = my_source_map.fam_rel(i,j);
+            gde_data_tag event    = my_source_map.event_type(i,j);
+            gde_data_tag fact     = my_source_map.fact_type(i,j);
+            gde_data_tag fact_mod = my_source_map.fact_type_mod(i,j);
+
+            if (fact == gde_data_tag::UNDEFINED)
+                continue;
+
+            int col = add_column(plan, my_source_map.fld_db_name(i,j));
+
+            // Facts about the record as a whole.
+
+            if (rel == gde_relation::UNDEFINED && fact == gde_data_tag::KEY)
+            {
+                plan.key = col;
+                continue;
+            }
+            if (rel == gde_relation::UNDEFINED &&
+                    (event == gde_data_tag::UNDEFINED || event == plan.record_event.event) &&
+                    set_event(plan.record_event, fact, fact_mod, col))
+                continue;
+
+            // Facts about one person. Find that person in the list, or add them.
+
+            person_cols* person = nullptr;
+            for (person_cols& p : plan.persons)
+                if (p.relation == rel)
+                    person = &p;
+            if (person == nullptr)
+            {
+                plan.persons.push_back(person_cols());
+                person = &plan.persons.back();
+                person->relation = rel;
+            }
+
+            if (event != gde_data_tag::UNDEFINED)
+            {
+                set_event(*find_event(*person, event), fact, fact_mod, col);
+                continue;
+            }
+
+            switch (fact)
+            {
+            case gde_data_tag::SURN:        person->surname     = col; break;
+            case gde_data_tag::GIVN:        person->given       = col; break;
+            case gde_data_tag::NAME:        person->name        = col; break;
+            case gde_data_tag::SEX:         person->sex         = col; break;
+            case gde_data_tag::AGE:         person->age         = col; break;
+            case gde_data_tag::OCCU:        person->occupation  = col; break;
+            case gde_data_tag::RESI:        person->residence   = col; break;
+            case gde_data_tag::STATUS:      person->status      = col; break;
+            case gde_data_tag::NOTE:        person->note        = col; break;
+            case gde_data_tag::INSCRIPTION: person->inscription = col; break;
+            default: break;
+            }
+        }
+
+        // Drop anyone who cannot be named. The source is usable if it has a key and at least
+        // one person left.
+
+        for (size_t k=plan.persons.size(); k-- > 0; )
+            if (plan.persons[k].surname < 0 && plan.persons[k].name < 0)
+                plan.persons.erase(plan.persons.begin() + k);
+
+        plan.ok = (plan.key >= 0 && !plan.persons.empty());
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Determine if a source can be exported
+///
+/// \param[in]  source_num   source number
+///
+/// \return     `true` if the source has a KEY field and at least one named person
+///
+/// \exception std::out_of_range thrown if the source number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool gde_gedcom_export::source_ok(int source_num) const
+{
+    test_input(source_num);
+    return plan_list[source_num].ok;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the query that reads the fields of a source that are exported
+///
+/// \param[in]  source_num   source number
+/// \param[in]  condition    optional SQL condition (without the WHERE keyword) that selects
+///                          the records to export
+///
+/// \return     SQL SELECT statement, or an empty string if the source cannot be exported
+///
+/// \exception std::out_of_range thrown if the source number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_gedcom_export::source_query(int source_num, std::string condition) const
+{
+    test_input(source_num);
+
+    const source_plan& plan = plan_list[source_num];
+    if (!plan.ok)
+        return "";
+
+    std::string query = "SELECT ";
+    for (size_t k=0; k<plan.db_fields.size(); k++)
+    {
+        if (k > 0)
+            query += ", ";
+        query += plan.db_fields[k];
+    }
+    query += " FROM " + my_source_map.src_db_table(source_num);
+    if (!condition.empty())
+        query += " WHERE " + condition;
+    return query;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Write the SOUR record of a source, if it has not been written yet
+///
+/// \param[in]  out          GEDCOM file, which must be open
+/// \param[in]  source_num   source number
+///
+/// \exception std::out_of_range  thrown if the source number is out of range
+/// \exception std::runtime_error thrown if the file cannot be written
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_gedcom_export::write_source(gde_gedcom_writer& out, int source_num)
+{
+    test_input(source_num);
+    if (source_written[source_num])
+        return;
+
+    out.write_record(source_xref(source_num), "SOUR");
+    out.write_line(1, "TITL", my_source_map.src_name(source_num));
+    out.write_line(1, "ABBR", my_source_map.src_code(source_num));
+
+    std::string description = my_source_map.src_description(source_num);
+    if (!description.empty())
+        out.write_line(1, "NOTE", description);
+
+    source_written[source_num] = true;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Write the records read from a row stream
+///
+/// The SOUR record of the source is written first, if required.
+///
+/// \param[in]  out          GEDCOM file, which must be open
+/// \param[in]  source_num   source number
+/// \param[in]  stream       stream opened with the query from `source_query()`
+///
+/// \return     number of source records read from the stream
+///
+/// \exception std::out_of_range  thrown if the source number is out of range
+/// \exception std::logic_error   thrown if the stream does not have the expected columns
+/// \exception std::runtime_error thrown if the database server reports an error or the file
+///                               cannot be written
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned long gde_gedcom_export::write_records(gde_gedcom_writer& out, int source_num,
+                                               db_row_stream& stream)
+{
+    test_input(source_num);
+
+    const source_plan& plan = plan_list[source_num];
+    if (!plan.ok)
+        return 0;
+
+    if (stream.num_cols() != plan.db_fields.size())
+        throw std::logic_error("Unexpected row stream in gde_gedcom_export::write_records");
+
+    write_source(out, source_num);
+
+    unsigned long num_rows = 0;
+    while (stream.next_row())
+    {
+        write_row(out, source_num, stream);
+        num_rows++;
+    }
+    return num_rows;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Export the records of a source
+///
+/// \param[in]  out          GEDCOM file, which must be open
+/// \param[in]  db           database connection, which must currently be open
+/// \param[in]  source_num   source number
+/// \param[in]  condition    optional SQL condition (without the WHERE keyword) that selects
+///                          the records to export, such as the condition of a search
+///
+/// \return     number of source records exported
+///
+/// \exception std::out_of_range  thrown if the source number is out of range
+/// \exception std::runtime_error thrown if the database server reports an error or the file
+///                               cannot be written
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned long gde_gedcom_export::export_source(gde_gedcom_writer& out, database& db, int source_num,
+                                               std::string condition)
+{
+    if (!source_ok(source_num))
+        return 0;
+
+    db_row_stream stream;
+    db.execute(source_query(source_num, condition), stream);
+    return write_records(out, source_num, stream);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Export a list of records from a source
+///
+/// Use this to export the records that have been linked to a person, for example. The keys
+/// are sent to the database in batches, so the list may be of any length.
+///
+/// \param[in]  out          GEDCOM file, which must be open
+/// \param[in]  db           database connection, which must currently be open
+/// \param[in]  source_num   source number
+/// \param[in]  keys         values of the KEY field of the records to export
+///
+/// \return     number of source records exported
+///
+/// \exception std::out_of_range  thrown if the source number is out of range
+/// \exception std::runtime_error thrown if the database server reports an error or the file
+///                               cannot be written
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned long gde_gedcom_export::export_keys(gde_gedcom_writer& out, database& db, int source_num,
+                                             const std::vector<std::string>& keys)
+{
+    static const size_t KEY_BATCH_SIZE = 500;
+
+    if (!source_ok(source_num))
+        return 0;
+
+    const std::string& key_field = plan_list[source_num].db_fields[plan_list[source_num].key];
+
+    unsigned long num_rows = 0;
+    for (size_t first=0; first<keys.size(); first+=KEY_BATCH_SIZE)
+    {
+        size_t last = std::min(keys.size(), first + KEY_BATCH_SIZE);
+
+        std::string condition = key_field + " IN (";
+        for (size_t i=first; i<last; i++)
+        {
+            if (i > first)
+                condition += ", ";
+            condition += "'" + db.escape_str(keys[i]) + "'";
+        }
+        condition += ")";
+
+        num_rows += export_source(out, db, source_num, condition);
+    }
+    return num_rows;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Export one or more sources to a new GEDCOM file
+///
+/// \param[in]  db           database connection, which must currently be open
+/// \param[in]  file_name    name of the GEDCOM file, which is replaced if it exists
+/// \param[in]  sources      numbers of the sources to export. Sources that cannot be exported
+///                          are skipped.
+/// \param[in]  condition    optional SQL condition (without the WHERE keyword) that selects
+///                          the records to export from each source
+/// \param[in]  submitter    name of the submitter, for the file header
+///
+/// \exception std::out_of_range  thrown if a source number is out of range
+/// \exception std::runtime_error thrown if the database server reports an error or the file
+///                               cannot be written
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_gedcom_export::export_file(database& db, const std::string& file_name,
+                                    const std::vector<int>& sources, std::string condition,
+                                    std::string submitter)
+{
+    gde_gedcom_writer out;
+    out.open(file_name);
+    out.write_header(submitter);
+
+    for (int source_num : sources)
+        export_source(out, db, source_num, condition);
+
+    out.write_trailer();
+    out.close();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of INDI records written so far
+///
+/// \return     number of persons
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned long gde_gedcom_export::num_persons() const
+{
+    return my_num_persons;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of FAM records written so far
+///
+/// \return     number of families
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned long gde_gedcom_export::num_families() const
+{
+    return my_num_families;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Convert a date to GEDCOM form
+///
+/// A full date is normally a MySQL DATE ("1871-04-02"), in which a zero month or day means
+/// that it is not known. Any other full date is only converted to upper case. If there is no
+/// full date, the date is made from the year, month and day; the month may be a number or a
+/// name.
+///
+/// \param[in]  date    full date, or empty
+/// \param[in]  year    year, or empty
+/// \param[in]  month   month, or empty
+/// \param[in]  day     day of the month, or empty
+///
+/// \return     GEDCOM date (such as "2 APR 1871" or "APR 1871"), or an empty string if the
+///             year is not known
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_gedcom_export::format_date(const std::string& date, const std::string& year,
+                                           const std::string& month, const std::string& day)
+{
+    static const char* const month_names[] =
+        { "JAN", "FEB", "MAR", "APR", "MAY", "JUN", "JUL", "AUG", "SEP", "OCT", "NOV", "DEC" };
+
+    int y = 0;
+    int m = 0;
+    int d = 0;
+
+    if (!date.empty())
+    {
+        bool iso = (date.size() >= 10 && date[4] == '-' && date[7] == '-');
+        for (size_t i=0; iso && i<10; i++)
+            if (i != 4 && i != 7 && !std::isdigit((unsigned char) date[i]))
+                iso = false;
+
+        if (!iso)
+        {
+            std::string result = date;
+            for (char& c : result)
+                c = std::toupper((unsigned char) c);
+            return result;
+        }
+
+        y = std::atoi(date.c_str());
+        m = std::atoi(date.c_str() + 5);
+        d = std::atoi(date.c_str() + 8);
+    }
+    else
+    {
+        y = std::atoi(year.c_str());
+        d = std::atoi(day.c_str());
+
+        if (!month.empty() && std::isdigit((unsigned char) month[0]))
+            m = std::atoi(month.c_str());
+        else if (month.size() >= 3)
+        {
+            std::string abbr;
+            for (size_t i=0; i<3; i++)
+                abbr += std::toupper((unsigned char) month[i]);
+            for (int k=0; k<12; k++)
+                if (abbr == month_names[k])
+                    m = k + 1;
+        }
+    }
+
+    if (y <= 0)
+        return "";
+
+    std::string result;
+    if (m >= 1 && m <= 12)
+    {
+        if (d >= 1 && d <= 31)
+            result = std::to_string(d) + " ";
+        result += month_names[m - 1];
+        result += " ";
+    }
+    return result + std::to_string(y);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Write the GEDCOM records for the current row of a stream.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_gedcom_export::write_row(gde_gedcom_writer& out, int source_num, const db_row_stream& stream)
+{
+    const source_plan& plan = plan_list[source_num];
+    gde_data_tag src_type   = plan.record_event.event;
+    bool family_event       = (src_type == gde_data_tag::MARR || src_type == gde_data_tag::DIV);
+
+    std::string key;
+    get(stream, plan.key, key);
+
+    // Name everyone in the record, and work out their sex from the record or their relation.
+
+    row_persons.clear();
+    for (const person_cols& p : plan.persons)
+    {
+        person_out person;
+        person.cols = &p;
+
+        get(stream, p.surname, person.surname);
+        get(stream, p.given, person.given);
+
+        // Split a full name, if there are no separate name fields.
+
+        if (p.surname < 0 && get(stream, p.name, data))
+        {
+            size_t last_space = data.find_last_of(' ');
+            if (last_space == std::string::npos)
+                person.surname = data;
+            else
+            {
+                person.surname = data.substr(last_space + 1);
+                if (p.given < 0)
+                    person.given = data.substr(0, last_space);
+            }
+        }
+
+        if (person.surname.empty() && person.given.empty())
+            continue;
+
+        if (get(stream, p.sex, data))
+        {
+            char c = std::toupper((unsigned char) data[0]);
+            if (c == 'M' || c == 'F')
+                person.sex = c;
+        }
+        if (person.sex == 'U')
+        {
+            switch (p.relation)
+            {
+            case gde_relation::FATHER:
+            case gde_relation::GROOM:
+            case gde_relation::GROOM_FATHER:
+            case gde_relation::BRIDE_FATHER:
+                person.sex = 'M';
+                break;
+            case gde_relation::MOTHER:
+            case gde_relation::BRIDE:
+            case gde_relation::GROOM_MOTHER:
+            case gde_relation::BRIDE_MOTHER:
+                person.sex = 'F';
+                break;
+            default:
+                break;
+            }
+        }
+
+        person.xref = "I" + std::to_string(++my_num_persons);
+        row_persons.push_back(person);
+    }
+
+    // Work out the families, so that the persons can point to them.
+
+    int principal = find_person(gde_relation::UNDEFINED);
+    int spouse    = find_person(gde_relation::SPOUSE);
+    int groom     = find_person(gde_relation::GROOM);
+    int bride     = find_person(gde_relation::BRIDE);
+
+    row_families.clear();
+    add_family(find_person(gde_relation::FATHER), find_person(gde_relation::MOTHER), principal, false);
+    add_family(find_person(gde_relation::GROOM_FATHER), find_person(gde_relation::GROOM_MOTHER), groom, false);
+    add_family(find_person(gde_relation::BRIDE_FATHER), find_person(gde_relation::BRIDE_MOTHER), bride, false);
+
+    if (groom >= 0 || bride >= 0)
+        add_family(groom, bride, -1, family_event);
+    else if (spouse >= 0 && principal >= 0)
+    {
+        if (row_persons[principal].sex == 'F' || row_persons[spouse].sex == 'M')
+            add_family(spouse, principal, -1, family_event);
+        else
+            add_family(principal, spouse, -1, family_event);
+    }
+    else if (family_event && principal >= 0)
+    {
+        if (row_persons[principal].sex == 'F')
+            add_family(-1, principal, -1, true);
+        else
+            add_family(principal, -1, -1, true);
+    }
+
+    // Write the persons.
+
+    std::string value;
+    for (const person_out& person : row_persons)
+    {
+        const person_cols& p = *person.cols;
+
+        out.write_record(person.xref, "INDI");
+        out.write_line(1, "NAME", person.given + " /" + person.surname + "/");
+        if (!person.given.empty())
+            out.write_line(2, "GIVN", person.given);
+        if (!person.surname.empty())
+            out.write_line(2, "SURN", person.surname);
+        out.write_line(1, "SEX", std::string(1, person.sex));
+
+        // The event of the record belongs to the principal, or to everyone in a census. The age
+        // of a partner in a marriage or divorce is written with the family event, and the age
+        // of anyone else is kept in the citation.
+
+        std::string age;
+        get(stream, p.age, age);
+        for (int f : person.fams)
+            if (row_families[f].has_event)
+                age.clear();
+
+        if (!family_event && (p.relation == gde_relation::UNDEFINED || src_type == gde_data_tag::CENS) &&
+                write_event(out, gedcom_tag(src_type), plan.event_type, plan.record_event, stream, age,
+                            true))
+        {
+            write_citation(out, 2, source_num, key);
+            age.clear();
+        }
+
+        for (const event_cols& event : p.events)
+            if (write_event(out, gedcom_tag(event.event), "", event, stream, "", false))
+                write_citation(out, 2, source_num, key);
+
+        if (get(stream, p.occupation, value))
+            out.write_line(1, "OCCU", value);
+        if (get(stream, p.residence, value))
+        {
+            out.write_line(1, "RESI");
+            out.write_line(2, "PLAC", value);
+        }
+        if (get(stream, p.status, value))
+        {
+            out.write_line(1, "FACT", value);
+            out.write_line(2, "TYPE", "Marital status");
+        }
+        if (get(stream, p.note, value))
+            out.write_line(1, "NOTE", value);
+        if (get(stream, p.inscription, value))
+            out.write_line(1, "NOTE", "Inscription: " + value);
+
+        if (!person.famc.empty())
+            out.write_pointer(1, "FAMC", person.famc);
+        for (int f : person.fams)
+            out.write_pointer(1, "FAMS", row_families[f].xref);
+
+        write_citation(out, 1, source_num, key, age.empty() ? "" : "Age: " + age);
+    }
+
+    // Write the families.
+
+    for (const family_out& family : row_families)
+    {
+        out.write_record(family.xref, "FAM");
+        if (family.husband >= 0)
+            out.write_pointer(1, "HUSB", row_persons[family.husband].xref);
+        if (family.wife >= 0)
+            out.write_pointer(1, "WIFE", row_persons[family.wife].xref);
+        if (family.child >= 0)
+            out.write_pointer(1, "CHIL", row_persons[family.child].xref);
+
+        if (family.has_event)
+        {
+            write_event(out, gedcom_tag(src_type), plan.event_type, plan.record_event, stream, "", true);
+
+            if (family.husband >= 0 && get(stream, row_persons[family.husband].cols->age, value))
+            {
+                out.write_line(2, "HUSB");
+                out.write_line(3, "AGE", value);
+            }
+            if (family.wife >= 0 && get(stream, row_persons[family.wife].cols->age, value))
+            {
+                out.write_line(2, "WIFE");
+                out.write_line(3, "AGE", value);
+            }
+            write_citation(out, 2, source_num, key);
+        }
+
+        write_citation(out, 1, source_num, key);
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Find a person in the current row by their relation to the principal, and return their index
+// in row_persons, or -1 if they are not named in this row.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int gde_gedcom_export::find_person(gde_relation relation) const
+{
+    for (size_t k=0; k<row_persons.size(); k++)
+        if (row_persons[k].cols->relation == relation)
+            return k;
+    return -1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Add a family to the current row, if enough of its members are named. A family with a child
+// needs at least one parent, and a couple needs both partners, unless the family holds the
+// event of the record.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_gedcom_export::add_family(int husband, int wife, int child, bool has_event)
+{
+    if (child >= 0 && husband < 0 && wife < 0)
+        return;
+    if (child < 0 && !has_event && (husband < 0 || wife < 0))
+        return;
+    if (husband < 0 && wife < 0)
+        return;
+
+    family_out family;
+    family.xref      = "F" + std::to_string(++my_num_families);
+    family.husband   = husband;
+    family.wife      = wife;
+    family.child     = child;
+    family.has_event = has_event;
+
+    int f = row_families.size();
+    row_families.push_back(family);
+
+    if (husband >= 0)
+        row_persons[husband].fams.push_back(f);
+    if (wife >= 0)
+        row_persons[wife].fams.push_back(f);
+    if (child >= 0)
+        row_persons[child].famc = family.xref;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Write an event at level 1, with its type (for an EVEN), date, place and age. Unless "always"
+// is set, nothing is written if the date and place are not known. Returns true if the event was
+// written.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool gde_gedcom_export::write_event(gde_gedcom_writer& out, const char* tag, const std::string& type,
+                                    const event_cols& event, const db_row_stream& stream,
+                                    const std::string& age, bool always)
+{
+    std::string date_text;
+    std::string year;
+    std::string month;
+    std::string day;
+
+    get(stream, event.date, date_text);
+    get(stream, event.year, year);
+    get(stream, event.month, month);
+    get(stream, event.day, day);
+
+    std::string date_value  = format_date(date_text, year, month, day);
+    std::string place_value = place(event, stream);
+
+    if (date_value.empty() && place_value.empty())
+    {
+        if (!always)
+            return false;
+
+        // An event with no details is marked as known to have happened.
+
+        if (age.empty() && type.empty())
+        {
+            out.write_line(1, tag, "Y");
+            return true;
+        }
+    }
+
+    out.write_line(1, tag);
+    if (!type.empty())
+        out.write_line(2, "TYPE", type);
+    if (!date_value.empty())
+        out.write_line(2, "DATE", date_value);
+    if (!place_value.empty())
+        out.write_line(2, "PLAC", place_value);
+    if (!age.empty())
+        out.write_line(2, "AGE", age);
+    return true;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Write a citation of a source record.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_gedcom_export::write_citation(gde_gedcom_writer& out, int level, int source_num,
+                                       const std::string& key, const std::string& note)
+{
+    out.write_pointer(level, "SOUR", source_xref(source_num));
+    out.write_line(level + 1, "PAGE", key);
+    if (!note.empty())
+        out.write_line(level + 1, "NOTE", note);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Get the place of an event: the full place if there is one, otherwise the cemetery, community
+// and county, separated by commas.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_gedcom_export::place(const event_cols& event, const db_row_stream& stream)
+{
+    std::string result;
+    if (get(stream, event.place, result))
+        return result;
+
+    std::string part;
+    for (int col : { event.cemetery, event.community, event.county })
+    {
+        if (!get(stream, col, part))
+            continue;
+        if (!result.empty())
+            result += ", ";
+        result += part;
+    }
+    return result;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Get a field from the current row, without leading or trailing spaces. Returns false if there
+// is no such column, or the field is null or blank.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool gde_gedcom_export::get(const db_row_stream& stream, int col, std::string& value) const
+{
+    value.clear();
+    if (col < 0 || !stream.get_data(col, value))
+        return false;
+
+    size_t first = value.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos)
+    {
+        value.clear();
+        return false;
+    }
+    size_t last = value.find_last_not_of(" \t\r\n");
+    if (first > 0 || last + 1 < value.size())
+        value = value.substr(first, last + 1 - first);
+    return true;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Add a database field to the source query, if it's not already there, and return
+// its column number.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int gde_gedcom_export::add_column(source_plan& plan, const std::string& db_field)
+{
+    for (size_t k=0; k<plan.db_fields.size(); k++)
+        if (plan.db_fields[k] == db_field)
+            return k;
+
+    plan.db_fields.push_back(db_field);
+    return plan.db_fields.size() - 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Find the columns of one of a person's events, or add them.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gde_gedcom_export::event_cols* gde_gedcom_export::find_event(person_cols& person, gde_data_tag event)
+{
+    for (event_cols& e : person.events)
+        if (e.event == event)
+            return &e;
+
+    person.events.push_back(event_cols());
+    person.events.back().event = event;
+    return &person.events.back();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Record the column of a date or place fact of an event. Returns false if the fact is not a
+// date or place.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool gde_gedcom_export::set_event(event_cols& event, gde_data_tag fact, gde_data_tag fact_mod, int col)
+{
+    if (fact == gde_data_tag::DATE)
+    {
+        switch (fact_mod)
+        {
+        case gde_data_tag::UNDEFINED: event.date  = col; return true;
+        case gde_data_tag::YEAR:      event.year  = col; return true;
+        case gde_data_tag::MONTH:     event.month = col; return true;
+        case gde_data_tag::DAY:       event.day   = col; return true;
+        default: return false;
+        }
+    }
+    if (fact == gde_data_tag::PLAC)
+    {
+        switch (fact_mod)
+        {
+        case gde_data_tag::UNDEFINED: event.place     = col; return true;
+        case gde_data_tag::COMMUNITY: event.community = col; return true;
+        case gde_data_tag::COUNTY:    event.county    = col; return true;
+        default: return false;
+        }
+    }
+    if (fact == gde_data_tag::CEMETERY)
+    {
+        event.cemetery = col;
+        return true;
+    }
+    return false;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Get the GEDCOM tag of an event. The data tags have the same names as the GEDCOM tags.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const char* gde_gedcom_export::gedcom_tag(gde_data_tag tag)
+{
+    switch (tag)
+    {
+    case gde_data_tag::BIRT: return "BIRT";
+    case gde_data_tag::BAPM: return "BAPM";
+    case gde_data_tag::CONF: return "CONF";
+    case gde_data_tag::DEAT: return "DEAT";
+    case gde_data_tag::BURI: return "BURI";
+    case gde_data_tag::MARR: return "MARR";
+    case gde_data_tag::DIV:  return "DIV";
+    case gde_data_tag::CENS: return "CENS";
+    case gde_data_tag::WILL: return "WILL";
+    case gde_data_tag::RESI: return "RESI";
+    default:                 return "EVEN";
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Get the cross-reference ID of the SOUR record of a source.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_gedcom_export::source_xref(int source_num)
+{
+    return "S" + std::to_string(source_num + 1);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Make sure the source number is valid.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_gedcom_export::test_input(int source_num) const
+{
+    if (source_num < 0 || source_num >= (int) plan_list.size())
+        throw std::out_of_range("Source number in gde_gedcom_export:: is out of range");
+}
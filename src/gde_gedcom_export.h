@@ -0,0 +1,141 @@
+///
+/// \file
+///
+
+#ifndef GDE_GEDCOM_EXPORT_H
+#define GDE_GEDCOM_EXPORT_H
+
+#include <string>
+#include <vector>
+
+#include "database.h"
+#include "db_row_set.h"
+#include "gde_gedcom.h"
+#include "gde_source_map.h"
+
+
+class gde_gedcom_export
+{
+public:
+    gde_gedcom_export (const gde_source_map& source_map);
+
+    bool          source_ok     (int source_num) const;
+    std::string   source_query  (int source_num, std::string condition = "") const;
+
+    void          write_source  (gde_gedcom_writer& out, int source_num);
+    unsigned long write_records (gde_gedcom_writer& out, int source_num, db_row_stream& stream);
+
+    unsigned long export_source (gde_gedcom_writer& out, database& db, int source_num,
+                                 std::string condition = "");
+    unsigned long export_keys   (gde_gedcom_writer& out, database& db, int source_num,
+                                 const std::vector<std::string>& keys);
+    void          export_file   (database& db, const std::string& file_name,
+                                 const std::vector<int>& sources, std::string condition = "",
+                                 std::string submitter = "");
+
+    unsigned long num_persons   () const;
+    unsigned long num_families  () const;
+
+    static std::string format_date (const std::string& date, const std::string& year = "",
+                                    const std::string& month = "", const std::string& day = "");
+
+private:
+
+    // Columns (in the source query) that describe one event.
+
+    struct event_cols
+    {
+        gde_data_tag event     = gde_data_tag::UNDEFINED;
+        int          date      = -1;
+        int          year      = -1;
+        int          month     = -1;
+        int          day       = -1;
+        int          place     = -1;
+        int          community = -1;
+        int          county    = -1;
+        int          cemetery  = -1;
+    };
+
+    // Columns that describe one person in the record.
+
+    struct person_cols
+    {
+        gde_relation            relation    = gde_relation::UNDEFINED;
+        int                     surname     = -1;
+        int                     given       = -1;
+        int                     name        = -1;
+        int                     sex         = -1;
+        int                     age         = -1;
+        int                     occupation  = -1;
+        int                     residence   = -1;
+        int                     status      = -1;
+        int                     note        = -1;
+        int                     inscription = -1;
+        std::vector<event_cols> events;
+    };
+
+    // Plan for turning the rows of one GenDat source into GEDCOM records.
+
+    struct source_plan
+    {
+        bool                     ok  = false;
+        int                      key = -1;
+        event_cols               record_event;
+        std::string              event_type;   // TYPE of the record event, if it is written as EVEN
+        std::vector<person_cols> persons;
+        std::vector<std::string> db_fields;
+    };
+
+    // One person or family written for the current row. These are reused from one row to the
+    // next.
+
+    struct person_out
+    {
+        const person_cols* cols = nullptr;
+        std::string        xref;
+        std::string        surname;
+        std::string        given;
+        char               sex  = 'U';
+        std::string        famc;
+        std::vector<int>   fams;
+    };
+
+    struct family_out
+    {
+        std::string xref;
+        int         husband   = -1;
+        int         wife      = -1;
+        int         child     = -1;
+        bool        has_event = false;   // the family holds the event of the record (MARR or DIV)
+    };
+
+    const gde_source_map&    my_source_map;
+    std::vector<source_plan> plan_list;
+    std::vector<bool>        source_written;
+    unsigned long            my_num_persons  = 0;
+    unsigned long            my_num_families = 0;
+
+    std::vector<person_out>  row_persons;
+    std::vector<family_out>  row_families;
+    std::string              data;
+
+    static int         add_column (source_plan& plan, const std::string& db_field);
+    static event_cols* find_event (person_cols& person, gde_data_tag event);
+    static bool        set_event  (event_cols& event, gde_data_tag fact, gde_data_tag fact_mod, int col);
+    static const char* gedcom_tag (gde_data_tag tag);
+    static std::string source_xref (int source_num);
+
+    void  write_row      (gde_gedcom_writer& out, int source_num, const db_row_stream& stream);
+    int   find_person    (gde_relation relation) const;
+    void  add_family     (int husband, int wife, int child, bool has_event);
+    bool  write_event    (gde_gedcom_writer& out, const char* tag, const std::string& type,
+                          const event_cols& event, const db_row_stream& stream, const std::string& age,
+                          bool always);
+    void  write_citation (gde_gedcom_writer& out, int level, int source_num, const std::string& key,
+                          const std::string& note = "");
+    std::string place    (const event_cols& event, const db_row_stream& stream);
+    bool  get            (const db_row_stream& stream, int col, std::string& value) const;
+    void  test_input     (int source_num) const;
+};
+
+#endif
@@ -0,0 +1,468 @@
+///
+/// \class gde_kinship gde_kinship.h
+///
+/// \brief Finds and names the relationship between two persons in a family graph
+///
+/// The relationship is found through the lowest common ancestor of the two persons: the common
+/// ancestor with the smallest total number of generations to both of them. The search works
+/// upwards from both persons at once (a bidirectional breadth-first search over the parent
+/// edges of a `gde_family_graph`), one generation at a time, always continuing on the side
+/// with the smaller frontier. It stops as soon as no undiscovered common ancestor could be
+/// closer than the best one found so far. Visited persons are marked in a bitset for each
+/// side.
+///
+/// The relationship is then named from the number of generations up from the first person
+/// to the common ancestor and down from there to the second person: "father", "niece",
+/// "second cousin once removed", and so on. If the two lines come down from the common
+/// ancestor through children who both have two known parents, and those parents are not the
+/// same, then the relationship is a half relationship, such as "half-brother". If a parent is
+/// not recorded, then the relationship is not called a half relationship. If the two persons
+/// are not related by blood but are married, then the relationship is "husband", "wife" or
+/// "spouse".
+///
+/// Many pairs can be related at once with `relate_batch()`, which shares them out among
+/// several threads. The graph must not be changed while a query is running.
+///
+
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdlib>
+#include <thread>
+#include <stdexcept>
+
+#include "gde_kinship.h"
+
+
+// Ordinal numbers, used in relationship names: "2nd", "3rd", "11th", ...
+
+static std::string ordinal_number(int n)
+{
+    std::string suffix = "th";
+    if (n % 100 < 11 || n % 100 > 13)
+    {
+        if (n % 10 == 1) suffix = "st";
+        if (n % 10 == 2) suffix = "nd";
+        if (n % 10 == 3) suffix = "rd";
+    }
+    return std::to_string(n) + suffix;
+}
+
+// Ordinal words for cousins: "first", "second", ... "tenth", then "11th", ...
+
+static std::string ordinal_word(int n)
+{
+    static const char* words[] = { "", "first", "second", "third", "fourth", "fifth",
+                                   "sixth", "seventh", "eighth", "ninth", "tenth" };
+    if (n >= 1 && n <= 10)
+        return words[n];
+    return ordinal_number(n);
+}
+
+// Prefix for each extra generation: "great-", then "2nd great-", "3rd great-", and so on.
+
+static std::string great_prefix(int n)
+{
+    if (n <= 0)
+        return "";
+    if (n == 1)
+        return "great-";
+    return ordinal_number(n) + " great-";
+}
+
+// Choose the male, female or neutral form of a word.
+
+static std::string gendered(char sex, const char* male, const char* female, const char* neutral)
+{
+    if (sex == 'M')
+        return male;
+    if (sex == 'F')
+        return female;
+    return neutral;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Constructor
+///
+/// \param[in]  graph   family graph, which must stay in existence for the lifetime of this object
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gde_kinship::gde_kinship(const gde_family_graph& graph) :
+    my_graph(graph)
+{
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Set the maximum number of generations to search upwards from each person
+///
+/// The default is 12.
+///
+/// \param[in]  generations   number of generations
+///
+/// \exception std::logic_error thrown if the number of generations is negative
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_kinship::set_max_generations(int generations)
+{
+    if (generations < 0)
+        throw std::logic_error("Negative number of generations in gde_kinship::set_max_generations");
+    max_generations = generations;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Set the number of worker threads used by `relate_batch()`
+///
+/// \param[in]  num_threads   number of threads, or 0 to use one thread per processor core
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_kinship::set_num_threads(unsigned int num_threads)
+{
+    my_num_threads = num_threads;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Find the relationship between two persons
+///
+/// \param[in]  person_1   first person number
+/// \param[in]  person_2   second person number
+///
+/// \return     the relationship, named from the point of view of the first person
+///
+/// \exception std::out_of_range thrown if a person number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gde_relationship gde_kinship::relate(int person_1, int person_2) const
+{
+    search_state     state;
+    gde_relationship result;
+    relate_1(state, person_1, person_2, result);
+    return result;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Find the relationships between many pairs of persons
+///
+/// The pairs are shared out among the worker threads (see `set_num_threads()`).
+///
+/// \param[in]  pairs     pairs of person numbers
+/// \param[out] results   the relationships, in the same order as the pairs
+///
+/// \exception std::out_of_range thrown if a person number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_kinship::relate_batch(const std::vector<std::pair<int, int>>& pairs,
+                               std::vector<gde_relationship>& results) const
+{
+    // Check the inputs first, so that the worker threads cannot throw.
+
+    for (const std::pair<int, int>& p : pairs)
+    {
+        my_graph.sex(p.first);
+        my_graph.sex(p.second);
+    }
+
+    results.clear();
+    results.resize(pairs.size());
+
+    unsigned int num_threads = my_num_threads;
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    // Each thread takes the next chunk of pairs.
+
+    const size_t        chunk = 64;
+    std::atomic<size_t> next(0);
+
+    auto worker = [&]()
+    {
+        search_state state;
+        size_t first;
+        while ((first = next.fetch_add(chunk)) < pairs.size())
+        {
+            size_t last = std::min(pairs.size(), first + chunk);
+            for (size_t i=first; i<last; i++)
+                relate_1(state, pairs[i].first, pairs[i].second, results[i]);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int t=1; t<num_threads && t * chunk < pairs.size(); t++)
+        threads.push_back(std::thread(worker));
+    worker();
+    for (std::thread& th : threads)
+        th.join();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Name a relationship
+///
+/// \param[in]  up     generations from the first person up to the common ancestor
+/// \param[in]  down   generations from the common ancestor down to the second person
+/// \param[in]  sex    sex of the second person: 'M', 'F' or 'U' (unknown)
+/// \param[in]  half   `true` for a half relationship, such as "half-sister"
+///
+/// \return     what the second person is to the first, such as "grandmother" or "first cousin
+///             once removed"
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_kinship::relationship_name(int up, int down, char sex, bool half)
+{
+    if (up < 0 || down < 0)
+        return "";
+    if (up == 0 && down == 0)
+        return "self";
+
+    // Direct line
+
+    if (up == 0)
+    {
+        std::string base = gendered(sex, "son", "daughter", "child");
+        if (down == 1)
+            return base;
+        return great_prefix(down - 2) + "grand" + base;
+    }
+    if (down == 0)
+    {
+        std::string base = gendered(sex, "father", "mother", "parent");
+        if (up == 1)
+            return base;
+        return great_prefix(up - 2) + "grand" + base;
+    }
+
+    // Collateral lines
+
+    std::string prefix = half ? "half-" : "";
+
+    if (up == 1 && down == 1)
+        return prefix + gendered(sex, "brother", "sister", "sibling");
+    if (up == 1)
+    {
+        std::string base = gendered(sex, "nephew", "niece", "nephew or niece");
+        if (down == 2)
+            return prefix + base;
+        return prefix + great_prefix(down - 3) + "grand" + base;
+    }
+    if (down == 1)
+    {
+        std::string base = gendered(sex, "uncle", "aunt", "uncle or aunt");
+        if (up == 2)
+            return prefix + base;
+        return prefix + great_prefix(up - 2) + base;
+    }
+
+    std::string name = prefix + ordinal_word(std::min(up, down) - 1) + " cousin";
+    int removed = std::abs(up - down);
+    if (removed == 1)
+        name += " once removed";
+    else if (removed == 2)
+        name += " twice removed";
+    else if (removed > 2)
+        name += " " + std::to_string(removed) + " times removed";
+    return name;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Do the work of relate(), using working storage that may be reused.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_kinship::relate_1(search_state& state, int person_1, int person_2, gde_relationship& result) const
+{
+    result = gde_relationship();
+    result.person_1 = person_1;
+    result.person_2 = person_2;
+
+    char sex_2 = my_graph.sex(person_2);
+    my_graph.sex(person_1);
+
+    size_t num_words = (my_graph.num_persons() + 63) / 64;
+    for (int s=0; s<2; s++)
+        if (state.seen[s].size() != num_words)
+            state.seen[s].assign(num_words, 0);
+    state.meetings.clear();
+
+    visit(state, 0, person_1, 0);
+    visit(state, 1, person_2, 0);
+
+    // Expand one generation at a time, on the side with the smaller frontier. A common
+    // ancestor that has not been found yet must be more than gen[s] generations from side s,
+    // for at least one side, so stop once the best one found is no further than that.
+
+    size_t start[2] = { 0, 0 };
+    int    gen[2]   = { 0, 0 };
+    int    best     = INT_MAX;
+
+    for (;;)
+    {
+        for (const std::pair<int, int>& m : state.meetings)
+            best = std::min(best, m.second);
+
+        bool open[2];
+        int  bound = INT_MAX;
+        for (int s=0; s<2; s++)
+        {
+            open[s] = (start[s] < state.nodes[s].size() && gen[s] < max_generations);
+            if (open[s])
+                bound = std::min(bound, gen[s] + 1);
+        }
+        if (best <= bound || (!open[0] && !open[1]))
+            break;
+
+        int s;
+        if (open[0] && open[1])
+            s = (state.nodes[0].size() - start[0] <= state.nodes[1].size() - start[1]) ? 0 : 1;
+        else
+            s = open[0] ? 0 : 1;
+
+        size_t end = state.nodes[s].size();
+        for (size_t i=start[s]; i<end; i++)
+            for (int parent : my_graph.parents(state.nodes[s][i]))
+                if (!(state.seen[s][parent >> 6] & (1ull << (parent & 63))))
+                    visit(state, s, parent, gen[s] + 1);
+        start[s] = end;
+        gen[s]++;
+    }
+
+    // Pick the lowest common ancestor, and look for a second one at the same distances.
+
+    if (best < INT_MAX)
+    {
+        for (const std::pair<int, int>& m : state.meetings)
+        {
+            if (m.second != best)
+                continue;
+
+            int up   = depth_of(state, 0, m.first);
+            int down = depth_of(state, 1, m.first);
+
+            if (result.ancestor < 0)
+            {
+                result.ancestor = m.first;
+                result.up       = up;
+                result.down     = down;
+            }
+            else if (result.ancestor_2 < 0 && up == result.up && down == result.down)
+                result.ancestor_2 = m.first;
+        }
+
+        // A collateral relationship is a half relationship only if the two lines come down
+        // from the common ancestor through children who both have two known parents, and
+        // those parents are not the same. If a parent is missing, then it cannot be told.
+
+        bool half = false;
+        if (result.up > 0 && result.down > 0 && result.ancestor_2 < 0)
+        {
+            int child_1 = branch_child(state, 0, result.ancestor, result.up - 1);
+            int child_2 = branch_child(state, 1, result.ancestor, result.down - 1);
+            if (child_1 >= 0 && child_2 >= 0)
+            {
+                gde_person_range parents_1 = my_graph.parents(child_1);
+                gde_person_range parents_2 = my_graph.parents(child_2);
+                if (parents_1.size() == 2 && parents_2.size() == 2)
+                    half = !std::is_permutation(parents_1.begin(), parents_1.end(), parents_2.begin());
+            }
+        }
+        result.name = relationship_name(result.up, result.down, sex_2, half);
+    }
+    else
+    {
+        for (int spouse : my_graph.spouses(person_1))
+            if (spouse == person_2)
+                result.name = gendered(sex_2, "husband", "wife", "spouse");
+    }
+
+    // Clear the working storage for the next search.
+
+    for (int s=0; s<2; s++)
+    {
+        for (int p : state.nodes[s])
+            state.seen[s][p >> 6] = 0;
+        state.nodes[s].clear();
+        state.depth[s].clear();
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Mark a person as visited from one side, and note if the other side has already reached them.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_kinship::visit(search_state& state, int side, int person, int gen)
+{
+    state.seen[side][person >> 6] |= (1ull << (person & 63));
+    state.nodes[side].push_back(person);
+    state.depth[side].push_back(gen);
+
+    if (state.seen[1 - side][person >> 6] & (1ull << (person & 63)))
+        state.meetings.push_back(std::make_pair(person, gen + depth_of(state, 1 - side, person)));
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Get the generation at which a person was reached from one side. This is only needed when
+// the two sides meet, so a linear search is good enough.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int gde_kinship::depth_of(const search_state& state, int side, int person)
+{
+    for (size_t i=0; i<state.nodes[side].size(); i++)
+        if (state.nodes[side][i] == person)
+            return state.depth[side][i];
+    return -1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Find the person through whom one side reached a common ancestor: a person visited from that
+// side at the given generation who has the ancestor as a parent. Returns -1 if there is none.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int gde_kinship::branch_child(const search_state& state, int side, int ancestor, int gen) const
+{
+    for (size_t i=0; i<state.nodes[side].size(); i++)
+    {
+        if (state.depth[side][i] != gen)
+            continue;
+        for (int parent : my_graph.parents(state.nodes[side][i]))
+            if (parent == ancestor)
+                return state.nodes[side][i];
+    }
+    return -1;
+}
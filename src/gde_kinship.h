@@ -0,0 +1,74 @@
+///
+/// \file
+///
+
+#ifndef GDE_KINSHIP_H
+#define GDE_KINSHIP_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gde_family_graph.h"
+
+
+///
+/// \brief The relationship between two persons in a family graph
+///
+
+class gde_relationship
+{
+public:
+    int          person_1   = -1;   ///< first person
+    int          person_2   = -1;   ///< second person
+    int          ancestor   = -1;   ///< lowest common ancestor, or -1 if none was found
+    int          ancestor_2 = -1;   ///< second lowest common ancestor (usually the spouse of the first), or -1
+    int          up         = -1;   ///< generations from the first person up to the common ancestor
+    int          down       = -1;   ///< generations from the common ancestor down to the second person
+    std::string  name;              ///< what the second person is to the first, or empty if not related
+};
+
+
+
+///
+/// \brief Finds and names the relationship between two persons in a family graph
+///
+
+class gde_kinship
+{
+public:
+    gde_kinship (const gde_family_graph& graph);
+
+    void             set_max_generations (int generations);
+    void             set_num_threads     (unsigned int num_threads);
+
+    gde_relationship relate       (int person_1, int person_2) const;
+    void             relate_batch (const std::vector<std::pair<int, int>>& pairs,
+                                   std::vector<gde_relationship>& results) const;
+
+    static std::string relationship_name (int up, int down, char sex, bool half = false);
+
+private:
+    const gde_family_graph& my_graph;
+    int                     max_generations = 12;
+    unsigned int            my_num_threads  = 0;
+
+    // Working storage for one search. Each thread has its own, so it is reused from one
+    // query to the next without being reallocated.
+
+    struct search_state
+    {
+        std::vector<uint64_t>              seen[2];    // visited bitsets, one for each side
+        std::vector<int>                   nodes[2];   // visited persons, in order of discovery
+        std::vector<int>                   depth[2];   // generation of each visited person
+        std::vector<std::pair<int, int>>   meetings;   // persons reached from both sides, with total generations
+    };
+
+    void relate_1  (search_state& state, int person_1, int person_2, gde_relationship& result) const;
+    static void visit    (search_state& state, int side, int person, int gen);
+    static int  depth_of (const search_state& state, int side, int person);
+    int         branch_child (const search_state& state, int side, int ancestor, int gen) const;
+};
+
+#endif
@@ -0,0 +1,411 @@
+///
+/// \class gde_linkage gde_linkage.h
+///
+/// \brief Finds person mentions that probably refer to the same person
+///
+/// This class takes the person mentions extracted from all of the GenDat sources (see
+/// `gde_mention_extractor`) and looks for pairs that may describe the same person, such as a
+/// child in a birth record and the groom in a later marriage record.
+///
+/// Comparing every mention with every other one would take far too long, so the mentions are
+/// first divided into blocks. Two mentions are only compared if their surnames have the same
+/// Soundex code and their estimated years of birth are within a few years of each other.
+/// Mentions with no estimated year of birth are not linked. The blocks are then scored in
+/// parallel, on all available processor cores. A very large block (a common surname) is split
+/// into pieces that are scored by different threads.
+///
+/// Each candidate pair is scored from the Jaro-Winkler similarity of the normalized surnames
+/// and given names and from the difference in the years of birth, with a small bonus if the
+/// events took place in the same community. The best candidates for each mention are kept and
+/// ranked.
+///
+
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
+#include <thread>
+#include <stdexcept>
+
+#include "gde_linkage.h"
+#include "gde_string_match.h"
+
+
+// Number of rows in each multi-row INSERT statement.
+
+static const unsigned int INSERT_BATCH_SIZE = 500;
+
+// A block with more mentions than this is split into pieces of this size, so that one very
+// common surname does not keep a single thread busy while the others have finished.
+
+static const size_t MAX_PIECE_SIZE = 256;
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Set the year of birth window
+///
+/// Two mentions are only compared if their estimated years of birth differ by no more than
+/// this number of years. The default is 2.
+///
+/// \param[in]  years   size of the window
+///
+/// \exception std::logic_error thrown if the window is negative
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_linkage::set_year_window(int years)
+{
+    if (years < 0)
+        throw std::logic_error("Negative year window in gde_linkage::set_year_window");
+    year_window = years;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Set the minimum score
+///
+/// Candidate pairs with a lower score are discarded. The default is 0.85.
+///
+/// \param[in]  score   minimum score, from 0.0 to 1.0
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_linkage::set_min_score(double score)
+{
+    min_score = score;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Set the maximum number of candidates kept for each mention
+///
+/// The default is 5.
+///
+/// \param[in]  max_links   number of candidates
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_linkage::set_max_per_mention(unsigned int max_links)
+{
+    max_per_mention = max_links;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Set the number of worker threads
+///
+/// \param[in]  num_threads   number of threads, or 0 to use one thread per processor core
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_linkage::set_num_threads(unsigned int num_threads)
+{
+    my_num_threads = num_threads;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Determine if a mention can be linked
+///
+/// `run()` skips mentions with no estimated year of birth, and mentions whose surname has no
+/// Soundex code. Use this to report how many mentions of each source are left out.
+///
+/// \param[in]  mention   person mention
+///
+/// \return     true if the mention has a year of birth and a surname that can be blocked
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool gde_linkage::linkable(const gde_mention& mention)
+{
+    return mention.birth_year > 0 &&
+           !gde_string_match::soundex(gde_string_match::normalize_name(mention.surname)).empty();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Find candidate links
+///
+/// For every mention that has candidates, the result holds up to `max_per_mention` links with
+/// that mention as `mention_1`, ranked by decreasing score. Each pair of mentions therefore
+/// appears twice, once in each direction.
+///
+/// \param[in]  mentions   person mentions from all sources
+/// \param[out] links      candidate links, sorted by `mention_1` and then by rank
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_linkage::run(const std::vector<gde_mention>& mentions,
+                      std::vector<gde_link_candidate>& links) const
+{
+    links.clear();
+
+    // Normalize the names and work out the blocking keys.
+
+    std::vector<prepared> prep(mentions.size());
+    std::vector<unsigned int> order;
+
+    for (unsigned int i=0; i<mentions.size(); i++)
+    {
+        prep[i].surname    = gde_string_match::normalize_name(mentions[i].surname);
+        prep[i].given      = gde_string_match::normalize_name(mentions[i].given);
+        prep[i].community  = gde_string_match::normalize_name(mentions[i].community);
+        prep[i].block      = gde_string_match::soundex(prep[i].surname);
+        prep[i].birth_year = mentions[i].birth_year;
+        prep[i].sex        = mentions[i].sex.empty() ? 0 : std::toupper((unsigned char) mentions[i].sex[0]);
+
+        if (!prep[i].block.empty() && prep[i].birth_year > 0)
+            order.push_back(i);
+    }
+
+    // Sort by block and then by year of birth, so that each block is one contiguous range
+    // and the year window can slide along it.
+
+    std::sort(order.begin(), order.end(), [&prep](unsigned int a, unsigned int b)
+    {
+        if (prep[a].block != prep[b].block)
+            return prep[a].block < prep[b].block;
+        return prep[a].birth_year < prep[b].birth_year;
+    });
+
+    // Divide each block into pieces. The mentions in a piece are compared with the later
+    // mentions of the whole block, so the pieces can be scored independently.
+
+    struct piece
+    {
+        size_t first;   // first mention of the piece
+        size_t last;    // one past the last mention of the piece
+        size_t end;     // one past the last mention of the block
+    };
+    std::vector<piece> pieces;
+
+    for (size_t first=0; first<order.size(); )
+    {
+        size_t end = first + 1;
+        while (end < order.size() && prep[order[end]].block == prep[order[first]].block)
+            end++;
+        if (end - first > 1)
+        {
+            for (size_t p=first; p<end; p+=MAX_PIECE_SIZE)
+                pieces.push_back({ p, std::min(end, p + MAX_PIECE_SIZE), end });
+        }
+        first = end;
+    }
+
+    // Start with the largest pieces, so that the threads finish at about the same time. A piece
+    // at the start of a large block compares its mentions with more of the block than the last
+    // piece does, but within one block the mentions are sorted by year of birth, so each of them
+    // is compared with about the same number of others.
+
+    std::sort(pieces.begin(), pieces.end(), [](const piece& a, const piece& b)
+    {
+        return (a.last - a.first) > (b.last - b.first);
+    });
+
+    // Score the pieces in parallel. Each thread takes the next unscored piece.
+
+    unsigned int num_threads = my_num_threads;
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::atomic<size_t> next_piece(0);
+    std::vector<std::vector<gde_link_candidate>> thread_links(num_threads);
+    std::vector<std::thread> threads;
+
+    auto worker = [&](unsigned int t)
+    {
+        size_t k;
+        while ((k = next_piece++) < pieces.size())
+            score_block(prep, mentions, order, pieces[k].first, pieces[k].last, pieces[k].end, thread_links[t]);
+    };
+
+    for (unsigned int t=1; t<num_threads; t++)
+        threads.push_back(std::thread(worker, t));
+    worker(0);
+    for (std::thread& th : threads)
+        th.join();
+
+    // Gather the results, and keep the best candidates for each mention.
+
+    for (std::vector<gde_link_candidate>& tl : thread_links)
+        links.insert(links.end(), tl.begin(), tl.end());
+
+    std::sort(links.begin(), links.end(), [](const gde_link_candidate& a, const gde_link_candidate& b)
+    {
+        if (a.mention_1 != b.mention_1)
+            return a.mention_1 < b.mention_1;
+        if (a.score != b.score)
+            return a.score > b.score;
+        return a.mention_2 < b.mention_2;
+    });
+
+    size_t kept = 0;
+    for (size_t i=0; i<links.size(); i++)
+    {
+        unsigned int rank = (i > 0 && links[i].mention_1 == links[i-1].mention_1) ? links[i-1].rank + 1 : 1;
+        links[i].rank = rank;
+        if (rank <= max_per_mention)
+            links[kept++] = links[i];
+    }
+    links.resize(kept);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Create the link candidate table
+///
+/// \param[in]  db      database connection, which must currently be open
+/// \param[in]  table   table name
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_linkage::create_table(database& db, std::string table) const
+{
+    db.execute("CREATE TABLE IF NOT EXISTS " + table + " ("
+               "source_1 VARCHAR(64) NOT NULL, "
+               "key_1 VARCHAR(64) NOT NULL, "
+               "relation_1 VARCHAR(4) NOT NULL, "
+               "source_2 VARCHAR(64) NOT NULL, "
+               "key_2 VARCHAR(64) NOT NULL, "
+               "relation_2 VARCHAR(4) NOT NULL, "
+               "score DOUBLE NOT NULL, "
+               "link_rank INT UNSIGNED NOT NULL, "
+               "KEY (source_1, key_1), "
+               "KEY (source_2, key_2))");
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Write the link candidates to the database
+///
+/// Any existing rows in the table are deleted first, so the table always holds the results of
+/// the most recent linkage pass. Sources are identified by their database table names, and
+/// relations by their GenDat field code prefixes (empty for the principal person).
+///
+/// \param[in]  db           database connection, which must currently be open
+/// \param[in]  table        table name (see `create_table`)
+/// \param[in]  source_map   object containing the GenDat source definitions
+/// \param[in]  mentions     person mentions that were passed to `run`
+/// \param[in]  links        link candidates produced by `run`
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_linkage::write_to_db(database& db, std::string table, const gde_source_map& source_map,
+                              const std::vector<gde_mention>& mentions,
+                              const std::vector<gde_link_candidate>& links) const
+{
+    db.execute("START TRANSACTION");
+    try
+    {
+        db.execute("DELETE FROM " + table);
+
+        std::string query;
+        for (size_t i=0; i<links.size(); i++)
+        {
+            if (i % INSERT_BATCH_SIZE == 0)
+                query = "INSERT INTO " + table +
+                        " (source_1, key_1, relation_1, source_2, key_2, relation_2, score, link_rank) VALUES ";
+            else
+                query += ", ";
+
+            const gde_mention& m1 = mentions[links[i].mention_1];
+            const gde_mention& m2 = mentions[links[i].mention_2];
+
+            query += "('" + db.escape_str(source_map.src_db_table(m1.source)) + "', '" +
+                     db.escape_str(m1.key) + "', '" + fam_rel_code(m1.relation) + "', '" +
+                     db.escape_str(source_map.src_db_table(m2.source)) + "', '" +
+                     db.escape_str(m2.key) + "', '" + fam_rel_code(m2.relation) + "', " +
+                     std::to_string(links[i].score) + ", " + std::to_string(links[i].rank) + ")";
+
+            if ((i + 1) % INSERT_BATCH_SIZE == 0 || i + 1 == links.size())
+                db.execute(query);
+        }
+
+        db.execute("COMMIT");
+    }
+    catch (const std::exception&)
+    {
+        try { db.execute("ROLLBACK"); } catch (const std::exception&) {}
+        throw;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Score the candidate pairs of one piece of a block: each of the mentions in order[first..last-1]
+// with the later mentions of the block, up to order[end-1]. The mentions of a block all have the
+// same blocking key and are sorted by year of birth.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_linkage::score_block(const std::vector<prepared>& prep, const std::vector<gde_mention>& mentions,
+                              const std::vector<unsigned int>& order, size_t first, size_t last, size_t end,
+                              std::vector<gde_link_candidate>& links) const
+{
+    for (size_t a=first; a<last; a++)
+    {
+        unsigned int    i = order[a];
+        const prepared& p = prep[i];
+
+        gde_string_match surname_match(p.surname);
+        gde_string_match given_match(p.given);
+
+        for (size_t b=a+1; b<end && prep[order[b]].birth_year - p.birth_year <= year_window; b++)
+        {
+            unsigned int    j = order[b];
+            const prepared& q = prep[j];
+
+            // Two people in the same record are never the same person, and people of
+            // different sex are not compared.
+
+            if (mentions[i].source == mentions[j].source && mentions[i].key == mentions[j].key)
+                continue;
+            if (p.sex != 0 && q.sex != 0 && p.sex != q.sex)
+                continue;
+
+            double s_surname = surname_match.jaro_winkler(q.surname);
+            double s_given   = (p.given.empty() || q.given.empty()) ? 0.5 : given_match.jaro_winkler(q.given);
+            double s_year    = 1.0 - std::abs(q.birth_year - p.birth_year) / (year_window + 1.0);
+
+            double score = 0.4 * s_surname + 0.4 * s_given + 0.2 * s_year;
+
+            if (!p.community.empty() && p.community == q.community)
+                score = std::min(1.0, score + 0.05);
+
+            if (score >= min_score)
+            {
+                gde_link_candidate link;
+                link.mention_1 = i;
+                link.mention_2 = j;
+                link.score     = score;
+                links.push_back(link);
+
+                std::swap(link.mention_1, link.mention_2);
+                links.push_back(link);
+            }
+        }
+    }
+}
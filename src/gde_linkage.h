@@ -0,0 +1,72 @@
+///
+/// \file
+///
+
+#ifndef GDE_LINKAGE_H
+#define GDE_LINKAGE_H
+
+#include <string>
+#include <vector>
+
+#include "database.h"
+#include "gde_mention.h"
+#include "gde_source_map.h"
+
+
+///
+/// \brief A possible link between two person mentions
+///
+
+class gde_link_candidate
+{
+public:
+    unsigned int mention_1 = 0;    ///< index of the first mention
+    unsigned int mention_2 = 0;    ///< index of the second mention
+    double       score     = 0.0;  ///< match score, from 0.0 to 1.0
+    unsigned int rank      = 0;    ///< rank among the candidates for the first mention (1 = best)
+};
+
+
+
+class gde_linkage
+{
+public:
+    void set_year_window     (int years);
+    void set_min_score       (double score);
+    void set_max_per_mention (unsigned int max_links);
+    void set_num_threads     (unsigned int num_threads);
+
+    void run                 (const std::vector<gde_mention>& mentions,
+                              std::vector<gde_link_candidate>& links) const;
+
+    static bool linkable     (const gde_mention& mention);
+
+    void create_table        (database& db, std::string table) const;
+    void write_to_db         (database& db, std::string table, const gde_source_map& source_map,
+                              const std::vector<gde_mention>& mentions,
+                              const std::vector<gde_link_candidate>& links) const;
+
+private:
+    int          year_window     = 2;
+    double       min_score       = 0.85;
+    unsigned int max_per_mention = 5;
+    unsigned int my_num_threads  = 0;
+
+    // Normalized form of one mention, ready for blocking and scoring.
+
+    struct prepared
+    {
+        std::string  block;
+        std::string  surname;
+        std::string  given;
+        std::string  community;
+        char         sex;
+        int          birth_year;
+    };
+
+    void score_block (const std::vector<prepared>& prep, const std::vector<gde_mention>& mentions,
+                      const std::vector<unsigned int>& order, size_t first, size_t last, size_t end,
+                      std::vector<gde_link_candidate>& links) const;
+};
+
+#endif
@@ -0,0 +1,477 @@
+///
+/// \class gde_mention_extractor gde_mention.h
+///
+/// \brief Extracts person mentions from GenDat sources
+///
+/// Every record in a GenDat source mentions one or more people: the child in a birth record,
+/// the child's father and mother, the bride and groom in a marriage record, and so on. This
+/// class uses the GenDat field codes in a `gde_source_map` to find out which database columns
+/// hold the surname, given names, sex and age of each of these people, and which columns hold
+/// the record key and the date and place of the event. It then turns each source record into
+/// a set of `gde_mention` objects that have the same layout, whatever the source.
+///
+/// A source can only be used if it has a KEY field and at least one person with a surname (or
+/// a full name). See `source_ok()`.
+///
+/// The year of birth of each person is estimated from, in order of preference:
+///
+/// - an explicit birth date or birth year for that person;
+/// - the event year, if the record is a birth or baptism and the person is the principal;
+/// - the event year less the recorded age.
+///
+/// A source without a date field, such as a census, is given a fixed event year, taken from the
+/// first four-digit number in the source name or else in its table name ("1871 Census"). See
+/// `event_year()`.
+///
+
+
+#include <cctype>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "gde_mention.h"
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Constructor
+///
+/// The constructor examines the field codes of every GenDat source and works out how to build
+/// person mentions from its records.
+///
+/// \param[in]  source_map   object containing the GenDat source definitions
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gde_mention_extractor::gde_mention_extractor(const gde_source_map& source_map) :
+    my_source_map(source_map)
+{
+    plan_list.resize(my_source_map.num_sources());
+
+    for (int i=0; i<my_source_map.num_sources(); i++)
+    {
+        source_plan& plan = plan_list[i];
+
+        for (int j=0; j<my_source_map.num_fields(i); j++)
+        {
+            gde_relation rel      = my_source_map.fam_rel(i,j);
+            gde_data_tag event    = my_source_map.event_type(i,j);
+            gde_data_tag fact     = my_source_map.fact_type(i,j);
+            gde_data_tag fact_mod = my_source_map.fact_type_mod(i,j);
+
+            if (fact == gde_data_tag::UNDEFINED)
+                continue;
+
+            int col = add_column(plan, my_source_map.fld_db_name(i,j));
+
+            // Facts about the record as a whole.
+
+            if (rel == gde_relation::UNDEFINED && fact == gde_data_tag::KEY)
+            {
+                plan.key = col;
+                continue;
+            }
+            if (rel == gde_relation::UNDEFINED &&
+                    (event == gde_data_tag::UNDEFINED || event == my_source_map.src_type(i)))
+            {
+                if (fact == gde_data_tag::DATE && fact_mod == gde_data_tag::UNDEFINED)
+                {
+                    plan.date = col;
+                    continue;
+                }
+                if (fact == gde_data_tag::DATE && fact_mod == gde_data_tag::YEAR)
+                {
+                    plan.year = col;
+                    continue;
+                }
+                if (fact == gde_data_tag::PLAC && fact_mod == gde_data_tag::COMMUNITY)
+                {
+                    plan.community = col;
+                    continue;
+                }
+                if (fact == gde_data_tag::PLAC && fact_mod == gde_data_tag::COUNTY)
+                {
+                    plan.county = col;
+                    continue;
+                }
+            }
+
+            // Facts about one person. Find that person in the list, or add them.
+
+            person_cols* person = nullptr;
+            for (person_cols& p : plan.persons)
+                if (p.relation == rel)
+                    person = &p;
+            if (person == nullptr)
+            {
+                plan.persons.push_back(person_cols());
+                person = &plan.persons.back();
+                person->relation = rel;
+            }
+
+            if (event == gde_data_tag::UNDEFINED)
+            {
+                switch (fact)
+                {
+                case gde_data_tag::SURN: person->surname = col; break;
+                case gde_data_tag::GIVN: person->given   = col; break;
+                case gde_data_tag::NAME: person->name    = col; break;
+                case gde_data_tag::SEX:  person->sex     = col; break;
+                case gde_data_tag::AGE:  person->age     = col; break;
+                default: break;
+                }
+            }
+            else if (event == gde_data_tag::BIRT && fact == gde_data_tag::DATE)
+            {
+                if (fact_mod == gde_data_tag::YEAR)
+                    person->birth_year = col;
+                else if (fact_mod == gde_data_tag::UNDEFINED)
+                    person->birth_date = col;
+            }
+        }
+
+        // Drop anyone who cannot be named. The source is usable if it has a key and at least
+        // one person left.
+
+        for (size_t k=plan.persons.size(); k-- > 0; )
+            if (plan.persons[k].surname < 0 && plan.persons[k].name < 0)
+                plan.persons.erase(plan.persons.begin() + k);
+
+        plan.ok = (plan.key >= 0 && !plan.persons.empty());
+
+        // A source with no date field describes one point in time, which is usually in its name.
+
+        if (plan.date < 0 && plan.year < 0)
+        {
+            plan.event_year = parse_year(my_source_map.src_name(i));
+            if (plan.event_year == 0)
+                plan.event_year = parse_year(my_source_map.src_db_table(i));
+        }
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Determine if person mentions can be extracted from a source
+///
+/// \param[in]  source_num   source number
+///
+/// \return     `true` if the source has a KEY field and at least one named person
+///
+/// \exception std::out_of_range thrown if the source number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool gde_mention_extractor::source_ok(int source_num) const
+{
+    test_input(source_num);
+    return plan_list[source_num].ok;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the database field that holds the record key of a source
+///
+/// \param[in]  source_num   source number
+///
+/// \return     database field name, or an empty string if the source cannot be used
+///
+/// \exception std::out_of_range thrown if the source number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_mention_extractor::key_field(int source_num) const
+{
+    test_input(source_num);
+
+    const source_plan& plan = plan_list[source_num];
+    if (!plan.ok)
+        return "";
+    return plan.db_fields[plan.key];
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the fixed event year of a source
+///
+/// Sources that have no date field are given the year found in the source name or table name.
+/// It is used as the year of every record, so that the year of birth can be estimated from an
+/// age.
+///
+/// \param[in]  source_num   source number
+///
+/// \return     event year, or 0 if the source has a date field or no year was found
+///
+/// \exception std::out_of_range thrown if the source number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int gde_mention_extractor::event_year(int source_num) const
+{
+    test_input(source_num);
+    return plan_list[source_num].event_year;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the query that reads the required fields of a source
+///
+/// \param[in]  source_num   source number
+/// \param[in]  condition    optional SQL condition (without the WHERE keyword) that selects
+///                          the records to read
+///
+/// \return     SQL SELECT statement, or an empty string if the source cannot be used
+///
+/// \exception std::out_of_range thrown if the source number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_mention_extractor::source_query(int source_num, std::string condition) const
+{
+    test_input(source_num);
+
+    const source_plan& plan = plan_list[source_num];
+    if (!plan.ok)
+        return "";
+
+    std::string query = "SELECT ";
+    for (size_t k=0; k<plan.db_fields.size(); k++)
+    {
+        if (k > 0)
+            query += ", ";
+        query += plan.db_fields[k];
+    }
+    query += " FROM " + my_source_map.src_db_table(source_num);
+    if (!condition.empty())
+        query += " WHERE " + condition;
+    return query;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Extract person mentions from a row set
+///
+/// \param[in]  source_num   source number
+/// \param[in]  row_set      result of running the query from `source_query()`
+/// \param[out] mentions     the new mentions are appended to this list
+///
+/// \exception std::out_of_range thrown if the source number is out of range
+/// \exception std::logic_error  thrown if the row set does not have the expected columns
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_mention_extractor::extract(int source_num, const db_row_set& row_set,
+                                    std::vector<gde_mention>& mentions) const
+{
+    test_input(source_num);
+
+    const source_plan& plan = plan_list[source_num];
+    if (!plan.ok || row_set.num_rows() == 0)
+        return;
+
+    if (row_set.num_cols() != plan.db_fields.size())
+        throw std::logic_error("Unexpected row set in gde_mention_extractor::extract");
+
+    gde_data_tag src_type = my_source_map.src_type(source_num);
+    std::string  data;
+
+    for (unsigned int row=0; row<row_set.num_rows(); row++)
+    {
+        // Read the facts about the record as a whole.
+
+        gde_mention record;
+        record.source = source_num;
+        record.event  = src_type;
+
+        row_set.get_data(row, plan.key, record.key);
+        if (plan.year >= 0 && row_set.get_data(row, plan.year, data))
+            record.year = parse_year(data);
+        if (record.year == 0 && plan.date >= 0 && row_set.get_data(row, plan.date, data))
+            record.year = parse_year(data);
+        if (record.year == 0)
+            record.year = plan.event_year;
+        if (plan.community >= 0)
+            row_set.get_data(row, plan.community, record.community);
+        if (plan.county >= 0)
+            row_set.get_data(row, plan.county, record.county);
+
+        // Add one mention for each named person.
+
+        for (const person_cols& p : plan.persons)
+        {
+            gde_mention m = record;
+            m.relation = p.relation;
+
+            if (p.surname >= 0)
+                row_set.get_data(row, p.surname, m.surname);
+            if (p.given >= 0)
+                row_set.get_data(row, p.given, m.given);
+
+            // Split a full name, if there are no separate name fields.
+
+            if (p.surname < 0 && row_set.get_data(row, p.name, data))
+            {
+                size_t last_space = data.find_last_of(' ');
+                if (last_space == std::string::npos)
+                    m.surname = data;
+                else
+                {
+                    m.surname = data.substr(last_space + 1);
+                    if (p.given < 0)
+                        m.given = data.substr(0, last_space);
+                }
+            }
+
+            if (m.surname.empty() && m.given.empty())
+                continue;
+
+            if (p.sex >= 0)
+                row_set.get_data(row, p.sex, m.sex);
+
+            // Estimate the year of birth.
+
+            if (p.birth_year >= 0 && row_set.get_data(row, p.birth_year, data))
+                m.birth_year = parse_year(data);
+            if (m.birth_year == 0 && p.birth_date >= 0 && row_set.get_data(row, p.birth_date, data))
+                m.birth_year = parse_year(data);
+            if (m.birth_year == 0 && m.year > 0 && p.relation == gde_relation::UNDEFINED &&
+                    (src_type == gde_data_tag::BIRT || src_type == gde_data_tag::BAPM))
+                m.birth_year = m.year;
+            if (m.birth_year == 0 && m.year > 0 && p.age >= 0 && row_set.get_data(row, p.age, data))
+            {
+                char* end;
+                long age = std::strtol(data.c_str(), &end, 10);
+                if (end != data.c_str() && age >= 0 && age < 120)
+                    m.birth_year = m.year - age;
+            }
+
+            mentions.push_back(m);
+        }
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Extract person mentions from a source in the database
+///
+/// \param[in]  source_num   source number
+/// \param[in]  db           database connection, which must currently be open
+/// \param[out] mentions     the new mentions are appended to this list
+/// \param[in]  condition    optional SQL condition (without the WHERE keyword) that selects
+///                          the records to read
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+/// \exception std::out_of_range  thrown if the source number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_mention_extractor::extract(int source_num, database& db, std::vector<gde_mention>& mentions,
+                                    std::string condition) const
+{
+    if (!source_ok(source_num))
+        return;
+
+    db_row_set row_set;
+    db.execute(source_query(source_num, condition), row_set);
+    extract(source_num, row_set, mentions);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Extract person mentions from every usable source in the database
+///
+/// \param[in]  db           database connection, which must currently be open
+/// \param[out] mentions     the new mentions are appended to this list
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_mention_extractor::extract_all(database& db, std::vector<gde_mention>& mentions) const
+{
+    for (int i=0; i<my_source_map.num_sources(); i++)
+        extract(i, db, mentions);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Find the year in a date
+///
+/// The year is taken to be the first group of exactly four digits, which works for dates such as
+/// "1871-04-02", "2 APR 1871" and "1871".
+///
+/// \param[in]  date   date string
+///
+/// \return     year, or 0 if none was found
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int gde_mention_extractor::parse_year(const std::string& date)
+{
+    size_t i = 0;
+    while (i < date.size())
+    {
+        if (!std::isdigit((unsigned char) date[i]))
+        {
+            i++;
+            continue;
+        }
+
+        size_t start = i;
+        while (i < date.size() && std::isdigit((unsigned char) date[i]))
+            i++;
+        if (i - start == 4)
+            return std::atoi(date.c_str() + start);
+    }
+    return 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Add a database field to the source query, if it's not already there, and return
+// its column number.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int gde_mention_extractor::add_column(source_plan& plan, const std::string& db_field)
+{
+    for (size_t k=0; k<plan.db_fields.size(); k++)
+        if (plan.db_fields[k] == db_field)
+            return k;
+
+    plan.db_fields.push_back(db_field);
+    return plan.db_fields.size() - 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Make sure the source number is valid.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_mention_extractor::test_input(int source_num) const
+{
+    if (source_num < 0 || source_num >= (int) plan_list.size())
+        throw std::out_of_range("Source number in gde_mention_extractor:: is out of range");
+}
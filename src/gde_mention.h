@@ -0,0 +1,93 @@
+///
+/// \file
+///
+
+#ifndef GDE_MENTION_H
+#define GDE_MENTION_H
+
+#include <string>
+#include <vector>
+
+#include "database.h"
+#include "db_row_set.h"
+#include "gde_source_map.h"
+
+
+///
+/// \brief One person mentioned in one GenDat source record
+///
+
+class gde_mention
+{
+public:
+    int           source     = -1;                       ///< source number in the source map
+    std::string   key;                                   ///< primary key of the source record
+    gde_relation  relation   = gde_relation::UNDEFINED;  ///< relation to the principal person
+    gde_data_tag  event      = gde_data_tag::UNDEFINED;  ///< type of the source record
+    std::string   surname;                               ///< surname
+    std::string   given;                                 ///< given name(s)
+    std::string   sex;                                   ///< sex, as recorded
+    int           year       = 0;                        ///< year of the event, or 0 if unknown
+    int           birth_year = 0;                        ///< estimated year of birth, or 0 if unknown
+    std::string   community;                             ///< community where the event took place
+    std::string   county;                                ///< county where the event took place
+};
+
+
+
+class gde_mention_extractor
+{
+public:
+    gde_mention_extractor (const gde_source_map& source_map);
+
+    bool        source_ok    (int source_num) const;
+    std::string key_field    (int source_num) const;
+    int         event_year   (int source_num) const;
+    std::string source_query (int source_num, std::string condition = "") const;
+    void        extract      (int source_num, const db_row_set& row_set,
+                              std::vector<gde_mention>& mentions) const;
+    void        extract      (int source_num, database& db, std::vector<gde_mention>& mentions,
+                              std::string condition = "") const;
+    void        extract_all  (database& db, std::vector<gde_mention>& mentions) const;
+
+    static int  parse_year   (const std::string& date);
+
+private:
+
+    // Columns (in the source query) that describe one person in the record.
+
+    struct person_cols
+    {
+        gde_relation relation   = gde_relation::UNDEFINED;
+        int          surname    = -1;
+        int          given      = -1;
+        int          name       = -1;
+        int          sex        = -1;
+        int          age        = -1;
+        int          birth_date = -1;
+        int          birth_year = -1;
+    };
+
+    // Plan for turning the rows of one GenDat source into person mentions.
+
+    struct source_plan
+    {
+        bool                     ok         = false;
+        int                      key        = -1;
+        int                      date       = -1;
+        int                      year       = -1;
+        int                      community  = -1;
+        int                      county     = -1;
+        int                      event_year = 0;
+        std::vector<person_cols> persons;
+        std::vector<std::string> db_fields;
+    };
+
+    const gde_source_map&    my_source_map;
+    std::vector<source_plan> plan_list;
+
+    static int  add_column (source_plan& plan, const std::string& db_field);
+    void        test_input (int source_num) const;
+};
+
+#endif
@@ -0,0 +1,561 @@
+///
+/// \class gde_mention_table gde_mention_table.h
+///
+/// \brief Maintains a single table of the people mentioned in all GenDat sources
+///
+/// Each GenDat source table has its own column layout, so a search across all of the sources
+/// would otherwise have to know the layout of every one of them. This class uses a
+/// `gde_mention_extractor` to project the records of every usable source into one denormalized
+/// table, with one row for each person mentioned in each record:
+///
+/// | Column       | Contents                                                        |
+/// |--------------|-----------------------------------------------------------------|
+/// | mention_id   | auto-increment primary key                                      |
+/// | source       | database table of the GenDat source                             |
+/// | rec_key      | primary key of the source record                                |
+/// | relation     | relation to the principal person (see `fam_rel_code()`)         |
+/// | event        | type of the source record (see `data_tag_text()`)               |
+/// | surname      | surname, as recorded                                            |
+/// | given        | given name(s), as recorded                                      |
+/// | sex          | sex, as recorded                                                |
+/// | surname_norm | normalized surname (see `gde_string_match::normalize_name()`)   |
+/// | surname_sdx  | Soundex code of the surname                                     |
+/// | year         | year of the event, or NULL                                      |
+/// | birth_year   | estimated year of birth, or NULL                                |
+/// | community    | community where the event took place                            |
+/// | county       | county where the event took place                               |
+///
+/// Cross-source searches then become indexed lookups on this one table.
+///
+/// The table is loaded with multi-row INSERT statements. The sources are loaded in parallel,
+/// with each worker thread using its own database connection. The rows of each source are
+/// replaced in one transaction, so a search during a rebuild sees either the old rows of a
+/// source or the new ones, never an empty or partly loaded source.
+///
+/// The table can be kept up to date incrementally by a `gde_change_tracker`, since this class
+/// implements the `gde_derived_table` interface.
+///
+
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <mutex>
+#include <thread>
+#include <stdexcept>
+
+#include "gde_mention_table.h"
+#include "gde_string_match.h"
+
+
+// Number of rows in each multi-row INSERT statement.
+
+static const unsigned int INSERT_BATCH_SIZE = 500;
+
+
+
+// Convert a column name to upper case, for comparison.
+
+static std::string upper_case(std::string str)
+{
+    for (char& c : str)
+        c = std::toupper((unsigned char) c);
+    return str;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Constructor
+///
+/// \param[in]  source_map   object containing the GenDat source definitions, which must stay in
+///                          existence for the lifetime of this object
+/// \param[in]  table        name of the person mention table
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gde_mention_table::gde_mention_table(const gde_source_map& source_map, std::string table) :
+    my_source_map(source_map),
+    extractor(source_map),
+    my_table(table)
+{
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the name of the person mention table
+///
+/// \return     table name
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_mention_table::table_name() const
+{
+    return my_table;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Set the number of worker threads used by `build()`
+///
+/// \param[in]  num_threads   number of threads, or 0 to use one thread per processor core
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_mention_table::set_num_threads(unsigned int num_threads)
+{
+    my_num_threads = num_threads;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Create the person mention table, if it does not already exist
+///
+/// \param[in]  db   database connection, which must currently be open
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_mention_table::create_table(database& db) const
+{
+    db.execute("CREATE TABLE IF NOT EXISTS " + my_table + " ("
+               "mention_id INT UNSIGNED NOT NULL AUTO_INCREMENT, "
+               "source VARCHAR(64) NOT NULL, "
+               "rec_key VARCHAR(64) NOT NULL, "
+               "relation VARCHAR(4) NOT NULL, "
+               "event VARCHAR(32) NOT NULL, "
+               "surname VARCHAR(100) NOT NULL, "
+               "given VARCHAR(100) NOT NULL, "
+               "sex VARCHAR(16) NOT NULL, "
+               "surname_norm VARCHAR(100) NOT NULL, "
+               "surname_sdx CHAR(4) NOT NULL, "
+               "year SMALLINT UNSIGNED NULL, "
+               "birth_year SMALLINT UNSIGNED NULL, "
+               "community VARCHAR(100) NOT NULL, "
+               "county VARCHAR(100) NOT NULL, "
+               "PRIMARY KEY (mention_id), "
+               "KEY (surname_norm, given), "
+               "KEY (surname_sdx, birth_year), "
+               "KEY (source, rec_key), "
+               "KEY (community, year))");
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Rebuild the whole person mention table
+///
+/// The table is created if required, and then the rows of every usable GenDat source are
+/// replaced, each source in its own transaction. Rows from any other source are then deleted.
+/// The sources are shared out among the worker threads. The calling thread uses the given
+/// connection, and every other worker opens its own connection to the same database.
+///
+/// \param[in]  db   database connection, which must currently be open
+///
+/// \return     number of rows loaded
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int gde_mention_table::build(database& db) const
+{
+    create_table(db);
+
+    std::vector<int> sources;
+    std::string      source_list;
+    for (int i=0; i<my_source_map.num_sources(); i++)
+    {
+        if (extractor.source_ok(i))
+        {
+            sources.push_back(i);
+            source_list += (source_list.empty() ? "'" : ", '") +
+                           db.escape_str(my_source_map.src_db_table(i)) + "'";
+        }
+    }
+
+    unsigned int num_threads = my_num_threads;
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    num_threads = std::max(1u, std::min(num_threads, (unsigned int) sources.size()));
+
+    std::atomic<size_t>       next_source(0);
+    std::atomic<unsigned int> num_rows(0);
+    std::mutex                error_mutex;
+    std::string               error_msg;
+
+    auto worker = [&](database* worker_db)
+    {
+        database own_db;
+
+        try
+        {
+            if (worker_db == nullptr)
+            {
+                own_db.connect(db);
+                worker_db = &own_db;
+            }
+
+            size_t s;
+            while ((s = next_source++) < sources.size())
+            {
+                std::vector<gde_mention> mentions;
+                extractor.extract(sources[s], *worker_db, mentions);
+                num_rows += replace_source(*worker_db, sources[s], mentions);
+            }
+        }
+        catch (const std::exception& e)
+        {
+            // Stop the other workers, and keep the first error for the caller.
+
+            next_source = sources.size();
+
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (error_msg.empty())
+                error_msg = e.what();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int t=1; t<num_threads; t++)
+        threads.push_back(std::thread(worker, nullptr));
+    worker(&db);
+    for (std::thread& th : threads)
+        th.join();
+
+    if (!error_msg.empty())
+        throw std::runtime_error(error_msg);
+
+    // Remove the rows of sources that are no longer usable.
+
+    db.execute("DELETE FROM " + my_table +
+               (source_list.empty() ? std::string() : " WHERE source NOT IN (" + source_list + ")"));
+
+    return num_rows;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Reload the rows of one GenDat source
+///
+/// Any rows from this source are deleted, and then the source is loaded again, in one
+/// transaction.
+///
+/// \param[in]  db           database connection, which must currently be open
+/// \param[in]  source_num   source number
+///
+/// \return     number of rows loaded
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+/// \exception std::out_of_range  thrown if the source number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int gde_mention_table::build_source(database& db, int source_num) const
+{
+    std::vector<gde_mention> mentions;
+    extractor.extract(source_num, db, mentions);
+    return replace_source(db, source_num, mentions);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Find the mentions of a person in all sources
+///
+/// The surname is normalized before it is compared, so "MacDonald" also finds "Macdonald". If
+/// a given name is supplied, only the mentions whose given names start with it are returned.
+///
+/// \param[in]  db        database connection, which must currently be open
+/// \param[in]  surname   surname to look for
+/// \param[in]  given     start of the given name(s), or an empty string to match any
+/// \param[out] row_set   matching rows of the person mention table
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_mention_table::find(database& db, const std::string& surname, const std::string& given,
+                             db_row_set& row_set) const
+{
+    find(db, surname, given, std::vector<std::string>(), row_set);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Find the mentions of a person in some communities
+///
+/// This version only returns the mentions of events in the given communities, such as the
+/// communities near a place that were found by `gde_search_map::add_place_near()`.
+///
+/// \param[in]  db            database connection, which must currently be open
+/// \param[in]  surname       surname to look for
+/// \param[in]  given         start of the given name(s), or an empty string to match any
+/// \param[in]  communities   community names, or an empty list to match any community
+/// \param[out] row_set       matching rows of the person mention table
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_mention_table::find(database& db, const std::string& surname, const std::string& given,
+                             const std::vector<std::string>& communities, db_row_set& row_set) const
+{
+    std::string query = "SELECT * FROM " + my_table + " WHERE surname_norm = '" +
+                        db.escape_str(gde_string_match::normalize_name(surname)) + "'";
+
+    if (!given.empty())
+    {
+        // Escape the LIKE wildcards as well as the usual special characters. The escape character
+        // is named, since SQLite has no default one.
+
+        std::string pattern;
+        for (char c : given)
+        {
+            if (c == '%' || c == '_' || c == '\\')
+                pattern += '\\';
+            pattern += c;
+        }
+        query += " AND given LIKE '" + db.escape_str(pattern) + "%' ESCAPE '" + db.escape_str("\\") + "'";
+    }
+
+    if (!communities.empty())
+    {
+        query += " AND community IN (";
+        for (size_t i=0; i<communities.size(); i++)
+            query += (i == 0 ? "'" : ", '") + db.escape_str(communities[i]) + "'";
+        query += ")";
+    }
+
+    query += " ORDER BY birth_year, source, rec_key";
+    db.execute(query, row_set);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the name used to track the state of this derived table
+///
+/// \return     table name
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_mention_table::derived_name() const
+{
+    return my_table;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Determine if the person mention table is built from a database table
+///
+/// \param[in]  db_table   database table name
+///
+/// \return     `true` if a usable GenDat source is stored in the table
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool gde_mention_table::depends_on(const std::string& db_table) const
+{
+    for (int i=0; i<my_source_map.num_sources(); i++)
+        if (my_source_map.src_db_table(i) == db_table && extractor.source_ok(i))
+            return true;
+    return false;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Reload the mentions from some source records
+///
+/// The existing rows for these records are deleted, and the records are then read again. Keys
+/// of records that no longer exist simply have their rows deleted.
+///
+/// A key of several columns (see `gde_change_tracker::split_key()`) is matched by the value of
+/// its column that holds the record key of the source. If it has no such column, then the
+/// record is found by all of its columns; the rows of such a record are only replaced if the
+/// record still exists.
+///
+/// \param[in]  db         database connection, which must currently be open
+/// \param[in]  db_table   database table that holds the source records
+/// \param[in]  keys       primary keys of the records
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_mention_table::refresh_keys(database& db, const std::string& db_table,
+                                     const std::vector<std::string>& keys)
+{
+    if (keys.empty())
+        return;
+
+    for (int i=0; i<my_source_map.num_sources(); i++)
+    {
+        if (my_source_map.src_db_table(i) != db_table || !extractor.source_ok(i))
+            continue;
+
+        // Find the record keys, and the conditions for the compound keys that do not include the
+        // record key column.
+
+        std::string              key_field = extractor.key_field(i);
+        std::vector<std::string> rec_keys;
+        std::string              conditions;
+
+        for (const std::string& key : keys)
+        {
+            std::vector<std::pair<std::string, std::string>> cols;
+            if (!gde_change_tracker::split_key(key, cols))
+            {
+                rec_keys.push_back(key);
+                continue;
+            }
+
+            std::string condition;
+            bool        found = false;
+            for (const auto& col : cols)
+            {
+                if (upper_case(col.first) == upper_case(key_field))
+                {
+                    rec_keys.push_back(col.second);
+                    found = true;
+                    break;
+                }
+                condition += (condition.empty() ? "(" : " AND ") + col.first + " = '" + db.escape_str(col.second) + "'";
+            }
+            if (!found && !condition.empty())
+                conditions += (conditions.empty() ? "" : " OR ") + condition + ")";
+        }
+
+        std::string key_list;
+        for (size_t k=0; k<rec_keys.size(); k++)
+            key_list += (k == 0 ? "'" : ", '") + db.escape_str(rec_keys[k]) + "'";
+
+        std::string where;
+        if (!key_list.empty())
+            where = key_field + " IN (" + key_list + ")";
+        if (!conditions.empty())
+            where += (where.empty() ? "" : " OR ") + conditions;
+
+        std::vector<gde_mention> mentions;
+        extractor.extract(i, db, mentions, where);
+
+        // The records found by their other key columns are deleted by their record keys.
+
+        if (!conditions.empty())
+        {
+            for (const gde_mention& m : mentions)
+                key_list += (key_list.empty() ? "'" : ", '") + db.escape_str(m.key) + "'";
+        }
+        if (key_list.empty())
+            continue;
+
+        // Replace the rows in one transaction, so that a failure leaves the old rows in place.
+
+        db.execute("START TRANSACTION");
+        try
+        {
+            db.execute("DELETE FROM " + my_table + " WHERE source = '" + db.escape_str(db_table) +
+                       "' AND rec_key IN (" + key_list + ")");
+            insert_mentions(db, mentions);
+            db.execute("COMMIT");
+        }
+        catch (const std::exception&)
+        {
+            try { db.execute("ROLLBACK"); } catch (const std::exception&) {}
+            throw;
+        }
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Replace all of the rows of one source with the given mentions, in one transaction, so that a
+// failure leaves the old rows in place.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int gde_mention_table::replace_source(database& db, int source_num,
+                                               const std::vector<gde_mention>& mentions) const
+{
+    db.execute("START TRANSACTION");
+    try
+    {
+        db.execute("DELETE FROM " + my_table + " WHERE source = '" +
+                   db.escape_str(my_source_map.src_db_table(source_num)) + "'");
+        unsigned int num_rows = insert_mentions(db, mentions);
+        db.execute("COMMIT");
+        return num_rows;
+    }
+    catch (const std::exception&)
+    {
+        try { db.execute("ROLLBACK"); } catch (const std::exception&) {}
+        throw;
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Insert person mentions into the table, using multi-row INSERT statements.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int gde_mention_table::insert_mentions(database& db, const std::vector<gde_mention>& mentions) const
+{
+    unsigned int num_rows = 0;
+    std::string  query;
+
+    for (size_t i=0; i<mentions.size(); i++)
+    {
+        if (i % INSERT_BATCH_SIZE == 0)
+            query = "INSERT INTO " + my_table +
+                    " (source, rec_key, relation, event, surname, given, sex, surname_norm, surname_sdx,"
+                    " year, birth_year, community, county) VALUES ";
+        else
+            query += ", ";
+
+        const gde_mention& m    = mentions[i];
+        std::string        norm = gde_string_match::normalize_name(m.surname);
+
+        query += "('" + db.escape_str(my_source_map.src_db_table(m.source)) + "', '" +
+                 db.escape_str(m.key) + "', '" +
+                 fam_rel_code(m.relation) + "', '" +
+                 data_tag_text(m.event) + "', '" +
+                 db.escape_str(m.surname) + "', '" +
+                 db.escape_str(m.given) + "', '" +
+                 db.escape_str(m.sex) + "', '" +
+                 db.escape_str(norm) + "', '" +
+                 gde_string_match::soundex(norm) + "', " +
+                 (m.year > 0 ? std::to_string(m.year) : "NULL") + ", " +
+                 (m.birth_year > 0 ? std::to_string(m.birth_year) : "NULL") + ", '" +
+                 db.escape_str(m.community) + "', '" +
+                 db.escape_str(m.county) + "')";
+
+        if ((i + 1) % INSERT_BATCH_SIZE == 0 || i + 1 == mentions.size())
+            num_rows += db.execute(query);
+    }
+
+    return num_rows;
+}
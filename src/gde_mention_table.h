@@ -0,0 +1,52 @@
+///
+/// \file
+///
+
+#ifndef GDE_MENTION_TABLE_H
+#define GDE_MENTION_TABLE_H
+
+#include <string>
+#include <vector>
+
+#include "database.h"
+#include "db_row_set.h"
+#include "gde_change_tracker.h"
+#include "gde_mention.h"
+#include "gde_source_map.h"
+
+
+class gde_mention_table : public gde_derived_table
+{
+public:
+    gde_mention_table (const gde_source_map& source_map, std::string table = "person_mention");
+
+    std::string  table_name      () const;
+    void         set_num_threads (unsigned int num_threads);
+
+    void         create_table    (database& db) const;
+    unsigned int build           (database& db) const;
+    unsigned int build_source    (database& db, int source_num) const;
+    void         find            (database& db, const std::string& surname, const std::string& given,
+                                  db_row_set& row_set) const;
+    void         find            (database& db, const std::string& surname, const std::string& given,
+                                  const std::vector<std::string>& communities, db_row_set& row_set) const;
+
+    // Implementation of gde_derived_table
+
+    std::string  derived_name    () const;
+    bool         depends_on      (const std::string& db_table) const;
+    void         refresh_keys    (database& db, const std::string& db_table,
+                                  const std::vector<std::string>& keys);
+
+private:
+    const gde_source_map&  my_source_map;
+    gde_mention_extractor  extractor;
+    std::string            my_table;
+    unsigned int           my_num_threads = 0;
+
+    unsigned int replace_source  (database& db, int source_num,
+                                  const std::vector<gde_mention>& mentions) const;
+    unsigned int insert_mentions (database& db, const std::vector<gde_mention>& mentions) const;
+};
+
+#endif
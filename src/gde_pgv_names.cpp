@@ -0,0 +1,254 @@
+///
+/// \class gde_pgv_names gde_pgv_names.h
+///
+/// \brief Looks up the names of PhpGedView individuals in batches
+///
+/// The PHP function `pgv_get_name()` issues one query on the `pgv_name` table for each
+/// individual, so a list page that links thousands of records to PhpGedView issues thousands
+/// of queries. This class instead collects the IDs that are needed, and fetches all of the
+/// names that are not already known with a few `IN (...)` queries. The names are kept in a
+/// cache, so each individual is only looked up once.
+///
+/// As in `pgv_get_name()`, the strings "@N.N." and "@P.N.", which PhpGedView uses for unknown
+/// names, are replaced with "(unknown)". IDs that are not in the database are also cached, so
+/// that they are not looked up again.
+///
+
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "gde_pgv_names.h"
+#include "db_row_set.h"
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Constructor
+///
+/// \param[in]  prefix   prefix of the PhpGedView table names (normally the database name and
+///                      a period)
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gde_pgv_names::gde_pgv_names(std::string prefix) :
+    my_prefix(prefix)
+{
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Set the maximum number of IDs in each query
+///
+/// The default is 500.
+///
+/// \param[in]  batch_size   number of IDs
+///
+/// \exception std::logic_error thrown if the batch size is zero
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_pgv_names::set_batch_size(unsigned int batch_size)
+{
+    if (batch_size == 0)
+        throw std::logic_error("Zero batch size in gde_pgv_names::set_batch_size");
+    my_batch_size = batch_size;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Look up a list of individuals
+///
+/// The names of any IDs that are not already in the cache are fetched from the database and
+/// added to the cache. Empty and repeated IDs are ignored.
+///
+/// \param[in]  db      database connection, which must currently be open
+/// \param[in]  n_ids   PhpGedView individual IDs
+///
+/// \return     number of queries sent to the database
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int gde_pgv_names::resolve(database& db, const std::vector<std::string>& n_ids)
+{
+    // Make a list of the IDs that are still needed. Mark each one as not found for now, which
+    // also removes duplicates from the list.
+
+    std::vector<std::string> needed;
+    for (const std::string& id : n_ids)
+    {
+        if (id.empty() || cache.count(id) > 0)
+            continue;
+
+        cache[id] = cache_entry { false, "" };
+        needed.push_back(id);
+    }
+
+    unsigned int num_queries = 0;
+    db_row_set   row_set;
+    std::string  id;
+    std::string  n_list;
+
+    for (size_t first=0; first<needed.size(); first+=my_batch_size)
+    {
+        size_t last = std::min(needed.size(), first + my_batch_size);
+
+        std::string query = "SELECT n_id, n_list FROM " + my_prefix + "pgv_name WHERE n_id IN (";
+        for (size_t i=first; i<last; i++)
+        {
+            if (i > first)
+                query += ", ";
+            query += "'" + db.escape_str(needed[i]) + "'";
+        }
+        query += ")";
+
+        try
+        {
+            db.execute(query, row_set);
+        }
+        catch (const std::runtime_error&)
+        {
+            // Forget the IDs that have not been looked up yet, so that they are tried again.
+
+            for (size_t i=first; i<needed.size(); i++)
+                cache.erase(needed[i]);
+            throw;
+        }
+        num_queries++;
+
+        // An individual may have more than one name. Keep the first, as pgv_get_name() does.
+
+        for (unsigned int row=0; row<row_set.num_rows(); row++)
+        {
+            row_set.get_data(row, 0, id);
+            row_set.get_data(row, 1, n_list);
+
+            auto it = cache.find(id);
+            if (it != cache.end() && !it->second.found)
+            {
+                it->second.found = true;
+                it->second.name  = clean_name(n_list);
+            }
+        }
+    }
+
+    return num_queries;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the name of an individual from the cache
+///
+/// \param[in]  n_id   PhpGedView individual ID
+/// \param[out] name   the name, or an empty string
+///
+/// \return     `true` if the individual was found. `false` if the individual is not in the
+///             database, or has not been looked up with `resolve()`.
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool gde_pgv_names::get_name(const std::string& n_id, std::string& name) const
+{
+    auto it = cache.find(n_id);
+    if (it == cache.end() || !it->second.found)
+    {
+        name.clear();
+        return false;
+    }
+
+    name = it->second.name;
+    return true;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the name of an individual, looking it up if required
+///
+/// Use `resolve()` first when many names are needed.
+///
+/// \param[in]  db     database connection, which must currently be open
+/// \param[in]  n_id   PhpGedView individual ID
+/// \param[out] name   the name, or an empty string
+///
+/// \return     `true` if the individual was found
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool gde_pgv_names::get_name(database& db, const std::string& n_id, std::string& name)
+{
+    resolve(db, std::vector<std::string>(1, n_id));
+    return get_name(n_id, name);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Empty the cache
+///
+/// Call this if names may have been changed in PhpGedView.
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_pgv_names::clear()
+{
+    cache.clear();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of IDs in the cache
+///
+/// \return     number of IDs, including those that were not found
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t gde_pgv_names::cache_size() const
+{
+    return cache.size();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Replace the PhpGedView markers for unknown names
+///
+/// \param[in]  n_list   name from the `n_list` field of `pgv_name`
+///
+/// \return     the name, with "@N.N." and "@P.N." replaced by "(unknown)"
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_pgv_names::clean_name(const std::string& n_list)
+{
+    static const std::string markers[] = { "@N.N.", "@P.N." };
+    static const std::string unknown   = "(unknown)";
+
+    std::string name = n_list;
+    for (const std::string& marker : markers)
+    {
+        size_t pos = 0;
+        while ((pos = name.find(marker, pos)) != std::string::npos)
+        {
+            name.replace(pos, marker.size(), unknown);
+            pos += unknown.size();
+        }
+    }
+    return name;
+}
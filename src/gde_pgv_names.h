@@ -0,0 +1,43 @@
+///
+/// \file
+///
+
+#ifndef GDE_PGV_NAMES_H
+#define GDE_PGV_NAMES_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "database.h"
+
+
+class gde_pgv_names
+{
+public:
+    gde_pgv_names (std::string prefix = "phpgedview.");
+
+    void         set_batch_size (unsigned int batch_size);
+
+    unsigned int resolve        (database& db, const std::vector<std::string>& n_ids);
+    bool         get_name       (const std::string& n_id, std::string& name) const;
+    bool         get_name       (database& db, const std::string& n_id, std::string& name);
+
+    void         clear          ();
+    size_t       cache_size     () const;
+
+    static std::string clean_name (const std::string& n_list);
+
+private:
+    struct cache_entry
+    {
+        bool         found;
+        std::string  name;
+    };
+
+    std::string                                   my_prefix;
+    unsigned int                                  my_batch_size = 500;
+    std::unordered_map<std::string, cache_entry>  cache;
+};
+
+#endif
@@ -0,0 +1,523 @@
+///
+/// \class gde_place_index gde_place_index.h
+///
+/// \brief Spatial index of place names
+///
+/// This class holds the coordinates of a set of named places, such as those in the Nova Scotia
+/// GeoNAMES table, and answers bounding-box and proximity queries without going back to the
+/// database server.
+///
+/// The places are sorted into a uniform grid of square cells. A query only needs to look at the
+/// few cells that overlap the search area, and then checks the exact distance to each place in
+/// those cells. The community names that are returned can then be used as search values for
+/// the PLAC_COMMUNITY fields of the GenDat sources (see `gde_search_map`).
+///
+
+
+#include <cmath>
+#include <cctype>
+#include <cstdlib>
+#include <algorithm>
+#include <stdexcept>
+
+#include "gde_place_index.h"
+
+
+static const double PI              = 3.14159265358979323846;
+
+// Mean radius of the earth, in kilometres.
+
+static const double EARTH_RADIUS_KM = 6371.0;
+static const double KM_PER_DEGREE   = EARTH_RADIUS_KM * PI / 180.0;
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Load places from database
+///
+/// This member function reads the name, county and NAD83 coordinates of every place in a
+/// GeoNAMES table, and then builds the spatial index.
+///
+/// \param[in]  db          database connection, which must currently be open
+/// \param[in]  table       database table with the place names (usually `ns_geonames`)
+/// \param[in]  condition   optional SQL condition used to select the places (for example,
+///                         to keep only populated places)
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_place_index::load(database &db, std::string table, std::string condition)
+{
+    std::vector< std::vector< std::string >> result_set;
+    unsigned int num_rows;
+    unsigned int num_cols;
+
+    std::string query = "SELECT GEONAME, COUNTY, NAD83_LAT, NAD83_LON FROM " + table +
+                        " WHERE NAD83_LAT IS NOT NULL AND NAD83_LON IS NOT NULL";
+    if (!condition.empty())
+        query += " AND (" + condition + ")";
+
+    db.execute (query, result_set, num_rows, num_cols);
+
+    // Start over with an empty index.
+
+    place_list.clear();
+    name_map.clear();
+    place_list.reserve(num_rows);
+
+    // Save every place that has usable coordinates. A place whose latitude or longitude is empty
+    // or not a number is skipped, rather than being put at zero.
+
+    for (unsigned int i=0; i<num_rows; i++)
+    {
+        const char *str_lat = result_set[i][2].c_str();
+        const char *str_lon = result_set[i][3].c_str();
+        char *end_lat;
+        char *end_lon;
+        double lat = std::strtod(str_lat, &end_lat);
+        double lon = std::strtod(str_lon, &end_lon);
+
+        if (end_lat != str_lat && *end_lat == '\0' && end_lon != str_lon && *end_lon == '\0')
+            add_place (result_set[i][0], result_set[i][1], lat, lon);
+    }
+
+    build();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Add one place
+///
+/// Places may be added one at a time, instead of being loaded from the database.
+/// Member function `build` must be called after the last place has been added.
+///
+/// \param[in]  name     place name
+/// \param[in]  county   county name
+/// \param[in]  lat      latitude, in decimal degrees
+/// \param[in]  lon      longitude, in decimal degrees
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_place_index::add_place(std::string name, std::string county, double lat, double lon)
+{
+    name_map.insert(std::make_pair(upper_case(name), (int) place_list.size()));
+    place_list.push_back({name, county, lat, lon});
+    grid_ok = false;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Build the spatial index
+///
+/// This member function sorts all of the places into a uniform grid. Each cell covers
+/// approximately `cell_size_km` by `cell_size_km` kilometres. A cell size close to the usual
+/// search radius works well.
+///
+/// \param[in]  cell_size_km   width and height of one grid cell, in kilometres
+///
+/// \exception std::logic_error thrown if the cell size is not positive
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_place_index::build(double cell_size_km)
+{
+    if (!(cell_size_km > 0.0))
+        throw std::logic_error("Cell size in gde_place_index::build must be positive");
+
+    cell_start.clear();
+    cell_places.clear();
+    grid_rows = 0;
+    grid_cols = 0;
+    grid_ok   = true;
+
+    if (place_list.empty())
+        return;
+
+    // Find the bounding box of all the places.
+
+    double lat_min = place_list[0].lat, lat_max = place_list[0].lat;
+    double lon_min = place_list[0].lon, lon_max = place_list[0].lon;
+    for (const place_def& p : place_list)
+    {
+        lat_min = std::min(lat_min, p.lat);
+        lat_max = std::max(lat_max, p.lat);
+        lon_min = std::min(lon_min, p.lon);
+        lon_max = std::max(lon_max, p.lon);
+    }
+
+    // A degree of longitude shrinks towards the poles, so size the cells for the middle
+    // of the bounding box.
+
+    double cos_lat = std::max(0.01, std::cos((lat_min + lat_max) / 2.0 * PI / 180.0));
+
+    grid_lat  = lat_min;
+    grid_lon  = lon_min;
+    cell_lat  = cell_size_km / KM_PER_DEGREE;
+    cell_lon  = cell_size_km / (KM_PER_DEGREE * cos_lat);
+    grid_rows = (int) ((lat_max - lat_min) / cell_lat) + 1;
+    grid_cols = (int) ((lon_max - lon_min) / cell_lon) + 1;
+
+    // Count the places in each cell, and then turn the counts into starting offsets.
+
+    std::vector<unsigned int> place_cell(place_list.size());
+    cell_start.assign((size_t) grid_rows * grid_cols + 1, 0);
+
+    for (unsigned int i=0; i<place_list.size(); i++)
+    {
+        int row = std::min(grid_rows - 1, (int) ((place_list[i].lat - grid_lat) / cell_lat));
+        int col = std::min(grid_cols - 1, (int) ((place_list[i].lon - grid_lon) / cell_lon));
+        place_cell[i] = row * grid_cols + col;
+        cell_start[place_cell[i] + 1]++;
+    }
+
+    for (size_t k=1; k<cell_start.size(); k++)
+        cell_start[k] += cell_start[k-1];
+
+    // Fill in the packed list of places for each cell.
+
+    std::vector<unsigned int> next(cell_start.begin(), cell_start.end() - 1);
+    cell_places.resize(place_list.size());
+    for (unsigned int i=0; i<place_list.size(); i++)
+        cell_places[next[place_cell[i]]++] = i;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of places
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int gde_place_index::num_places() const
+{
+    return place_list.size();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the name of a place
+///
+/// \param[in]  place_num   place number
+///
+/// \return     place name
+///
+/// \exception std::out_of_range thrown if the place number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_place_index::place_name(int place_num) const
+{
+    test_input(place_num);
+    return place_list[place_num].name;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the county of a place
+///
+/// \param[in]  place_num   place number
+///
+/// \return     county name
+///
+/// \exception std::out_of_range thrown if the place number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_place_index::place_county(int place_num) const
+{
+    test_input(place_num);
+    return place_list[place_num].county;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the latitude of a place
+///
+/// \param[in]  place_num   place number
+///
+/// \return     latitude, in decimal degrees
+///
+/// \exception std::out_of_range thrown if the place number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double gde_place_index::place_lat(int place_num) const
+{
+    test_input(place_num);
+    return place_list[place_num].lat;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the longitude of a place
+///
+/// \param[in]  place_num   place number
+///
+/// \return     longitude, in decimal degrees
+///
+/// \exception std::out_of_range thrown if the place number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double gde_place_index::place_lon(int place_num) const
+{
+    test_input(place_num);
+    return place_list[place_num].lon;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Find a place by name
+///
+/// The name comparison ignores case. If more than one place has the same name, then the first
+/// one that was loaded is returned.
+///
+/// \param[in]  name     place name
+/// \param[in]  county   county name (optional), used to choose between places with the same name
+///
+/// \return     place number, or -1 if the place was not found
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int gde_place_index::find_place(std::string name, std::string county) const
+{
+    int found = -1;
+    std::string county_uc = upper_case(county);
+
+    auto range = name_map.equal_range(upper_case(name));
+    for (auto i = range.first; i != range.second; i++)
+    {
+        if (county.empty() || upper_case(place_list[i->second].county) == county_uc)
+        {
+            if (found < 0 || i->second < found)
+                found = i->second;
+        }
+    }
+    return found;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Find all places inside a bounding box
+///
+/// \param[in]  lat_min   southern edge, in decimal degrees
+/// \param[in]  lon_min   western edge, in decimal degrees
+/// \param[in]  lat_max   northern edge, in decimal degrees
+/// \param[in]  lon_max   eastern edge, in decimal degrees
+///
+/// \return     place numbers, in ascending order
+///
+/// \exception std::logic_error thrown if the index has not been built
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<int> gde_place_index::find_in_box(double lat_min, double lon_min,
+                                              double lat_max, double lon_max) const
+{
+    std::vector<int> found;
+    int row_1, col_1, row_2, col_2;
+
+    cell_range(lat_min, lon_min, lat_max, lon_max, row_1, col_1, row_2, col_2);
+
+    for (int row=row_1; row<=row_2; row++)
+        for (int col=col_1; col<=col_2; col++)
+        {
+            int k = row * grid_cols + col;
+            for (unsigned int j=cell_start[k]; j<cell_start[k+1]; j++)
+            {
+                const place_def& p = place_list[cell_places[j]];
+                if (p.lat >= lat_min && p.lat <= lat_max && p.lon >= lon_min && p.lon <= lon_max)
+                    found.push_back(cell_places[j]);
+            }
+        }
+
+    std::sort(found.begin(), found.end());
+    return found;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Find all places within a given distance
+///
+/// \param[in]  lat         latitude of the centre, in decimal degrees
+/// \param[in]  lon         longitude of the centre, in decimal degrees
+/// \param[in]  radius_km   search radius, in kilometres
+///
+/// \return     place numbers, in ascending order
+///
+/// \exception std::logic_error thrown if the index has not been built
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<int> gde_place_index::find_in_radius(double lat, double lon, double radius_km) const
+{
+    std::vector<int> found;
+    int row_1, col_1, row_2, col_2;
+
+    // Find the bounding box of the search circle.
+
+    double d_lat   = radius_km / KM_PER_DEGREE;
+    double cos_lat = std::max(0.01, std::cos(lat * PI / 180.0));
+    double d_lon   = radius_km / (KM_PER_DEGREE * cos_lat);
+
+    cell_range(lat - d_lat, lon - d_lon, lat + d_lat, lon + d_lon, row_1, col_1, row_2, col_2);
+
+    // Check the exact distance to every place in the overlapping cells.
+
+    for (int row=row_1; row<=row_2; row++)
+        for (int col=col_1; col<=col_2; col++)
+        {
+            int k = row * grid_cols + col;
+            for (unsigned int j=cell_start[k]; j<cell_start[k+1]; j++)
+            {
+                const place_def& p = place_list[cell_places[j]];
+                if (distance_km(lat, lon, p.lat, p.lon) <= radius_km)
+                    found.push_back(cell_places[j]);
+            }
+        }
+
+    std::sort(found.begin(), found.end());
+    return found;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Find the names of all communities near a named place
+///
+/// This member function is meant to turn a request such as "all baptisms within 15 km of
+/// Antigonish" into a list of community names that can be used in a database search.
+///
+/// \param[in]  name        name of the central place
+/// \param[in]  radius_km   search radius, in kilometres
+/// \param[in]  county      county of the central place (optional)
+///
+/// \return     sorted list of unique place names, which is empty if the central place was not found
+///
+/// \exception std::logic_error thrown if the index has not been built
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::string> gde_place_index::communities_near(std::string name, double radius_km,
+                                                           std::string county) const
+{
+    std::vector<std::string> names;
+
+    int centre = find_place(name, county);
+    if (centre < 0)
+        return names;
+
+    std::vector<int> found = find_in_radius(place_list[centre].lat, place_list[centre].lon, radius_km);
+    for (int i : found)
+        names.push_back(place_list[i].name);
+
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    return names;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Great circle distance between two points
+///
+/// \param[in]  lat_1   latitude of the first point, in decimal degrees
+/// \param[in]  lon_1   longitude of the first point, in decimal degrees
+/// \param[in]  lat_2   latitude of the second point, in decimal degrees
+/// \param[in]  lon_2   longitude of the second point, in decimal degrees
+///
+/// \return     distance, in kilometres
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double gde_place_index::distance_km(double lat_1, double lon_1, double lat_2, double lon_2)
+{
+    const double to_rad = PI / 180.0;
+
+    double s_lat = std::sin((lat_2 - lat_1) * to_rad / 2.0);
+    double s_lon = std::sin((lon_2 - lon_1) * to_rad / 2.0);
+    double a     = s_lat * s_lat + std::cos(lat_1 * to_rad) * std::cos(lat_2 * to_rad) * s_lon * s_lon;
+
+    return 2.0 * EARTH_RADIUS_KM * std::asin(std::min(1.0, std::sqrt(a)));
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Find the range of grid cells that overlap a bounding box. The range is empty
+// (row_1 > row_2) if the box lies entirely outside the grid.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_place_index::cell_range(double lat_min, double lon_min, double lat_max, double lon_max,
+                                 int& row_1, int& col_1, int& row_2, int& col_2) const
+{
+    if (!grid_ok)
+        throw std::logic_error("gde_place_index::build must be called before searching");
+
+    row_1 = 0;
+    col_1 = 0;
+    row_2 = -1;
+    col_2 = -1;
+
+    if (grid_rows == 0 || lat_max < lat_min || lon_max < lon_min)
+        return;
+
+    row_1 = std::max(0,             (int) std::floor((lat_min - grid_lat) / cell_lat));
+    row_2 = std::min(grid_rows - 1, (int) std::floor((lat_max - grid_lat) / cell_lat));
+    col_1 = std::max(0,             (int) std::floor((lon_min - grid_lon) / cell_lon));
+    col_2 = std::min(grid_cols - 1, (int) std::floor((lon_max - grid_lon) / cell_lon));
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Make sure the place number is valid.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_place_index::test_input(int place_num) const
+{
+    if (place_num < 0 || place_num >= num_places())
+        throw std::out_of_range("Place number in gde_place_index:: is out of range");
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Convert a string to upper case.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_place_index::upper_case(std::string str)
+{
+    for (char& c : str)
+        c = std::toupper((unsigned char) c);
+    return str;
+}
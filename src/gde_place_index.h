@@ -0,0 +1,72 @@
+///
+/// \file
+///
+
+#ifndef GDE_PLACE_INDEX_H
+#define GDE_PLACE_INDEX_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "database.h"
+
+
+class gde_place_index
+{
+public:
+    void                     load             (database &db, std::string table, std::string condition = "");
+    void                     add_place        (std::string name, std::string county, double lat, double lon);
+    void                     build            (double cell_size_km = 5.0);
+
+    int                      num_places       () const;
+    std::string              place_name       (int place_num) const;
+    std::string              place_county     (int place_num) const;
+    double                   place_lat        (int place_num) const;
+    double                   place_lon        (int place_num) const;
+
+    int                      find_place       (std::string name, std::string county = "") const;
+    std::vector<int>         find_in_box      (double lat_min, double lon_min,
+                                               double lat_max, double lon_max) const;
+    std::vector<int>         find_in_radius   (double lat, double lon, double radius_km) const;
+    std::vector<std::string> communities_near (std::string name, double radius_km,
+                                               std::string county = "") const;
+
+    static double            distance_km      (double lat_1, double lon_1, double lat_2, double lon_2);
+
+private:
+
+    struct place_def
+    {
+        std::string name;
+        std::string county;
+        double      lat;
+        double      lon;
+    };
+
+    std::vector<place_def> place_list;
+
+    // Look up places by upper case name.
+
+    std::unordered_multimap<std::string, int> name_map;
+
+    // Uniform grid of cells covering the bounding box of all places. The places in cell `k`
+    // are `cell_places[cell_start[k]]` to `cell_places[cell_start[k+1]-1]`.
+
+    bool                       grid_ok   = false;
+    double                     grid_lat  = 0.0;
+    double                     grid_lon  = 0.0;
+    double                     cell_lat  = 1.0;
+    double                     cell_lon  = 1.0;
+    int                        grid_rows = 0;
+    int                        grid_cols = 0;
+    std::vector<unsigned int>  cell_start;
+    std::vector<unsigned int>  cell_places;
+
+    void test_input (int place_num) const;
+    void cell_range (double lat_min, double lon_min, double lat_max, double lon_max,
+                     int& row_1, int& col_1, int& row_2, int& col_2) const;
+    static std::string upper_case (std::string str);
+};
+
+#endif
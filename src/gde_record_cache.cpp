@@ -0,0 +1,782 @@
+///
+/// \class gde_record_cache gde_record_cache.h
+///
+/// \brief Steps through the records of one table, with a cache of the nearby records
+///
+/// The PHP edit pages (`edit_ns_births_data.php` and the others) move from one record to the
+/// next with a `get_next_valid_key()` query, and then fetch the record itself, so every click
+/// costs two round trips to the database server. This class instead loads the sorted list of
+/// keys once, so that the next and previous keys are known without asking the server, and keeps
+/// the records near the current position in a small cache.
+///
+/// Each time a record is requested, the records that follow it (or precede it, if the user is
+/// moving backwards) are fetched ahead of time with a single range query. This is done either
+/// by a background thread with its own database connection (see start_prefetch()), or by
+/// calling prefetch() when the program is otherwise idle. Records far from the current position
+/// are dropped from the cache when it is full.
+///
+/// The key field must be unique, and the database must sort it in the same order each time.
+/// Records that are added to the table after the keys are loaded are not seen until
+/// load_keys() is called again. After a record has been changed, call invalidate() so that the
+/// old copy is not shown again.
+///
+
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+#include "gde_record_cache.h"
+#include "gde_trace.h"
+#include "db_row_set.h"
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Constructor
+///
+/// \param[in]  table       database table
+/// \param[in]  key_field   unique key field of the table
+/// \param[in]  fields      fields to fetch for each record, separated by commas. The key field
+///                         must be one of them.
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gde_record_cache::gde_record_cache(std::string table, std::string key_field, std::string fields) :
+    my_table(table),
+    my_key_field(key_field),
+    my_fields(fields)
+{
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Destructor
+///
+/// Stops the prefetch thread, if it is running.
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gde_record_cache::~gde_record_cache()
+{
+    stop_prefetch();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Set the maximum number of records in the cache
+///
+/// The default is 64. The cache should hold at least twice the number of records that are
+/// prefetched, so that moving back and forth does not drop records that are still wanted.
+///
+/// \param[in]  num_records   number of records
+///
+/// \exception std::logic_error thrown if the number of records is zero
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_record_cache::set_cache_size(size_t num_records)
+{
+    if (num_records == 0)
+        throw std::logic_error("Zero cache size in gde_record_cache::set_cache_size");
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    my_cache_size = num_records;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Set the number of records fetched ahead of the current position
+///
+/// The default is 16. Zero turns prefetching off.
+///
+/// \param[in]  num_records   number of records
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_record_cache::set_prefetch(size_t num_records)
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    my_prefetch = num_records;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Load the sorted list of keys
+///
+/// Any records in the cache are dropped, and the current position is set to the first key.
+///
+/// \param[in]  db          database connection, which must currently be open
+/// \param[in]  condition   SQL condition that selects the records to step through, or an empty
+///                         string for all of the records in the table
+///
+/// \return     number of keys
+///
+/// \exception std::runtime_error thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t gde_record_cache::load_keys(database& db, std::string condition)
+{
+    std::string query = "SELECT " + my_key_field + " FROM " + my_table;
+    if (!condition.empty())
+        query += " WHERE (" + condition + ")";
+    query += " ORDER BY " + my_key_field;
+
+    // Read the keys as a stream, since a table may hold hundreds of thousands of records.
+
+    std::vector<std::string>                keys;
+    std::unordered_map<std::string, size_t> index;
+    db_row_stream                           stream;
+    std::string                             key_value;
+
+    db.execute(query, stream);
+    while (stream.next_row())
+    {
+        if (stream.get_data(0, key_value) && index.emplace(key_value, keys.size()).second)
+            keys.push_back(key_value);
+    }
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+
+    key_list.swap(keys);
+    key_index.swap(index);
+    my_condition = condition;
+    cache.clear();
+    current_pos = 0;
+    direction   = 1;
+    generation++;
+
+    return key_list.size();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of keys
+///
+/// \return     number of keys loaded by load_keys()
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t gde_record_cache::num_keys() const
+{
+    return key_list.size();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the key at a position
+///
+/// \param[in]  pos   position in the sorted key list
+///
+/// \return     key
+///
+/// \exception std::out_of_range thrown if the position is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_record_cache::key(size_t pos) const
+{
+    test_input(pos, "key");
+    return key_list[pos];
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Find the position of a key
+///
+/// \param[in]  key   key to look for
+/// \param[out] pos   position of the key in the sorted key list
+///
+/// \return     true if the key was found
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool gde_record_cache::find_key(const std::string& key, size_t& pos) const
+{
+    auto it = key_index.find(key);
+    if (it == key_index.end())
+        return false;
+
+    pos = it->second;
+    return true;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get a record
+///
+/// The record is taken from the cache if it is there, and otherwise fetched from the database.
+/// The position becomes the current position, and if the prefetch thread is running it is asked
+/// to fetch the records beyond it, in the direction in which the user is moving.
+///
+/// \param[in]  db       database connection, which must currently be open. It is only used if
+///                      the record is not in the cache.
+/// \param[in]  pos      position in the sorted key list
+/// \param[out] record   the record
+///
+/// \exception std::out_of_range    thrown if the position is out of range
+/// \exception std::runtime_error   thrown if the record is no longer in the table, or if the
+///                                 database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_record_cache::get_record(database& db, size_t pos, gde_record& record)
+{
+    test_input(pos, "get_record");
+
+    std::unique_lock<std::mutex> lock(cache_mutex);
+
+    if (pos != current_pos)
+        direction = (pos > current_pos) ? 1 : -1;
+    current_pos = pos;
+
+    auto it = cache.find(pos);
+    if (it != cache.end())
+    {
+        record = it->second;
+        my_num_hits++;
+    }
+    else
+    {
+        my_num_misses++;
+        lock.unlock();
+
+        std::vector<gde_record>  records;
+        std::vector<std::string> names;
+        fetch_range(db, key_list[pos], key_list[pos], records, names);
+        if (records.empty())
+            throw std::runtime_error("Record " + key_list[pos] + " is no longer in " + my_table);
+        record = records[0];
+
+        lock.lock();
+        store(records, names);
+    }
+
+    if (worker_running)
+    {
+        work_requested = true;
+        work_ready.notify_one();
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Check whether a record is in the cache
+///
+/// \param[in]  pos   position in the sorted key list
+///
+/// \return     true if the record is in the cache
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool gde_record_cache::is_cached(size_t pos) const
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return cache.count(pos) != 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Fetch the records beyond the current position
+///
+/// This does on the calling thread what the prefetch thread would do, for use when the
+/// prefetch thread is not running. It is meant to be called when the program is idle.
+///
+/// \param[in]  db   database connection, which must currently be open
+///
+/// \exception std::runtime_error   thrown if the database server reports an error
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_record_cache::prefetch(database& db)
+{
+    std::unique_lock<std::mutex> lock(cache_mutex);
+
+    size_t first;
+    size_t last;
+    if (!prefetch_window(first, last))
+        return;
+
+    lock.unlock();
+
+    std::vector<gde_record>  records;
+    std::vector<std::string> names;
+    fetch_range(db, key_list[first], key_list[last], records, names);
+
+    lock.lock();
+    store(records, names);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Drop a record from the cache
+///
+/// Call this after the record has been changed in the database. Records that the prefetch
+/// thread is fetching at the time are discarded as well, since they may hold the old data.
+///
+/// \param[in]  key   key of the record
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_record_cache::invalidate(const std::string& key)
+{
+    size_t pos;
+    if (!find_key(key, pos))
+        return;
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    cache.erase(pos);
+    generation++;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Drop all of the records from the cache
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_record_cache::clear_cache()
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    cache.clear();
+    generation++;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Start fetching records in the background
+///
+/// A thread is started with its own connection to the same database, since a connection cannot
+/// be used by two threads at once. If the thread is already running, nothing is done. If the
+/// thread later fails, it stops, and prefetch_error() gives the reason.
+///
+/// \param[in]  db   database connection, which must currently be open
+///
+/// \exception std::runtime_error   thrown if the new connection cannot be opened
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_record_cache::start_prefetch(const database& db)
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+
+    if (worker_running)
+        return;
+
+    // A thread that stopped because of an error has not been joined yet.
+
+    if (worker.joinable())
+        worker.join();
+
+    worker_db.disconnect();
+    worker_db.connect(db);
+
+    worker_error.clear();
+    stop_worker    = false;
+    work_requested = true;
+    worker_running = true;
+    worker         = std::thread(&gde_record_cache::prefetch_worker, this);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Stop fetching records in the background
+///
+/// Waits for the prefetch thread to finish any query that it has sent, and closes its
+/// connection.
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_record_cache::stop_prefetch()
+{
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        stop_worker = true;
+        work_ready.notify_one();
+    }
+
+    if (worker.joinable())
+        worker.join();
+
+    worker_db.disconnect();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Check whether the prefetch thread is running
+///
+/// \return     true if the thread is running
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool gde_record_cache::prefetch_running() const
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return worker_running;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the reason why the prefetch thread stopped
+///
+/// \return     error message, or an empty string if the thread has not failed
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_record_cache::prefetch_error() const
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return worker_error;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of columns in each record
+///
+/// \return     number of columns, or zero if no record has been fetched yet
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int gde_record_cache::num_cols() const
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return col_names.size();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the name of a column
+///
+/// \param[in]  col   column number
+///
+/// \return     column name
+///
+/// \exception std::out_of_range thrown if the column number is out of range
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_record_cache::col_name(unsigned int col) const
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+
+    if (col >= col_names.size())
+        throw std::out_of_range("Column number in gde_record_cache::col_name is out of range");
+    return col_names[col];
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of records that were found in the cache
+///
+/// \return     number of calls to get_record() that did not need a query
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned long gde_record_cache::num_hits() const
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return my_num_hits;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of records that were not found in the cache
+///
+/// \return     number of calls to get_record() that needed a query
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned long gde_record_cache::num_misses() const
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return my_num_misses;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Estimate the memory held by the key list and the cached records
+///
+/// \return     approximate number of bytes, not counting the overhead of the memory allocator
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t gde_record_cache::memory_used() const
+{
+    std::lock_guard<std::mutex> lock(cache_mutex);
+
+    // Each key is held twice: in the key list, and in the index (with its position and a hash
+    // table link).
+
+    size_t bytes = key_list.capacity() * sizeof(std::string);
+    for (const std::string& key : key_list)
+        bytes += 2 * key.capacity();
+    bytes += key_index.size() * (sizeof(std::string) + sizeof(size_t) + sizeof(void*));
+
+    for (const auto& entry : cache)
+    {
+        const gde_record& record = entry.second;
+
+        bytes += sizeof(entry) + record.key.capacity() + record.values.capacity() * sizeof(std::string)
+                 + record.is_null.capacity() / 8;
+        for (const std::string& value : record.values)
+            bytes += value.capacity();
+    }
+
+    return bytes;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Main loop of the prefetch thread. The thread sleeps until get_record() asks for work, fetches
+// the records beyond the current position on its own connection, and stores them unless the
+// keys were reloaded or a record was invalidated while the query was running.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_record_cache::prefetch_worker()
+{
+    gde_trace::set_thread_name("record prefetch");
+
+    std::unique_lock<std::mutex> lock(cache_mutex);
+
+    while (true)
+    {
+        work_ready.wait(lock, [this] { return stop_worker || work_requested; });
+        if (stop_worker)
+            break;
+
+        work_requested = false;
+
+        size_t first;
+        size_t last;
+        if (!prefetch_window(first, last))
+            continue;
+
+        std::string   first_key        = key_list[first];
+        std::string   last_key         = key_list[last];
+        unsigned long fetch_generation = generation;
+
+        lock.unlock();
+
+        std::vector<gde_record>  records;
+        std::vector<std::string> names;
+        std::string              error;
+        try
+        {
+            gde_trace_span span("gde_record_cache::prefetch");
+            fetch_range(worker_db, first_key, last_key, records, names);
+        }
+        catch (std::exception& e)
+        {
+            error = e.what();
+        }
+
+        lock.lock();
+
+        if (!error.empty())
+        {
+            worker_error = error;
+            break;
+        }
+        if (fetch_generation == generation)
+            store(records, names);
+    }
+
+    worker_running = false;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Find the positions to prefetch. Nothing is fetched while at least half of the my_prefetch
+// records beyond the current position (in the current direction) are already in the cache, so
+// that the records are fetched in batches rather than one at a time as the user steps along.
+// Otherwise the batch starts at the first record that is not in the cache. Returns false if
+// there is nothing to fetch. The cache mutex must be held.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool gde_record_cache::prefetch_window(size_t& first, size_t& last) const
+{
+    if (my_prefetch == 0 || key_list.empty())
+        return false;
+
+    size_t num_ahead = 0;
+
+    if (direction > 0)
+    {
+        size_t pos = current_pos + 1;
+        while (pos < key_list.size() && cache.count(pos) != 0)
+            pos++;
+        num_ahead = pos - current_pos - 1;
+        if (pos >= key_list.size() || num_ahead >= (my_prefetch + 1) / 2)
+            return false;
+
+        first = pos;
+        last  = std::min(pos + my_prefetch - 1, key_list.size() - 1);
+        while (last > first && cache.count(last) != 0)
+            last--;
+    }
+    else
+    {
+        size_t pos = current_pos;
+        while (pos > 0 && cache.count(pos - 1) != 0)
+            pos--;
+        num_ahead = current_pos - pos;
+        if (pos == 0 || num_ahead >= (my_prefetch + 1) / 2)
+            return false;
+
+        last  = pos - 1;
+        first = (last >= my_prefetch - 1) ? last - (my_prefetch - 1) : 0;
+        while (first < last && cache.count(first) != 0)
+            first++;
+    }
+
+    return true;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Fetch the records whose keys lie between two keys (inclusive).
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_record_cache::fetch_range(database& db, const std::string& first_key, const std::string& last_key,
+                                   std::vector<gde_record>& records, std::vector<std::string>& names) const
+{
+    std::string query = "SELECT " + my_fields + " FROM " + my_table + " WHERE (";
+    if (first_key == last_key)
+        query += my_key_field + "='" + db.escape_str(first_key) + "'";
+    else
+        query += my_key_field + ">='" + db.escape_str(first_key) + "' AND " +
+                 my_key_field + "<='" + db.escape_str(last_key)  + "'";
+    query += ")";
+    if (!my_condition.empty())
+        query += " AND (" + my_condition + ")";
+    query += " ORDER BY " + my_key_field;
+
+    db_row_set row_set;
+    db.execute(query, row_set);
+
+    unsigned int num_cols = row_set.num_cols();
+    unsigned int key_col  = num_cols;
+
+    names.resize(num_cols);
+    for (unsigned int col = 0; col < num_cols; col++)
+    {
+        names[col] = row_set.col_name(col);
+        if (names[col] == my_key_field)
+            key_col = col;
+    }
+    if (key_col == num_cols)
+        throw std::runtime_error("Key field " + my_key_field + " is not one of the fields fetched from " + my_table);
+
+    records.resize(row_set.num_rows());
+    for (unsigned int row = 0; row < row_set.num_rows(); row++)
+    {
+        gde_record& record = records[row];
+        record.values.resize(num_cols);
+        record.is_null.resize(num_cols);
+        for (unsigned int col = 0; col < num_cols; col++)
+            record.is_null[col] = !row_set.get_data(row, col, record.values[col]);
+        record.key = record.values[key_col];
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Add fetched records to the cache, and then drop the records farthest from the current
+// position until the cache is no larger than its maximum size. Records whose keys are not in
+// the key list (added since the keys were loaded) are ignored. The cache mutex must be held.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_record_cache::store(std::vector<gde_record>& records, std::vector<std::string>& names)
+{
+    if (!records.empty())
+        col_names.swap(names);
+
+    for (gde_record& record : records)
+    {
+        auto it = key_index.find(record.key);
+        if (it != key_index.end())
+            cache[it->second] = std::move(record);
+    }
+
+    while (cache.size() > my_cache_size)
+    {
+        size_t low  = cache.begin()->first;
+        size_t high = cache.rbegin()->first;
+
+        if (current_pos - std::min(low, current_pos) >= std::max(high, current_pos) - current_pos)
+            cache.erase(cache.begin());
+        else
+            cache.erase(std::prev(cache.end()));
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Check that a position is within the key list. The name of the calling function is put in the
+// message.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_record_cache::test_input(size_t pos, const char* func) const
+{
+    if (pos >= key_list.size())
+        throw std::out_of_range(std::string("Position in gde_record_cache::") + func + " is out of range");
+}
@@ -0,0 +1,108 @@
+///
+/// \file
+///
+
+#ifndef GDE_RECORD_CACHE_H
+#define GDE_RECORD_CACHE_H
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "database.h"
+
+
+///
+/// \brief One record held by a gde_record_cache
+///
+
+class gde_record
+{
+public:
+    std::string               key;        ///< value of the key field
+    std::vector<std::string>  values;     ///< field values, in column order
+    std::vector<bool>         is_null;    ///< true if the field is NULL
+};
+
+
+
+class gde_record_cache
+{
+public:
+    gde_record_cache (std::string table, std::string key_field, std::string fields = "*");
+    ~gde_record_cache ();
+
+    gde_record_cache (const gde_record_cache&) = delete;
+    gde_record_cache& operator= (const gde_record_cache&) = delete;
+
+    void          set_cache_size (size_t num_records);
+    void          set_prefetch   (size_t num_records);
+
+    size_t        load_keys      (database& db, std::string condition = "");
+    size_t        num_keys       () const;
+    std::string   key            (size_t pos) const;
+    bool          find_key       (const std::string& key, size_t& pos) const;
+
+    void          get_record     (database& db, size_t pos, gde_record& record);
+    bool          is_cached      (size_t pos) const;
+    void          prefetch       (database& db);
+    void          invalidate     (const std::string& key);
+    void          clear_cache    ();
+
+    void          start_prefetch (const database& db);
+    void          stop_prefetch  ();
+    bool          prefetch_running () const;
+    std::string   prefetch_error () const;
+
+    unsigned int  num_cols       () const;
+    std::string   col_name       (unsigned int col) const;
+    unsigned long num_hits       () const;
+    unsigned long num_misses     () const;
+    size_t        memory_used    () const;
+
+private:
+    std::string                              my_table;
+    std::string                              my_key_field;
+    std::string                              my_fields;
+    std::string                              my_condition;
+    size_t                                   my_cache_size = 64;
+    size_t                                   my_prefetch   = 16;
+
+    // The key list is only changed by load_keys(), on the thread that owns the cache, but the
+    // prefetch thread reads it, so changes are made while holding the cache mutex.
+
+    std::vector<std::string>                 key_list;
+    std::unordered_map<std::string, size_t>  key_index;    // key -> position in key_list
+
+    // Everything below is shared with the prefetch thread, and guarded by cache_mutex.
+
+    mutable std::mutex                       cache_mutex;
+    std::map<size_t, gde_record>             cache;        // position -> record
+    std::vector<std::string>                 col_names;
+    size_t                                   current_pos   = 0;
+    int                                      direction     = 1;
+    unsigned long                            generation    = 0;
+    unsigned long                            my_num_hits   = 0;
+    unsigned long                            my_num_misses = 0;
+
+    std::thread                              worker;
+    std::condition_variable                  work_ready;
+    database                                 worker_db;
+    bool                                     worker_running = false;
+    bool                                     stop_worker    = false;
+    bool                                     work_requested = false;
+    std::string                              worker_error;
+
+    void  prefetch_worker ();
+    bool  prefetch_window (size_t& first, size_t& last) const;
+    void  fetch_range     (database& db, const std::string& first_key, const std::string& last_key,
+                           std::vector<gde_record>& records, std::vector<std::string>& names) const;
+    void  store           (std::vector<gde_record>& records, std::vector<std::string>& names);
+    void  test_input      (size_t pos, const char* func) const;
+};
+
+#endif
@@ -6,6 +6,7 @@
 /// This class ...
 ///
 
+#include <algorithm>
 #include <iostream>
 
 #include "gde_search_map.h"
@@ -104,3 +105,57 @@ void gde_search_map::opt_field (gde_relation fld_fam_rel,
 {
 
 }
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Limit the search to the communities near a place
+///
+/// This member function finds all of the places within a given distance of the named place, and
+/// adds their names to the list of communities that the PLAC_COMMUNITY fields are searched for.
+/// It can be called more than once to search around several places.
+///
+/// \param[in]  places      spatial index of the place names
+/// \param[in]  name        name of the central place
+/// \param[in]  radius_km   search radius, in kilometres
+/// \param[in]  county      county of the central place (optional)
+///
+/// \return     number of communities added, which is zero if the central place was not found
+///
+/// \exception std::logic_error thrown if the place index has not been built
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int gde_search_map::add_place_near (const gde_place_index& places, std::string name,
+                                             double radius_km, std::string county)
+{
+    std::vector<std::string> found = places.communities_near(name, radius_km, county);
+
+    unsigned int num_added = 0;
+    for (const std::string& community : found)
+    {
+        if (std::find(community_list.begin(), community_list.end(), community) == community_list.end())
+        {
+            community_list.push_back(community);
+            num_added++;
+        }
+    }
+    return num_added;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the communities that the search is limited to
+///
+/// \return     community names added by `add_place_near()`, or an empty list if the search is not
+///             limited to any communities
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const std::vector<std::string>& gde_search_map::communities () const
+{
+    return community_list;
+}
@@ -5,8 +5,10 @@
 #ifndef GDE_SEARCH_MAP_H
 #define GDE_SEARCH_MAP_H
 
+#include <string>
 #include <vector>
 
+#include "gde_place_index.h"
 #include "gde_source_map.h"
 
 
@@ -30,9 +32,16 @@ public:
 
     bool get_field  (int index, int& source, std::vector<int>& field);
 
+    unsigned int add_place_near (const gde_place_index& places, std::string name, double radius_km,
+                                 std::string county = "");
+
+    const std::vector<std::string>& communities () const;
+
 private:
     const gde_source_map&     my_source_map;
 
+    std::vector<std::string>       community_list;   // communities to search, or empty for all
+
     std::vector<bool>              src_selected;
     std::vector<std::vector<bool>> fld_selected;
 };
@@ -38,6 +38,7 @@
 #include <iostream>
 
 #include "gde_source_map.h"
+#include "gde_trace.h"
 
 
 
@@ -55,10 +56,44 @@
 
 void gde_source_map::load_defs(database &db, std::string src_defs, std::string fld_defs)
 {
+    gde_trace_span span("gde_source_map::load_defs");
+
     // Run the overloaded version of this function from the base class.
 
     db_map::load_defs (db, src_defs, fld_defs);
+    interpret_defs ();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Load source and field definitions from rows that have already been read
+///
+/// \param[in]  src_rows   source definitions, in the column order of `db_map::load_defs`
+/// \param[in]  fld_rows   field definitions, in the column order of `db_map::load_defs`
+///
+/// \exception std::runtime_error thrown if a field definition refers to a non-existent source
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void gde_source_map::load_defs(const std::vector<std::vector<std::string>>& src_rows,
+                               const std::vector<std::vector<std::string>>& fld_rows)
+{
+    db_map::load_defs (src_rows, fld_rows);
+    interpret_defs ();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Interpret the source and field codes of the definitions loaded by the base class.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_source_map::interpret_defs()
+{
     // Define the possible GenDAT source types.
 
     std::unordered_map <std::string, gde_data_tag> source_type_map;
@@ -129,6 +164,7 @@ void gde_source_map::load_defs(database &db, std::string src_defs, std::string f
 
     // If there are no defined sources, then there is nothing to do.
 
+    gde_source_list.clear();
     if (num_sources() <= 0)
         return;
 
@@ -522,6 +558,48 @@ std::string data_tag_text(gde_data_tag data_tag)
 
 
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the field code prefix of a family relation
+///
+/// This is the inverse of the mapping used by `gde_source_map::load_defs` to read the family
+/// relationship part of a GenDat field code.
+///
+/// \param[in]  relation     family relation
+///
+/// \return     relation code (such as "F" or "GM"), or an empty string for the principal person
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string fam_rel_code(gde_relation relation)
+{
+    switch (relation)
+    {
+    case gde_relation::FATHER:
+        return "F";
+    case gde_relation::MOTHER:
+        return "M";
+    case gde_relation::SPOUSE:
+        return "S";
+    case gde_relation::BRIDE:
+        return "B";
+    case gde_relation::BRIDE_FATHER:
+        return "BF";
+    case gde_relation::BRIDE_MOTHER:
+        return "BM";
+    case gde_relation::GROOM:
+        return "G";
+    case gde_relation::GROOM_FATHER:
+        return "GF";
+    case gde_relation::GROOM_MOTHER:
+        return "GM";
+    default:
+        return "";
+    }
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 ///
 /// \brief Split a string into a set of tokens
@@ -72,12 +72,15 @@ enum class gde_data_tag
 };
 
 std::string data_tag_text (gde_data_tag data_tag);
+std::string fam_rel_code  (gde_relation relation);
 
 
 class gde_source_map : public db_map
 {
 public:
     void            load_defs        (database &db, std::string src_defs, std::string fld_defs);
+    void            load_defs        (const std::vector<std::vector<std::string>>& src_rows,
+                                      const std::vector<std::vector<std::string>>& fld_rows);
 
     gde_data_tag    src_type         (int source_num) const;
 
@@ -109,6 +112,7 @@ private:
 
     // A couple of private utility functions.
 
+    void interpret_defs ();
     std::vector<std::string> split (const std::string& input, const std::string& regex);
     void test_inputs (int source_num, int field_num) const;
 };
@@ -0,0 +1,1043 @@
+///
+/// \class gde_string_match gde_string_match.h
+///
+/// \brief Approximate string matching for names
+///
+/// This class scores the similarity between one query string (usually a surname or a given name)
+/// and a large number of candidate strings. Two measures are provided:
+///
+/// - the Jaro-Winkler similarity, which ranges from 0.0 (no similarity) to 1.0 (identical), and
+///   which was designed for short strings such as personal names;
+/// - the Levenshtein (edit) distance, bounded by a maximum distance of interest.
+///
+/// The query is prepared once, when the object is constructed, so that it can then be compared
+/// with many candidates. When the compiler targets SSE2 or AVX2, the member functions use SIMD
+/// kernels. The single Jaro-Winkler comparison compares one query character with up to 32
+/// candidate characters in a single instruction. The batch Jaro-Winkler kernel finds the
+/// positions of the query characters in each candidate with one pass over the candidate, and
+/// then matches 2 (SSE2) or 4 (AVX2) candidates at once, one in each 64-bit lane. The
+/// Levenshtein kernel runs the bit-parallel algorithm of Myers on 4 (SSE2) or 8 (AVX2)
+/// candidates at once. Strings that are too long
+/// for the kernels, and builds without SIMD support (or with `GDE_NO_SIMD` defined), use the
+/// scalar versions, which always give identical results.
+///
+/// If the object is constructed with `normalize` set, then the query and all of the candidates
+/// are passed through `normalize_name()` before they are compared.
+///
+
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#if !defined(GDE_NO_SIMD) && defined(__AVX2__)
+#define GDE_SIMD_AVX2
+#include <immintrin.h>
+#elif !defined(GDE_NO_SIMD) && defined(__SSE2__)
+#define GDE_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "gde_string_match.h"
+
+
+// Longest strings that can be handled by the bit-parallel kernels.
+
+static const unsigned int MAX_LEN_64 = 64;
+static const unsigned int MAX_LEN_32 = 32;
+
+// Number of candidates handled at once by the SIMD Levenshtein kernel.
+
+#if defined(GDE_SIMD_AVX2)
+static const unsigned int NUM_LANES = 8;
+#elif defined(GDE_SIMD_SSE2)
+static const unsigned int NUM_LANES = 4;
+#else
+static const unsigned int NUM_LANES = 1;
+#endif
+
+// Number of candidates handled at once by the SIMD Jaro-Winkler kernel.
+
+#if defined(GDE_SIMD_AVX2)
+static const unsigned int NUM_LANES_64 = 4;
+#elif defined(GDE_SIMD_SSE2)
+static const unsigned int NUM_LANES_64 = 2;
+#else
+static const unsigned int NUM_LANES_64 = 1;
+#endif
+
+// Value of char_num for the characters that are not in the query.
+
+static const unsigned char NO_CHAR = 0xFF;
+
+
+static double       jaro_winkler_ref (const char* s1, unsigned int l1, const char* s2, unsigned int l2);
+static unsigned int levenshtein_ref  (const char* s1, unsigned int l1, const char* s2, unsigned int l2,
+                                      unsigned int max_dist);
+static double       winkler_boost    (double jaro, const char* s1, unsigned int l1,
+                                      const char* s2, unsigned int l2);
+#if defined(GDE_SIMD_AVX2) || defined(GDE_SIMD_SSE2)
+static double       jaro_matched     (const char* s1, unsigned int l1, const char* s2, unsigned int l2,
+                                      uint64_t used_1, uint64_t used_2);
+#endif
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Constructor
+///
+/// \param[in]  query       string that will be compared with the candidates
+/// \param[in]  normalize   if `true`, normalize the query and all candidates with `normalize_name()`
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gde_string_match::gde_string_match(std::string query, bool normalize)
+{
+    my_normalize = normalize;
+    my_query     = normalize ? normalize_name(query) : query;
+
+    // Set up the character position masks for the bit-parallel kernels.
+
+    std::memset(peq,    0, sizeof(peq));
+    std::memset(peq_32, 0, sizeof(peq_32));
+    std::memset(char_num, NO_CHAR, sizeof(char_num));
+    num_chars = 0;
+
+    for (unsigned int i = 0; i < my_query.size() && i < MAX_LEN_64; i++)
+    {
+        unsigned char c = my_query[i];
+        peq[c] |= (uint64_t) 1 << i;
+        if (i < MAX_LEN_32)
+            peq_32[c] |= (uint32_t) 1 << i;
+
+        if (char_num[c] == NO_CHAR)
+            char_num[c] = num_chars++;
+        query_num[i] = char_num[c];
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the query string
+///
+/// \return     query string, after normalization (if that was requested)
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_string_match::query() const
+{
+    return my_query;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Jaro-Winkler similarity with one candidate
+///
+/// \param[in]  candidate   candidate string
+///
+/// \return     similarity, from 0.0 to 1.0
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double gde_string_match::jaro_winkler(const std::string& candidate) const
+{
+    if (my_normalize)
+    {
+        std::string norm = normalize_name(candidate);
+        return jaro_winkler_1(norm.data(), norm.size());
+    }
+    return jaro_winkler_1(candidate.data(), candidate.size());
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Bounded Levenshtein distance to one candidate
+///
+/// \param[in]  candidate   candidate string
+/// \param[in]  max_dist    largest distance of interest
+///
+/// \return     edit distance, or `max_dist + 1` if the distance is greater than `max_dist`
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int gde_string_match::levenshtein(const std::string& candidate, unsigned int max_dist) const
+{
+    if (my_normalize)
+    {
+        std::string norm = normalize_name(candidate);
+        return levenshtein_1(norm.data(), norm.size(), max_dist);
+    }
+    return levenshtein_1(candidate.data(), candidate.size(), max_dist);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Jaro-Winkler similarity with many candidates
+///
+/// The scores are the same as those of `jaro_winkler()`, but with SIMD support several
+/// candidates are scored at once.
+///
+/// \param[in]  candidates   candidate strings
+/// \param[out] scores       one similarity score for each candidate
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_string_match::jaro_winkler_batch(const std::vector<std::string>& candidates,
+                                          std::vector<double>& scores) const
+{
+    scores.resize(candidates.size());
+
+    // Normalize the candidates, if required.
+
+    std::vector<std::string> norm;
+    if (my_normalize)
+    {
+        norm.reserve(candidates.size());
+        for (const std::string& c : candidates)
+            norm.push_back(normalize_name(c));
+    }
+    const std::vector<std::string>& cands = my_normalize ? norm : candidates;
+
+    // Collect groups of candidates that the multi-lane kernel can handle, and score the others
+    // one at a time.
+
+    bool               use_kernel = (my_query.size() > 0 && my_query.size() <= MAX_LEN_64);
+    const std::string* group    [NUM_LANES_64];
+    size_t             group_pos[NUM_LANES_64];
+    double             group_out[NUM_LANES_64];
+    unsigned int       num_group = 0;
+
+    for (size_t i = 0; i < cands.size(); i++)
+    {
+        if (!use_kernel || cands[i].empty() || cands[i].size() > MAX_LEN_64)
+        {
+            scores[i] = jaro_winkler_1(cands[i].data(), cands[i].size());
+            continue;
+        }
+
+        group[num_group]     = &cands[i];
+        group_pos[num_group] = i;
+        if (++num_group < NUM_LANES_64 && i + 1 < cands.size())
+            continue;
+
+        jaro_winkler_n(group, num_group, group_out);
+        for (unsigned int k = 0; k < num_group; k++)
+            scores[group_pos[k]] = group_out[k];
+        num_group = 0;
+    }
+
+    if (num_group > 0)
+    {
+        jaro_winkler_n(group, num_group, group_out);
+        for (unsigned int k = 0; k < num_group; k++)
+            scores[group_pos[k]] = group_out[k];
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Bounded Levenshtein distance to many candidates
+///
+/// \param[in]  candidates   candidate strings
+/// \param[in]  max_dist     largest distance of interest
+/// \param[out] distances    one distance for each candidate, or `max_dist + 1` if the distance
+///                          is greater than `max_dist`
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_string_match::levenshtein_batch(const std::vector<std::string>& candidates,
+                                         unsigned int max_dist,
+                                         std::vector<unsigned int>& distances) const
+{
+    distances.resize(candidates.size());
+
+    // Normalize the candidates, if required.
+
+    std::vector<std::string> norm;
+    if (my_normalize)
+    {
+        norm.reserve(candidates.size());
+        for (const std::string& c : candidates)
+            norm.push_back(normalize_name(c));
+    }
+    const std::vector<std::string>& cands = my_normalize ? norm : candidates;
+
+    // Run the multi-lane kernel on full groups of candidates, if it can handle the query.
+
+    size_t i = 0;
+    if (NUM_LANES > 1 && my_query.size() > 0 && my_query.size() <= MAX_LEN_32)
+    {
+        const std::string* group[NUM_LANES];
+        for (; i + NUM_LANES <= cands.size(); i += NUM_LANES)
+        {
+            for (unsigned int k = 0; k < NUM_LANES; k++)
+                group[k] = &cands[i + k];
+            levenshtein_n(group, NUM_LANES, max_dist, &distances[i]);
+        }
+    }
+
+    // Finish off the rest, one at a time.
+
+    for (; i < cands.size(); i++)
+        distances[i] = levenshtein_1(cands[i].data(), cands[i].size(), max_dist);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Jaro-Winkler similarity, scalar version
+///
+/// This is the textbook algorithm. It is used for strings too long for the SIMD kernels, and as
+/// the reference for testing and benchmarking them.
+///
+/// \param[in]  str_1   first string
+/// \param[in]  str_2   second string
+///
+/// \return     similarity, from 0.0 to 1.0
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double gde_string_match::jaro_winkler_scalar(const std::string& str_1, const std::string& str_2)
+{
+    return jaro_winkler_ref(str_1.data(), str_1.size(), str_2.data(), str_2.size());
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Bounded Levenshtein distance, scalar version
+///
+/// This is the textbook dynamic programming algorithm, which gives up as soon as every entry
+/// in a row of the distance matrix exceeds `max_dist`.
+///
+/// \param[in]  str_1      first string
+/// \param[in]  str_2      second string
+/// \param[in]  max_dist   largest distance of interest
+///
+/// \return     edit distance, or `max_dist + 1` if the distance is greater than `max_dist`
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int gde_string_match::levenshtein_scalar(const std::string& str_1, const std::string& str_2,
+                                                  unsigned int max_dist)
+{
+    return levenshtein_ref(str_1.data(), str_1.size(), str_2.data(), str_2.size(), max_dist);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Normalize a personal name
+///
+/// This function puts a name into a standard form before comparison:
+///
+/// - letters are converted to upper case, and accented Latin-1 letters (in either UTF-8 or
+///   ISO-8859-1 encoding) are replaced by the unaccented letter;
+/// - apostrophes, periods and other punctuation are removed;
+/// - spaces, hyphens and commas separate words, with exactly one space between words;
+/// - the prefix "MAC" is written as "MC", so that MacDonald and McDonald compare equal.
+///
+/// \param[in]  name   name to be normalized
+///
+/// \return     normalized name
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_string_match::normalize_name(const std::string& name)
+{
+    // Unaccented upper case letters for Latin-1 code points 0xC0 to 0xFF.
+
+    static const char latin_1[65] =
+        "AAAAAAACEEEEIIIIDNOOOOO OUUUUY S"
+        "AAAAAAACEEEEIIIIDNOOOOO OUUUUY Y";
+
+    std::string out;
+    out.reserve(name.size());
+    bool word_start = true;
+    size_t word_pos = 0;
+
+    for (size_t i = 0; i < name.size(); i++)
+    {
+        unsigned int c = (unsigned char) name[i];
+        char letter = 0;
+
+        // Decode a two byte UTF-8 sequence for a Latin-1 letter.
+
+        if (c == 0xC3 && i + 1 < name.size() && (unsigned char) name[i+1] >= 0x80 &&
+                (unsigned char) name[i+1] <= 0xBF)
+            c = (unsigned char) name[++i] + 0x40;
+
+        if (c < 0x80 && std::isalpha(c))
+            letter = std::toupper(c);
+        else if (c >= 0xC0 && latin_1[c - 0xC0] != ' ')
+            letter = latin_1[c - 0xC0];
+        else if (c == ' ' || c == '-' || c == ',' || c == '\t' || c == '/')
+        {
+            word_start = true;
+            continue;
+        }
+        else
+            continue;
+
+        // Start a new word, if required.
+
+        if (word_start)
+        {
+            if (!out.empty())
+                out += ' ';
+            word_pos   = out.size();
+            word_start = false;
+        }
+        out += letter;
+
+        // Fold "MAC" into "MC" at the start of a long enough word (leaving names like "Mack").
+
+        if (out.size() - word_pos == 4 && out.compare(word_pos, 3, "MAC") == 0 &&
+                i + 1 < name.size() && std::isalpha((unsigned char) name[i+1]))
+            out.erase(word_pos + 1, 1);
+    }
+    return out;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Similarity between two personal names
+///
+/// Both names are normalized, and then compared with the Jaro-Winkler similarity.
+///
+/// \param[in]  name_1   first name
+/// \param[in]  name_2   second name
+///
+/// \return     similarity, from 0.0 to 1.0
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double gde_string_match::name_similarity(const std::string& name_1, const std::string& name_2)
+{
+    gde_string_match match(name_1, true);
+    return match.jaro_winkler(name_2);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Soundex code of a name
+///
+/// This is the American Soundex phonetic code: the first letter of the name followed by three
+/// digits that encode the following consonants. The name is normalized first, and spaces are
+/// ignored, so that "Mac Donald", "MacDonald" and "McDonald" all have the same code (M235).
+///
+/// \param[in]  name   name to be encoded
+///
+/// \return     four character Soundex code, or an empty string if the name has no letters
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_string_match::soundex(const std::string& name)
+{
+    // Digit codes for the letters A to Z. Vowels (and Y) are '0'; H and W are '-'.
+
+    static const char codes[27] = "0123012-02245501262301-202";
+
+    std::string norm = normalize_name(name);
+    std::string code;
+    char last = 0;
+
+    for (char c : norm)
+    {
+        if (c < 'A' || c > 'Z')
+            continue;
+
+        char digit = codes[c - 'A'];
+        if (code.empty())
+        {
+            code += c;
+            last  = digit;
+        }
+        else if (digit == '-')
+        {
+            // H and W do not separate consonants with the same code.
+        }
+        else
+        {
+            if (digit != '0' && digit != last)
+                code += digit;
+            last = digit;
+        }
+        if (code.size() == 4)
+            break;
+    }
+
+    if (!code.empty())
+        code.resize(4, '0');
+    return code;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the SIMD instruction set used by the kernels
+///
+/// \return     "AVX2", "SSE2" or "scalar"
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_string_match::simd_level()
+{
+#if defined(GDE_SIMD_AVX2)
+    return "AVX2";
+#elif defined(GDE_SIMD_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Jaro-Winkler similarity between the query and one candidate, using bit masks.
+//
+// For each query character, in order, find the first candidate character within the match
+// window that is equal and has not already been matched. With SIMD, the positions of all equal
+// candidate characters are found with one compare instruction per 16 or 32 characters.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double gde_string_match::jaro_winkler_1(const char* cand, unsigned int cand_len) const
+{
+    const char*  query     = my_query.data();
+    unsigned int query_len = my_query.size();
+
+#if defined(GDE_SIMD_AVX2) || defined(GDE_SIMD_SSE2)
+    if (query_len > MAX_LEN_64 || cand_len > MAX_LEN_64)
+        return jaro_winkler_ref(query, query_len, cand, cand_len);
+
+    if (query_len == 0 || cand_len == 0)
+        return (query_len == 0 && cand_len == 0) ? 1.0 : 0.0;
+
+    unsigned int window = std::max(query_len, cand_len) / 2;
+    window = (window > 0) ? window - 1 : 0;
+
+    // Copy the candidate into a zero-padded buffer, so that whole vectors can be loaded.
+
+    alignas(32) unsigned char buf[MAX_LEN_64];
+    std::memset(buf, 0, sizeof(buf));
+    std::memcpy(buf, cand, cand_len);
+
+#if defined(GDE_SIMD_AVX2)
+    unsigned int num_chunks = (cand_len + 31) / 32;
+    __m256i chunk[2];
+    for (unsigned int k = 0; k < num_chunks; k++)
+        chunk[k] = _mm256_load_si256((const __m256i*) (buf + 32 * k));
+#else
+    unsigned int num_chunks = (cand_len + 15) / 16;
+    __m128i chunk[4];
+    for (unsigned int k = 0; k < num_chunks; k++)
+        chunk[k] = _mm_load_si128((const __m128i*) (buf + 16 * k));
+#endif
+
+    uint64_t     cand_used  = 0;
+    uint64_t     query_used = 0;
+    unsigned int matches    = 0;
+
+    for (unsigned int i = 0; i < query_len; i++)
+    {
+        unsigned int lo = (i > window) ? i - window : 0;
+        unsigned int hi = std::min(i + window, cand_len - 1);
+        if (lo > hi)
+            continue;
+
+        // Find the positions of this query character in the candidate.
+
+        uint64_t eq = 0;
+#if defined(GDE_SIMD_AVX2)
+        __m256i q = _mm256_set1_epi8(query[i]);
+        for (unsigned int k = 0; k < num_chunks; k++)
+            eq |= (uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(q, chunk[k])) << (32 * k);
+#else
+        __m128i q = _mm_set1_epi8(query[i]);
+        for (unsigned int k = 0; k < num_chunks; k++)
+            eq |= (uint64_t) (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(q, chunk[k])) << (16 * k);
+#endif
+
+        // Keep only unmatched positions inside the match window, and take the first one.
+
+        uint64_t upper = (hi >= 63) ? ~(uint64_t) 0 : (((uint64_t) 1 << (hi + 1)) - 1);
+        uint64_t avail = eq & upper & ~(((uint64_t) 1 << lo) - 1) & ~cand_used;
+        if (avail)
+        {
+            cand_used  |= avail & (~avail + 1);
+            query_used |= (uint64_t) 1 << i;
+            matches++;
+        }
+    }
+
+    if (matches == 0)
+        return 0.0;
+
+    return jaro_matched(query, query_len, cand, cand_len, query_used, cand_used);
+#else
+    return jaro_winkler_ref(query, query_len, cand, cand_len);
+#endif
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Jaro-Winkler similarity between the query and a group of up to NUM_LANES_64 candidates. This is
+// the same greedy matching as jaro_winkler_1, but with one candidate in each 64-bit SIMD lane.
+//
+// First, one pass over each candidate finds the positions of each distinct query character in it.
+// Then each query character takes the first unmatched position in the match window of every lane
+// at once. The window is kept as two masks that move one position to the left for each query
+// character: the positions up to the end of the window, and the positions before its start. The
+// query and the candidates must have between 1 and 64 characters.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_string_match::jaro_winkler_n(const std::string* const* cands, unsigned int num_cands,
+                                      double* scores) const
+{
+#if defined(GDE_SIMD_AVX2) || defined(GDE_SIMD_SSE2)
+    const char*  query     = my_query.data();
+    unsigned int query_len = my_query.size();
+
+    alignas(32) uint64_t cand_eq   [MAX_LEN_64 * NUM_LANES_64];
+    alignas(32) uint64_t lane_win  [NUM_LANES_64];
+    alignas(32) uint64_t lane_upper[NUM_LANES_64];
+    alignas(32) uint64_t lane_cand [NUM_LANES_64];
+    alignas(32) uint64_t lane_query[NUM_LANES_64];
+
+    std::memset(cand_eq, 0, num_chars * NUM_LANES_64 * sizeof(uint64_t));
+
+    for (unsigned int k = 0; k < NUM_LANES_64; k++)
+    {
+        unsigned int cand_len = (k < num_cands) ? cands[k]->size() : 0;
+        unsigned int window   = std::max(query_len, cand_len) / 2;
+        window = (window > 0) ? window - 1 : 0;
+
+        lane_win[k]   = window;
+        lane_upper[k] = ((uint64_t) 2 << window) - 1;
+
+        for (unsigned int j = 0; j < cand_len; j++)
+        {
+            unsigned char num = char_num[(unsigned char) (*cands[k])[j]];
+            if (num != NO_CHAR)
+                cand_eq[num * NUM_LANES_64 + k] |= (uint64_t) 1 << j;
+        }
+    }
+
+    // For the lowest set bit x of each lane, x | -x has its top bit set only if x is not zero.
+
+#if defined(GDE_SIMD_AVX2)
+    const __m256i zero       = _mm256_setzero_si256();
+    const __m256i one        = _mm256_set1_epi64x(1);
+    const __m256i window     = _mm256_load_si256((const __m256i*) lane_win);
+    __m256i       upper      = _mm256_load_si256((const __m256i*) lane_upper);
+    __m256i       before     = zero;
+    __m256i       cand_used  = zero;
+    __m256i       query_used = zero;
+
+    for (unsigned int i = 0; i < query_len; i++)
+    {
+        __m256i eq    = _mm256_load_si256((const __m256i*) (cand_eq + query_num[i] * NUM_LANES_64));
+        __m256i avail = _mm256_andnot_si256(_mm256_or_si256(before, cand_used), _mm256_and_si256(eq, upper));
+        __m256i first = _mm256_and_si256(avail, _mm256_sub_epi64(zero, avail));
+        __m256i found = _mm256_srli_epi64(_mm256_or_si256(first, _mm256_sub_epi64(zero, first)), 63);
+
+        cand_used  = _mm256_or_si256(cand_used, first);
+        query_used = _mm256_or_si256(query_used, _mm256_sll_epi64(found, _mm_cvtsi32_si128(i)));
+
+        // The start of the window moves once i reaches the window size.
+
+        __m256i moved = _mm256_xor_si256(_mm256_srli_epi64(_mm256_sub_epi64(_mm256_set1_epi64x(i), window), 63), one);
+        before = _mm256_or_si256(_mm256_slli_epi64(before, 1), moved);
+        upper  = _mm256_or_si256(_mm256_slli_epi64(upper, 1), one);
+    }
+
+    _mm256_store_si256((__m256i*) lane_cand,  cand_used);
+    _mm256_store_si256((__m256i*) lane_query, query_used);
+#else
+    const __m128i zero       = _mm_setzero_si128();
+    const __m128i one        = _mm_set1_epi64x(1);
+    const __m128i window     = _mm_load_si128((const __m128i*) lane_win);
+    __m128i       upper      = _mm_load_si128((const __m128i*) lane_upper);
+    __m128i       before     = zero;
+    __m128i       cand_used  = zero;
+    __m128i       query_used = zero;
+
+    for (unsigned int i = 0; i < query_len; i++)
+    {
+        __m128i eq    = _mm_load_si128((const __m128i*) (cand_eq + query_num[i] * NUM_LANES_64));
+        __m128i avail = _mm_andnot_si128(_mm_or_si128(before, cand_used), _mm_and_si128(eq, upper));
+        __m128i first = _mm_and_si128(avail, _mm_sub_epi64(zero, avail));
+        __m128i found = _mm_srli_epi64(_mm_or_si128(first, _mm_sub_epi64(zero, first)), 63);
+
+        cand_used  = _mm_or_si128(cand_used, first);
+        query_used = _mm_or_si128(query_used, _mm_sll_epi64(found, _mm_cvtsi32_si128(i)));
+
+        // The start of the window moves once i reaches the window size.
+
+        __m128i moved = _mm_xor_si128(_mm_srli_epi64(_mm_sub_epi64(_mm_set1_epi64x(i), window), 63), one);
+        before = _mm_or_si128(_mm_slli_epi64(before, 1), moved);
+        upper  = _mm_or_si128(_mm_slli_epi64(upper, 1), one);
+    }
+
+    _mm_store_si128((__m128i*) lane_cand,  cand_used);
+    _mm_store_si128((__m128i*) lane_query, query_used);
+#endif
+
+    for (unsigned int k = 0; k < num_cands; k++)
+    {
+        if (lane_cand[k] == 0)
+            scores[k] = 0.0;
+        else
+            scores[k] = jaro_matched(query, query_len, cands[k]->data(), cands[k]->size(),
+                                     lane_query[k], lane_cand[k]);
+    }
+#else
+    for (unsigned int k = 0; k < num_cands; k++)
+        scores[k] = jaro_winkler_1(cands[k]->data(), cands[k]->size());
+#endif
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Bounded Levenshtein distance between the query and one candidate, using the bit-parallel
+// algorithm of Myers (1999), as reformulated for edit distance by Hyyro (2001). One machine word
+// holds one column of the distance matrix, encoded as vertical +1/-1 differences.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned int gde_string_match::levenshtein_1(const char* cand, unsigned int cand_len,
+                                             unsigned int max_dist) const
+{
+    unsigned int query_len = my_query.size();
+
+    if (query_len > MAX_LEN_64)
+        return levenshtein_ref(my_query.data(), query_len, cand, cand_len, max_dist);
+
+    unsigned int len_diff = (query_len > cand_len) ? query_len - cand_len : cand_len - query_len;
+    if (len_diff > max_dist)
+        return max_dist + 1;
+    if (query_len == 0)
+        return cand_len;
+
+    uint64_t last  = (uint64_t) 1 << (query_len - 1);
+    uint64_t pv    = ~(uint64_t) 0;
+    uint64_t mv    = 0;
+    unsigned int score = query_len;
+
+    for (unsigned int j = 0; j < cand_len; j++)
+    {
+        uint64_t eq = peq[(unsigned char) cand[j]];
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+
+        if (ph & last)
+            score++;
+        else if (mh & last)
+            score--;
+
+        // Each remaining candidate character can lower the distance by at most one.
+
+        if (score > max_dist + (cand_len - j - 1))
+            return max_dist + 1;
+
+        ph = (ph << 1) | 1;
+        mh =  mh << 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+    }
+
+    return std::min(score, max_dist + 1);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Bounded Levenshtein distance between the query and a group of up to NUM_LANES candidates.
+// This is the same algorithm as levenshtein_1, but with one candidate in each 32-bit SIMD lane.
+// The query must have between 1 and 32 characters.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_string_match::levenshtein_n(const std::string* const* cands, unsigned int num_cands,
+                                     unsigned int max_dist, unsigned int* distances) const
+{
+#if defined(GDE_SIMD_AVX2) || defined(GDE_SIMD_SSE2)
+    unsigned int query_len = my_query.size();
+    unsigned int max_len   = 0;
+
+    alignas(32) int32_t  lane_len [NUM_LANES];
+    alignas(32) int32_t  lane_eq  [NUM_LANES];
+    alignas(32) uint32_t lane_out [NUM_LANES];
+
+    for (unsigned int k = 0; k < NUM_LANES; k++)
+    {
+        lane_len[k] = (k < num_cands) ? cands[k]->size() : 0;
+        max_len = std::max(max_len, (unsigned int) lane_len[k]);
+    }
+
+#if defined(GDE_SIMD_AVX2)
+    const __m256i ones  = _mm256_set1_epi32(-1);
+    const __m256i one   = _mm256_set1_epi32(1);
+    const __m256i last  = _mm256_set1_epi32((int32_t) ((uint32_t) 1 << (query_len - 1)));
+    const __m256i lens  = _mm256_load_si256((const __m256i*) lane_len);
+    __m256i pv    = ones;
+    __m256i mv    = _mm256_setzero_si256();
+    __m256i score = _mm256_set1_epi32(query_len);
+
+    for (unsigned int j = 0; j < max_len; j++)
+    {
+        for (unsigned int k = 0; k < NUM_LANES; k++)
+            lane_eq[k] = ((int32_t) j < lane_len[k]) ? (unsigned char) (*cands[k])[j] : 0;
+
+        __m256i active = _mm256_cmpgt_epi32(lens, _mm256_set1_epi32(j));
+        __m256i eq = _mm256_i32gather_epi32((const int*) peq_32,
+                                            _mm256_load_si256((const __m256i*) lane_eq), 4);
+        __m256i xv = _mm256_or_si256(eq, mv);
+        __m256i xh = _mm256_or_si256(_mm256_xor_si256(_mm256_add_epi32(_mm256_and_si256(eq, pv), pv), pv), eq);
+        __m256i ph = _mm256_or_si256(mv, _mm256_xor_si256(_mm256_or_si256(xh, pv), ones));
+        __m256i mh = _mm256_and_si256(pv, xh);
+
+        // The compare results are -1 where the bit is set, so subtract them to count up.
+
+        __m256i up   = _mm256_cmpeq_epi32(_mm256_and_si256(ph, last), last);
+        __m256i down = _mm256_cmpeq_epi32(_mm256_and_si256(mh, last), last);
+        score = _mm256_add_epi32(score, _mm256_and_si256(_mm256_sub_epi32(down, up), active));
+
+        ph = _mm256_or_si256(_mm256_slli_epi32(ph, 1), one);
+        mh = _mm256_slli_epi32(mh, 1);
+        pv = _mm256_or_si256(mh, _mm256_xor_si256(_mm256_or_si256(xv, ph), ones));
+        mv = _mm256_and_si256(ph, xv);
+    }
+
+    _mm256_store_si256((__m256i*) lane_out, score);
+#else
+    const __m128i ones  = _mm_set1_epi32(-1);
+    const __m128i one   = _mm_set1_epi32(1);
+    const __m128i last  = _mm_set1_epi32((int32_t) ((uint32_t) 1 << (query_len - 1)));
+    const __m128i lens  = _mm_load_si128((const __m128i*) lane_len);
+    __m128i pv    = ones;
+    __m128i mv    = _mm_setzero_si128();
+    __m128i score = _mm_set1_epi32(query_len);
+
+    for (unsigned int j = 0; j < max_len; j++)
+    {
+        for (unsigned int k = 0; k < NUM_LANES; k++)
+            lane_eq[k] = ((int32_t) j < lane_len[k]) ? peq_32[(unsigned char) (*cands[k])[j]] : 0;
+
+        __m128i active = _mm_cmpgt_epi32(lens, _mm_set1_epi32(j));
+        __m128i eq = _mm_load_si128((const __m128i*) lane_eq);
+        __m128i xv = _mm_or_si128(eq, mv);
+        __m128i xh = _mm_or_si128(_mm_xor_si128(_mm_add_epi32(_mm_and_si128(eq, pv), pv), pv), eq);
+        __m128i ph = _mm_or_si128(mv, _mm_xor_si128(_mm_or_si128(xh, pv), ones));
+        __m128i mh = _mm_and_si128(pv, xh);
+
+        // The compare results are -1 where the bit is set, so subtract them to count up.
+
+        __m128i up   = _mm_cmpeq_epi32(_mm_and_si128(ph, last), last);
+        __m128i down = _mm_cmpeq_epi32(_mm_and_si128(mh, last), last);
+        score = _mm_add_epi32(score, _mm_and_si128(_mm_sub_epi32(down, up), active));
+
+        ph = _mm_or_si128(_mm_slli_epi32(ph, 1), one);
+        mh = _mm_slli_epi32(mh, 1);
+        pv = _mm_or_si128(mh, _mm_xor_si128(_mm_or_si128(xv, ph), ones));
+        mv = _mm_and_si128(ph, xv);
+    }
+
+    _mm_store_si128((__m128i*) lane_out, score);
+#endif
+
+    for (unsigned int k = 0; k < num_cands; k++)
+        distances[k] = std::min(lane_out[k], max_dist + 1);
+#else
+    for (unsigned int k = 0; k < num_cands; k++)
+        distances[k] = levenshtein_1(cands[k]->data(), cands[k]->size(), max_dist);
+#endif
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Reference Jaro-Winkler similarity.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static double jaro_winkler_ref(const char* s1, unsigned int l1, const char* s2, unsigned int l2)
+{
+    if (l1 == 0 || l2 == 0)
+        return (l1 == 0 && l2 == 0) ? 1.0 : 0.0;
+
+    unsigned int window = std::max(l1, l2) / 2;
+    window = (window > 0) ? window - 1 : 0;
+
+    std::vector<char> used_1(l1, 0);
+    std::vector<char> used_2(l2, 0);
+    unsigned int matches = 0;
+
+    // Find the matching characters.
+
+    for (unsigned int i = 0; i < l1; i++)
+    {
+        unsigned int lo = (i > window) ? i - window : 0;
+        unsigned int hi = std::min(i + window + 1, l2);
+        for (unsigned int j = lo; j < hi; j++)
+        {
+            if (!used_2[j] && s1[i] == s2[j])
+            {
+                used_1[i] = used_2[j] = 1;
+                matches++;
+                break;
+            }
+        }
+    }
+
+    if (matches == 0)
+        return 0.0;
+
+    // Count the matched characters that are out of order.
+
+    unsigned int half_trans = 0;
+    unsigned int k = 0;
+    for (unsigned int i = 0; i < l1; i++)
+    {
+        if (used_1[i])
+        {
+            while (!used_2[k])
+                k++;
+            if (s1[i] != s2[k])
+                half_trans++;
+            k++;
+        }
+    }
+
+    double m    = matches;
+    double jaro = (m / l1 + m / l2 + (m - half_trans / 2.0) / m) / 3.0;
+
+    return winkler_boost(jaro, s1, l1, s2, l2);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Reference bounded Levenshtein distance.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static unsigned int levenshtein_ref(const char* s1, unsigned int l1, const char* s2, unsigned int l2,
+                                    unsigned int max_dist)
+{
+    unsigned int len_diff = (l1 > l2) ? l1 - l2 : l2 - l1;
+    if (len_diff > max_dist)
+        return max_dist + 1;
+
+    std::vector<unsigned int> row(l2 + 1);
+    for (unsigned int j = 0; j <= l2; j++)
+        row[j] = j;
+
+    for (unsigned int i = 1; i <= l1; i++)
+    {
+        unsigned int diag    = row[0];
+        unsigned int row_min = row[0] = i;
+
+        for (unsigned int j = 1; j <= l2; j++)
+        {
+            unsigned int above = row[j];
+            unsigned int cost  = (s1[i-1] == s2[j-1]) ? 0 : 1;
+            row[j]  = std::min(std::min(above + 1, row[j-1] + 1), diag + cost);
+            diag    = above;
+            row_min = std::min(row_min, row[j]);
+        }
+
+        if (row_min > max_dist)
+            return max_dist + 1;
+    }
+
+    return std::min(row[l2], max_dist + 1);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Winkler's adjustment, which favours strings with a common prefix of up to four characters.
+// It is only applied to strings that are already reasonably similar.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static double winkler_boost(double jaro, const char* s1, unsigned int l1, const char* s2, unsigned int l2)
+{
+    if (jaro <= 0.7)
+        return jaro;
+
+    unsigned int prefix = 0;
+    unsigned int limit  = std::min(std::min(l1, l2), 4u);
+    while (prefix < limit && s1[prefix] == s2[prefix])
+        prefix++;
+
+    return jaro + prefix * 0.1 * (1.0 - jaro);
+}
+
+
+
+#if defined(GDE_SIMD_AVX2) || defined(GDE_SIMD_SSE2)
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Jaro-Winkler similarity from the matched positions of the two strings, given as bit masks. At
+// least one character must have been matched, and the strings must have at most 64 characters.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static double jaro_matched(const char* s1, unsigned int l1, const char* s2, unsigned int l2,
+                           uint64_t used_1, uint64_t used_2)
+{
+    unsigned int matches = __builtin_popcountll(used_1);
+
+    // Count the matched characters that are out of order.
+
+    unsigned int half_trans = 0;
+    while (used_1)
+    {
+        if (s1[__builtin_ctzll(used_1)] != s2[__builtin_ctzll(used_2)])
+            half_trans++;
+        used_1 &= used_1 - 1;
+        used_2 &= used_2 - 1;
+    }
+
+    double m    = matches;
+    double jaro = (m / l1 + m / l2 + (m - half_trans / 2.0) / m) / 3.0;
+
+    return winkler_boost(jaro, s1, l1, s2, l2);
+}
+#endif
@@ -0,0 +1,62 @@
+///
+/// \file
+///
+
+#ifndef GDE_STRING_MATCH_H
+#define GDE_STRING_MATCH_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+class gde_string_match
+{
+public:
+    gde_string_match (std::string query, bool normalize = false);
+
+    std::string  query              () const;
+
+    double       jaro_winkler       (const std::string& candidate) const;
+    unsigned int levenshtein        (const std::string& candidate, unsigned int max_dist) const;
+
+    void         jaro_winkler_batch (const std::vector<std::string>& candidates,
+                                     std::vector<double>& scores) const;
+    void         levenshtein_batch  (const std::vector<std::string>& candidates,
+                                     unsigned int max_dist,
+                                     std::vector<unsigned int>& distances) const;
+
+    static double       jaro_winkler_scalar (const std::string& str_1, const std::string& str_2);
+    static unsigned int levenshtein_scalar  (const std::string& str_1, const std::string& str_2,
+                                             unsigned int max_dist);
+    static std::string  normalize_name      (const std::string& name);
+    static double       name_similarity     (const std::string& name_1, const std::string& name_2);
+    static std::string  soundex             (const std::string& name);
+    static std::string  simd_level          ();
+
+private:
+    std::string  my_query;
+    bool         my_normalize;
+
+    // Bit masks of the positions of each character in the query string, used by the
+    // bit-parallel kernels. These are only valid for queries of up to 64 characters.
+
+    uint64_t     peq   [256];
+    uint32_t     peq_32[256];
+
+    // Number of each distinct character in the query (0xFF if it is not in the query), and the
+    // number of the character at each query position, used by the Jaro-Winkler batch kernel.
+
+    unsigned char char_num [256];
+    unsigned char query_num[64];
+    unsigned int  num_chars;
+
+    double       jaro_winkler_1 (const char* cand, unsigned int cand_len) const;
+    void         jaro_winkler_n (const std::string* const* cands, unsigned int num_cands,
+                                 double* scores) const;
+    unsigned int levenshtein_1  (const char* cand, unsigned int cand_len, unsigned int max_dist) const;
+    void         levenshtein_n  (const std::string* const* cands, unsigned int num_cands,
+                                 unsigned int max_dist, unsigned int* distances) const;
+};
+
+#endif
@@ -0,0 +1,418 @@
+///
+/// \class gde_trace gde_trace.h
+///
+/// \brief Records timed spans, and writes them in the Chrome trace-event format
+///
+/// A gde_trace_span placed at the start of a block records the time spent in that block. The
+/// spans are written with save() as a JSON file in the Chrome trace-event format, which can be
+/// opened in chrome://tracing or https://ui.perfetto.dev to see where the time went: in the
+/// database server, in copying results, or in filling in the display.
+///
+/// Each thread records its spans in its own buffer, so recording a span takes no lock. A buffer
+/// holds the most recent BUFFER_SIZE spans of its thread; older spans are overwritten. The
+/// buffers of threads that have ended are kept (up to MAX_FINISHED_THREADS of them), so the
+/// spans of worker threads can be seen after the work is done.
+///
+/// Recording is on by default. It costs two clock readings per span.
+///
+
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "gde_trace.h"
+
+
+const size_t gde_trace::BUFFER_SIZE;
+const size_t gde_trace::MAX_FINISHED_THREADS;
+
+
+// One recorded span. The fields are atomic only so that save() can read a buffer while its
+// thread is writing to it; relaxed atomic loads and stores cost no more than plain ones.
+
+struct trace_event
+{
+    std::atomic<const char*> name;
+    std::atomic<const char*> category;
+    std::atomic<long long>   start_ns;
+    std::atomic<long long>   end_ns;
+};
+
+// The spans recorded by one thread. Only that thread writes to the buffer. Event number n is in
+// slot n % BUFFER_SIZE, and is valid once num_written is greater than n.
+
+struct trace_buffer
+{
+    int                      tid = 0;
+    std::atomic<const char*> thread_name {nullptr};
+    std::atomic<bool>        finished    {false};
+    std::atomic<size_t>      num_written {0};
+    std::atomic<size_t>      first_valid {0};
+    trace_event              events[gde_trace::BUFFER_SIZE];
+};
+
+// A copy of one span, taken when the trace is written.
+
+struct trace_copy
+{
+    const char* name;
+    const char* category;
+    long long   start_ns;
+    long long   end_ns;
+};
+
+// Marks the buffer of a thread as finished when the thread ends.
+
+struct trace_buffer_holder
+{
+    std::shared_ptr<trace_buffer> buffer;
+
+    ~trace_buffer_holder()
+    {
+        if (buffer)
+            buffer->finished = true;
+    }
+};
+
+static std::atomic<bool>                          trace_enabled {true};
+static std::mutex                                 registry_mutex;
+static std::vector<std::shared_ptr<trace_buffer>> registry;
+static int                                        next_tid = 1;
+static thread_local trace_buffer_holder           this_thread;
+
+
+
+// Get the buffer of the calling thread, creating it on first use.
+
+static trace_buffer& thread_buffer()
+{
+    if (!this_thread.buffer)
+    {
+        std::shared_ptr<trace_buffer> buffer = std::make_shared<trace_buffer>();
+
+        std::lock_guard<std::mutex> lock(registry_mutex);
+
+        buffer->tid = next_tid++;
+
+        // Drop the oldest buffers of threads that have ended, if there are too many.
+
+        size_t num_finished = std::count_if(registry.begin(), registry.end(),
+                                            [] (const std::shared_ptr<trace_buffer>& b) { return b->finished.load(); });
+        for (auto it = registry.begin(); it != registry.end() && num_finished >= gde_trace::MAX_FINISHED_THREADS; )
+        {
+            if ((*it)->finished)
+            {
+                it = registry.erase(it);
+                num_finished--;
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        registry.push_back(buffer);
+        this_thread.buffer = buffer;
+    }
+    return *this_thread.buffer;
+}
+
+
+
+// Copy the valid events of one buffer. Events that the thread may have overwritten while they
+// were being copied are dropped.
+
+static void copy_events(trace_buffer& buffer, std::vector<trace_copy>& events)
+{
+    size_t before = buffer.num_written.load(std::memory_order_acquire);
+    size_t first  = std::max(buffer.first_valid.load(), (before > gde_trace::BUFFER_SIZE) ? before - gde_trace::BUFFER_SIZE : 0);
+
+    std::vector<trace_copy> copied;
+    copied.reserve(before - std::min(first, before));
+    for (size_t n = first; n < before; n++)
+    {
+        trace_event& e = buffer.events[n % gde_trace::BUFFER_SIZE];
+        copied.push_back({ e.name.load(std::memory_order_relaxed), e.category.load(std::memory_order_relaxed),
+                           e.start_ns.load(std::memory_order_relaxed), e.end_ns.load(std::memory_order_relaxed) });
+    }
+
+    // The thread may be writing event number "after" right now, which is in the same slot as
+    // event number after - BUFFER_SIZE.
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    size_t after      = buffer.num_written.load(std::memory_order_relaxed);
+    size_t safe_first = (after + 1 > gde_trace::BUFFER_SIZE) ? after + 1 - gde_trace::BUFFER_SIZE : 0;
+
+    for (size_t n = first; n < before; n++)
+    {
+        if (n >= safe_first)
+            events.push_back(copied[n - first]);
+    }
+}
+
+
+
+// Append a string to JSON output, with the characters that need it escaped.
+
+static void append_json_string(std::string& out, const char* str)
+{
+    out += '"';
+    for (const char* p = (str != nullptr) ? str : ""; *p != '\0'; p++)
+    {
+        unsigned char c = *p;
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+            out += (char)c;
+        }
+        else if (c < 0x20)
+        {
+            char escape[8];
+            snprintf(escape, sizeof(escape), "\\u%04x", c);
+            out += escape;
+        }
+        else
+        {
+            out += (char)c;
+        }
+    }
+    out += '"';
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Turn the recording of spans on or off
+///
+/// \param[in]  enabled   true to record spans
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_trace::set_enabled(bool enabled)
+{
+    trace_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Check whether spans are being recorded
+///
+/// \return     true if spans are being recorded
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool gde_trace::enabled()
+{
+    return trace_enabled.load(std::memory_order_relaxed);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Name the calling thread in the trace
+///
+/// Threads that are not named are shown by number.
+///
+/// \param[in]  name   thread name, which must be a string literal
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_trace::set_thread_name(const char* name)
+{
+    thread_buffer().thread_name = name;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Record a span on the calling thread
+///
+/// This is normally called by gde_trace_span.
+///
+/// \param[in]  name       span name, which must be a string literal
+/// \param[in]  category   span category, which must be a string literal
+/// \param[in]  start_ns   start time, from now_ns()
+/// \param[in]  end_ns     end time, from now_ns()
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_trace::add_span(const char* name, const char* category, long long start_ns, long long end_ns)
+{
+    trace_buffer& buffer = thread_buffer();
+
+    size_t       n = buffer.num_written.load(std::memory_order_relaxed);
+    trace_event& e = buffer.events[n % BUFFER_SIZE];
+
+    e.name.store(name, std::memory_order_relaxed);
+    e.category.store(category, std::memory_order_relaxed);
+    e.start_ns.store(start_ns, std::memory_order_relaxed);
+    e.end_ns.store(end_ns, std::memory_order_relaxed);
+
+    buffer.num_written.store(n + 1, std::memory_order_release);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the current time
+///
+/// \return     nanoseconds since the first call
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+long long gde_trace::now_ns()
+{
+    static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the number of spans held
+///
+/// \return     number of spans that would be written by save()
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t gde_trace::num_events()
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    size_t count = 0;
+    for (const std::shared_ptr<trace_buffer>& buffer : registry)
+    {
+        size_t written = buffer->num_written.load(std::memory_order_acquire);
+        size_t first   = buffer->first_valid.load();
+        count += std::min(written - std::min(first, written), BUFFER_SIZE);
+    }
+    return count;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Drop all of the spans recorded so far
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_trace::clear()
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    registry.erase(std::remove_if(registry.begin(), registry.end(),
+                                  [] (const std::shared_ptr<trace_buffer>& b) { return b->finished.load(); }),
+                   registry.end());
+
+    for (const std::shared_ptr<trace_buffer>& buffer : registry)
+        buffer->first_valid = buffer->num_written.load(std::memory_order_acquire);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Format the spans as Chrome trace-event JSON
+///
+/// \return     JSON text
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string gde_trace::to_json()
+{
+    std::vector<std::shared_ptr<trace_buffer>> buffers;
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        buffers = registry;
+    }
+
+    std::string             out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    std::vector<trace_copy> events;
+    char                    number[100];
+    bool                    first = true;
+
+    for (const std::shared_ptr<trace_buffer>& buffer : buffers)
+    {
+        // Name the thread.
+
+        if (!first)
+            out += ",";
+        first = false;
+
+        snprintf(number, sizeof(number), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":",
+                 buffer->tid);
+        out += number;
+        const char* thread_name = buffer->thread_name.load();
+        if (thread_name != nullptr)
+        {
+            append_json_string(out, thread_name);
+        }
+        else
+        {
+            snprintf(number, sizeof(number), "\"thread %d\"", buffer->tid);
+            out += number;
+        }
+        out += "}}";
+
+        // Write the spans as complete ("X") events, with times in microseconds.
+
+        events.clear();
+        copy_events(*buffer, events);
+
+        for (const trace_copy& e : events)
+        {
+            out += ",\n{\"name\":";
+            append_json_string(out, e.name);
+            out += ",\"cat\":";
+            append_json_string(out, e.category);
+            snprintf(number, sizeof(number), ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                     buffer->tid, e.start_ns / 1000.0, (e.end_ns - e.start_ns) / 1000.0);
+            out += number;
+        }
+    }
+
+    out += "]}\n";
+    return out;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Write the spans to a file
+///
+/// \param[in]  file_name   name of the file, which is replaced if it exists
+///
+/// \exception std::runtime_error thrown if the file cannot be written
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gde_trace::save(const std::string& file_name)
+{
+    std::string json = to_json();
+
+    FILE* file = fopen(file_name.c_str(), "w");
+    if (file == nullptr)
+        throw std::runtime_error("Cannot open trace file " + file_name);
+
+    bool ok = (fwrite(json.data(), 1, json.size(), file) == json.size());
+    if (fclose(file) != 0)
+        ok = false;
+    if (!ok)
+        throw std::runtime_error("Error writing trace file " + file_name);
+}
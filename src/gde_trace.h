@@ -0,0 +1,62 @@
+///
+/// \file
+///
+
+#ifndef GDE_TRACE_H
+#define GDE_TRACE_H
+
+#include <cstddef>
+#include <string>
+
+
+class gde_trace
+{
+public:
+    static void        set_enabled     (bool enabled);
+    static bool        enabled         ();
+    static void        set_thread_name (const char* name);
+
+    static void        add_span        (const char* name, const char* category,
+                                        long long start_ns, long long end_ns);
+    static long long   now_ns          ();
+
+    static size_t      num_events      ();
+    static void        clear           ();
+    static std::string to_json         ();
+    static void        save            (const std::string& file_name);
+
+    static const size_t BUFFER_SIZE          = 8192;   // events kept for each thread
+    static const size_t MAX_FINISHED_THREADS = 64;     // threads whose events are kept after they end
+};
+
+
+
+///
+/// \brief Records the time from its construction to its destruction as a trace span
+///
+/// The name and category must be string literals (or otherwise outlive the trace), since only
+/// the pointers are kept.
+///
+
+class gde_trace_span
+{
+public:
+    gde_trace_span (const char* name, const char* category = "gde") :
+        my_name(name), my_category(category), start_ns(gde_trace::enabled() ? gde_trace::now_ns() : -1) {}
+
+    ~gde_trace_span ()
+    {
+        if (start_ns >= 0)
+            gde_trace::add_span(my_name, my_category, start_ns, gde_trace::now_ns());
+    }
+
+    gde_trace_span (const gde_trace_span&) = delete;
+    gde_trace_span& operator= (const gde_trace_span&) = delete;
+
+private:
+    const char* my_name;
+    const char* my_category;
+    long long   start_ns;
+};
+
+#endif
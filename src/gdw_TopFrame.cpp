@@ -19,13 +19,18 @@
 #include <wx/artprov.h>
 
 #include "database.h"
+#include "db_query_stats.h"
 #include "db_map.h"
 #include "gdw_TopFrame.h"
 #include "gdw_edit.h"
+#include "gdw_navigator.h"
+#include "gdw_perf.h"
 #include "gdw_search.h"
 #include "gdw_dialog.h"
 #include "gdw_show_src_info.h"
 #include "gdw_db_ops.h"
+#include "gde_change_tracker.h"
+#include "gde_trace.h"
 
 
 
@@ -47,6 +52,18 @@ TopFrame::TopFrame(const wxString& title, const wxPoint& pos, const wxSize& size
 
     wxLog::SetLogLevel(wxLOG_Warning);
 
+    // Name this thread in trace files.
+
+    gde_trace::set_thread_name("GUI");
+
+    // Log the SQL of any query that takes longer than the slow-query threshold. Queries can be
+    // sent from worker threads, which wxLog allows.
+
+    db_query_stats::shared().set_slow_query_handler([] (const db_query_timing& timing)
+    {
+        wxLogMessage("Slow query (%.1f ms, %lu rows): %s", timing.total_ms, timing.rows, timing.query.c_str());
+    });
+
   //****************************************************************************
   // Bind the event handler to the IDs used in this class.
   //****************************************************************************
@@ -80,15 +97,20 @@ TopFrame::TopFrame(const wxString& title, const wxPoint& pos, const wxSize& size
   wxMenu *menuTools = new wxMenu;
   menuBar->Append(menuTools, "&Tools");
   menuTools->Append(ID_Edit, "&Edit");
+  menuTools->Append(ID_Navigator, "Edit NS &Records");
   menuTools->Append(ID_ShowSourceInfo, "Show Source Info");
   menuTools->Append(ID_Search, "Search");
   menuTools->Append(ID_DatabaseOps, "Database Operations");
+  menuTools->AppendSeparator();
+  menuTools->Append(ID_PerfDashboard, "&Performance Dashboard");
+  menuTools->Append(ID_SaveTrace, "Save &Trace...");
 
   // Help Menu
 
   wxMenu *menuHelp = new wxMenu;
   menuBar->Append(menuHelp, "&Help");
   menuHelp->Append(ID_ShowLogWin, "Show Log Window");
+  menuHelp->Append(ID_QueryStats, "Show Query Statistics");
   menuHelp->Append(wxID_ABOUT);
 
   // Make the menu bar visible.
@@ -163,6 +185,12 @@ void TopFrame::event_handler (wxCommandEvent& event)
                 try
                 {
                     gendat_sources.load_defs(gendat_db, "z_sour", "z_sour_field");
+
+                    // Record all edits in the change journal, if this database has one.
+
+                    gde_change_tracker change_tracker;
+                    if (change_tracker.journal_exists(gendat_db))
+                        gendat_db.set_change_journal(change_tracker.journal_table());
                 }
                 catch (std::runtime_error& exception)
                 {
@@ -205,6 +233,10 @@ void TopFrame::event_handler (wxCommandEvent& event)
       notebook->AddPage(new gdw_edit(notebook, &gendat_db), L"Edit", true);
       break;
 
+    case ID_Navigator:
+      notebook->AddPage(new gdw_navigator(notebook, &gendat_db), L"NS Records", true);
+      break;
+
     case ID_ShowSourceInfo:
       notebook->AddPage(new gdw_show_src_info(notebook, &gendat_db, gendat_sources), L"GenDat Source Info", true);
       break;
@@ -217,6 +249,32 @@ void TopFrame::event_handler (wxCommandEvent& event)
         notebook->AddPage(new gdw_db_ops(notebook, &gendat_db), L"Database Ops", true);
         break;
 
+    case ID_PerfDashboard:
+        notebook->AddPage(new gdw_perf(notebook, notebook), L"Performance", true);
+        break;
+
+
+    case ID_SaveTrace:
+        {
+            // Save the timeline of recent panel draws and queries, for viewing in
+            // chrome://tracing or ui.perfetto.dev.
+
+            wxFileDialog save_dialog(this, "Save trace", "", "gendat_trace.json", "JSON files (*.json)|*.json",
+                                     wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+            if (save_dialog.ShowModal() == wxID_OK)
+            {
+                try
+                {
+                    gde_trace::save(save_dialog.GetPath().ToStdString());
+                    SetStatusText(wxString::Format("Saved %lu trace events", (unsigned long)gde_trace::num_events()));
+                }
+                catch (std::runtime_error& exception)
+                {
+                    wxMessageBox(exception.what(), "Save Trace", wxOK | wxICON_ERROR);
+                }
+            }
+        }
+        break;
 
     case ID_ShowLogWin:
 
@@ -226,6 +284,13 @@ void TopFrame::event_handler (wxCommandEvent& event)
         new wxLogWindow(this, wxS("Log messages"), true, false);
         break;
 
+    case ID_QueryStats:
+
+        // Show the time spent on each kind of query since the program started.
+
+        wxMessageBox(db_query_stats::shared().report(), "Query Statistics", wxOK | wxICON_INFORMATION);
+        break;
+
     case wxID_ABOUT:
 
       // Show the "About" page.
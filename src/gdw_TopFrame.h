@@ -38,8 +38,12 @@ private:
       ID_DatabaseOps,
       ID_Edit,
       ID_Search,
+      ID_Navigator,
+      ID_QueryStats,
+      ID_SaveTrace,
+      ID_PerfDashboard,
       ID_first = ID_Connect,
-      ID_last  = ID_Search
+      ID_last  = ID_PerfDashboard
     };
 
   wxPanel            *top_panel;
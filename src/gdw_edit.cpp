@@ -23,7 +23,7 @@
 
 */
 
-gdw_edit::gdw_edit(wxWindow* parent, database* db) : gdw_panel(parent)
+gdw_edit::gdw_edit(wxWindow* parent, database* db) : gdw_panel(parent), view(row_set)
 {
         my_db             = db;
         unsaved_data_flag = false;
@@ -32,6 +32,10 @@ gdw_edit::gdw_edit(wxWindow* parent, database* db) : gdw_panel(parent)
 
         row_set.set_null_subst_on();
 
+        // Store columns with few distinct values (county, sex, religion, ...) only once.
+
+        row_set.set_dict_encoding(true);
+
         // Get 2 unique event identifiers and bind them to the event handler.
 
         id_mgr.reserve(2);
@@ -40,6 +44,7 @@ gdw_edit::gdw_edit(wxWindow* parent, database* db) : gdw_panel(parent)
         id_save_event = id_mgr.alloc_id();
 
         Bind (wxEVT_GRID_CELL_CHANGED, &gdw_edit::event_handler, this , id_grid_event);
+        Bind (wxEVT_GRID_LABEL_LEFT_CLICK, &gdw_edit::event_handler, this , id_grid_event);
 
         wxLogMessage("gdw_edit Constructor: %d:%d", id_mgr.first_id(), id_mgr.last_id());
 }
@@ -63,9 +68,13 @@ void gdw_edit::process_window_draw()
 
         my_db->execute(query, row_set);
 
+        // Show the rows in the order last chosen by clicking the column labels.
+
+        view.refresh();
+
         // Get the number of rows and columns in the row set.
 
-        num_rows = row_set.num_rows();
+        num_rows = view.num_rows();
         num_cols = row_set.num_cols();
 
         // Create a sizer to hold the data table.
@@ -93,7 +102,7 @@ void gdw_edit::process_window_draw()
 
                 for (unsigned int row = 0; row < num_rows; row++)
                 {
-                        if (row_set.get_data(row, col, data))
+                        if (row_set.get_data(view.row(row), col, data))
                         {
                                 grid->SetCellValue(row, col, data);
                         }
@@ -122,7 +131,16 @@ void gdw_edit::process_window_events (wxEvent* event)
         wxLogMessage("process_window_events: %d", event_id);
 
 
-        if (event_id == id_grid_event)
+        if (event_id == id_grid_event && event->GetEventType() == wxEVT_GRID_LABEL_LEFT_CLICK)
+        {
+                // A click on a column label sorts by that column. A shift-click adds the column
+                // as another sort key.
+
+                wxGridEvent* grid_event = (wxGridEvent*)event;
+                if (grid_event->GetRow() < 0 && grid_event->GetCol() >= 0)
+                        sort_by_column(grid_event->GetCol(), grid_event->ShiftDown());
+        }
+        else if (event_id == id_grid_event)
         {
 
                 wxGridEvent* grid_event = (wxGridEvent*)event;
@@ -133,7 +151,7 @@ void gdw_edit::process_window_events (wxEvent* event)
                 std::string error_msg;
 
                 data = grid->GetCellValue(row, col);
-                if (row_set.save_data(row, col, data, error_msg))
+                if (row_set.save_data(view.row(row), col, data, error_msg))
                 {
                         grid->SetCellBackgroundColour(row, col, *wxYELLOW);
                         unsaved_data_flag = true;
@@ -154,12 +172,90 @@ void gdw_edit::process_window_events (wxEvent* event)
 }
 
 
+/*
+
+  Sort the grid rows by a column. Clicking the first sort column again reverses its order.
+
+  The rows are sorted by the values loaded from the database, without another query. The cells
+  are moved with their rows, so that changes not yet saved (and their colours) stay with them.
+
+*/
+
+void gdw_edit::sort_by_column(unsigned int col, bool add_key)
+{
+        std::vector<db_sort_key> keys = view.sort_keys();
+
+        if (add_key)
+        {
+                bool found = false;
+                for (db_sort_key& key : keys)
+                {
+                        if (key.col == col)
+                        {
+                                key.descending = !key.descending;
+                                found          = true;
+                        }
+                }
+                if (!found)
+                        keys.push_back(db_sort_key(col));
+        }
+        else
+        {
+                bool descending = (!keys.empty() && keys[0].col == col && !keys[0].descending);
+                keys.assign(1, db_sort_key(col, descending));
+        }
+
+        // Save the cells of each row, by row set row number.
+
+        unsigned int num_rows = view.num_rows();
+        unsigned int num_cols = row_set.num_cols();
+
+        std::vector<std::vector<wxString>> values(row_set.num_rows());
+        std::vector<std::vector<wxColour>> colours(row_set.num_rows());
+
+        for (unsigned int row = 0; row < num_rows; row++)
+        {
+                unsigned int set_row = view.row(row);
+                for (unsigned int c = 0; c < num_cols; c++)
+                {
+                        values[set_row].push_back(grid->GetCellValue(row, c));
+                        colours[set_row].push_back(grid->GetCellBackgroundColour(row, c));
+                }
+        }
+
+        // Sort, and put the cells back in the new order.
+
+        view.sort(keys);
+
+        grid->BeginBatch();
+        for (unsigned int row = 0; row < num_rows; row++)
+        {
+                unsigned int set_row = view.row(row);
+                for (unsigned int c = 0; c < num_cols; c++)
+                {
+                        grid->SetCellValue(row, c, values[set_row][c]);
+                        grid->SetCellBackgroundColour(row, c, colours[set_row][c]);
+                }
+        }
+        grid->EndBatch();
+
+        grid->SetSortingColumn(keys[0].col, !keys[0].descending);
+}
+
+
 bool gdw_edit::has_unsaved_data()
 {
         return unsaved_data_flag;
 }
 
 
+void gdw_edit::process_page_stats(gdw_page_stats& stats)
+{
+        stats.memory_bytes   = row_set.memory_used();
+        stats.pending_writes = row_set.num_pending_writes();
+}
+
+
 void gdw_edit::process_execute()
 {
         // Save any data changes in the database.
@@ -15,8 +15,11 @@
 
 #include <wx/grid.h>
 
+#include <vector>
+
 #include "database.h"
 #include "db_row_set_w.h"
+#include "db_row_view.h"
 #include "gdw_panel.h"
 #include "id_manager.h"
 
@@ -31,11 +34,14 @@ private:
         void process_window_draw ();
         void process_execute     ();
         bool has_unsaved_data    ();
+        void process_page_stats  (gdw_page_stats& stats);
         
         void process_window_events (wxEvent* event);
+        void sort_by_column        (unsigned int col, bool add_key);
 
         database*    my_db;
         db_row_set_w row_set;
+        db_row_view  view;             // order of the rows in the grid
         wxGrid*      grid;
         bool         unsaved_data_flag;
 
@@ -0,0 +1,435 @@
+///
+/// \class gdw_navigator gdw_navigator.h
+///
+/// \brief Provides single-record editing of the Nova Scotia vital statistics tables.
+///
+/// This class shows one record of the NS births, marriages or deaths table at a time, with
+/// buttons to step to the first, previous, next or last record, and a field to jump to a given
+/// key. It replaces the PHP edit pages, which send a `get_next_valid_key()` query for each
+/// step. The keys are loaded once, and the records near the current one are fetched ahead of
+/// time by a gde_record_cache, so stepping through the records does not wait for the database
+/// server.
+///
+/// Changed fields are written to the database (and the change journal) when the user moves to
+/// another record, or selects "Execute".
+///
+
+#include <wx/wxprec.h>
+
+#ifndef WX_PRECOMP
+#include <wx/wx.h>
+#endif
+
+#include <string>
+
+#include "gdw_navigator.h"
+
+
+// Tables that can be edited, with their primary keys.
+
+static const struct
+{
+    const char* label;
+    const char* table;
+    const char* key_field;
+}
+nav_tables[] =
+{
+    { "NS Births",    "ns_births_data",    "BirthID"    },
+    { "NS Marriages", "ns_marriages_data", "MarriageID" },
+    { "NS Deaths",    "ns_deaths_data",    "Deathid"    }
+};
+
+static const int NUM_NAV_TABLES = sizeof(nav_tables) / sizeof(nav_tables[0]);
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Constructor
+///
+/// \param [in]   parent        pointer to the parent window
+/// \param [in]   db            pointer to database connection object
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gdw_navigator::gdw_navigator(wxWindow* parent, database* db) : gdw_panel(parent)
+{
+    wxLogMessage("gdw_navigator Constructor: Start");
+
+    my_db             = db;
+    table_num         = 0;
+    current_pos       = 0;
+    unsaved_data_flag = false;
+
+    table_choice  = nullptr;
+    key_text      = nullptr;
+    position_text = nullptr;
+    grid          = nullptr;
+
+    // Enable SQL NULL substitution.
+
+    edit_set.set_null_subst_on();
+
+    // Get unique event identifiers and bind them to the event handler.
+
+    id_mgr.reserve(7);
+
+    id_table_event = id_mgr.alloc_id();
+    id_first_event = id_mgr.alloc_id();
+    id_prev_event  = id_mgr.alloc_id();
+    id_next_event  = id_mgr.alloc_id();
+    id_last_event  = id_mgr.alloc_id();
+    id_key_event   = id_mgr.alloc_id();
+    id_grid_event  = id_mgr.alloc_id();
+
+    Bind (wxEVT_CHOICE,            &gdw_navigator::event_handler, this, id_table_event);
+    Bind (wxEVT_BUTTON,            &gdw_navigator::event_handler, this, id_first_event, id_last_event);
+    Bind (wxEVT_TEXT_ENTER,        &gdw_navigator::event_handler, this, id_key_event);
+    Bind (wxEVT_GRID_CELL_CHANGED, &gdw_navigator::event_handler, this, id_grid_event);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Destructor
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gdw_navigator::~gdw_navigator()
+{
+    wxLogMessage("gdw_navigator Destructor: Start");
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Draw the page
+///
+/// This member function creates the controls, and then loads the keys of the selected table
+/// and shows its first record.
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gdw_navigator::process_window_draw()
+{
+    wxLogMessage("gdw_navigator::process_window_draw");
+
+    // Create the row of navigation controls.
+
+    wxBoxSizer* nav_sizer = new wxBoxSizer(wxHORIZONTAL);
+
+    wxArrayString table_labels;
+    for (int i = 0; i < NUM_NAV_TABLES; i++)
+        table_labels.Add(nav_tables[i].label);
+
+    table_choice = new wxChoice(this, id_table_event, wxDefaultPosition, wxDefaultSize, table_labels);
+    table_choice->SetSelection(table_num);
+
+    nav_sizer->Add(table_choice, 0, wxALL, 5);
+    nav_sizer->Add(new wxButton(this, id_first_event, "|<", wxDefaultPosition, wxSize(40, -1)), 0, wxALL, 5);
+    nav_sizer->Add(new wxButton(this, id_prev_event,  "<",  wxDefaultPosition, wxSize(40, -1)), 0, wxALL, 5);
+    nav_sizer->Add(new wxButton(this, id_next_event,  ">",  wxDefaultPosition, wxSize(40, -1)), 0, wxALL, 5);
+    nav_sizer->Add(new wxButton(this, id_last_event,  ">|", wxDefaultPosition, wxSize(40, -1)), 0, wxALL, 5);
+
+    nav_sizer->Add(new wxStaticText(this, wxID_ANY, "Key:"), 0, wxALL | wxALIGN_CENTER_VERTICAL, 5);
+    key_text = new wxTextCtrl(this, id_key_event, "", wxDefaultPosition, wxSize(100, -1), wxTE_PROCESS_ENTER);
+    nav_sizer->Add(key_text, 0, wxALL, 5);
+
+    position_text = new wxStaticText(this, wxID_ANY, "");
+    nav_sizer->Add(position_text, 0, wxALL | wxALIGN_CENTER_VERTICAL, 5);
+
+    // Create the record display table, with one row for each field.
+
+    grid = new wxGrid(this, id_grid_event);
+    grid->CreateGrid(0, 1);
+    grid->SetColLabelValue(0, "Value");
+    grid->SetRowLabelSize(200);
+    grid->SetColSize(0, 400);
+
+    // Finish the panel.
+
+    wxBoxSizer* sizer = new wxBoxSizer(wxVERTICAL);
+    sizer->Add(nav_sizer, 0, wxEXPAND);
+    sizer->Add(grid, 1, wxEXPAND);
+    this->SetSizer(sizer);
+
+    open_table(table_num);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Save changes
+///
+/// This member function writes any changes to the current record to the database.
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gdw_navigator::process_execute()
+{
+    save_record();
+    if (cache && cache->num_keys() != 0)
+        show_record(current_pos);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Determine if page has unsaved data
+///
+/// \return   true if the page contains unsaved data, false otherwise
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool gdw_navigator::has_unsaved_data()
+{
+    return unsaved_data_flag;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Report the resource use of the page
+///
+/// \param [in,out]  stats   resource use of the page
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gdw_navigator::process_page_stats(gdw_page_stats& stats)
+{
+    stats.memory_bytes   = edit_set.memory_used();
+    stats.pending_writes = edit_set.num_pending_writes();
+
+    if (cache)
+    {
+        stats.memory_bytes += cache->memory_used();
+        stats.has_cache     = true;
+        stats.cache_hits    = cache->num_hits();
+        stats.cache_misses  = cache->num_misses();
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Process window events
+///
+/// \param [in]   event   the wxWidgets event
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gdw_navigator::process_window_events (wxEvent* event)
+{
+    unsigned int event_id = event->GetId();
+
+    wxLogMessage("gdw_navigator::process_window_events: %d", event_id);
+
+    if (event_id == id_table_event)
+    {
+        save_record();
+        open_table(table_choice->GetSelection());
+        return;
+    }
+
+    if (event_id == id_grid_event)
+    {
+        wxGridEvent* grid_event = (wxGridEvent*)event;
+        int row = grid_event->GetRow();
+
+        // Read the record into the edit row set the first time one of its fields is changed.
+
+        if (edit_key != record.key)
+        {
+            my_db->execute("SELECT * FROM " + std::string(nav_tables[table_num].table) + " WHERE " +
+                           nav_tables[table_num].key_field + "='" + my_db->escape_str(record.key) + "'",
+                           edit_set);
+            if (edit_set.num_rows() != 1)
+                throw std::runtime_error("Record " + record.key + " is no longer in the database");
+            edit_key = record.key;
+        }
+
+        std::string data = grid->GetCellValue(row, 0).ToStdString();
+        std::string error_msg;
+
+        if (edit_set.save_data(0, row, data, error_msg))
+        {
+            grid->SetCellBackgroundColour(row, 0, *wxYELLOW);
+            unsaved_data_flag = true;
+        }
+        else
+        {
+            wxLogMessage(error_msg.c_str());
+            grid->SetCellValue(row, 0, grid_event->GetString());
+        }
+        return;
+    }
+
+    if (!cache || cache->num_keys() == 0)
+        return;
+
+    size_t pos = current_pos;
+
+    if (event_id == id_first_event)
+        pos = 0;
+    else if (event_id == id_prev_event && pos > 0)
+        pos--;
+    else if (event_id == id_next_event && pos + 1 < cache->num_keys())
+        pos++;
+    else if (event_id == id_last_event)
+        pos = cache->num_keys() - 1;
+    else if (event_id == id_key_event)
+    {
+        std::string key = key_text->GetValue().ToStdString();
+        if (!cache->find_key(key, pos))
+        {
+            position_text->SetLabel("Record " + key + " not found");
+            return;
+        }
+    }
+
+    save_record();
+    show_record(pos);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Load the keys of one of the tables, start fetching its records in the background, and show
+// the first record.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gdw_navigator::open_table(int table)
+{
+    if (table < 0 || table >= NUM_NAV_TABLES)
+        return;
+
+    table_num   = table;
+    current_pos = 0;
+    edit_key.clear();
+
+    cache.reset(new gde_record_cache(nav_tables[table].table, nav_tables[table].key_field));
+    cache->load_keys(*my_db);
+
+    // The prefetch thread needs its own connection. If it cannot be opened, the records are
+    // fetched on this connection when the program is idle instead.
+
+    try
+    {
+        cache->start_prefetch(*my_db);
+    }
+    catch (std::runtime_error& exception)
+    {
+        wxLogMessage("gdw_navigator: no prefetch connection: %s", exception.what());
+    }
+
+    if (cache->num_keys() == 0)
+    {
+        if (grid->GetNumberRows() > 0)
+            grid->DeleteRows(0, grid->GetNumberRows());
+        position_text->SetLabel("No records");
+        return;
+    }
+
+    show_record(0);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Show the record at a position in the key list of the current table.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gdw_navigator::show_record(size_t pos)
+{
+    cache->get_record(*my_db, pos, record);
+    current_pos = pos;
+
+    unsigned int num_cols = cache->num_cols();
+    int          num_rows = grid->GetNumberRows();
+
+    if (num_rows < (int)num_cols)
+        grid->AppendRows(num_cols - num_rows);
+    else if (num_rows > (int)num_cols)
+        grid->DeleteRows(num_cols, num_rows - num_cols);
+
+    for (unsigned int col = 0; col < num_cols; col++)
+    {
+        grid->SetRowLabelValue(col, cache->col_name(col));
+        if (record.is_null[col])
+        {
+            grid->SetCellValue(col, 0, "(NULL)");
+            grid->SetCellBackgroundColour(col, 0, *wxCYAN);
+        }
+        else
+        {
+            grid->SetCellValue(col, 0, record.values[col]);
+            grid->SetCellBackgroundColour(col, 0, *wxWHITE);
+        }
+    }
+    grid->ForceRefresh();
+
+    key_text->ChangeValue(record.key);
+    position_text->SetLabel(wxString::Format("Record %lu of %lu", (unsigned long)pos + 1,
+                                             (unsigned long)cache->num_keys()));
+
+    if (!cache->prefetch_running())
+    {
+        if (!cache->prefetch_error().empty())
+            wxLogMessage("gdw_navigator: prefetch stopped: %s", cache->prefetch_error().c_str());
+        CallAfter(&gdw_navigator::idle_prefetch);
+    }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Write any changes to the current record, and drop the old copy from the cache.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gdw_navigator::save_record()
+{
+    if (!unsaved_data_flag)
+        return;
+
+    edit_set.write_to_db(*my_db);
+    cache->invalidate(edit_key);
+
+    edit_key.clear();
+    unsaved_data_flag = false;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Fetch the records beyond the current one on the main connection. This is only used when the
+// prefetch thread is not running, and is queued with CallAfter() so that it runs once the
+// current record has been shown.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gdw_navigator::idle_prefetch()
+{
+    try
+    {
+        if (cache)
+            cache->prefetch(*my_db);
+    }
+    catch (std::runtime_error& exception)
+    {
+        wxLogMessage("gdw_navigator: prefetch failed: %s", exception.what());
+    }
+}
@@ -0,0 +1,75 @@
+///
+/// \file
+///
+
+
+
+#ifndef GDW_NAVIGATOR_H
+#define GDW_NAVIGATOR_H
+
+#include <wx/wxprec.h>
+
+#ifndef WX_PRECOMP
+#include <wx/wx.h>
+#endif
+
+#include <wx/grid.h>
+
+#include <memory>
+#include <string>
+
+#include "database.h"
+#include "db_row_set_w.h"
+#include "gde_record_cache.h"
+#include "gdw_panel.h"
+#include "id_manager.h"
+
+class gdw_navigator : public gdw_panel
+{
+public:
+    gdw_navigator (wxWindow* parent, database* db);
+    ~gdw_navigator();
+
+
+private:
+    void process_window_draw ();
+    void process_execute     ();
+    bool has_unsaved_data    ();
+    void process_page_stats  (gdw_page_stats& stats);
+
+    void process_window_events (wxEvent* event);
+
+    void open_table    (int table_num);
+    void show_record   (size_t pos);
+    void save_record   ();
+    void idle_prefetch ();
+
+    database*    my_db;
+    int          table_num;
+    size_t       current_pos;
+    bool         unsaved_data_flag;
+
+    std::unique_ptr<gde_record_cache> cache;
+    gde_record                        record;
+
+    // The record being edited. It is only read from the database once the user changes a field.
+
+    db_row_set_w edit_set;
+    std::string  edit_key;
+
+    wxChoice*     table_choice;
+    wxTextCtrl*   key_text;
+    wxStaticText* position_text;
+    wxGrid*       grid;
+
+    id_manager   id_mgr;
+    unsigned int id_table_event;
+    unsigned int id_first_event;
+    unsigned int id_prev_event;
+    unsigned int id_next_event;
+    unsigned int id_last_event;
+    unsigned int id_key_event;
+    unsigned int id_grid_event;
+};
+
+#endif
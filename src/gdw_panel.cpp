@@ -12,9 +12,10 @@
 /// - process_execute
 /// - process_window_events
 ///
-/// If required, some derived classes may also need to override the following virtual function:
+/// If required, some derived classes may also need to override the following virtual functions:
 ///
 /// - has_unsaved_data
+/// - process_page_stats
 ///
 
 #include <wx/wxprec.h>
@@ -24,6 +25,7 @@
 #endif
 
 #include "gdw_panel.h"
+#include "gde_trace.h"
 
 
 
@@ -56,6 +58,8 @@ gdw_panel::gdw_panel(wxWindow *parent) : wxPanel(parent)
 
 void gdw_panel::delayed_start()
 {
+    gde_trace_span span("gdw_panel::delayed_start", "wx");
+
     try
     {
         process_window_draw();
@@ -85,6 +89,8 @@ void gdw_panel::page_reload()
 {
     if (ok_to_delete())
     {
+        gde_trace_span span("gdw_panel::page_reload", "wx");
+
         // Clear the main data display panel.
 
         DestroyChildren();
@@ -120,6 +126,8 @@ void gdw_panel::page_reload()
 
 void gdw_panel::page_execute()
 {
+    gde_trace_span span("gdw_panel::page_execute", "wx");
+
     try
     {
         process_execute();
@@ -186,6 +194,43 @@ bool gdw_panel::has_unsaved_data()
 
 
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Get the resource use of the page
+///
+/// This member function calls `process_page_stats()` to find the memory, pending writes and
+/// cache counts of the page, for the performance dashboard.
+///
+/// \param [out]  stats   resource use of the page
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gdw_panel::page_stats(gdw_page_stats& stats)
+{
+    stats = gdw_page_stats();
+    process_page_stats(stats);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Report the resource use of the page
+///
+/// \param [in,out]  stats   resource use of the page, which is all zeros on entry
+///
+/// \note
+/// This version of the function leaves the counts at zero. Derived classes that hold row sets
+/// or caches should override it.
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gdw_panel::process_page_stats(gdw_page_stats&)
+{
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 ///
 /// \brief Event handler
@@ -16,6 +16,22 @@
 #include <stdexcept>
 
 
+///
+/// \brief Resource use of one display page, as shown by the performance dashboard
+///
+
+class gdw_page_stats
+{
+public:
+    size_t        memory_bytes   = 0;       ///< approximate memory held by the page's row sets and caches
+    unsigned int  pending_writes = 0;       ///< rows changed on the page but not yet written to the database
+    bool          has_cache      = false;   ///< true if the page reads through a record cache
+    unsigned long cache_hits     = 0;       ///< records found in the cache
+    unsigned long cache_misses   = 0;       ///< records that needed a query
+};
+
+
+
 class gdw_panel : public wxPanel
 {
 public:
@@ -25,6 +41,7 @@ public:
     void page_reload  ();
     void page_execute ();
     bool ok_to_delete ();
+    void page_stats   (gdw_page_stats& stats);
 
 protected:
     void event_handler (wxEvent& event);
@@ -34,6 +51,7 @@ private:
     virtual void process_execute       () = 0;
     virtual void process_window_events (wxEvent* event) = 0;
     virtual bool has_unsaved_data      ();
+    virtual void process_page_stats    (gdw_page_stats& stats);
 
     void delayed_start ();
     void process_runtime_error (std::runtime_error& exception);
@@ -0,0 +1,359 @@
+///
+/// \class gdw_perf gdw_perf.h
+///
+/// \brief Shows live performance counters
+///
+/// This page is refreshed every REFRESH_MS milliseconds from the query statistics kept by
+/// db_query_stats::shared(), and from the other open pages. It shows:
+///
+/// - the query and data rates since the last refresh, and the totals since the counters were reset
+/// - for each open page, the memory held by its row sets and caches, the number of changed rows
+///   not yet written, and the record cache hit rate
+/// - for each query fingerprint, the query rate and the p50, p95 and p99 latencies
+///
+/// Selecting "Execute" resets the query counters, so that the latencies of one task can be seen
+/// on their own.
+///
+
+#include <wx/wxprec.h>
+
+#ifndef WX_PRECOMP
+#include <wx/wx.h>
+#endif
+
+#include <algorithm>
+#include <vector>
+
+#include "db_query_stats.h"
+#include "gdw_perf.h"
+
+
+// Columns of the page table.
+
+enum
+{
+    PAGE_COL_NAME = 0,
+    PAGE_COL_MEMORY,
+    PAGE_COL_PENDING,
+    PAGE_COL_HIT_RATE,
+    NUM_PAGE_COLS
+};
+
+// Columns of the query table.
+
+enum
+{
+    QUERY_COL_COUNT = 0,
+    QUERY_COL_RATE,
+    QUERY_COL_P50,
+    QUERY_COL_P95,
+    QUERY_COL_P99,
+    QUERY_COL_MAX,
+    QUERY_COL_ROWS,
+    QUERY_COL_BYTES,
+    QUERY_COL_FINGERPRINT,
+    NUM_QUERY_COLS
+};
+
+
+
+// Format a number of bytes for display.
+
+static wxString format_bytes(double bytes)
+{
+    if (bytes >= 1024.0 * 1024.0 * 1024.0)
+        return wxString::Format("%.2f GB", bytes / (1024.0 * 1024.0 * 1024.0));
+    else if (bytes >= 1024.0 * 1024.0)
+        return wxString::Format("%.2f MB", bytes / (1024.0 * 1024.0));
+    else if (bytes >= 1024.0)
+        return wxString::Format("%.1f KB", bytes / 1024.0);
+    else
+        return wxString::Format("%.0f B", bytes);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Constructor
+///
+/// \param [in]   parent     pointer to the parent window
+/// \param [in]   notebook   notebook holding the pages to report on
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gdw_perf::gdw_perf(wxWindow* parent, wxNotebook* notebook) : gdw_panel(parent)
+{
+    wxLogMessage("gdw_perf Constructor: Start");
+
+    my_notebook      = notebook;
+    last_time        = std::chrono::steady_clock::now();
+    last_num_queries = db_query_stats::shared().num_queries();
+    last_bytes       = db_query_stats::shared().totals().bytes;
+
+    summary_text = nullptr;
+    page_grid    = nullptr;
+    query_grid   = nullptr;
+
+    // Get a unique event identifier for the refresh timer and bind it to the event handler.
+
+    id_mgr.reserve(1);
+    id_timer_event = id_mgr.alloc_id();
+
+    timer.SetOwner(this, id_timer_event);
+    Bind (wxEVT_TIMER, &gdw_perf::event_handler, this, id_timer_event);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Destructor
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+gdw_perf::~gdw_perf()
+{
+    wxLogMessage("gdw_perf Destructor: Start");
+
+    timer.Stop();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Draw the page
+///
+/// This member function creates the summary line and the two tables, fills them in, and starts
+/// the refresh timer.
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gdw_perf::process_window_draw()
+{
+    wxLogMessage("gdw_perf::process_window_draw");
+
+    summary_text = new wxStaticText(this, wxID_ANY, "");
+
+    // Create the table of open pages.
+
+    page_grid = new wxGrid(this, wxID_ANY);
+    page_grid->CreateGrid(0, NUM_PAGE_COLS);
+    page_grid->EnableEditing(false);
+    page_grid->SetRowLabelSize(0);
+    page_grid->SetColLabelValue(PAGE_COL_NAME,     "Page");
+    page_grid->SetColLabelValue(PAGE_COL_MEMORY,   "Row set memory");
+    page_grid->SetColLabelValue(PAGE_COL_PENDING,  "Pending writes");
+    page_grid->SetColLabelValue(PAGE_COL_HIT_RATE, "Cache hit rate");
+    page_grid->SetColSize(PAGE_COL_NAME, 200);
+    page_grid->SetColSize(PAGE_COL_MEMORY, 120);
+    page_grid->SetColSize(PAGE_COL_PENDING, 120);
+    page_grid->SetColSize(PAGE_COL_HIT_RATE, 200);
+
+    // Create the table of query fingerprints.
+
+    query_grid = new wxGrid(this, wxID_ANY);
+    query_grid->CreateGrid(0, NUM_QUERY_COLS);
+    query_grid->EnableEditing(false);
+    query_grid->SetRowLabelSize(0);
+    query_grid->SetColLabelValue(QUERY_COL_COUNT,       "Count");
+    query_grid->SetColLabelValue(QUERY_COL_RATE,        "Per sec");
+    query_grid->SetColLabelValue(QUERY_COL_P50,         "p50 ms");
+    query_grid->SetColLabelValue(QUERY_COL_P95,         "p95 ms");
+    query_grid->SetColLabelValue(QUERY_COL_P99,         "p99 ms");
+    query_grid->SetColLabelValue(QUERY_COL_MAX,         "Max ms");
+    query_grid->SetColLabelValue(QUERY_COL_ROWS,        "Rows");
+    query_grid->SetColLabelValue(QUERY_COL_BYTES,       "Received");
+    query_grid->SetColLabelValue(QUERY_COL_FINGERPRINT, "Query");
+    query_grid->SetColSize(QUERY_COL_FINGERPRINT, 600);
+
+    // Finish the panel.
+
+    wxBoxSizer* sizer = new wxBoxSizer(wxVERTICAL);
+    sizer->Add(summary_text, 0, wxALL | wxEXPAND, 5);
+    sizer->Add(new wxStaticText(this, wxID_ANY, "Open pages"), 0, wxLEFT | wxTOP, 5);
+    sizer->Add(page_grid, 0, wxALL | wxEXPAND, 5);
+    sizer->Add(new wxStaticText(this, wxID_ANY, "Queries, since the counters were reset"), 0, wxLEFT | wxTOP, 5);
+    sizer->Add(query_grid, 1, wxALL | wxEXPAND, 5);
+    this->SetSizer(sizer);
+
+    refresh();
+    timer.Start(REFRESH_MS);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Reset the query counters
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gdw_perf::process_execute()
+{
+    db_query_stats::shared().reset();
+    last_counts.clear();
+    refresh();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+///
+/// \brief Process window events
+///
+/// \param [in]   event   the wxWidgets event
+///
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gdw_perf::process_window_events(wxEvent* event)
+{
+    if (event->GetId() == (int)id_timer_event && summary_text != nullptr)
+        refresh();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Update the summary line and both tables. The rates are for the time since the previous refresh.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gdw_perf::refresh()
+{
+    db_query_stats&  stats       = db_query_stats::shared();
+    db_query_summary all         = stats.totals();
+    unsigned long    num_queries = stats.num_queries();
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - last_time).count();
+    if (seconds <= 0)
+        seconds = 1;
+
+    // The counts go down if the counters were reset since the previous refresh.
+
+    unsigned long new_queries = (num_queries >= last_num_queries) ? num_queries - last_num_queries : num_queries;
+    unsigned long new_bytes   = (all.bytes   >= last_bytes)       ? all.bytes   - last_bytes       : all.bytes;
+
+    wxString summary = wxString::Format("%.1f queries/sec, %s/sec received.    Since reset: %lu queries, "
+                                        "%s received, p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, %lu errors.",
+                                        new_queries / seconds, format_bytes(new_bytes / seconds),
+                                        all.count, format_bytes(all.bytes), all.percentile_ms(0.50),
+                                        all.percentile_ms(0.95), all.percentile_ms(0.99), all.errors);
+    if (!stats.enabled())
+        summary += "    (Query statistics are turned off.)";
+    summary_text->SetLabel(summary);
+
+    refresh_pages();
+    refresh_queries(seconds);
+
+    last_time        = now;
+    last_num_queries = num_queries;
+    last_bytes       = all.bytes;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Fill in the table of open pages.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gdw_perf::refresh_pages()
+{
+    std::vector<int> pages;
+    for (size_t i = 0; i < my_notebook->GetPageCount(); i++)
+    {
+        if (my_notebook->GetPage(i) != this && dynamic_cast<gdw_panel*>(my_notebook->GetPage(i)) != nullptr)
+            pages.push_back(i);
+    }
+
+    page_grid->BeginBatch();
+    resize_grid(page_grid, pages.size());
+
+    for (size_t row = 0; row < pages.size(); row++)
+    {
+        gdw_page_stats page;
+        dynamic_cast<gdw_panel*>(my_notebook->GetPage(pages[row]))->page_stats(page);
+
+        page_grid->SetCellValue(row, PAGE_COL_NAME,    my_notebook->GetPageText(pages[row]));
+        page_grid->SetCellValue(row, PAGE_COL_MEMORY,  format_bytes(page.memory_bytes));
+        page_grid->SetCellValue(row, PAGE_COL_PENDING, wxString::Format("%u", page.pending_writes));
+
+        unsigned long lookups = page.cache_hits + page.cache_misses;
+        if (!page.has_cache)
+            page_grid->SetCellValue(row, PAGE_COL_HIT_RATE, "");
+        else if (lookups == 0)
+            page_grid->SetCellValue(row, PAGE_COL_HIT_RATE, "no lookups");
+        else
+            page_grid->SetCellValue(row, PAGE_COL_HIT_RATE, wxString::Format("%.1f%% of %lu",
+                                    100.0 * page.cache_hits / lookups, lookups));
+    }
+
+    page_grid->EndBatch();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Fill in the table of query fingerprints. The rate of each fingerprint is found from its count
+// at the previous refresh.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gdw_perf::refresh_queries(double seconds)
+{
+    std::vector<db_query_summary> summaries;
+    db_query_stats::shared().summary(summaries);
+
+    int num_rows = std::min((int)summaries.size(), (int)MAX_QUERY_ROWS);
+
+    query_grid->BeginBatch();
+    resize_grid(query_grid, num_rows);
+
+    std::map<std::string, unsigned long> counts;
+    for (const db_query_summary& s : summaries)
+        counts[s.fingerprint] = s.count;
+
+    for (int row = 0; row < num_rows; row++)
+    {
+        const db_query_summary& s = summaries[row];
+
+        auto          last = last_counts.find(s.fingerprint);
+        unsigned long prev = (last != last_counts.end() && last->second <= s.count) ? last->second : 0;
+
+        query_grid->SetCellValue(row, QUERY_COL_COUNT,       wxString::Format("%lu", s.count));
+        query_grid->SetCellValue(row, QUERY_COL_RATE,        wxString::Format("%.1f", (s.count - prev) / seconds));
+        query_grid->SetCellValue(row, QUERY_COL_P50,         wxString::Format("%.2f", s.percentile_ms(0.50)));
+        query_grid->SetCellValue(row, QUERY_COL_P95,         wxString::Format("%.2f", s.percentile_ms(0.95)));
+        query_grid->SetCellValue(row, QUERY_COL_P99,         wxString::Format("%.2f", s.percentile_ms(0.99)));
+        query_grid->SetCellValue(row, QUERY_COL_MAX,         wxString::Format("%.2f", s.max_ms));
+        query_grid->SetCellValue(row, QUERY_COL_ROWS,        wxString::Format("%lu", s.rows));
+        query_grid->SetCellValue(row, QUERY_COL_BYTES,       format_bytes(s.bytes));
+        query_grid->SetCellValue(row, QUERY_COL_FINGERPRINT, wxString::FromUTF8(s.fingerprint.c_str()));
+    }
+
+    query_grid->EndBatch();
+
+    last_counts.swap(counts);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Add or delete rows at the end of a table, so that it has the given number of rows.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void gdw_perf::resize_grid(wxGrid* grid, int num_rows)
+{
+    if (grid->GetNumberRows() < num_rows)
+        grid->AppendRows(num_rows - grid->GetNumberRows());
+    else if (grid->GetNumberRows() > num_rows)
+        grid->DeleteRows(num_rows, grid->GetNumberRows() - num_rows);
+}
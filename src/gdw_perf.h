@@ -0,0 +1,66 @@
+///
+/// \file
+///
+
+
+
+#ifndef GDW_PERF_H
+#define GDW_PERF_H
+
+#include <wx/wxprec.h>
+
+#ifndef WX_PRECOMP
+#include <wx/wx.h>
+#endif
+
+#include <wx/grid.h>
+#include <wx/notebook.h>
+#include <wx/timer.h>
+
+#include <chrono>
+#include <map>
+#include <string>
+
+#include "gdw_panel.h"
+#include "id_manager.h"
+
+class gdw_perf : public gdw_panel
+{
+public:
+    gdw_perf (wxWindow* parent, wxNotebook* notebook);
+    ~gdw_perf();
+
+    static const int REFRESH_MS     = 1000;   // time between refreshes
+    static const int MAX_QUERY_ROWS = 50;     // fingerprints shown, in decreasing order of total time
+
+
+private:
+    void process_window_draw ();
+    void process_execute     ();
+
+    void process_window_events (wxEvent* event);
+
+    void refresh         ();
+    void refresh_pages   ();
+    void refresh_queries (double seconds);
+    void resize_grid     (wxGrid* grid, int num_rows);
+
+    wxNotebook*   my_notebook;
+
+    // Counts at the previous refresh, for the rates.
+
+    std::chrono::steady_clock::time_point  last_time;
+    unsigned long                          last_num_queries;
+    unsigned long                          last_bytes;
+    std::map<std::string, unsigned long>   last_counts;    // fingerprint -> count
+
+    wxStaticText* summary_text;
+    wxGrid*       page_grid;
+    wxGrid*       query_grid;
+    wxTimer       timer;
+
+    id_manager   id_mgr;
+    unsigned int id_timer_event;
+};
+
+#endif
@@ -14,13 +14,33 @@
 
 #include <wx/splitter.h>
 
+#include <cstdlib>
 #include <string>
 #include "gdw_search.h"
 #include "gdw_field_group.h"
 
+#include "gde_mention_table.h"
 #include "gde_search_map.h"
 
 
+// Columns of the person mention table that the search results are counted by, with their labels.
+
+static const struct
+{
+    const char* column;
+    const char* label;
+}
+search_facets[] =
+{
+    { "birth_year", "Birth year" },
+    { "county",     "County"     },
+    { "community",  "Community"  },
+    { "source",     "Source"     }
+};
+
+static const unsigned int NUM_SEARCH_FACETS = sizeof(search_facets) / sizeof(search_facets[0]);
+
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 ///
 /// \brief Constructor
@@ -42,10 +62,16 @@ gdw_search::gdw_search(wxWindow* parent, database* db, const gde_source_map& sou
     // Get a unique event identifier and bind it to the event handler, which is inherited from
     // the base class.
 
-    id_mgr.reserve(1);
-    id_text_event = id_mgr.alloc_id();
+    id_mgr.reserve(2);
+    id_text_event  = id_mgr.alloc_id();
+    id_facet_event = id_mgr.alloc_id();
+
+    Bind (wxEVT_TEXT,          &gdw_search::event_handler, this, id_text_event);
+    Bind (wxEVT_CHECKLISTBOX,  &gdw_search::event_handler, this, id_facet_event);
+
+    // Columns with few distinct values are counted by their dictionary codes.
 
-    Bind (wxEVT_TEXT, &gdw_search::event_handler, this, id_text_event);
+    results.set_dict_encoding(true);
 }
 
 gdw_search::~gdw_search()
@@ -81,11 +107,7 @@ void gdw_search::process_window_draw()
 
     wxPanel *left_side = new wxPanel(splittermain, wxID_ANY);
 
-    wxTextCtrl *txt = new wxTextCtrl(left_side, wxID_ANY, "", wxDefaultPosition, wxDefaultSize, wxTE_MULTILINE|wxTE_READONLY);
-    (*txt)<< "Left Side" << "\n\n";
-    wxBoxSizer *sizer1 = new wxBoxSizer(wxVERTICAL);
-    sizer1->Add(txt, 1, wxEXPAND, 10);
-    left_side->SetSizer(sizer1);
+    draw_facets(left_side);
 
     //Right side
 
@@ -128,6 +150,23 @@ void gdw_search::process_window_events (wxEvent* event)
     {
         unsaved_data_flag = true;
     }
+    else if (event_id == id_facet_event && facets)
+    {
+        // A value of a facet was checked or unchecked. Update the counts of the other facets.
+
+        wxCommandEvent* command = static_cast<wxCommandEvent*>(event);
+
+        for (unsigned int facet = 0; facet < wx_facet_lists.size(); facet++)
+        {
+            wxCheckListBox* list = wx_facet_lists[facet];
+            if (list == command->GetEventObject())
+            {
+                unsigned int value = command->GetInt();
+                facets->select(facet, value, list->IsChecked(value));
+            }
+        }
+        show_facets();
+    }
 }
 
 
@@ -138,6 +177,13 @@ bool gdw_search::has_unsaved_data()
 
 
 
+void gdw_search::process_page_stats(gdw_page_stats& stats)
+{
+    stats.memory_bytes = results.memory_used();
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 ///
 /// \brief Process the execute command
@@ -153,6 +199,7 @@ void gdw_search::process_execute()
     std::string given_name (wx_given_name->GetValue());
     std::string community  (wx_community->GetValue());
     std::string county     (wx_county->GetValue());
+    double      radius_km = strtod(std::string(wx_radius->GetValue()).c_str(), nullptr);
 
     gde_search_map my_search_map(my_source_map);
 
@@ -183,10 +230,112 @@ void gdw_search::process_execute()
                             gde_data_tag::PLAC,
                             gde_data_tag::COUNTY);
 
+    // With a distance, search the communities near the one given, using the coordinates of the
+    // GeoNAMES places.
 
+    if (!community.empty() && radius_km > 0.0)
+    {
+        if (!places)
+        {
+            places.reset(new gde_place_index);
+            places->load(*my_db, "ns_geonames");
+        }
+        if (my_search_map.add_place_near(*places, community, radius_km, county) == 0)
+        {
+            wxLogError("The community %s was not found in the place names", community.c_str());
+            return;
+        }
+    }
 
+    // Find the mentions of the person, and count them by each facet. Later changes to the
+    // selected values are counted from the loaded results, without querying the database.
 
+    gde_mention_table mentions(my_source_map);
+    facets.reset();
+    mentions.find(*my_db, surname, given_name, my_search_map.communities(), results);
+
+    facets.reset(new gde_facets(results));
+    for (unsigned int facet = 0; facet < NUM_SEARCH_FACETS; facet++)
+        facets->add_facet(search_facets[facet].column);
+    facets->aggregate();
+
+    // Start with the community and county of the search form selected. A search near a community
+    // has already been limited to the communities around it.
+
+    unsigned int value;
+    if (!community.empty() && my_search_map.communities().empty() && facets->find_value(2, community, value))
+        facets->select(2, value);
+    if (!county.empty() && facets->find_value(1, county, value))
+        facets->select(1, value);
+
+    show_facets();
+}
+
+
+
+// This private member function creates the facet lists: for each facet, a list of its values and
+// their counts, in which values can be checked to narrow the search results.
+
+void gdw_search::draw_facets(wxPanel *parent)
+{
+    wxBoxSizer *vbox = new wxBoxSizer(wxVERTICAL);
+
+    wx_num_matches = new wxStaticText(parent, wxID_ANY, "");
+    vbox->Add(wx_num_matches, 0, wxALL, 5);
+
+    wx_facet_lists.clear();
+    for (unsigned int facet = 0; facet < NUM_SEARCH_FACETS; facet++)
+    {
+        vbox->Add(new wxStaticText(parent, wxID_ANY, search_facets[facet].label), 0, wxLEFT | wxTOP, 5);
+
+        wxCheckListBox* list = new wxCheckListBox(parent, id_facet_event);
+        vbox->Add(list, 1, wxEXPAND | wxALL, 5);
+        wx_facet_lists.push_back(list);
+    }
+
+    parent->SetSizer(vbox);
+    show_facets();
+}
+
+
+
+// This private member function shows the current counts in the facet lists. The lists are only
+// rebuilt after a new search; otherwise, the labels are changed in place, so that the lists keep
+// their scroll positions.
+
+void gdw_search::show_facets()
+{
+    if (wx_num_matches == nullptr)
+        return;
+
+    for (unsigned int facet = 0; facet < wx_facet_lists.size(); facet++)
+    {
+        wxCheckListBox* list       = wx_facet_lists[facet];
+        unsigned int    num_values = facets ? facets->num_values(facet) : 0;
+
+        if (list->GetCount() != num_values)
+        {
+            list->Clear();
+            for (unsigned int value = 0; value < num_values; value++)
+                list->Append("");
+        }
+
+        for (unsigned int value = 0; value < num_values; value++)
+        {
+            std::string label = facets->value(facet, value);
+            if (label.empty())
+                label = "(none)";
+            label += "  (" + std::to_string(facets->count(facet, value)) + ")";
+
+            list->SetString(value, wxString::FromUTF8(label.c_str()));
+            list->Check(value, facets->is_selected(facet, value));
+        }
+    }
 
+    if (facets)
+        wx_num_matches->SetLabel(wxString::Format("%u of %u mentions", facets->num_matches(), results.num_rows()));
+    else
+        wx_num_matches->SetLabel("");
 }
 
 
@@ -203,6 +352,7 @@ void::gdw_search::draw_search_form(wxPanel *parent)
     wx_given_name = field_group.add_field ("Given Names(s)", "");
     wx_community  = field_group.add_field ("Community",      "");
     wx_county     = field_group.add_field ("County",         "");
+    wx_radius     = field_group.add_field ("Within (km)",    "");
 
     parent->SetSizer(vbox);
     vbox->SetSizeHints(parent);
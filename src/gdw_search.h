@@ -15,8 +15,15 @@
 
 #include <wx/grid.h>
 #include <wx/treectrl.h>
+#include <wx/checklst.h>
+
+#include <memory>
+#include <vector>
 
 #include "database.h"
+#include "db_row_set.h"
+#include "gde_facets.h"
+#include "gde_place_index.h"
 #include "gde_source_map.h"
 #include "gdw_panel.h"
 #include "id_manager.h"
@@ -32,20 +39,31 @@ private:
     void process_window_draw ();
     void process_execute     ();
     bool has_unsaved_data    ();
+    void process_page_stats  (gdw_page_stats& stats);
 
     void process_window_events (wxEvent* event);
 
     void draw_search_form      (wxPanel*);
+    void draw_facets           (wxPanel*);
+    void show_facets           ();
 
     database*                 my_db;
     const gde_source_map&     my_source_map;
     bool                      unsaved_data_flag;
     id_manager                id_mgr;
     unsigned int              id_text_event;
+    unsigned int              id_facet_event;
     wxTextCtrl*               wx_surname;
     wxTextCtrl*               wx_given_name;
     wxTextCtrl*               wx_community;
     wxTextCtrl*               wx_county;
+    wxTextCtrl*               wx_radius;
+
+    db_row_set                    results;          // Mentions found by the last search
+    std::unique_ptr<gde_facets>   facets;           // Counts of the mentions, or null before a search
+    std::vector<wxCheckListBox*>  wx_facet_lists;   // One list for each facet
+    wxStaticText*                 wx_num_matches = nullptr;
+    std::unique_ptr<gde_place_index>  places;       // Place coordinates, loaded by the first search by distance
 };
 
 #endif
@@ -0,0 +1,1088 @@
+///
+/// \file
+///
+/// \brief Microbenchmarks for the core data classes
+///
+/// gendat-bench times the classes that every page uses: filling and reading db_row_set,
+/// db_row_set_w::save_data, db_map and gde_source_map loading, and id_manager. The inputs are
+/// synthetic, but have the shape of the real data: rows as wide as the 1871 census table, a
+/// source catalog of about the size of the GenDat one, and the usual mix of field codes.
+///
+/// For each benchmark, the number of operations is increased until a run takes at least the
+/// minimum time, and the time, heap allocations and heap bytes per operation of that run are
+/// reported. Allocations are counted by replacing the global operator new in this program. The
+/// peak of the heap bytes in use during the run, above those in use when it started, is also
+/// reported; since each operation frees what it allocates, this is the peak of one operation.
+///
+/// The results are written as JSON (to standard output, or to the file given with --json), so
+/// that runs made before and after a change can be compared. A table is also written to
+/// standard error. Build with "make bench OPT_FLAGS=-O2" (after "make clean") for meaningful
+/// times.
+///
+/// The gde_string_match benchmarks run the scalar and SIMD versions of the name comparisons on
+/// the same names. The instruction set that the SIMD kernels were built for is named in the JSON
+/// context; build with "OPT_FLAGS='-O2 -mavx2'" to time the AVX2 kernels.
+///
+/// The id_manager benchmarks also check that no identifier is handed out twice while panels
+/// are being opened and closed on several threads at once. The program exits with status 1 if
+/// the check fails.
+///
+/// The database benchmarks insert, select and stream rows of a temporary table through the
+/// `database` class, so that the backends can be compared. They use an in-memory SQLite
+/// database unless another is given with --host (for example a MySQL server, or
+/// "sqlite:/tmp/bench.db" for an SQLite file). The backend is named in the JSON context.
+///
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "database.h"
+#include "db_map.h"
+#include "db_row_set.h"
+#include "db_row_set_w.h"
+#include "db_row_view.h"
+#include "db_snapshot.h"
+#include "gde_facets.h"
+#include "gde_source_map.h"
+#include "gde_string_match.h"
+#include "id_manager.h"
+
+
+//**************************************************************************************************
+// Allocation counting
+//**************************************************************************************************
+
+static std::atomic<unsigned long long> num_allocs {0};
+static std::atomic<unsigned long long> num_alloc_bytes {0};
+static std::atomic<long long>          num_live_bytes {0};
+static std::atomic<long long>          peak_live_bytes {0};
+
+// Each block starts with its size, so that operator delete can count the bytes in use.
+
+static const std::size_t alloc_header = alignof(std::max_align_t);
+
+void* operator new(std::size_t size)
+{
+    num_allocs.fetch_add(1, std::memory_order_relaxed);
+    num_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+
+    char* p = (char*) malloc(size + alloc_header);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    *(std::size_t*) p = size;
+
+    long long live = num_live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+    long long peak = peak_live_bytes.load(std::memory_order_relaxed);
+    while (live > peak && !peak_live_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        ;
+    return p + alloc_header;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+// The library allocates some buffers (for std::stable_sort, for example) with the nothrow
+// versions, so they must use the same blocks.
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return operator new(size);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+
+// The delete operators are not inlined, since g++ would then warn that memory from operator new
+// is passed to free().
+
+__attribute__((noinline)) void operator delete(void* p) noexcept
+{
+    if (p == nullptr)
+        return;
+
+    char* block = (char*) p - alloc_header;
+    num_live_bytes.fetch_sub(*(std::size_t*) block, std::memory_order_relaxed);
+    free(block);
+}
+
+__attribute__((noinline)) void operator delete[](void* p) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+    operator delete(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+    operator delete(p);
+}
+
+
+
+//**************************************************************************************************
+// Benchmark harness
+//**************************************************************************************************
+
+// Result of one benchmark.
+
+struct bench_result
+{
+    std::string   name;
+    unsigned long iterations    = 0;
+    double        ns_per_op     = 0;
+    double        allocs_per_op = 0;
+    double        bytes_per_op  = 0;
+    long long     peak_bytes    = 0;
+};
+
+// A benchmark runs the given number of operations. Any setup is done before it is registered.
+
+struct bench_def
+{
+    std::string                         name;
+    std::function<void (unsigned long)> run;
+};
+
+static double min_time_s = 0.5;
+
+static const char* db_sqlite_memory = "sqlite::memory:";
+
+
+
+// Run one benchmark, increasing the number of operations until a run takes at least min_time_s.
+
+static bench_result run_bench(const bench_def& bench)
+{
+    bench_result result;
+    result.name = bench.name;
+
+    unsigned long iterations = 1;
+    for (;;)
+    {
+        unsigned long long allocs_before = num_allocs.load();
+        unsigned long long bytes_before  = num_alloc_bytes.load();
+        long long          live_before   = num_live_bytes.load();
+        peak_live_bytes.store(live_before);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        bench.run(iterations);
+
+        double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (elapsed_s >= min_time_s || iterations >= 1000000000UL)
+        {
+            result.iterations    = iterations;
+            result.ns_per_op     = elapsed_s * 1e9 / iterations;
+            result.allocs_per_op = (double)(num_allocs.load() - allocs_before) / iterations;
+            result.bytes_per_op  = (double)(num_alloc_bytes.load() - bytes_before) / iterations;
+            result.peak_bytes    = peak_live_bytes.load() - live_before;
+            return result;
+        }
+
+        // Aim a little past the minimum time, but grow by at most 100 times per step.
+
+        double scale = (elapsed_s > 0) ? 1.4 * min_time_s / elapsed_s : 100;
+        iterations = (unsigned long)(iterations * std::min(std::max(scale, 2.0), 100.0));
+    }
+}
+
+
+
+static std::string json_string(const std::string& str)
+{
+    std::string out = "\"";
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+
+
+static void write_json(FILE* file, const std::vector<bench_result>& results, bool check_ok,
+                       const std::string& backend)
+{
+    char      date[64];
+    time_t    now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+    fprintf(file, "{\n  \"context\": {\n");
+    fprintf(file, "    \"date\": %s,\n", json_string(date).c_str());
+    fprintf(file, "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+    fprintf(file, "    \"min_time_s\": %g,\n", min_time_s);
+#ifdef __OPTIMIZE__
+    fprintf(file, "    \"optimized\": true,\n");
+#else
+    fprintf(file, "    \"optimized\": false,\n");
+#endif
+    fprintf(file, "    \"database_backend\": %s,\n", json_string(backend).c_str());
+    fprintf(file, "    \"string_match_simd\": %s,\n", json_string(gde_string_match::simd_level()).c_str());
+    fprintf(file, "    \"concurrent_id_check\": %s\n", check_ok ? "\"ok\"" : "\"FAILED\"");
+    fprintf(file, "  },\n  \"benchmarks\": [\n");
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const bench_result& r = results[i];
+        fprintf(file, "    {\"name\": %s, \"iterations\": %lu, \"ns_per_op\": %.2f, "
+                      "\"allocs_per_op\": %.3f, \"bytes_per_op\": %.1f, \"peak_bytes\": %lld}%s\n",
+                json_string(r.name).c_str(), r.iterations, r.ns_per_op, r.allocs_per_op, r.bytes_per_op,
+                r.peak_bytes,
+                (i + 1 < results.size()) ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+}
+
+
+
+//**************************************************************************************************
+// Synthetic inputs
+//**************************************************************************************************
+
+static const char* surnames[] =
+{
+    "MacDonald", "McLean", "Fraser", "Campbell", "Chisholm", "MacKenzie", "Cameron", "Boudreau",
+    "LeBlanc", "Smith", "O'Brien", "Murphy", "Munro", "Sutherland", "Grant", "Doucet"
+};
+static const char* given_names[] =
+{
+    "John", "Mary", "Donald", "Catherine", "Alexander", "Margaret", "Angus", "Ann", "Hugh",
+    "Christy", "William", "Jane", "Roderick", "Isabella", "Archibald", "Flora"
+};
+static const char* places[] =
+{
+    "Antigonish", "Pictou", "Inverness", "Halifax", "Guysborough", "Cape Breton", "Colchester",
+    "Lunenburg", "Richmond", "Victoria"
+};
+
+template <size_t N>
+static const char* pick(const char* (&list)[N], std::mt19937& rng)
+{
+    return list[rng() % N];
+}
+
+
+
+// Column of the synthetic census table.
+
+struct census_col
+{
+    const char*  name;
+    db_data_type type;
+};
+
+// The shape of the 1871 census table: 40 columns, mostly short strings, with integer keys and
+// page, line and age columns.
+
+static const census_col census_cols[] =
+{
+    { "id",              DB_UNSIGNED_INT }, { "district_id",    DB_SMALLINT  }, { "sub_district_id", DB_CHAR     },
+    { "division",        DB_SMALLINT     }, { "page",           DB_SMALLINT  }, { "line",            DB_TINYINT  },
+    { "family",          DB_SMALLINT     }, { "surname",        DB_VARCHAR   }, { "given_name",      DB_VARCHAR  },
+    { "sex",             DB_CHAR         }, { "age",            DB_TINYINT   }, { "birth_month",     DB_VARCHAR  },
+    { "birthplace",      DB_VARCHAR      }, { "religion",       DB_VARCHAR   }, { "origin",          DB_VARCHAR  },
+    { "nationality",     DB_VARCHAR      }, { "occupation",     DB_VARCHAR   }, { "marital_status",  DB_CHAR     },
+    { "married_in_year", DB_CHAR         }, { "school",         DB_CHAR      }, { "cannot_read",     DB_CHAR     },
+    { "cannot_write",    DB_CHAR         }, { "deaf_dumb",      DB_CHAR      }, { "blind",           DB_CHAR     },
+    { "unsound_mind",    DB_CHAR         }, { "dwelling",       DB_SMALLINT  }, { "house_status",    DB_VARCHAR  },
+    { "land_acres",      DB_DECIMAL      }, { "improved_acres", DB_DECIMAL   }, { "cattle",          DB_SMALLINT },
+    { "sheep",           DB_SMALLINT     }, { "swine",          DB_SMALLINT  }, { "horses",          DB_SMALLINT },
+    { "wheat_bushels",   DB_DECIMAL      }, { "oats_bushels",   DB_DECIMAL   }, { "potatoes",        DB_DECIMAL  },
+    { "remarks",         DB_TEXT         }, { "reel",           DB_VARCHAR   }, { "image",           DB_VARCHAR  },
+    { "last_changed",    DB_DATE         }
+};
+
+static const unsigned int NUM_CENSUS_COLS = sizeof(census_cols) / sizeof(census_cols[0]);
+
+
+
+// Generate one value for a census column.
+
+static std::string census_value(unsigned int row, unsigned int col, std::mt19937& rng)
+{
+    const std::string name = census_cols[col].name;
+
+    if (col == 0)
+        return std::to_string(row + 1);
+    if (name == "surname")
+        return pick(surnames, rng);
+    if (name == "given_name")
+        return std::string(pick(given_names, rng)) + ((rng() % 3 == 0) ? std::string(" ") + pick(given_names, rng) : "");
+    if (name == "sex")
+        return (rng() % 2) ? "M" : "F";
+    if (name == "birthplace" || name == "origin")
+        return pick(places, rng);
+    if (name == "remarks")
+        return (rng() % 10 == 0) ? "Name difficult to read; see also next page" : "";
+    if (name == "last_changed")
+        return "2019-0" + std::to_string(1 + rng() % 9) + "-1" + std::to_string(rng() % 10);
+
+    switch (census_cols[col].type)
+    {
+    case DB_UNSIGNED_INT:
+    case DB_SMALLINT:
+    case DB_TINYINT:
+        return std::to_string(rng() % 100);
+    case DB_DECIMAL:
+        return std::to_string(rng() % 200) + "." + std::to_string(rng() % 10);
+    case DB_CHAR:
+        return (rng() % 4 == 0) ? "" : "Y";
+    default:
+        return std::string(4 + rng() % 12, 'a' + rng() % 26);
+    }
+}
+
+
+
+// Build the row sets of the benchmarks. This class is a friend of db_row_set, so that a row set
+// can be loaded the way database::execute() loads it, but without a database server.
+
+class gendat_bench
+{
+public:
+    static void load_census(db_row_set& row_set, unsigned int num_rows, unsigned int seed)
+    {
+        std::mt19937 rng(seed);
+
+        std::vector<db_col_desc> cols(NUM_CENSUS_COLS);
+        for (unsigned int col = 0; col < NUM_CENSUS_COLS; col++)
+        {
+            cols[col].my_name       = census_cols[col].name;
+            cols[col].my_name_in_db = census_cols[col].name;
+            cols[col].my_table      = "1871_census_data";
+            cols[col].my_type       = census_cols[col].type;
+            cols[col].my_null_ok    = (col != 0);
+            cols[col].my_pri_key    = (col == 0);
+            cols[col].my_auto_inc   = (col == 0);
+        }
+
+        std::vector<std::vector<std::string>> rows(num_rows, std::vector<std::string>(NUM_CENSUS_COLS));
+        std::vector<std::vector<bool>>        nulls(num_rows, std::vector<bool>(NUM_CENSUS_COLS));
+        for (unsigned int row = 0; row < num_rows; row++)
+        {
+            for (unsigned int col = 0; col < NUM_CENSUS_COLS; col++)
+            {
+                rows[row][col]  = census_value(row, col, rng);
+                nulls[row][col] = (col != 0 && rows[row][col].empty() && rng() % 2 == 0);
+            }
+        }
+
+        load(row_set, cols, rows, nulls);
+    }
+
+    static void copy(db_row_set& row_set, const db_row_set& source)
+    {
+        load(row_set, source.col_desc_list, source.result_set, source.null_fields);
+    }
+
+    // Load the rows as database::execute does. If the row set is dictionary encoded, each row is
+    // copied into one buffer and encoded, as the rows read by a backend are.
+
+    static void load(db_row_set& row_set, const std::vector<db_col_desc>& cols,
+                     const std::vector<std::vector<std::string>>& rows,
+                     const std::vector<std::vector<bool>>& nulls)
+    {
+        row_set.clear();
+        row_set.setup_child_phase_1();
+
+        row_set.my_num_cols   = cols.size();
+        row_set.col_desc_list = cols;
+
+        if (row_set.dict_encoding)
+        {
+            std::vector<std::string> row;
+            std::vector<bool>        null_row;
+            for (size_t i = 0; i < rows.size(); i++)
+            {
+                row      = rows[i];
+                null_row = nulls[i];
+                row_set.encode_row(row, null_row);
+            }
+            row_set.end_encoding();
+        }
+        else
+        {
+            row_set.result_set  = rows;
+            row_set.null_fields = nulls;
+        }
+        row_set.my_num_rows = rows.size();
+
+        row_set.setup_child_phase_2();
+    }
+};
+
+
+
+// Field codes, with roughly the frequencies found in the GenDat catalog. The marriage codes are
+// only valid for marriage sources, and some codes are deliberately invalid.
+
+static const char* common_codes[] =
+{
+    "SURN", "GIVN", "GIVN", "SEX", "AGE", "KEY", "NOTE", "RESI", "OCCU", "STATUS", "", "", "",
+    "F_SURN", "F_GIVN", "F_OCCU", "F_RESI", "M_SURN", "M_GIVN", "M_RESI", "S_SURN", "S_GIVN",
+    "PLAC_COMMUNITY", "PLAC_COUNTY", "DATE", "DATE_Y", "DATE_M", "DATE_D", "XREF_INDI",
+    "BURI_CEMETERY", "INSCRIPTION", "FOO_BAR"
+};
+static const char* event_codes[] =
+{
+    "_DATE", "_DATE_Y", "_DATE_M", "_DATE_D", "_PLAC", "_PLAC_COMMUNITY", "_PLAC_COUNTY"
+};
+static const char* marriage_codes[] =
+{
+    "G_SURN", "G_GIVN", "G_AGE", "G_RESI", "G_OCCU", "GF_SURN", "GF_GIVN", "GM_SURN", "GM_GIVN",
+    "B_SURN", "B_GIVN", "B_AGE", "B_RESI", "BF_SURN", "BF_GIVN", "BM_SURN", "BM_GIVN", "B_STATUS"
+};
+static const char* source_codes[] = { "BIRT", "BAPM", "DEAT", "BURI", "MARR", "MARR", "CENS", "WILL", "MISC" };
+
+
+
+// Generate a source catalog with the given number of sources, and 20 to 60 fields per source.
+
+static void make_catalog(unsigned int num_sources, std::vector<std::vector<std::string>>& src_rows,
+                         std::vector<std::vector<std::string>>& fld_rows)
+{
+    std::mt19937 rng(1871);
+
+    src_rows.clear();
+    fld_rows.clear();
+
+    unsigned int field_id = 1;
+    for (unsigned int src = 0; src < num_sources; src++)
+    {
+        std::string id   = std::to_string(src + 1);
+        std::string code = pick(source_codes, rng);
+
+        // A few sources are views derived from an earlier source.
+
+        std::string derived_from = (src > 5 && rng() % 8 == 0) ? std::to_string(1 + rng() % src) : "";
+
+        src_rows.push_back({ id, "Source " + id, "Synthetic " + code + " source", "1.0", code,
+                             "src_" + id + "_data", derived_from, (rng() % 2) ? "yes" : "no" });
+
+        unsigned int num_fields = 20 + rng() % 41;
+        for (unsigned int fld = 0; fld < num_fields; fld++)
+        {
+            std::string fld_code;
+            unsigned int kind = rng() % 10;
+            if (kind < 2 && code != "CENS" && code != "MISC")
+                fld_code = code + pick(event_codes, rng);
+            else if (kind < 5 && code == "MARR")
+                fld_code = pick(marriage_codes, rng);
+            else
+                fld_code = pick(common_codes, rng);
+
+            std::string name = "field_" + std::to_string(fld);
+            fld_rows.push_back({ std::to_string(field_id++), id, fld_code, name, name, "yes" });
+        }
+    }
+}
+
+
+
+//**************************************************************************************************
+// Benchmarks
+//**************************************************************************************************
+
+// Open and close one panel's worth of identifiers, as gdw_navigator does.
+
+static const unsigned int IDS_PER_PANEL = 7;
+
+static void open_close_panel()
+{
+    id_manager id_mgr;
+    id_mgr.reserve(IDS_PER_PANEL);
+    for (unsigned int i = 0; i < IDS_PER_PANEL; i++)
+        id_mgr.alloc_id();
+}
+
+
+
+// Open and close panels on several threads, and check that no identifier is held by two
+// panels at once. Each identifier in use is marked with the thread that holds it.
+
+static const unsigned int MAX_CHECKED_ID = 1 << 20;
+static std::unique_ptr<std::atomic<int>[]> id_owner(new std::atomic<int>[MAX_CHECKED_ID]());
+static std::atomic<bool> id_check_failed {false};
+
+static void open_close_panel_checked(int thread_num)
+{
+    id_manager   id_mgr;
+    unsigned int ids[IDS_PER_PANEL];
+
+    id_mgr.reserve(IDS_PER_PANEL);
+    for (unsigned int i = 0; i < IDS_PER_PANEL; i++)
+    {
+        ids[i] = id_mgr.alloc_id();
+
+        int expected = 0;
+        if (ids[i] >= MAX_CHECKED_ID || !id_owner[ids[i]].compare_exchange_strong(expected, thread_num))
+            id_check_failed = true;
+    }
+    for (unsigned int i = 0; i < IDS_PER_PANEL; i++)
+    {
+        if (ids[i] < MAX_CHECKED_ID)
+            id_owner[ids[i]].store(0);
+    }
+}
+
+
+
+static void add_benchmarks(std::vector<bench_def>& benches)
+{
+    // db_row_set: load a page of census rows (the copy done by database::execute), and read
+    // every field of it.
+
+    for (unsigned int num_rows : { 30u, 1000u })
+    {
+        auto source = std::make_shared<db_row_set>();
+        gendat_bench::load_census(*source, num_rows, 1);
+
+        benches.push_back({ "db_row_set/load_census_" + std::to_string(num_rows) + "_rows",
+            [source] (unsigned long n)
+            {
+                for (unsigned long i = 0; i < n; i++)
+                {
+                    db_row_set row_set;
+                    gendat_bench::copy(row_set, *source);
+                }
+            } });
+    }
+
+    {
+        auto source = std::make_shared<db_row_set>();
+        gendat_bench::load_census(*source, 1000, 1);
+
+        benches.push_back({ "db_row_set/load_census_1000_rows_dict",
+            [source] (unsigned long n)
+            {
+                for (unsigned long i = 0; i < n; i++)
+                {
+                    db_row_set row_set;
+                    row_set.set_dict_encoding(true);
+                    gendat_bench::copy(row_set, *source);
+                }
+            } });
+    }
+
+    // Reading and measuring a row set, with the strings stored in each row and with the columns
+    // dictionary encoded.
+
+    for (bool dict : { false, true })
+    {
+        std::string suffix  = dict ? "_dict" : "";
+        auto        row_set = std::make_shared<db_row_set>();
+        row_set->set_dict_encoding(dict);
+        gendat_bench::load_census(*row_set, 1000, 2);
+
+        benches.push_back({ "db_row_set/get_data_census_field" + suffix,
+            [row_set] (unsigned long n)
+            {
+                std::string  data;
+                unsigned int row = 0;
+                unsigned int col = 0;
+                for (unsigned long i = 0; i < n; i++)
+                {
+                    row_set->get_data(row, col, data);
+                    if (++col == NUM_CENSUS_COLS)
+                    {
+                        col = 0;
+                        if (++row == row_set->num_rows())
+                            row = 0;
+                    }
+                }
+            } });
+
+        benches.push_back({ "db_row_set/memory_used_1000_rows" + suffix,
+            [row_set] (unsigned long n)
+            {
+                size_t total = 0;
+                for (unsigned long i = 0; i < n; i++)
+                    total += row_set->memory_used();
+                if (total == 1)
+                    std::cerr << total;
+            } });
+
+        // gde_facets: count the rows by four columns, and select and deselect one value, which
+        // updates the counts of the other facets.
+
+        benches.push_back({ "gde_facets/aggregate_4_facets_1000_rows" + suffix,
+            [row_set] (unsigned long n)
+            {
+                for (unsigned long i = 0; i < n; i++)
+                {
+                    gde_facets facets(*row_set);
+                    for (const char* name : { "district_id", "sex", "religion", "birthplace" })
+                        facets.add_facet(name);
+                    facets.aggregate();
+                }
+            } });
+
+        auto facets = std::make_shared<gde_facets>(*row_set);
+        for (const char* name : { "district_id", "sex", "religion", "birthplace" })
+            facets->add_facet(name);
+        facets->aggregate();
+
+        benches.push_back({ "gde_facets/select_value_1000_rows" + suffix,
+            [row_set, facets] (unsigned long n)
+            {
+                for (unsigned long i = 0; i < n; i++)
+                    facets->select(1, 0, i % 2 == 0);
+                facets->clear_selection(1);
+            } });
+
+        // db_row_view: sort the rows by an integer column (age), a text column (surname), and
+        // surname then given name, without querying the database again.
+
+        struct sort_case
+        {
+            const char*  name;
+            unsigned int col_1;
+            int          col_2;
+        };
+        static const sort_case sort_cases[] =
+        {
+            { "db_row_view/sort_age_1000_rows",                10, -1 },
+            { "db_row_view/sort_surname_1000_rows",            7,  -1 },
+            { "db_row_view/sort_surname_given_name_1000_rows", 7,  8  }
+        };
+
+        for (const sort_case& c : sort_cases)
+        {
+            std::vector<db_sort_key> keys(1, db_sort_key(c.col_1));
+            if (c.col_2 >= 0)
+                keys.push_back(db_sort_key(c.col_2));
+
+            benches.push_back({ c.name + suffix,
+                [row_set, keys] (unsigned long n)
+                {
+                    db_row_view view(*row_set);
+                    for (unsigned long i = 0; i < n; i++)
+                        view.sort(keys);
+                } });
+        }
+    }
+
+    // gde_string_match: compare one surname with 1000 others, using the scalar functions and the
+    // batch functions, which use the SIMD kernels (see gde_string_match::simd_level()). Both are
+    // given the same names, so that their times can be compared directly. Half of the names have
+    // one character changed, inserted or deleted, as in a misspelled record.
+
+    {
+        std::mt19937 rng(3);
+        auto names = std::make_shared<std::vector<std::string>>();
+        for (unsigned int i = 0; i < 1000; i++)
+        {
+            std::string name = pick(surnames, rng);
+            size_t      pos  = rng() % name.size();
+            switch (rng() % 6)
+            {
+            case 0:  name[pos] = 'a' + rng() % 26;           break;
+            case 1:  name.insert(pos, 1, 'a' + rng() % 26);  break;
+            case 2:  name.erase(pos, 1);                     break;
+            default:                                         break;
+            }
+            names->push_back(name);
+        }
+
+        const std::string query = "MacDonald";
+        auto matcher = std::make_shared<gde_string_match>(query);
+
+        benches.push_back({ "gde_string_match/jaro_winkler_1000_names_scalar",
+            [names, query] (unsigned long n)
+            {
+                double total = 0;
+                for (unsigned long i = 0; i < n; i++)
+                    for (const std::string& name : *names)
+                        total += gde_string_match::jaro_winkler_scalar(query, name);
+                if (total < 0)
+                    std::cerr << total;
+            } });
+
+        benches.push_back({ "gde_string_match/jaro_winkler_1000_names_simd_single",
+            [names, matcher] (unsigned long n)
+            {
+                double total = 0;
+                for (unsigned long i = 0; i < n; i++)
+                    for (const std::string& name : *names)
+                        total += matcher->jaro_winkler(name);
+                if (total < 0)
+                    std::cerr << total;
+            } });
+
+        benches.push_back({ "gde_string_match/jaro_winkler_1000_names_simd",
+            [names, matcher] (unsigned long n)
+            {
+                std::vector<double> scores;
+                for (unsigned long i = 0; i < n; i++)
+                    matcher->jaro_winkler_batch(*names, scores);
+            } });
+
+        benches.push_back({ "gde_string_match/levenshtein_1000_names_scalar",
+            [names, query] (unsigned long n)
+            {
+                unsigned long total = 0;
+                for (unsigned long i = 0; i < n; i++)
+                    for (const std::string& name : *names)
+                        total += gde_string_match::levenshtein_scalar(query, name, 2);
+                if (total == 1)
+                    std::cerr << total;
+            } });
+
+        benches.push_back({ "gde_string_match/levenshtein_1000_names_simd",
+            [names, matcher] (unsigned long n)
+            {
+                std::vector<unsigned int> distances;
+                for (unsigned long i = 0; i < n; i++)
+                    matcher->levenshtein_batch(*names, 2, distances);
+            } });
+    }
+
+    // db_row_set_w::save_data: edits to a string column, an integer column (validated with a
+    // regular expression), and empty values with NULL substitution.
+
+    struct edit_case
+    {
+        const char*  name;
+        unsigned int col;
+        const char*  value;
+        bool         null_subst;
+    };
+    static const edit_case edit_cases[] =
+    {
+        { "db_row_set_w/save_data_varchar",    7,  "MacIsaac", false },
+        { "db_row_set_w/save_data_int",        10, "42",       false },
+        { "db_row_set_w/save_data_decimal",    27, "104.5",    false },
+        { "db_row_set_w/save_data_date",       39, "1871-04-02", false },
+        { "db_row_set_w/save_data_null_subst", 12, "",         true  }
+    };
+
+    for (const edit_case& edit : edit_cases)
+    {
+        auto row_set = std::make_shared<db_row_set_w>();
+        gendat_bench::load_census(*row_set, 1000, 3);
+        if (edit.null_subst)
+            row_set->set_null_subst_on();
+
+        benches.push_back({ edit.name,
+            [row_set, edit] (unsigned long n)
+            {
+                std::string error_msg;
+                for (unsigned long i = 0; i < n; i++)
+                {
+                    if (!row_set->save_data(i % row_set->num_rows(), edit.col, edit.value, error_msg))
+                        throw std::logic_error(std::string(edit.name) + ": " + error_msg);
+                }
+            } });
+    }
+
+    // db_map and gde_source_map: load and interpret a catalog of sources.
+
+    for (unsigned int num_sources : { 60u, 600u })
+    {
+        auto src_rows = std::make_shared<std::vector<std::vector<std::string>>>();
+        auto fld_rows = std::make_shared<std::vector<std::vector<std::string>>>();
+        make_catalog(num_sources, *src_rows, *fld_rows);
+
+        benches.push_back({ "db_map/load_defs_" + std::to_string(num_sources) + "_sources",
+            [src_rows, fld_rows] (unsigned long n)
+            {
+                db_map map;
+                for (unsigned long i = 0; i < n; i++)
+                    map.load_defs(*src_rows, *fld_rows);
+            } });
+
+        benches.push_back({ "gde_source_map/load_defs_" + std::to_string(num_sources) + "_sources",
+            [src_rows, fld_rows] (unsigned long n)
+            {
+                gde_source_map map;
+                for (unsigned long i = 0; i < n; i++)
+                    map.load_defs(*src_rows, *fld_rows);
+            } });
+    }
+
+    // id_manager: open and close a panel while other panels hold identifiers.
+
+    for (unsigned int open_panels : { 0u, 40u, 1000u })
+    {
+        benches.push_back({ "id_manager/open_close_panel_" + std::to_string(open_panels) + "_open",
+            [open_panels] (unsigned long n)
+            {
+                std::vector<std::unique_ptr<id_manager>> panels;
+                for (unsigned int i = 0; i < open_panels; i++)
+                {
+                    panels.emplace_back(new id_manager(IDS_PER_PANEL));
+                    panels.back()->alloc_id();
+                }
+                for (unsigned long i = 0; i < n; i++)
+                    open_close_panel();
+            } });
+    }
+
+    benches.push_back({ "id_manager/open_close_panel_4_threads",
+        [] (unsigned long n)
+        {
+            std::vector<std::thread> threads;
+            for (int t = 1; t <= 4; t++)
+            {
+                threads.emplace_back([n, t] ()
+                {
+                    for (unsigned long i = t - 1; i < n; i += 4)
+                        open_close_panel_checked(t);
+                });
+            }
+            for (std::thread& thread : threads)
+                thread.join();
+        } });
+}
+
+
+
+// Database benchmarks, on a temporary table of census-like rows. The connection is shared by
+// the benchmarks, and is closed when the last of them is destroyed.
+
+static const unsigned int DB_BENCH_ROWS = 1000;
+
+static void add_db_benchmarks(std::vector<bench_def>& benches, std::shared_ptr<database> db)
+{
+    db->execute("CREATE TEMPORARY TABLE gendat_bench_person ("
+                "id INT UNSIGNED NOT NULL, surname VARCHAR(64) NOT NULL, given_name VARCHAR(64) NOT NULL, "
+                "age TINYINT UNSIGNED NULL, birthplace VARCHAR(32) NULL, occupation VARCHAR(64) NULL, "
+                "PRIMARY KEY (id), KEY (surname))");
+
+    auto next_id = std::make_shared<unsigned int>(0);
+    auto rng     = std::make_shared<std::mt19937>(5);
+
+    auto insert_row = [db, next_id, rng] ()
+    {
+        unsigned int age = (*rng)() % 90;
+        db->execute("INSERT INTO gendat_bench_person VALUES (" + std::to_string(++*next_id) + ", '" +
+                    db->escape_str(pick(surnames, *rng)) + "', '" + pick(given_names, *rng) + "', " +
+                    (age < 5 ? std::string("NULL") : std::to_string(age)) + ", '" + pick(places, *rng) +
+                    "', 'Farmer')");
+    };
+
+    db->execute("START TRANSACTION");
+    for (unsigned int i = 0; i < DB_BENCH_ROWS; i++)
+        insert_row();
+    db->execute("COMMIT");
+
+    std::string select = "SELECT * FROM gendat_bench_person WHERE id <= " + std::to_string(DB_BENCH_ROWS);
+
+    benches.push_back({ "database/insert_row_in_transaction",
+        [db, insert_row] (unsigned long n)
+        {
+            db->execute("START TRANSACTION");
+            for (unsigned long i = 0; i < n; i++)
+                insert_row();
+            db->execute("COMMIT");
+        } });
+
+    benches.push_back({ "database/point_select",
+        [db] (unsigned long n)
+        {
+            db_row_set row_set;
+            for (unsigned long i = 0; i < n; i++)
+                db->execute("SELECT * FROM gendat_bench_person WHERE id = " + std::to_string(i % DB_BENCH_ROWS + 1), row_set);
+        } });
+
+    benches.push_back({ "database/select_" + std::to_string(DB_BENCH_ROWS) + "_rows_row_set",
+        [db, select] (unsigned long n)
+        {
+            for (unsigned long i = 0; i < n; i++)
+            {
+                db_row_set row_set;
+                db->execute(select, row_set);
+            }
+        } });
+
+    benches.push_back({ "database/stream_" + std::to_string(DB_BENCH_ROWS) + "_rows",
+        [db, select] (unsigned long n)
+        {
+            db_row_stream stream;
+            std::string   data;
+            for (unsigned long i = 0; i < n; i++)
+            {
+                db->execute(select, stream);
+                while (stream.next_row())
+                    stream.get_data(1, data);
+            }
+        } });
+
+    // The same rows from a snapshot file. The file is removed when the benchmarks are destroyed.
+
+    std::shared_ptr<std::string> snap_file(new std::string(std::string(P_tmpdir) + "/gendat_bench.snap"),
+        [] (std::string* name) { remove(name->c_str()); delete name; });
+    db_snapshot::write(*db, select, *snap_file);
+
+    benches.push_back({ "database/snapshot_write_" + std::to_string(DB_BENCH_ROWS) + "_rows",
+        [db, select] (unsigned long n)
+        {
+            std::string name = std::string(P_tmpdir) + "/gendat_bench_write.snap";
+            for (unsigned long i = 0; i < n; i++)
+                db_snapshot::write(*db, select, name);
+            remove(name.c_str());
+        } });
+
+    benches.push_back({ "database/snapshot_open_" + std::to_string(DB_BENCH_ROWS) + "_rows_row_set",
+        [snap_file] (unsigned long n)
+        {
+            for (unsigned long i = 0; i < n; i++)
+            {
+                db_row_set row_set;
+                row_set.load_snapshot(db_snapshot::open(*snap_file));
+            }
+        } });
+
+    benches.push_back({ "database/snapshot_scan_" + std::to_string(DB_BENCH_ROWS) + "_rows",
+        [snap_file] (unsigned long n)
+        {
+            std::shared_ptr<const db_snapshot> snapshot = db_snapshot::open(*snap_file);
+            const char* data;
+            size_t      length;
+            for (unsigned long i = 0; i < n; i++)
+                for (unsigned int row = 0; row < snapshot->num_rows(); row++)
+                    snapshot->get_field(row, 1, data, length);
+        } });
+}
+
+
+
+static void show_usage()
+{
+    std::cerr << "Usage: gendat-bench [--filter TEXT] [--min-time SECONDS] [--json FILE] [--list]\n"
+                 "                    [--host NAME] [--user NAME] [--database NAME]\n"
+                 "\n"
+                 "  --filter TEXT       run only the benchmarks whose names contain TEXT\n"
+                 "  --min-time SECONDS  minimum time for each benchmark (default 0.5)\n"
+                 "  --json FILE         write the JSON results to FILE instead of standard output\n"
+                 "  --list              list the benchmarks without running them\n"
+                 "  --host NAME         database for the database benchmarks (default sqlite::memory:)\n"
+                 "  --user NAME         database user\n"
+                 "  --database NAME     database name (default gendat_bench)\n"
+                 "\n"
+                 "The database password is read from the GENDAT_PASSWORD environment variable.\n";
+}
+
+
+
+int main(int argc, char* argv[])
+{
+    std::string filter;
+    std::string json_file;
+    bool        list_only = false;
+    std::string db_host   = db_sqlite_memory;
+    std::string db_user;
+    std::string db_name   = "gendat_bench";
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--list")
+            list_only = true;
+        else if (arg == "--filter" && i + 1 < argc)
+            filter = argv[++i];
+        else if (arg == "--min-time" && i + 1 < argc)
+            min_time_s = atof(argv[++i]);
+        else if (arg == "--json" && i + 1 < argc)
+            json_file = argv[++i];
+        else if (arg == "--host" && i + 1 < argc)
+            db_host = argv[++i];
+        else if (arg == "--user" && i + 1 < argc)
+            db_user = argv[++i];
+        else if (arg == "--database" && i + 1 < argc)
+            db_name = argv[++i];
+        else
+        {
+            show_usage();
+            return 2;
+        }
+    }
+
+    std::vector<bench_def> benches;
+    add_benchmarks(benches);
+
+    // The database benchmarks are skipped if the database cannot be opened.
+
+    std::string backend = "none";
+    try
+    {
+        const char* passwd = getenv("GENDAT_PASSWORD");
+        auto db = std::make_shared<database>();
+        db->connect(db_host, db_user, passwd ? passwd : "", db_name);
+        db->set_query_stats(nullptr);
+        add_db_benchmarks(benches, db);
+        backend = db->backend_name();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Database benchmarks skipped: " << e.what() << "\n";
+    }
+
+    std::vector<bench_result> results;
+    for (const bench_def& bench : benches)
+    {
+        if (!filter.empty() && bench.name.find(filter) == std::string::npos)
+            continue;
+
+        if (list_only)
+        {
+            std::cout << bench.name << "\n";
+            continue;
+        }
+
+        bench_result result = run_bench(bench);
+        results.push_back(result);
+
+        fprintf(stderr, "%-45s %12.1f ns/op %10.2f allocs/op %12.1f bytes/op %10lld peak bytes\n",
+                result.name.c_str(), result.ns_per_op, result.allocs_per_op, result.bytes_per_op,
+                result.peak_bytes);
+    }
+
+    if (list_only)
+        return 0;
+
+    if (id_check_failed)
+        std::cerr << "\nid_manager: an identifier was held by two panels at once\n";
+
+    FILE* file = json_file.empty() ? stdout : fopen(json_file.c_str(), "w");
+    if (file == nullptr)
+    {
+        std::cerr << "Cannot open " << json_file << "\n";
+        return 1;
+    }
+    write_json(file, results, !id_check_failed, backend);
+    if (file != stdout)
+        fclose(file);
+
+    return id_check_failed ? 1 : 0;
+}
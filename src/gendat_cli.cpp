@@ -0,0 +1,844 @@
+///
+/// \file
+///
+/// \brief Command-line tool for batch jobs
+///
+/// gendat-cli runs the searches, exports and maintenance jobs of GenDat Explorer without
+/// wxWidgets, so that long jobs can be run on the database host (from cron, for example) with
+/// no display. Besides searches and GEDCOM exports, it rebuilds the derived tables (person
+/// mentions, census households and linkage candidates), keeps the change journal, and looks up
+/// relationships and names in PhpGedView. It is linked only with libgendat_core.a and the MySQL
+/// and SQLite client libraries.
+///
+/// Run `gendat-cli help` for the list of commands and options.
+///
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "database.h"
+#include "db_query_stats.h"
+#include "db_row_set.h"
+#include "db_snapshot.h"
+#include "gde_census.h"
+#include "gde_change_tracker.h"
+#include "gde_facets.h"
+#include "gde_family_graph.h"
+#include "gde_gedcom_export.h"
+#include "gde_kinship.h"
+#include "gde_linkage.h"
+#include "gde_mention_table.h"
+#include "gde_pgv_names.h"
+#include "gde_place_index.h"
+#include "gde_search_map.h"
+#include "gde_source_map.h"
+#include "gde_trace.h"
+
+
+// Options that apply to every command.
+
+struct cli_options
+{
+    std::string  host        = "localhost";
+    std::string  user        = "test_RO";
+    std::string  password;
+    std::string  db_name     = "zzz";
+    unsigned int num_threads = 0;
+    bool         show_stats  = false;
+    bool         show_help   = false;
+    std::string  trace_file;
+
+    // Options of the export command.
+
+    std::vector<std::string> sources;
+    std::string              condition;
+    std::string              submitter;
+
+    // Options of the search command.
+
+    std::vector<std::string> facets;
+    std::string              near_place;
+
+    // Options of the search and places commands.
+
+    double                   radius_km = 10.0;
+
+    // Options of the census command.
+
+    gde_census_columns       census_columns;
+};
+
+// GeoNAMES table with the coordinates of the places.
+
+static const char* const PLACE_TABLE = "ns_geonames";
+
+// Thrown for a bad command line. The usage message is shown.
+
+class usage_error : public std::runtime_error
+{
+public:
+    usage_error(const std::string& message) : std::runtime_error(message) {}
+};
+
+
+
+static void show_usage(std::ostream& out)
+{
+    out << "Usage: gendat-cli [options] command [arguments]\n"
+           "\n"
+           "Searches and exports:\n"
+           "  sources                     list the GenDat sources\n"
+           "  search SURNAME [GIVEN]      find the mentions of a person in all sources\n"
+           "  places NAME [COUNTY]        list the places within --radius km of a place\n"
+           "  sql QUERY                   run an SQL statement and write the result\n"
+           "  snapshot FILE QUERY         write the result of a query to a snapshot file\n"
+           "  show-snapshot FILE          write the contents of a snapshot file (no database needed)\n"
+           "  export FILE                 export sources to a GEDCOM file\n"
+           "\n"
+           "Derived tables and the change journal:\n"
+           "  build-mentions              rebuild the person mention table\n"
+           "  create-journal              create the change journal, so that edits are recorded\n"
+           "  refresh                     apply the change journal to the person mention table\n"
+           "  purge                       delete journal entries that have been applied\n"
+           "  census [DISTRICT SUB]       rebuild the census household tables, or one sub-district\n"
+           "\n"
+           "Linkage and families:\n"
+           "  link [TABLE]                find the mentions that may be the same person, and write\n"
+           "                              the ranked candidates to TABLE (default person_link)\n"
+           "  kinship ID ID...            name the relationship of the first PhpGedView individual\n"
+           "                              to each of the others\n"
+           "  pgv-names [ID...]           look up the names of PhpGedView individuals, in batches;\n"
+           "                              the IDs are read from standard input if none are given\n"
+           "\n"
+           "  help, --help, -h            show this message\n"
+           "\n"
+           "Results are written to standard output as tab-separated values, with \\N for NULL.\n"
+           "Arguments after \"--\" are not read as options, so that an SQL script that starts with\n"
+           "a comment can be run with: gendat-cli [options] -- sql \"$(cat load.sql)\"\n"
+           "\n"
+           "Options:\n"
+           "  --host NAME                 database server (default localhost), or sqlite:PATH\n"
+           "                              for an SQLite file or a directory of them\n"
+           "  --user NAME                 database user (default test_RO)\n"
+           "  --database NAME             database name (default zzz)\n"
+           "  --threads N                 worker threads, or 0 for one per core (default 0)\n"
+           "  --stats                     write the query statistics to standard error at the end\n"
+           "  --trace FILE                write a Chrome trace-event file at the end\n"
+           "  --source CODE               (export) source code, table or number; may be repeated.\n"
+           "                              All sources are exported if none are given.\n"
+           "  --where CONDITION           (export) SQL condition that selects the records\n"
+           "  --submitter NAME            (export) submitter named in the file header\n"
+           "  --facet COLUMN[=VALUE]      (search) count the mentions by the values of a column,\n"
+           "                              instead of listing them; may be repeated. With a value,\n"
+           "                              only the mentions with one of the values given are counted\n"
+           "                              in the other columns.\n"
+           "  --near PLACE                (search) only the mentions in the communities within\n"
+           "                              --radius km of a place in the GeoNAMES table\n"
+           "  --radius KM                 (search, places) distance from the place (default 10)\n"
+           "  --family-column NAME        (census) column with the family number (default family),\n"
+           "                              or \"\" for none. Used only if the table has it.\n"
+           "  --relation-column NAME      (census) column with the relation to the head of the\n"
+           "                              household (default relation), or \"\" for none. Used only\n"
+           "                              if the table has it.\n"
+           "\n"
+           "The password is read from the GENDAT_PASSWORD environment variable, so that it does\n"
+           "not show up in the process list.\n";
+}
+
+
+
+// Write one field of a result as tab-separated text. Tabs, newlines and backslashes in the data
+// are escaped as in the MySQL "SELECT ... INTO OUTFILE" format.
+
+static void write_field(std::ostream& out, bool is_set, const std::string& data)
+{
+    if (!is_set)
+    {
+        out << "\\N";
+        return;
+    }
+
+    for (char c : data)
+    {
+        switch (c)
+        {
+        case '\t': out << "\\t";  break;
+        case '\n': out << "\\n";  break;
+        case '\r': out << "\\r";  break;
+        case '\\': out << "\\\\"; break;
+        default:   out << c;      break;
+        }
+    }
+}
+
+
+
+static void write_row_set(std::ostream& out, const db_row_set& row_set)
+{
+    std::string data;
+
+    for (unsigned int col = 0; col < row_set.num_cols(); col++)
+        out << (col == 0 ? "" : "\t") << row_set.col_name(col);
+    out << "\n";
+
+    for (unsigned int row = 0; row < row_set.num_rows(); row++)
+    {
+        for (unsigned int col = 0; col < row_set.num_cols(); col++)
+        {
+            if (col != 0)
+                out << "\t";
+            bool is_set = row_set.get_data(row, col, data);
+            write_field(out, is_set, data);
+        }
+        out << "\n";
+    }
+}
+
+
+
+// Find the number of a source from its code, database table or number.
+
+static int find_source(const gde_source_map& sources, const std::string& name)
+{
+    for (int source_num = 0; source_num < sources.num_sources(); source_num++)
+    {
+        if (sources.src_code(source_num) == name || sources.src_db_table(source_num) == name)
+            return source_num;
+    }
+
+    char* end = nullptr;
+    long  num = strtol(name.c_str(), &end, 10);
+    if (!name.empty() && *end == '\0' && num >= 0 && num < sources.num_sources())
+        return (int)num;
+
+    throw usage_error("Unknown source: " + name);
+}
+
+
+
+static void cmd_sources(database& db, const cli_options&)
+{
+    gde_source_map sources;
+    sources.load_defs(db, "z_sour", "z_sour_field");
+
+    std::cout << "number\tcode\ttable\tname\n";
+    for (int source_num = 0; source_num < sources.num_sources(); source_num++)
+    {
+        std::cout << source_num << "\t" << sources.src_code(source_num) << "\t"
+                  << sources.src_db_table(source_num) << "\t" << sources.src_name(source_num) << "\n";
+    }
+}
+
+
+
+static void cmd_search(database& db, const cli_options& options, const std::vector<std::string>& args)
+{
+    if (args.empty() || args.size() > 2)
+        throw usage_error("search needs a surname, and optionally a given name");
+
+    gde_source_map sources;
+    sources.load_defs(db, "z_sour", "z_sour_field");
+
+    // Search near a place, if one was given.
+
+    gde_search_map search_map(sources);
+    if (!options.near_place.empty())
+    {
+        gde_place_index places;
+        places.load(db, PLACE_TABLE);
+        if (search_map.add_place_near(places, options.near_place, options.radius_km) == 0)
+            throw std::runtime_error("Place not found: " + options.near_place);
+    }
+
+    gde_mention_table mentions(sources);
+    db_row_set        row_set;
+    row_set.set_dict_encoding(!options.facets.empty());
+    mentions.find(db, args[0], (args.size() > 1) ? args[1] : "", search_map.communities(), row_set);
+
+    if (options.facets.empty())
+    {
+        write_row_set(std::cout, row_set);
+        std::cerr << row_set.num_rows() << " mentions found\n";
+        return;
+    }
+
+    // Add each column once, then select the values given.
+
+    gde_facets                                        facets(row_set);
+    std::vector<std::pair<unsigned int, std::string>> selections;
+    std::vector<std::string>                          facet_names;
+
+    for (const std::string& facet : options.facets)
+    {
+        size_t      equals = facet.find('=');
+        std::string name   = facet.substr(0, equals);
+
+        unsigned int num = std::find(facet_names.begin(), facet_names.end(), name) - facet_names.begin();
+        if (num == facet_names.size())
+        {
+            facets.add_facet(name);
+            facet_names.push_back(name);
+        }
+        if (equals != std::string::npos)
+            selections.emplace_back(num, facet.substr(equals + 1));
+    }
+
+    facets.aggregate();
+    for (auto& selection : selections)
+    {
+        unsigned int value;
+        if (facets.find_value(selection.first, selection.second, value))
+            facets.select(selection.first, value);
+        else
+            std::cerr << "No mention has " << facet_names[selection.first] << " = " << selection.second << "\n";
+    }
+
+    std::cout << "facet\tvalue\tcount\n";
+    for (unsigned int facet = 0; facet < facets.num_facets(); facet++)
+    {
+        for (unsigned int value = 0; value < facets.num_values(facet); value++)
+        {
+            std::cout << facet_names[facet] << "\t";
+            write_field(std::cout, !facets.value_is_null(facet, value), facets.value(facet, value));
+            std::cout << "\t" << facets.count(facet, value) << "\n";
+        }
+    }
+    std::cerr << facets.num_matches() << " of " << row_set.num_rows() << " mentions match\n";
+}
+
+
+
+// Run any SQL statement. Results are streamed, so that a large table can be dumped without
+// holding it in memory.
+
+static void cmd_sql(database& db, const cli_options&, const std::vector<std::string>& args)
+{
+    if (args.size() != 1)
+        throw usage_error("sql needs one SQL statement (in quotes)");
+
+    db_row_stream stream;
+    db.execute(args[0], stream);
+
+    if (!stream.is_open())
+        return;
+
+    for (unsigned int col = 0; col < stream.num_cols(); col++)
+        std::cout << (col == 0 ? "" : "\t") << stream.col_name(col);
+    std::cout << "\n";
+
+    std::string data;
+    while (stream.next_row())
+    {
+        for (unsigned int col = 0; col < stream.num_cols(); col++)
+        {
+            if (col != 0)
+                std::cout << "\t";
+            bool is_set = stream.get_data(col, data);
+            write_field(std::cout, is_set, data);
+        }
+        std::cout << "\n";
+    }
+    std::cerr << stream.row_num() << " rows\n";
+}
+
+
+
+// Write the result of a query to a snapshot file, so that it can be browsed without the database.
+
+static void cmd_snapshot(database& db, const cli_options&, const std::vector<std::string>& args)
+{
+    if (args.size() != 2)
+        throw usage_error("snapshot needs the name of the file, and one SQL query (in quotes)");
+
+    unsigned int num_rows = db_snapshot::write(db, args[1], args[0]);
+    std::cerr << num_rows << " rows written to " << args[0] << "\n";
+}
+
+
+
+static void cmd_show_snapshot(const std::vector<std::string>& args)
+{
+    if (args.size() != 1)
+        throw usage_error("show-snapshot needs the name of the snapshot file");
+
+    std::shared_ptr<const db_snapshot> snapshot = db_snapshot::open(args[0]);
+
+    db_row_set row_set;
+    row_set.load_snapshot(snapshot);
+    write_row_set(std::cout, row_set);
+
+    unsigned int num_dict = 0;
+    for (unsigned int col = 0; col < snapshot->num_cols(); col++)
+        num_dict += snapshot->is_dict_encoded(col);
+
+    std::cerr << snapshot->num_rows() << " rows, " << num_dict << " of " << snapshot->num_cols()
+              << " columns dictionary encoded, " << snapshot->file_size() << " bytes\n"
+              << "Query: " << snapshot->query() << "\n";
+}
+
+
+
+static void cmd_export(database& db, const cli_options& options, const std::vector<std::string>& args)
+{
+    if (args.size() != 1)
+        throw usage_error("export needs the name of the GEDCOM file");
+
+    gde_source_map sources;
+    sources.load_defs(db, "z_sour", "z_sour_field");
+
+    gde_gedcom_export exporter(sources);
+    std::vector<int>  source_list;
+
+    if (options.sources.empty())
+    {
+        for (int source_num = 0; source_num < sources.num_sources(); source_num++)
+            source_list.push_back(source_num);
+    }
+    else
+    {
+        for (const std::string& name : options.sources)
+            source_list.push_back(find_source(sources, name));
+    }
+
+    exporter.export_file(db, args[0], source_list, options.condition, options.submitter);
+    std::cerr << exporter.num_persons() << " persons and " << exporter.num_families()
+              << " families written to " << args[0] << "\n";
+}
+
+
+
+// Rebuild the person mention table. If the database has a change journal, the table is then
+// marked as up to date with it, so that the next refresh only applies later changes.
+
+static void cmd_build_mentions(database& db, const cli_options& options)
+{
+    gde_source_map sources;
+    sources.load_defs(db, "z_sour", "z_sour_field");
+
+    gde_mention_table mentions(sources);
+    mentions.set_num_threads(options.num_threads);
+
+    // Changes committed while the table is being built are applied again by the next refresh.
+
+    gde_change_tracker tracker;
+    bool               has_journal = tracker.journal_exists(db);
+    unsigned long long mark        = has_journal ? tracker.safe_mark(db) : 0;
+
+    unsigned int num_rows = mentions.build(db);
+    if (has_journal)
+        tracker.mark_current(db, &mentions, mark);
+
+    std::cerr << num_rows << " rows loaded into " << mentions.table_name() << "\n";
+}
+
+
+
+static void cmd_refresh(database& db, const cli_options&)
+{
+    gde_source_map sources;
+    sources.load_defs(db, "z_sour", "z_sour_field");
+
+    gde_mention_table  mentions(sources);
+    gde_change_tracker tracker;
+    if (!tracker.journal_exists(db))
+        throw std::runtime_error("There is no change journal (" + tracker.journal_table() + ") in this database");
+
+    tracker.add_derived(&mentions);
+    std::cerr << tracker.refresh(db) << " changed records applied\n";
+}
+
+
+
+// Create the change journal. Programs that edit the sources record their changes in it from
+// their next connection on.
+
+static void cmd_create_journal(database& db, const cli_options&)
+{
+    gde_change_tracker tracker;
+    tracker.create_tables(db);
+    std::cerr << "Change journal " << tracker.journal_table() << " created\n";
+}
+
+
+
+static void cmd_purge(database& db, const cli_options&)
+{
+    gde_change_tracker tracker;
+    if (!tracker.journal_exists(db))
+        throw std::runtime_error("There is no change journal (" + tracker.journal_table() + ") in this database");
+
+    std::cerr << tracker.purge(db) << " journal entries deleted\n";
+}
+
+
+
+static void cmd_census(database& db, const cli_options& options, const std::vector<std::string>& args)
+{
+    if (args.size() != 0 && args.size() != 2)
+        throw usage_error("census needs either no arguments, or a district and a sub-district");
+
+    gde_census_households census;
+    census.set_columns(options.census_columns);
+    census.set_num_threads(options.num_threads);
+
+    if (args.empty())
+        census.build(db);
+    else
+        census.build_district(db, args[0], args[1]);
+
+    census.create_tables(db);
+    census.write_to_db(db);
+    std::cerr << census.num_households() << " households with " << census.num_persons()
+              << " persons written\n";
+}
+
+
+
+// Run a linkage pass over the mentions in all sources, and replace the candidate table with
+// the results.
+
+static void cmd_link(database& db, const cli_options& options, const std::vector<std::string>& args)
+{
+    if (args.size() > 1)
+        throw usage_error("link needs at most the name of the candidate table");
+    std::string table = args.empty() ? "person_link" : args[0];
+
+    gde_source_map sources;
+    sources.load_defs(db, "z_sour", "z_sour_field");
+
+    gde_mention_extractor    extractor(sources);
+    std::vector<gde_mention> mentions;
+    extractor.extract_all(db, mentions);
+
+    // Report the mentions that cannot be linked, mostly those with no year of birth.
+
+    std::vector<unsigned int> num_mentions(sources.num_sources());
+    std::vector<unsigned int> num_unlinkable(sources.num_sources());
+    for (const gde_mention& m : mentions)
+    {
+        num_mentions[m.source]++;
+        if (!gde_linkage::linkable(m))
+            num_unlinkable[m.source]++;
+    }
+    for (int i = 0; i < sources.num_sources(); i++)
+    {
+        if (num_unlinkable[i] > 0)
+            std::cerr << sources.src_name(i) << ": " << num_unlinkable[i] << " of " << num_mentions[i]
+                      << " mentions have no year of birth or surname, and are not linked\n";
+    }
+
+    gde_linkage                     linkage;
+    std::vector<gde_link_candidate> links;
+    linkage.set_num_threads(options.num_threads);
+    linkage.run(mentions, links);
+
+    linkage.create_table(db, table);
+    linkage.write_to_db(db, table, sources, mentions, links);
+    std::cerr << links.size() << " candidate links for " << mentions.size() << " mentions written to "
+              << table << "\n";
+}
+
+
+
+// Name the relationship of the first PhpGedView individual to each of the others.
+
+static void cmd_kinship(database& db, const cli_options& options, const std::vector<std::string>& args)
+{
+    if (args.size() < 2)
+        throw usage_error("kinship needs at least two PhpGedView individual IDs");
+
+    gde_family_graph graph;
+    graph.load(db);
+
+    std::vector<int> persons;
+    for (const std::string& id : args)
+    {
+        int person = graph.find_person(id);
+        if (person < 0)
+            throw std::runtime_error("Individual not found: " + id);
+        persons.push_back(person);
+    }
+
+    std::vector<std::pair<int, int>> pairs;
+    for (size_t i=1; i<persons.size(); i++)
+        pairs.push_back(std::make_pair(persons[0], persons[i]));
+
+    gde_kinship                   kinship(graph);
+    std::vector<gde_relationship> results;
+    kinship.set_num_threads(options.num_threads);
+    kinship.relate_batch(pairs, results);
+
+    std::cout << "person\trelationship\tancestor\tancestor_2\tup\tdown\n";
+    for (const gde_relationship& r : results)
+    {
+        std::cout << graph.pgv_id(r.person_2) << "\t";
+        write_field(std::cout, !r.name.empty(), r.name);
+        std::cout << "\t";
+        write_field(std::cout, r.ancestor >= 0, (r.ancestor >= 0) ? graph.pgv_id(r.ancestor) : "");
+        std::cout << "\t";
+        write_field(std::cout, r.ancestor_2 >= 0, (r.ancestor_2 >= 0) ? graph.pgv_id(r.ancestor_2) : "");
+        std::cout << "\t";
+        write_field(std::cout, r.up >= 0, std::to_string(r.up));
+        std::cout << "\t";
+        write_field(std::cout, r.down >= 0, std::to_string(r.down));
+        std::cout << "\n";
+    }
+}
+
+
+
+// Look up the names of PhpGedView individuals, in batches. The IDs are read from standard
+// input if none are given, so that the n_id column of a query can be piped in. They may be
+// separated by any white space, and blank lines are skipped.
+
+static void cmd_pgv_names(database& db, const cli_options&, const std::vector<std::string>& args)
+{
+    std::vector<std::string> ids = args;
+    if (ids.empty())
+    {
+        std::string id;
+        while (std::cin >> id)
+            ids.push_back(id);
+    }
+
+    gde_pgv_names names;
+    unsigned int  num_queries = names.resolve(db, ids);
+
+    std::string name;
+    std::cout << "n_id\tname\n";
+    for (const std::string& id : ids)
+    {
+        if (id.empty())
+            continue;
+        bool found = names.get_name(id, name);
+        write_field(std::cout, true, id);
+        std::cout << "\t";
+        write_field(std::cout, found, name);
+        std::cout << "\n";
+    }
+    std::cerr << names.cache_size() << " individuals looked up with " << num_queries << " queries\n";
+}
+
+
+
+// List the places near a place, nearest first, with their distances.
+
+static void cmd_places(database& db, const cli_options& options, const std::vector<std::string>& args)
+{
+    if (args.empty() || args.size() > 2)
+        throw usage_error("places needs the name of a place, and optionally its county");
+
+    gde_place_index places;
+    places.load(db, PLACE_TABLE);
+
+    int centre = places.find_place(args[0], (args.size() > 1) ? args[1] : "");
+    if (centre < 0)
+        throw std::runtime_error("Place not found: " + args[0]);
+
+    double lat = places.place_lat(centre);
+    double lon = places.place_lon(centre);
+
+    std::vector<std::pair<double, int>> found;
+    for (int place : places.find_in_radius(lat, lon, options.radius_km))
+        found.emplace_back(gde_place_index::distance_km(lat, lon, places.place_lat(place), places.place_lon(place)), place);
+    std::sort(found.begin(), found.end());
+
+    std::cout << "place\tcounty\tlatitude\tlongitude\tdistance_km\n" << std::fixed;
+    for (auto& place : found)
+    {
+        std::cout << places.place_name(place.second) << "\t" << places.place_county(place.second) << "\t"
+                  << std::setprecision(5) << places.place_lat(place.second) << "\t"
+                  << places.place_lon(place.second) << "\t" << std::setprecision(1) << place.first << "\n";
+    }
+    std::cerr << found.size() << " of " << places.num_places() << " places within "
+              << options.radius_km << " km\n";
+}
+
+
+
+// Read the options, which come before the command. The remaining arguments are returned. After
+// "--", every argument is taken as it is, even if it starts with "--" (such as an SQL script
+// that starts with a comment).
+
+static std::vector<std::string> parse_options(int argc, char* argv[], cli_options& options)
+{
+    std::vector<std::string> args;
+
+    bool options_ended = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+
+        if (arg == "--" && !options_ended)
+        {
+            options_ended = true;
+            continue;
+        }
+
+        // Help takes no value, and may be asked for in the usual ways.
+
+        if (!options_ended && (arg == "--help" || arg == "-h"))
+        {
+            options.show_help = true;
+            continue;
+        }
+
+        if (options_ended || arg.size() < 2 || arg.compare(0, 2, "--") != 0)
+        {
+            args.push_back(arg);
+            continue;
+        }
+
+        if (arg == "--stats")
+        {
+            options.show_stats = true;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+            throw usage_error("Missing value for " + arg);
+        std::string value = argv[++i];
+
+        if (arg == "--host")
+            options.host = value;
+        else if (arg == "--user")
+            options.user = value;
+        else if (arg == "--database")
+            options.db_name = value;
+        else if (arg == "--threads")
+            options.num_threads = (unsigned int)strtoul(value.c_str(), nullptr, 10);
+        else if (arg == "--trace")
+            options.trace_file = value;
+        else if (arg == "--source")
+            options.sources.push_back(value);
+        else if (arg == "--where")
+            options.condition = value;
+        else if (arg == "--submitter")
+            options.submitter = value;
+        else if (arg == "--facet")
+            options.facets.push_back(value);
+        else if (arg == "--near")
+            options.near_place = value;
+        else if (arg == "--radius")
+            options.radius_km = strtod(value.c_str(), nullptr);
+        else if (arg == "--family-column")
+            options.census_columns.family = value;
+        else if (arg == "--relation-column")
+            options.census_columns.relation = value;
+        else
+            throw usage_error("Unknown option " + arg);
+    }
+
+    const char* password = getenv("GENDAT_PASSWORD");
+    if (password != nullptr)
+        options.password = password;
+
+    return args;
+}
+
+
+
+static void run_command(database& db, const cli_options& options, const std::string& command,
+                        const std::vector<std::string>& args)
+{
+    gde_trace_span span("gendat-cli command", "cli");
+
+    if (command == "sources")
+        cmd_sources(db, options);
+    else if (command == "search")
+        cmd_search(db, options, args);
+    else if (command == "sql")
+        cmd_sql(db, options, args);
+    else if (command == "snapshot")
+        cmd_snapshot(db, options, args);
+    else if (command == "show-snapshot")
+        cmd_show_snapshot(args);
+    else if (command == "export")
+        cmd_export(db, options, args);
+    else if (command == "build-mentions")
+        cmd_build_mentions(db, options);
+    else if (command == "create-journal")
+        cmd_create_journal(db, options);
+    else if (command == "refresh")
+        cmd_refresh(db, options);
+    else if (command == "purge")
+        cmd_purge(db, options);
+    else if (command == "census")
+        cmd_census(db, options, args);
+    else if (command == "places")
+        cmd_places(db, options, args);
+    else if (command == "link")
+        cmd_link(db, options, args);
+    else if (command == "kinship")
+        cmd_kinship(db, options, args);
+    else if (command == "pgv-names")
+        cmd_pgv_names(db, options, args);
+    else
+        throw usage_error("Unknown command " + command);
+}
+
+
+
+int main(int argc, char* argv[])
+{
+    cli_options options;
+    int         exit_code = 0;
+
+    gde_trace::set_thread_name("main");
+
+    try
+    {
+        std::vector<std::string> args = parse_options(argc, argv, options);
+        bool help = options.show_help || (!args.empty() && args[0] == "help");
+        if (help || args.empty())
+        {
+            show_usage(help ? std::cout : std::cerr);
+            return help ? 0 : 2;
+        }
+
+        std::string command = args[0];
+        args.erase(args.begin());
+
+        // A snapshot is read without the database.
+
+        database db;
+        if (command != "show-snapshot")
+            db.connect(options.host, options.user, options.password, options.db_name);
+        run_command(db, options, command, args);
+    }
+    catch (usage_error& exception)
+    {
+        std::cerr << "gendat-cli: " << exception.what() << "\n\n";
+        show_usage(std::cerr);
+        exit_code = 2;
+    }
+    catch (std::exception& exception)
+    {
+        std::cerr << "gendat-cli: " << exception.what() << "\n";
+        exit_code = 1;
+    }
+
+    if (options.show_stats)
+        std::cerr << "\n" << db_query_stats::shared().report();
+
+    if (!options.trace_file.empty())
+    {
+        try
+        {
+            gde_trace::save(options.trace_file);
+        }
+        catch (std::runtime_error& exception)
+        {
+            std::cerr << "gendat-cli: " << exception.what() << "\n";
+            exit_code = 1;
+        }
+    }
+
+    return exit_code;
+}
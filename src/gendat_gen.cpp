@@ -0,0 +1,1829 @@
+///
+/// \file
+///
+/// \brief Synthetic dataset generator
+///
+/// gendat-gen writes a synthetic GenDat database as tab-separated files, with a script
+/// (load.sql) that creates the tables and bulk-loads the files into a local MariaDB or MySQL
+/// server. The data have the shape of the real database, so that searches, linkage and grid
+/// loading can be timed at production scale without copying the production data:
+///
+/// - the NS birth, marriage and death index tables (`ns_births`, `ns_marriages`, `ns_deaths`),
+///   and their transcription tables (`ns_births_data` and so on) with the fields edited in
+///   `gdw_edit` and the web scripts;
+/// - the 1871 census table (`1871_census_data`), in enumeration order, one household after
+///   another;
+/// - the `z_sour` and `z_sour_field` catalog that describes these sources;
+/// - the `ns_geonames` place names;
+/// - the PhpGedView tables (`pgv_individuals`, `pgv_families` and `pgv_name`), in their own
+///   database.
+///
+/// Surnames, given names and places are drawn from Zipf-like distributions over Nova Scotia
+/// names, with a long tail of rarer names and occasional transcription variants ("McDonald" for
+/// "MacDonald"). Part of the vital records are made from people in the PhpGedView family tree,
+/// with their cross-references filled in, so that record linkage has true matches to find.
+///
+/// The output is determined by the options and the random seed. Each table is written by its
+/// own thread, and rows are streamed to the files, so the memory used depends only on the size
+/// of the family tree.
+///
+/// Run `gendat-gen help` for the options.
+///
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// Options of the generator.
+
+struct gen_options
+{
+    std::string  out_dir     = "gendat-data";
+    unsigned long num_rows   = 10000;
+    unsigned int seed        = 1871;
+    double       transcribed = 0.25;         // fraction of index records with a transcription
+    double       linked      = 0.4;          // fraction of transcriptions made from the family tree
+    std::string  pgv_db      = "phpgedview";
+    std::vector<std::string> tables;         // table groups to write; all if empty
+    bool         show_help   = false;
+};
+
+// Thrown for a bad command line. The usage message is shown.
+
+class usage_error : public std::runtime_error
+{
+public:
+    usage_error(const std::string& message) : std::runtime_error(message) {}
+};
+
+static const char* table_groups[] = { "births", "marriages", "deaths", "census", "catalog", "places", "pgv" };
+
+
+
+static void show_usage(std::ostream& out)
+{
+    out << "Usage: gendat-gen [options]\n"
+           "\n"
+           "Writes a synthetic GenDat database as tab-separated files, and a script load.sql that\n"
+           "loads them. Load the files with\n"
+           "\n"
+           "    cd DIR && mysql --local-infile=1 DATABASE < load.sql\n"
+           "\n"
+           "or, into SQLite files in DIR, with\n"
+           "\n"
+           "    cd DIR && gendat-cli --host sqlite:. --database DATABASE -- sql \"$(cat load.sql)\"\n"
+           "\n"
+           "Options:\n"
+           "  --out DIR                   output directory (default gendat-data)\n"
+           "  --rows N                    rows in ns_births and 1871_census_data (default 10000).\n"
+           "                              ns_deaths gets 0.6 N rows, ns_marriages 0.4 N and the\n"
+           "                              family tree 0.2 N individuals.\n"
+           "  --seed N                    random seed (default 1871)\n"
+           "  --transcribed FRACTION      index records that have a transcription (default 0.25)\n"
+           "  --linked FRACTION           transcriptions of people in the family tree (default 0.4)\n"
+           "  --pgv-database NAME         database of the PhpGedView tables (default phpgedview)\n"
+           "  --tables LIST               comma-separated table groups to write (default all):\n"
+           "                              births, marriages, deaths, census, catalog, places, pgv\n"
+           "  help, --help, -h            show this message\n";
+}
+
+
+
+//**************************************************************************************************
+// Distributions
+//**************************************************************************************************
+
+// Random choice of an index, with given weights.
+
+class weighted_pool
+{
+public:
+    void add(double weight)
+    {
+        total += weight;
+        cumulative.push_back(total);
+    }
+
+    size_t pick(std::mt19937& rng) const
+    {
+        double x = std::uniform_real_distribution<double>(0.0, total)(rng);
+        size_t i = std::upper_bound(cumulative.begin(), cumulative.end(), x) - cumulative.begin();
+        return std::min(i, cumulative.size() - 1);
+    }
+
+    size_t size() const { return cumulative.size(); }
+
+private:
+    std::vector<double> cumulative;
+    double              total = 0;
+};
+
+// Names with a Zipf distribution: the name of rank r (from 0) has weight 1 / (r + 1)^s.
+
+class name_pool
+{
+public:
+    void add(const std::string& name)
+    {
+        weights.add(1.0 / std::pow(names.size() + 1.0, exponent));
+        names.push_back(name);
+    }
+
+    const std::string& pick(std::mt19937& rng) const { return names[weights.pick(rng)]; }
+    const std::string& name(size_t i) const { return names[i]; }
+    size_t             pick_index(std::mt19937& rng) const { return weights.pick(rng); }
+    size_t             size() const { return names.size(); }
+
+    double exponent = 1.0;
+
+private:
+    std::vector<std::string> names;
+    weighted_pool            weights;
+};
+
+template <size_t N>
+static const char* pick(const char* (&list)[N], std::mt19937& rng)
+{
+    return list[rng() % N];
+}
+
+static bool chance(double p, std::mt19937& rng)
+{
+    return std::uniform_real_distribution<double>(0.0, 1.0)(rng) < p;
+}
+
+
+
+// The most common surnames, in decreasing order of frequency.
+
+static const char* common_surnames[] =
+{
+    "MacDonald", "MacNeil", "MacKinnon", "MacLean", "Fraser", "MacKenzie", "Campbell", "MacLeod",
+    "Chisholm", "MacIsaac", "Cameron", "MacInnis", "Smith", "Boudreau", "LeBlanc", "Murphy",
+    "MacPherson", "Morrison", "MacMillan", "MacGillivray", "Grant", "Sutherland", "Munro", "Ross",
+    "Gillis", "Matheson", "Robertson", "Beaton", "Doucet", "Comeau", "Thibodeau", "Landry",
+    "Walsh", "O'Brien", "Power", "Kelly", "Ryan", "Sullivan", "Brown", "Johnson", "Miller",
+    "Wilson", "Taylor", "Martin", "Young", "Hiltz", "Zinck", "Conrad", "Ernst", "Publicover",
+    "Crowell", "Nickerson", "Stewart", "Harding", "Morash", "Corkum", "Mosher", "Eisenhauer",
+    "Rafuse", "Whynot"
+};
+
+// Gaelic stems and syllables for the long tail of rarer surnames.
+
+static const char* gaelic_stems[] =
+{
+    "Askill", "Aulay", "Bain", "Callum", "Caskill", "Cormack", "Coll", "Dougall", "Eachern",
+    "Ewan", "Farlane", "Gregor", "Gilvray", "Intyre", "Iver", "Kay", "Kenna", "Killop", "Lennan",
+    "Lellan", "Master", "Millan", "Nab", "Naughton", "Phail", "Phee", "Quarrie", "Rae",
+    "Ritchie", "Varish"
+};
+static const char* tail_first[] =
+{
+    "Bel", "Cor", "Dun", "Fer", "Gal", "Har", "Kel", "Lan", "Mor", "Nor", "Pel", "Ros", "Sut",
+    "Thi", "Wen", "Ald", "Bur", "Cam", "Dal", "Est"
+};
+static const char* tail_middle[] = { "", "a", "e", "i", "o", "en", "er", "ing" };
+static const char* tail_last[] =
+{
+    "ton", "well", "ford", "by", "ley", "man", "son", "er", "ard", "ville", "eau", "ier", "and",
+    "ock", "in"
+};
+
+static const char* male_given[] =
+{
+    "John", "Donald", "Alexander", "Angus", "William", "James", "Hugh", "Archibald", "Roderick",
+    "Allan", "Neil", "Malcolm", "Duncan", "Ronald", "Daniel", "Dougald", "Joseph", "George",
+    "Thomas", "Charles", "Peter", "Michael", "Patrick", "Samuel", "Robert", "Lauchlin", "Colin",
+    "Kenneth", "Jean", "Pierre"
+};
+static const char* female_given[] =
+{
+    "Mary", "Catherine", "Margaret", "Ann", "Christy", "Sarah", "Flora", "Jane", "Isabella",
+    "Elizabeth", "Jessie", "Janet", "Effie", "Annie", "Marcella", "Johanna", "Bridget", "Ellen",
+    "Agnes", "Martha", "Rebecca", "Susan", "Louisa", "Emily", "Marguerite", "Rose", "Helen",
+    "Barbara", "Peggy", "Harriet"
+};
+static const char* month_names[] =
+{
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+};
+
+
+
+// Counties, with their population in 1871 (in thousands) and their principal communities.
+
+struct county_def
+{
+    const char* name;
+    int         population;
+    double      lat;
+    double      lon;
+    const char* communities[6];
+};
+
+static const county_def counties[] =
+{
+    { "Annapolis",   18, 44.74, -65.51, { "Annapolis Royal", "Bridgetown", "Middleton", "Lawrencetown", "Granville Ferry", "Paradise" } },
+    { "Antigonish",  16, 45.62, -61.99, { "Antigonish", "St. Andrews", "Heatherton", "Tracadie", "Lochaber", "Pomquet" } },
+    { "Cape Breton", 26, 46.14, -60.19, { "Sydney", "North Sydney", "Glace Bay", "Louisbourg", "Sydney Mines", "Boularderie" } },
+    { "Colchester",  23, 45.36, -63.28, { "Truro", "Stewiacke", "Tatamagouche", "Great Village", "Onslow", "Economy" } },
+    { "Cumberland",  23, 45.83, -64.21, { "Amherst", "Parrsboro", "Pugwash", "Springhill", "River Hebert", "Wallace" } },
+    { "Digby",       17, 44.62, -65.76, { "Digby", "Weymouth", "Church Point", "Bear River", "Meteghan", "Sandy Cove" } },
+    { "Guysborough", 16, 45.39, -61.50, { "Guysborough", "Canso", "Sherbrooke", "Isaac's Harbour", "Country Harbour", "Goshen" } },
+    { "Halifax",     56, 44.65, -63.57, { "Halifax", "Dartmouth", "Musquodoboit", "Sheet Harbour", "Bedford", "Ketch Harbour" } },
+    { "Hants",       21, 44.99, -64.13, { "Windsor", "Hantsport", "Maitland", "Walton", "Kempt", "Rawdon" } },
+    { "Inverness",   23, 46.23, -61.30, { "Port Hood", "Mabou", "Margaree", "Inverness", "Judique", "Cheticamp" } },
+    { "Kings",       21, 45.08, -64.50, { "Kentville", "Wolfville", "Berwick", "Canning", "Aylesford", "Waterville" } },
+    { "Lunenburg",   23, 44.38, -64.31, { "Lunenburg", "Mahone Bay", "Bridgewater", "Chester", "New Germany", "LaHave" } },
+    { "Pictou",      32, 45.68, -62.71, { "Pictou", "New Glasgow", "Stellarton", "Westville", "River John", "Merigomish" } },
+    { "Queens",      10, 44.04, -64.72, { "Liverpool", "Caledonia", "Milton", "Port Medway", "Brooklyn", "Greenfield" } },
+    { "Richmond",    14, 45.59, -61.00, { "Arichat", "St. Peter's", "Petit-de-Grat", "River Bourgeois", "L'Ardoise", "D'Escousse" } },
+    { "Shelburne",   12, 43.76, -65.32, { "Shelburne", "Barrington", "Lockeport", "Clark's Harbour", "Jordan Falls", "Port La Tour" } },
+    { "Victoria",    11, 46.10, -60.75, { "Baddeck", "Ingonish", "Cape North", "Middle River", "Big Bras d'Or", "Englishtown" } },
+    { "Yarmouth",    18, 43.84, -66.12, { "Yarmouth", "Tusket", "Wedgeport", "Pubnico", "Arcadia", "Hebron" } }
+};
+
+static const unsigned int NUM_COUNTIES = sizeof(counties) / sizeof(counties[0]);
+
+// Smaller places are named after the communities.
+
+static const char* place_prefixes[] = { "North ", "South ", "East ", "West ", "Upper ", "Lower ", "Middle " };
+static const char* place_suffixes[] = { " Road", " Mills", " Harbour", " Station", " Brook", " Mountain", " Cross Roads" };
+
+
+
+// A place name, as in the ns_geonames table.
+
+struct place_def
+{
+    std::string  name;
+    unsigned int county;
+    const char*  generic;
+    double       lat;
+    double       lon;
+};
+
+// The names and places shared by all tables. They are built once, and then only read.
+
+class gen_model
+{
+public:
+    void build_names(std::mt19937& rng);
+    void build_places(std::mt19937& rng);
+
+    std::string surname(std::mt19937& rng, double variant_rate = 0) const;
+    std::string given(char sex, std::mt19937& rng) const;
+    size_t      place(std::mt19937& rng) const { return place_weights.pick(rng); }
+    std::string place_text(size_t place) const;
+
+    name_pool              surnames;
+    name_pool              male_names;
+    name_pool              female_names;
+    std::vector<place_def> places;
+    weighted_pool          place_weights;
+
+    static std::string variant(const std::string& name, std::mt19937& rng);
+};
+
+
+
+void gen_model::build_names(std::mt19937& rng)
+{
+    for (const char* name : common_surnames)
+        surnames.add(name);
+
+    // The long tail, in random order so that rank does not follow the spelling.
+
+    std::vector<std::string> tail;
+    for (const char* stem : gaelic_stems)
+    {
+        tail.push_back(std::string("Mac") + stem);
+        tail.push_back(std::string("Mc") + stem);
+    }
+    for (const char* first : tail_first)
+        for (const char* middle : tail_middle)
+            for (const char* last : tail_last)
+                tail.push_back(std::string(first) + middle + last);
+
+    std::shuffle(tail.begin(), tail.end(), rng);
+    for (const std::string& name : tail)
+        surnames.add(name);
+
+    male_names.exponent   = 0.9;
+    female_names.exponent = 0.9;
+    for (const char* name : male_given)
+        male_names.add(name);
+    for (const char* name : female_given)
+        female_names.add(name);
+}
+
+
+
+// The communities of each county get most of the weight, shared in proportion to the county
+// population. The smaller places named after them share the rest.
+
+void gen_model::build_places(std::mt19937& rng)
+{
+    for (unsigned int county = 0; county < NUM_COUNTIES; county++)
+    {
+        const county_def& def = counties[county];
+        for (unsigned int c = 0; c < 6; c++)
+        {
+            double lat = def.lat + (rng() % 2000) / 5000.0 - 0.2;
+            double lon = def.lon + (rng() % 2000) / 5000.0 - 0.2;
+
+            places.push_back({ def.communities[c], county, "Community", lat, lon });
+            place_weights.add(def.population / (c + 1.0));
+
+            for (const char* prefix : place_prefixes)
+            {
+                places.push_back({ prefix + std::string(def.communities[c]), county, "Community",
+                                   lat + (rng() % 100) / 1000.0, lon + (rng() % 100) / 1000.0 });
+                place_weights.add(def.population / (c + 1.0) / 20);
+            }
+            for (const char* suffix : place_suffixes)
+            {
+                places.push_back({ def.communities[c] + std::string(suffix), county,
+                                   (std::string(suffix) == " Harbour") ? "Harbour" : "Community",
+                                   lat + (rng() % 100) / 1000.0, lon + (rng() % 100) / 1000.0 });
+                place_weights.add(def.population / (c + 1.0) / 25);
+            }
+        }
+    }
+}
+
+
+
+std::string gen_model::surname(std::mt19937& rng, double variant_rate) const
+{
+    const std::string& name = surnames.pick(rng);
+    return chance(variant_rate, rng) ? variant(name, rng) : name;
+}
+
+
+
+std::string gen_model::given(char sex, std::mt19937& rng) const
+{
+    const name_pool& pool = (sex == 'M') ? male_names : female_names;
+
+    // About one person in four has a second given name.
+
+    std::string name = pool.pick(rng);
+    if (rng() % 4 == 0)
+        name += " " + pool.pick(rng);
+    return name;
+}
+
+
+
+std::string gen_model::place_text(size_t place) const
+{
+    return places[place].name + ", " + counties[places[place].county].name + " Co.";
+}
+
+
+
+// A transcription variant of a name, of the kinds seen in the indexes: Mac and Mc exchanged, a
+// doubled letter written once, or a letter doubled.
+
+std::string gen_model::variant(const std::string& name, std::mt19937& rng)
+{
+    if (name.compare(0, 3, "Mac") == 0)
+        return "Mc" + name.substr(3);
+    if (name.compare(0, 2, "Mc") == 0)
+        return "Mac" + name.substr(2);
+
+    if (name.size() < 4)
+        return name;
+
+    for (size_t i = 1; i + 1 < name.size(); i++)
+        if (name[i] == name[i + 1])
+            return name.substr(0, i) + name.substr(i + 1);
+
+    size_t i = 1 + rng() % (name.size() - 2);
+    return name.substr(0, i) + name[i] + name.substr(i);
+}
+
+
+
+//**************************************************************************************************
+// Family tree
+//**************************************************************************************************
+
+// The PhpGedView family tree is built in memory first, since the vital records are partly made
+// from it. A person has at most one family as a spouse.
+
+struct pgv_person
+{
+    int32_t  surname;        // index in gen_model::surnames
+    int32_t  given;          // index in the name pool of the person's sex, or -1 if unknown
+    int32_t  second_given;   // second given name, or -1
+    int32_t  place;          // birth place
+    int32_t  famc = -1;      // family as a child
+    int32_t  fams = -1;      // family as a spouse
+    int16_t  birth_year;
+    char     sex;
+};
+
+struct pgv_family
+{
+    int32_t  husband;
+    int32_t  wife;
+    int32_t  first_child;    // the children of a family are numbered consecutively
+    int16_t  num_children;
+    int16_t  year;           // year of the marriage
+    int32_t  place;
+};
+
+class gen_tree
+{
+public:
+    void build(const gen_model& model, unsigned long num_persons, std::mt19937& rng);
+
+    std::string  surname   (int32_t person) const;
+    std::string  given     (int32_t person) const;
+    std::string  full_name (int32_t person) const;
+
+    int32_t      person_born     (int first_year, int last_year, std::mt19937& rng) const;
+    int32_t      family_married  (int first_year, int last_year, std::mt19937& rng) const;
+
+    static std::string indi_id (int32_t person) { return "I" + std::to_string(person + 1); }
+    static std::string fam_id  (int32_t family) { return "F" + std::to_string(family + 1); }
+
+    std::vector<pgv_person> persons;
+    std::vector<pgv_family> families;
+
+private:
+    const gen_model* my_model = nullptr;
+
+    int32_t  new_person(char sex, int32_t surname, int birth_year, int32_t place, std::mt19937& rng);
+
+    // Persons and families in order of birth and marriage year, for choosing one in a period.
+
+    std::vector<int32_t> persons_by_year;
+    std::vector<int16_t> person_years;
+    std::vector<int32_t> families_by_year;
+    std::vector<int16_t> family_years;
+};
+
+
+
+int32_t gen_tree::new_person(char sex, int32_t surname, int birth_year, int32_t place, std::mt19937& rng)
+{
+    const name_pool& pool = (sex == 'M') ? my_model->male_names : my_model->female_names;
+
+    pgv_person person;
+    person.surname      = surname;
+    person.given        = (rng() % 50 == 0) ? -1 : (int32_t)pool.pick_index(rng);
+    person.second_given = (rng() % 4 == 0) ? (int32_t)pool.pick_index(rng) : -1;
+    person.place        = place;
+    person.birth_year   = (int16_t)birth_year;
+    person.sex          = sex;
+
+    persons.push_back(person);
+    return (int32_t)persons.size() - 1;
+}
+
+
+
+// Couples are formed from the unmarried children of earlier families where possible, and
+// otherwise from new people with no parents in the tree, until the tree has the requested size.
+
+void gen_tree::build(const gen_model& model, unsigned long num_persons, std::mt19937& rng)
+{
+    my_model = &model;
+    persons.clear();
+    families.clear();
+    persons.reserve(num_persons + 16);
+    families.reserve(num_persons / 3 + 16);
+
+    std::vector<int32_t> single_men;
+    std::vector<int32_t> single_women;
+
+    auto take = [] (std::vector<int32_t>& list, size_t i)
+    {
+        int32_t person = list[i];
+        list[i] = list.back();
+        list.pop_back();
+        return person;
+    };
+
+    while (persons.size() < num_persons)
+    {
+        // The wife is an unmarried woman of the tree or a newcomer. The husband is an unmarried
+        // man of the tree of about her age, if one is chosen, or a newcomer.
+
+        int32_t wife = (!single_women.empty() && rng() % 10 < 6) ? take(single_women, rng() % single_women.size()) :
+            new_person('F', (int32_t)model.surnames.pick_index(rng), 1770 + rng() % 90, (int32_t)model.place(rng), rng);
+        int     wife_year = persons[wife].birth_year;
+        int32_t husband   = -1;
+
+        if (!single_men.empty() && rng() % 10 < 6)
+        {
+            size_t i    = rng() % single_men.size();
+            int    diff = persons[single_men[i]].birth_year - wife_year;
+            if (diff >= -12 && diff <= 4 && persons[single_men[i]].surname != persons[wife].surname)
+                husband = take(single_men, i);
+        }
+        if (husband < 0)
+        {
+            int32_t surname;
+            do
+                surname = (int32_t)model.surnames.pick_index(rng);
+            while (surname == persons[wife].surname);
+            husband = new_person('M', surname, wife_year - rng() % 10, (int32_t)model.place(rng), rng);
+        }
+
+        int year = wife_year + 18 + rng() % 12;
+        if (year > 1950)
+            continue;
+
+        pgv_family family;
+        family.husband      = husband;
+        family.wife         = wife;
+        family.first_child  = (int32_t)persons.size();
+        family.num_children = (int16_t)((rng() % 3) + (rng() % 4) + (rng() % 5));
+        family.year         = (int16_t)year;
+        family.place        = (rng() % 2) ? persons[wife].place : persons[husband].place;
+
+        int32_t family_num = (int32_t)families.size();
+        persons[husband].fams = family_num;
+        persons[wife].fams    = family_num;
+
+        int birth_year = year;
+        for (int c = 0; c < family.num_children; c++)
+        {
+            birth_year += 1 + rng() % 3;
+            char    sex   = (rng() % 2) ? 'M' : 'F';
+            int32_t child = new_person(sex, persons[husband].surname, birth_year, family.place, rng);
+            persons[child].famc = family_num;
+            (sex == 'M' ? single_men : single_women).push_back(child);
+        }
+
+        families.push_back(family);
+    }
+
+    persons_by_year.resize(persons.size());
+    for (size_t i = 0; i < persons.size(); i++)
+        persons_by_year[i] = (int32_t)i;
+    std::stable_sort(persons_by_year.begin(), persons_by_year.end(),
+                     [this] (int32_t a, int32_t b) { return persons[a].birth_year < persons[b].birth_year; });
+    person_years.resize(persons.size());
+    for (size_t i = 0; i < persons.size(); i++)
+        person_years[i] = persons[persons_by_year[i]].birth_year;
+
+    families_by_year.resize(families.size());
+    for (size_t i = 0; i < families.size(); i++)
+        families_by_year[i] = (int32_t)i;
+    std::stable_sort(families_by_year.begin(), families_by_year.end(),
+                     [this] (int32_t a, int32_t b) { return families[a].year < families[b].year; });
+    family_years.resize(families.size());
+    for (size_t i = 0; i < families.size(); i++)
+        family_years[i] = families[families_by_year[i]].year;
+}
+
+
+
+std::string gen_tree::surname(int32_t person) const
+{
+    return my_model->surnames.name(persons[person].surname);
+}
+
+
+
+// The given names, or "@P.N." if they are unknown, as PhpGedView records them.
+
+std::string gen_tree::given(int32_t person) const
+{
+    const pgv_person& p    = persons[person];
+    const name_pool&  pool = (p.sex == 'M') ? my_model->male_names : my_model->female_names;
+
+    if (p.given < 0)
+        return "@P.N.";
+    if (p.second_given < 0)
+        return pool.name(p.given);
+    return pool.name(p.given) + " " + pool.name(p.second_given);
+}
+
+
+
+std::string gen_tree::full_name(int32_t person) const
+{
+    return given(person) + " " + surname(person);
+}
+
+
+
+// A person born in the given period, or -1 if there is none.
+
+int32_t gen_tree::person_born(int first_year, int last_year, std::mt19937& rng) const
+{
+    size_t begin = std::lower_bound(person_years.begin(), person_years.end(), first_year) - person_years.begin();
+    size_t end   = std::upper_bound(person_years.begin(), person_years.end(), last_year) - person_years.begin();
+    return (begin < end) ? persons_by_year[begin + rng() % (end - begin)] : -1;
+}
+
+
+
+// A family formed in the given period, or -1 if there is none.
+
+int32_t gen_tree::family_married(int first_year, int last_year, std::mt19937& rng) const
+{
+    size_t begin = std::lower_bound(family_years.begin(), family_years.end(), first_year) - family_years.begin();
+    size_t end   = std::upper_bound(family_years.begin(), family_years.end(), last_year) - family_years.begin();
+    return (begin < end) ? families_by_year[begin + rng() % (end - begin)] : -1;
+}
+
+
+
+//**************************************************************************************************
+// Output
+//**************************************************************************************************
+
+// A tab-separated file in the format of MySQL "LOAD DATA INFILE": tabs, newlines and
+// backslashes escaped, and \N for NULL.
+
+class tsv_file
+{
+public:
+    tsv_file(const std::string& path) : my_path(path)
+    {
+        file = fopen(path.c_str(), "w");
+        if (file == nullptr)
+            throw std::runtime_error("Cannot create " + path + ": " + strerror(errno));
+        setvbuf(file, nullptr, _IOFBF, 1 << 20);
+    }
+
+    ~tsv_file()
+    {
+        if (file != nullptr)
+            fclose(file);
+    }
+
+    tsv_file(const tsv_file&) = delete;
+    tsv_file& operator=(const tsv_file&) = delete;
+
+    void field(const std::string& data)
+    {
+        separator();
+
+        // Most fields need no escapes, and are written at once.
+
+        if (data.find_first_of("\t\n\r\\") == std::string::npos)
+        {
+            fwrite(data.data(), 1, data.size(), file);
+            return;
+        }
+
+        for (char c : data)
+        {
+            switch (c)
+            {
+            case '\t': fputs("\\t",  file); break;
+            case '\n': fputs("\\n",  file); break;
+            case '\r': fputs("\\r",  file); break;
+            case '\\': fputs("\\\\", file); break;
+            default:   putc(c, file);       break;
+            }
+        }
+    }
+
+    void field(long value)
+    {
+        separator();
+        fprintf(file, "%ld", value);
+    }
+
+    void field(double value, int decimals)
+    {
+        separator();
+        fprintf(file, "%.*f", decimals, value);
+    }
+
+    // An empty string is written as NULL.
+
+    void field_or_null(const std::string& data)
+    {
+        if (data.empty())
+            null();
+        else
+            field(data);
+    }
+
+    void null()
+    {
+        separator();
+        fputs("\\N", file);
+    }
+
+    void end_row()
+    {
+        putc('\n', file);
+        first = true;
+    }
+
+    void close()
+    {
+        bool failed = (ferror(file) != 0);
+        failed |= (fclose(file) != 0);
+        file = nullptr;
+        if (failed)
+            throw std::runtime_error("Error writing " + my_path);
+    }
+
+private:
+    void separator()
+    {
+        if (!first)
+            putc('\t', file);
+        first = false;
+    }
+
+    FILE*       file  = nullptr;
+    std::string my_path;
+    bool        first = true;
+};
+
+
+
+// Description of one output table, for load.sql.
+
+struct gen_table
+{
+    std::string  group;          // table group of the --tables option
+    std::string  name;
+    bool         in_pgv_db;      // the table is in the PhpGedView database
+    std::string  definition;     // column and key definitions of CREATE TABLE
+};
+
+static const gen_table gen_tables[] =
+{
+    { "births", "ns_births", false,
+      "BirthID INT UNSIGNED NOT NULL, RegBook VARCHAR(8) NOT NULL, RegPage VARCHAR(8) NOT NULL, "
+      "LastName VARCHAR(64) NOT NULL, FirstName VARCHAR(64) NOT NULL, Place VARCHAR(64) NULL, "
+      "County VARCHAR(32) NOT NULL, Year SMALLINT UNSIGNED NOT NULL, Month TINYINT UNSIGNED NULL, "
+      "Day TINYINT UNSIGNED NULL, PRIMARY KEY (BirthID), KEY (LastName, FirstName), KEY (Year)" },
+    { "births", "ns_births_data", false,
+      "BirthID INT UNSIGNED NOT NULL, name VARCHAR(128) NULL, birth_date VARCHAR(32) NULL, "
+      "birth_place VARCHAR(128) NULL, father VARCHAR(128) NULL, mother VARCHAR(128) NULL, "
+      "father_residence VARCHAR(128) NULL, marriage_date VARCHAR(32) NULL, "
+      "marriage_place VARCHAR(128) NULL, notes TEXT NULL, n_id VARCHAR(20) NULL, "
+      "n_id_f VARCHAR(20) NULL, n_id_m VARCHAR(20) NULL, PRIMARY KEY (BirthID), KEY (n_id)" },
+    { "marriages", "ns_marriages", false,
+      "MarriageID INT UNSIGNED NOT NULL, RegBook VARCHAR(8) NOT NULL, RegPage VARCHAR(8) NOT NULL, "
+      "GroomLastName VARCHAR(64) NOT NULL, GroomFirstName VARCHAR(64) NOT NULL, "
+      "BrideLastName VARCHAR(64) NOT NULL, BrideFirstName VARCHAR(64) NOT NULL, "
+      "Place VARCHAR(64) NULL, County VARCHAR(32) NOT NULL, Year SMALLINT UNSIGNED NOT NULL, "
+      "Month TINYINT UNSIGNED NULL, Day TINYINT UNSIGNED NULL, PRIMARY KEY (MarriageID), "
+      "KEY (GroomLastName, GroomFirstName), KEY (BrideLastName, BrideFirstName)" },
+    { "marriages", "ns_marriages_data", false,
+      "MarriageID INT UNSIGNED NOT NULL, groom VARCHAR(128) NULL, groom_age VARCHAR(8) NULL, "
+      "groom_status VARCHAR(16) NULL, groom_residence VARCHAR(128) NULL, "
+      "groom_birthplace VARCHAR(128) NULL, groom_occupation VARCHAR(64) NULL, "
+      "groom_father VARCHAR(128) NULL, groom_father_birthplace VARCHAR(128) NULL, "
+      "groom_mother VARCHAR(128) NULL, groom_mother_birthplace VARCHAR(128) NULL, "
+      "bride VARCHAR(128) NULL, bride_age VARCHAR(8) NULL, bride_status VARCHAR(16) NULL, "
+      "bride_residence VARCHAR(128) NULL, bride_birthplace VARCHAR(128) NULL, "
+      "bride_occupation VARCHAR(64) NULL, bride_father VARCHAR(128) NULL, "
+      "bride_father_birthplace VARCHAR(128) NULL, bride_mother VARCHAR(128) NULL, "
+      "bride_mother_birthplace VARCHAR(128) NULL, date VARCHAR(32) NULL, place VARCHAR(128) NULL, "
+      "notes TEXT NULL, n_id_g VARCHAR(20) NULL, n_id_b VARCHAR(20) NULL, PRIMARY KEY (MarriageID), "
+      "KEY (n_id_g), KEY (n_id_b)" },
+    { "deaths", "ns_deaths", false,
+      "Deathid INT UNSIGNED NOT NULL, RegBook VARCHAR(8) NOT NULL, RegPage VARCHAR(8) NOT NULL, "
+      "LastName VARCHAR(64) NOT NULL, FirstName VARCHAR(64) NOT NULL, Place VARCHAR(64) NULL, "
+      "County VARCHAR(32) NOT NULL, Year SMALLINT UNSIGNED NOT NULL, Month TINYINT UNSIGNED NULL, "
+      "Day TINYINT UNSIGNED NULL, PRIMARY KEY (Deathid), KEY (LastName, FirstName), KEY (Year)" },
+    { "deaths", "ns_deaths_data", false,
+      "Deathid INT UNSIGNED NOT NULL, name VARCHAR(128) NULL, death_date VARCHAR(32) NULL, "
+      "death_place VARCHAR(128) NULL, death_age VARCHAR(16) NULL, death_residence VARCHAR(128) NULL, "
+      "birth_date VARCHAR(32) NULL, birth_place VARCHAR(128) NULL, mar_status VARCHAR(16) NULL, "
+      "spouse VARCHAR(128) NULL, father VARCHAR(128) NULL, father_birthplace VARCHAR(128) NULL, "
+      "mother VARCHAR(128) NULL, mother_birthplace VARCHAR(128) NULL, informant VARCHAR(128) NULL, "
+      "notes TEXT NULL, n_id VARCHAR(20) NULL, PRIMARY KEY (Deathid), KEY (n_id)" },
+    { "census", "1871_census_data", false,
+      "id INT UNSIGNED NOT NULL, district_id SMALLINT UNSIGNED NOT NULL, sub_district_id CHAR(2) NOT NULL, "
+      "division SMALLINT UNSIGNED NULL, page SMALLINT UNSIGNED NOT NULL, line TINYINT UNSIGNED NOT NULL, "
+      "family SMALLINT UNSIGNED NULL, surname VARCHAR(64) NOT NULL, given_name VARCHAR(64) NOT NULL, "
+      "sex CHAR(1) NULL, age TINYINT UNSIGNED NULL, birth_month VARCHAR(8) NULL, "
+      "birthplace VARCHAR(32) NULL, religion VARCHAR(32) NULL, origin VARCHAR(32) NULL, "
+      "nationality VARCHAR(32) NULL, occupation VARCHAR(64) NULL, marital_status CHAR(1) NULL, "
+      "married_in_year CHAR(1) NULL, school CHAR(1) NULL, cannot_read CHAR(1) NULL, "
+      "cannot_write CHAR(1) NULL, deaf_dumb CHAR(1) NULL, blind CHAR(1) NULL, "
+      "unsound_mind CHAR(1) NULL, dwelling SMALLINT UNSIGNED NULL, house_status VARCHAR(16) NULL, "
+      "land_acres DECIMAL(8,1) NULL, improved_acres DECIMAL(8,1) NULL, cattle SMALLINT UNSIGNED NULL, "
+      "sheep SMALLINT UNSIGNED NULL, swine SMALLINT UNSIGNED NULL, horses SMALLINT UNSIGNED NULL, "
+      "wheat_bushels DECIMAL(8,1) NULL, oats_bushels DECIMAL(8,1) NULL, potatoes DECIMAL(8,1) NULL, "
+      "remarks TEXT NULL, reel VARCHAR(16) NULL, image VARCHAR(16) NULL, last_changed DATE NULL, "
+      "PRIMARY KEY (id), KEY (district_id, sub_district_id, page, line), KEY (surname, given_name)" },
+    { "catalog", "z_sour", false,
+      "id INT UNSIGNED NOT NULL, name VARCHAR(64) NOT NULL, description VARCHAR(255) NULL, "
+      "version VARCHAR(16) NULL, code VARCHAR(8) NOT NULL, db_table VARCHAR(64) NOT NULL, "
+      "derived_from INT UNSIGNED NULL, writable ENUM('yes','no') NOT NULL DEFAULT 'no', "
+      "PRIMARY KEY (id)" },
+    { "catalog", "z_sour_field", false,
+      "id INT UNSIGNED NOT NULL, source INT UNSIGNED NOT NULL, code VARCHAR(32) NULL, "
+      "name VARCHAR(64) NOT NULL, db_field VARCHAR(64) NOT NULL, "
+      "writable ENUM('yes','no') NOT NULL DEFAULT 'no', PRIMARY KEY (id), KEY (source)" },
+    { "places", "ns_geonames", false,
+      "OBJECTID INT UNSIGNED NOT NULL, GEONAME VARCHAR(64) NOT NULL, LOCN_NARR VARCHAR(128) NULL, "
+      "COUNTY VARCHAR(32) NOT NULL, GENERIC_TM VARCHAR(32) NULL, NAD83_LAT DOUBLE NULL, "
+      "NAD83_LON DOUBLE NULL, PRIMARY KEY (OBJECTID), KEY (GEONAME)" },
+    { "pgv", "pgv_individuals", true,
+      "i_id VARCHAR(255) NOT NULL, i_file INT NOT NULL, i_rin VARCHAR(255) NOT NULL, "
+      "i_isdead INT NOT NULL DEFAULT 1, i_sex CHAR(1) NOT NULL, i_gedcom LONGTEXT NOT NULL, "
+      "PRIMARY KEY (i_id, i_file)" },
+    { "pgv", "pgv_families", true,
+      "f_id VARCHAR(255) NOT NULL, f_file INT NOT NULL, f_husb VARCHAR(255) NULL, "
+      "f_wife VARCHAR(255) NULL, f_chil TEXT NULL, f_gedcom LONGTEXT NOT NULL, f_numchil INT NOT NULL, "
+      "PRIMARY KEY (f_id, f_file), KEY (f_husb), KEY (f_wife)" },
+    { "pgv", "pgv_name", true,
+      "n_file INT NOT NULL, n_id VARCHAR(255) NOT NULL, n_num INT NOT NULL, n_type VARCHAR(15) NOT NULL, "
+      "n_sort VARCHAR(255) NOT NULL, n_list VARCHAR(255) NOT NULL, n_surname VARCHAR(255) NULL, "
+      "n_givn VARCHAR(255) NULL, PRIMARY KEY (n_id, n_file, n_num), KEY (n_surname)" }
+};
+
+
+
+//**************************************************************************************************
+// Vital records
+//**************************************************************************************************
+
+// The three kinds of index record have the same registration and date columns.
+
+static void write_registration(tsv_file& out, unsigned long record, int year, std::mt19937& rng)
+{
+    out.field(std::to_string(1800 + (year - 1860) * 4 + rng() % 4));
+    out.field(std::to_string(1 + (record * 7) % 320));
+}
+
+static void write_index_date(tsv_file& out, int year, int month, int day)
+{
+    out.field((long)year);
+    if (month > 0)
+        out.field((long)month);
+    else
+        out.null();
+    if (day > 0)
+        out.field((long)day);
+    else
+        out.null();
+}
+
+// A date as it is transcribed: "12 Mar 1871", "Mar 1871" or "1871".
+
+static std::string date_text(int year, int month, int day)
+{
+    std::string text = std::to_string(year);
+    if (month > 0)
+        text = std::string(month_names[month - 1]) + " " + text;
+    if (month > 0 && day > 0)
+        text = std::to_string(day) + " " + text;
+    return text;
+}
+
+// Most index records have the full date, and some have only the year, or the month and year.
+
+static void random_date(int& month, int& day, std::mt19937& rng)
+{
+    unsigned int r = rng() % 20;
+    month = (r == 0) ? 0 : 1 + rng() % 12;
+    day   = (r <= 2) ? 0 : 1 + rng() % 28;
+}
+
+
+
+// A person named in a record: either someone in the family tree, or a new random person.
+
+struct gen_person
+{
+    std::string  surname;
+    std::string  given;
+    std::string  n_id;            // PhpGedView ID, if the person is in the family tree
+    int          birth_year = 0;
+    size_t       place      = 0;
+
+    std::string full_name() const { return given + " " + surname; }
+};
+
+static gen_person tree_person(const gen_tree& tree, int32_t person)
+{
+    gen_person p;
+    p.surname    = tree.surname(person);
+    p.given      = tree.given(person);
+    p.n_id       = gen_tree::indi_id(person);
+    p.birth_year = tree.persons[person].birth_year;
+    p.place      = tree.persons[person].place;
+    return p;
+}
+
+static gen_person random_person(const gen_model& model, char sex, const std::string& surname,
+                                int birth_year, std::mt19937& rng)
+{
+    gen_person p;
+    p.surname    = surname.empty() ? model.surname(rng) : surname;
+    p.given      = model.given(sex, rng);
+    p.birth_year = birth_year;
+    p.place      = model.place(rng);
+    return p;
+}
+
+// The parents of a person in the tree, or random parents with the same surname.
+
+static void parents(const gen_model& model, const gen_tree& tree, int32_t person, const gen_person& child,
+                    gen_person& father, gen_person& mother, std::mt19937& rng)
+{
+    int32_t family = (person >= 0) ? tree.persons[person].famc : -1;
+    if (family >= 0)
+    {
+        father = tree_person(tree, tree.families[family].husband);
+        mother = tree_person(tree, tree.families[family].wife);
+        return;
+    }
+    father = random_person(model, 'M', child.surname, child.birth_year - 22 - rng() % 20, rng);
+    mother = random_person(model, 'F', "", child.birth_year - 20 - rng() % 18, rng);
+}
+
+// An index name may differ from the transcription, since the two were made independently.
+
+static std::string index_surname(const std::string& surname, std::mt19937& rng)
+{
+    return chance(0.03, rng) ? gen_model::variant(surname, rng) : surname;
+}
+
+static std::string given_or_blank(const std::string& given)
+{
+    return (given == "@P.N.") ? "" : given;
+}
+
+
+
+// NS births: 1864 to 1877, and delayed registrations of births from 1830.
+
+static void write_births(const gen_options& options, const gen_model& model, const gen_tree& tree,
+                         unsigned long num_rows, std::mt19937& rng)
+{
+    tsv_file index(options.out_dir + "/ns_births.tsv");
+    tsv_file data(options.out_dir + "/ns_births_data.tsv");
+
+    for (unsigned long record = 1; record <= num_rows; record++)
+    {
+        int year = (rng() % 5 == 0) ? 1830 + rng() % 34 : 1864 + rng() % 14;
+
+        bool       has_data = chance(options.transcribed, rng);
+        int32_t    person   = (has_data && chance(options.linked, rng)) ? tree.person_born(year, year, rng) : -1;
+        char       sex      = (person >= 0) ? tree.persons[person].sex : ((rng() % 2) ? 'M' : 'F');
+        gen_person child    = (person >= 0) ? tree_person(tree, person) : random_person(model, sex, "", year, rng);
+
+        int month, day;
+        random_date(month, day, rng);
+
+        const place_def& place = model.places[child.place];
+
+        index.field((long)record);
+        write_registration(index, record, year, rng);
+        index.field(index_surname(child.surname, rng));
+        index.field(given_or_blank(child.given));
+        if (rng() % 10 == 0)
+            index.null();
+        else
+            index.field(place.name);
+        index.field(counties[place.county].name);
+        write_index_date(index, year, month, day);
+        index.end_row();
+
+        if (!has_data)
+            continue;
+
+        gen_person father, mother;
+        parents(model, tree, person, child, father, mother, rng);
+
+        int32_t family = (person >= 0) ? tree.persons[person].famc : -1;
+
+        data.field((long)record);
+        data.field(child.full_name());
+        data.field(date_text(year, month, day));
+        data.field(model.place_text(child.place));
+        data.field(father.full_name());
+        data.field(mother.full_name());
+        data.field_or_null((rng() % 3) ? model.place_text(child.place) : "");
+        if (family >= 0)
+        {
+            data.field(std::to_string(tree.families[family].year));
+            data.field(model.place_text(tree.families[family].place));
+        }
+        else
+        {
+            data.null();
+            data.null();
+        }
+        data.field_or_null((rng() % 20 == 0) ? "Illegible entry; see original register" : "");
+        data.field_or_null(child.n_id);
+        data.field_or_null(father.n_id);
+        data.field_or_null(mother.n_id);
+        data.end_row();
+    }
+
+    index.close();
+    data.close();
+}
+
+
+
+// NS marriages: 1864 to 1935.
+
+static void write_marriages(const gen_options& options, const gen_model& model, const gen_tree& tree,
+                            unsigned long num_rows, std::mt19937& rng)
+{
+    static const char* occupations[] =
+    {
+        "Farmer", "Farmer", "Farmer", "Fisherman", "Labourer", "Carpenter", "Blacksmith", "Mariner",
+        "Merchant", "Miner", "Teacher", "Shoemaker"
+    };
+
+    tsv_file index(options.out_dir + "/ns_marriages.tsv");
+    tsv_file data(options.out_dir + "/ns_marriages_data.tsv");
+
+    for (unsigned long record = 1; record <= num_rows; record++)
+    {
+        int year = 1864 + rng() % 72;
+
+        bool    has_data = chance(options.transcribed, rng);
+        int32_t family   = (has_data && chance(options.linked, rng)) ? tree.family_married(year, year, rng) : -1;
+
+        gen_person groom, bride;
+        if (family >= 0)
+        {
+            groom = tree_person(tree, tree.families[family].husband);
+            bride = tree_person(tree, tree.families[family].wife);
+        }
+        else
+        {
+            groom = random_person(model, 'M', "", year - 20 - rng() % 15, rng);
+            bride = random_person(model, 'F', "", year - 18 - rng() % 12, rng);
+        }
+
+        int month, day;
+        random_date(month, day, rng);
+
+        size_t           place_num = (family >= 0) ? tree.families[family].place : model.place(rng);
+        const place_def& place     = model.places[place_num];
+
+        index.field((long)record);
+        write_registration(index, record, year, rng);
+        index.field(index_surname(groom.surname, rng));
+        index.field(given_or_blank(groom.given));
+        index.field(index_surname(bride.surname, rng));
+        index.field(given_or_blank(bride.given));
+        index.field(place.name);
+        index.field(counties[place.county].name);
+        write_index_date(index, year, month, day);
+        index.end_row();
+
+        if (!has_data)
+            continue;
+
+        int32_t groom_num = (family >= 0) ? tree.families[family].husband : -1;
+        int32_t bride_num = (family >= 0) ? tree.families[family].wife    : -1;
+
+        gen_person groom_father, groom_mother, bride_father, bride_mother;
+        parents(model, tree, groom_num, groom, groom_father, groom_mother, rng);
+        parents(model, tree, bride_num, bride, bride_father, bride_mother, rng);
+
+        data.field((long)record);
+
+        data.field(groom.full_name());
+        data.field(std::to_string(year - groom.birth_year));
+        data.field((rng() % 12 == 0) ? "Widower" : "Bachelor");
+        data.field(model.place_text(place_num));
+        data.field(model.place_text(groom.place));
+        data.field(pick(occupations, rng));
+        data.field(groom_father.full_name());
+        data.field_or_null((rng() % 2) ? model.place_text(groom_father.place) : "");
+        data.field(groom_mother.full_name());
+        data.field_or_null((rng() % 2) ? model.place_text(groom_mother.place) : "");
+
+        data.field(bride.full_name());
+        data.field(std::to_string(year - bride.birth_year));
+        data.field((rng() % 15 == 0) ? "Widow" : "Spinster");
+        data.field(model.place_text(place_num));
+        data.field(model.place_text(bride.place));
+        data.field_or_null((rng() % 8 == 0) ? "Domestic" : "");
+        data.field(bride_father.full_name());
+        data.field_or_null((rng() % 2) ? model.place_text(bride_father.place) : "");
+        data.field(bride_mother.full_name());
+        data.field_or_null((rng() % 2) ? model.place_text(bride_mother.place) : "");
+
+        data.field(date_text(year, month, day));
+        data.field(model.place_text(place_num));
+        data.field_or_null((rng() % 20 == 0) ? "Married by licence" : "");
+        data.field_or_null(groom.n_id);
+        data.field_or_null(bride.n_id);
+        data.end_row();
+    }
+
+    index.close();
+    data.close();
+}
+
+
+
+// NS deaths: 1864 to 1877, and 1908 to 1969. A quarter of the deaths are of young children.
+
+static void write_deaths(const gen_options& options, const gen_model& model, const gen_tree& tree,
+                         unsigned long num_rows, std::mt19937& rng)
+{
+    static const char* informants[] = { "Father", "Mother", "Husband", "Wife", "Son", "Daughter", "Neighbour" };
+
+    tsv_file index(options.out_dir + "/ns_deaths.tsv");
+    tsv_file data(options.out_dir + "/ns_deaths_data.tsv");
+
+    for (unsigned long record = 1; record <= num_rows; record++)
+    {
+        int year = (rng() % 4 == 0) ? 1864 + rng() % 14 : 1908 + rng() % 62;
+        int age  = (rng() % 4 == 0) ? rng() % 5 : 5 + rng() % 91;
+
+        bool    has_data = chance(options.transcribed, rng);
+        int32_t person   = (has_data && chance(options.linked, rng)) ? tree.person_born(year - 95, year, rng) : -1;
+        if (person >= 0)
+            age = year - tree.persons[person].birth_year;
+
+        char       sex      = (person >= 0) ? tree.persons[person].sex : ((rng() % 2) ? 'M' : 'F');
+        gen_person deceased = (person >= 0) ? tree_person(tree, person) : random_person(model, sex, "", year - age, rng);
+
+        int month, day;
+        random_date(month, day, rng);
+
+        size_t           place_num = (rng() % 3) ? deceased.place : model.place(rng);
+        const place_def& place     = model.places[place_num];
+
+        index.field((long)record);
+        write_registration(index, record, year, rng);
+        index.field(index_surname(deceased.surname, rng));
+        index.field(given_or_blank(deceased.given));
+        if (rng() % 10 == 0)
+            index.null();
+        else
+            index.field(place.name);
+        index.field(counties[place.county].name);
+        write_index_date(index, year, month, day);
+        index.end_row();
+
+        if (!has_data)
+            continue;
+
+        gen_person father, mother;
+        parents(model, tree, person, deceased, father, mother, rng);
+
+        int32_t family = (person >= 0) ? tree.persons[person].fams : -1;
+        std::string spouse;
+        if (family >= 0)
+            spouse = tree.full_name((sex == 'M') ? tree.families[family].wife : tree.families[family].husband);
+        else if (age > 20 && rng() % 3 != 0)
+            spouse = random_person(model, (sex == 'M') ? 'F' : 'M', "", 0, rng).full_name();
+
+        data.field((long)record);
+        data.field(deceased.full_name());
+        data.field(date_text(year, month, day));
+        data.field(model.place_text(place_num));
+        data.field((age > 0) ? std::to_string(age) : std::to_string(1 + rng() % 11) + " months");
+        data.field_or_null((rng() % 2) ? model.place_text(place_num) : "");
+        data.field_or_null((rng() % 3) ? std::to_string(year - age) : "");
+        data.field(model.place_text(deceased.place));
+        data.field(spouse.empty() ? "Single" : (rng() % 3 ? "Married" : "Widowed"));
+        data.field_or_null(spouse);
+        data.field(father.full_name());
+        data.field_or_null((rng() % 2) ? model.place_text(father.place) : "");
+        data.field(mother.full_name());
+        data.field_or_null((rng() % 2) ? model.place_text(mother.place) : "");
+        data.field(pick(informants, rng));
+        data.field_or_null((rng() % 20 == 0) ? "Cause of death not given" : "");
+        data.field_or_null(deceased.n_id);
+        data.end_row();
+    }
+
+    index.close();
+    data.close();
+}
+
+
+
+//**************************************************************************************************
+// 1871 census
+//**************************************************************************************************
+
+// The census is written in enumeration order: districts by county, sub-districts within a
+// district, and pages of 25 lines, with one household after another. Only heads of households
+// have the agricultural columns.
+
+static void write_census(const gen_options& options, const gen_model& model, unsigned long num_rows,
+                         std::mt19937& rng)
+{
+    static const char* religions[]   = { "Presbyterian", "Presbyterian", "Roman Catholic", "Roman Catholic",
+                                         "Church of England", "Baptist", "Methodist" };
+    static const char* origins[]     = { "Scotch", "Scotch", "Scotch", "Irish", "English", "French", "German", "African" };
+    static const char* birthplaces[] = { "N.S.", "N.S.", "N.S.", "N.S.", "N.S.", "N.S.", "Scotland",
+                                         "Ireland", "England", "N.B.", "P.E.I." };
+    static const char* occupations[] = { "Farmer", "Farmer", "Farmer", "Fisherman", "Labourer", "Carpenter",
+                                         "Blacksmith", "Mariner", "Merchant", "Miner", "Shoemaker", "Tailor" };
+
+    tsv_file out(options.out_dir + "/1871_census_data.tsv");
+
+    unsigned long id            = 0;
+    unsigned int  district      = 190;
+    unsigned int  sub_district  = 0;
+    unsigned long sub_size      = 0;
+    unsigned long sub_rows      = 0;
+    unsigned int  page          = 1;
+    unsigned int  line          = 1;
+    unsigned int  family        = 0;
+
+    while (id < num_rows)
+    {
+        // Start a new sub-district, and a new district after about eight of them.
+
+        if (sub_rows >= sub_size)
+        {
+            if (sub_size != 0 && ++sub_district >= 6 + (district * 7) % 6)
+            {
+                district++;
+                sub_district = 0;
+            }
+            sub_size = 800 + rng() % 2500;
+            sub_rows = 0;
+            page     = 1;
+            line     = 1;
+            family   = 0;
+        }
+
+        std::string  surname      = model.surname(rng, 0.02);
+        std::string  origin       = pick(origins, rng);
+        std::string  religion     = pick(religions, rng);
+        int          head_age     = 22 + rng() % 50;
+        unsigned int num_children = (rng() % 3) + (rng() % 4) + (rng() % 4);
+        bool         has_wife     = (rng() % 8 != 0);
+        bool         has_servant  = (rng() % 12 == 0);
+
+        family++;
+
+        // Members: head, wife, children, and sometimes a servant.
+
+        unsigned int num_members = 1 + (has_wife ? 1 : 0) + num_children + (has_servant ? 1 : 0);
+        int          child_age   = head_age - 22 - rng() % 5;
+
+        for (unsigned int member = 0; member < num_members && id < num_rows; member++)
+        {
+            bool        is_head    = (member == 0);
+            bool        is_wife    = (has_wife && member == 1);
+            bool        is_servant = (has_servant && member == num_members - 1);
+            char        sex;
+            int         age;
+            std::string member_surname = surname;
+
+            if (is_head)
+            {
+                sex = (rng() % 10 == 0) ? 'F' : 'M';
+                age = head_age;
+            }
+            else if (is_wife)
+            {
+                sex = 'F';
+                age = std::max(16, head_age - 3 + (int)(rng() % 7) - 3);
+            }
+            else if (is_servant)
+            {
+                sex            = (rng() % 2) ? 'M' : 'F';
+                age            = 14 + rng() % 20;
+                member_surname = model.surname(rng, 0.02);
+            }
+            else
+            {
+                sex       = (rng() % 2) ? 'M' : 'F';
+                age       = std::max(0, child_age);
+                child_age -= 1 + rng() % 3;
+            }
+
+            id++;
+            sub_rows++;
+
+            out.field((long)id);
+            out.field((long)district);
+            out.field(std::string(1, 'A' + sub_district));
+            out.field((long)(1 + sub_rows / 1000));
+            out.field((long)page);
+            out.field((long)line);
+            out.field((long)family);
+            out.field(member_surname);
+            out.field(given_or_blank(model.given(sex, rng)));
+            out.field(std::string(1, sex));
+            out.field((long)age);
+            if (age == 0)
+                out.field(month_names[rng() % 12]);
+            else
+                out.null();
+            out.field((is_head || is_wife) ? pick(birthplaces, rng) : "N.S.");
+            out.field(religion);
+            out.field(is_servant ? pick(origins, rng) : origin.c_str());
+            out.null();
+            if ((is_head || (is_servant && sex == 'M') || (age >= 16 && sex == 'M')) && rng() % 5 != 0)
+                out.field(is_servant ? "Servant" : pick(occupations, rng));
+            else
+                out.null();
+            if (is_head || is_wife)
+                out.field((is_head && !has_wife) ? "W" : "M");
+            else
+                out.null();
+            out.null();
+            out.field_or_null((age >= 6 && age <= 16 && rng() % 2) ? "Y" : "");
+            out.field_or_null((age > 20 && rng() % 6 == 0) ? "Y" : "");
+            out.field_or_null((age > 20 && rng() % 5 == 0) ? "Y" : "");
+            out.field_or_null((rng() % 500 == 0) ? "Y" : "");
+            out.field_or_null((rng() % 800 == 0) ? "Y" : "");
+            out.field_or_null((rng() % 1000 == 0) ? "Y" : "");
+            out.field((long)family);
+            out.field_or_null(is_head ? ((rng() % 5) ? "Owner" : "Tenant") : "");
+            if (is_head && rng() % 3 != 0)
+            {
+                double land = 20 + rng() % 300;
+                out.field(land, 1);
+                out.field(land * (30 + rng() % 60) / 100, 1);
+                out.field((long)(rng() % 15));
+                out.field((long)(rng() % 40));
+                out.field((long)(rng() % 6));
+                out.field((long)(rng() % 4));
+                out.field((double)(rng() % 80), 1);
+                out.field((double)(rng() % 400), 1);
+                out.field((double)(rng() % 300), 1);
+            }
+            else
+            {
+                for (int col = 0; col < 9; col++)
+                    out.null();
+            }
+            out.field_or_null((rng() % 50 == 0) ? "Name difficult to read; see also next page" : "");
+            out.field("C-" + std::to_string(10540 + (district - 190) % NUM_COUNTIES));
+            out.field(std::to_string(4000000 + district * 1000 + page));
+            out.null();
+            out.end_row();
+
+            if (++line > 25)
+            {
+                line = 1;
+                page++;
+            }
+        }
+    }
+
+    out.close();
+}
+
+
+
+//**************************************************************************************************
+// Catalog and places
+//**************************************************************************************************
+
+// Source catalog for the generated tables. The index tables are read-only sources; the
+// transcription tables are derived from them and can be edited.
+
+struct catalog_field
+{
+    const char* db_field;
+    const char* code;
+};
+
+struct catalog_source
+{
+    const char*                  name;
+    const char*                  code;
+    const char*                  db_table;
+    int                          derived_from;
+    bool                         writable;
+    std::vector<catalog_field>   fields;
+};
+
+static void write_catalog(const gen_options& options)
+{
+    static const std::vector<catalog_source> sources =
+    {
+        { "NS Births", "BIRT", "ns_births", 0, false,
+          { { "BirthID", "KEY" }, { "LastName", "SURN" }, { "FirstName", "GIVN" },
+            { "Place", "BIRT_PLAC_COMMUNITY" }, { "County", "BIRT_PLAC_COUNTY" },
+            { "Year", "BIRT_DATE_Y" }, { "Month", "BIRT_DATE_M" }, { "Day", "BIRT_DATE_D" } } },
+        { "NS Marriages", "MARR", "ns_marriages", 0, false,
+          { { "MarriageID", "KEY" }, { "GroomLastName", "G_SURN" }, { "GroomFirstName", "G_GIVN" },
+            { "BrideLastName", "B_SURN" }, { "BrideFirstName", "B_GIVN" },
+            { "Place", "MARR_PLAC_COMMUNITY" }, { "County", "MARR_PLAC_COUNTY" },
+            { "Year", "MARR_DATE_Y" }, { "Month", "MARR_DATE_M" }, { "Day", "MARR_DATE_D" } } },
+        { "NS Deaths", "DEAT", "ns_deaths", 0, false,
+          { { "Deathid", "KEY" }, { "LastName", "SURN" }, { "FirstName", "GIVN" },
+            { "Place", "DEAT_PLAC_COMMUNITY" }, { "County", "DEAT_PLAC_COUNTY" },
+            { "Year", "DEAT_DATE_Y" }, { "Month", "DEAT_DATE_M" }, { "Day", "DEAT_DATE_D" } } },
+        { "NS Births (transcribed)", "BIRT", "ns_births_data", 1, true,
+          { { "BirthID", "KEY" }, { "name", "NAME" }, { "birth_date", "BIRT_DATE" },
+            { "birth_place", "BIRT_PLAC" }, { "father", "F_NAME" }, { "mother", "M_NAME" },
+            { "father_residence", "F_RESI" }, { "marriage_date", "" }, { "marriage_place", "" },
+            { "notes", "NOTE" }, { "n_id", "XREF_INDI" }, { "n_id_f", "F_XREF_INDI" },
+            { "n_id_m", "M_XREF_INDI" } } },
+        { "NS Marriages (transcribed)", "MARR", "ns_marriages_data", 2, true,
+          { { "MarriageID", "KEY" }, { "groom", "G_NAME" }, { "groom_age", "G_AGE" },
+            { "groom_status", "G_STATUS" }, { "groom_residence", "G_RESI" },
+            { "groom_birthplace", "G_BIRT_PLAC" }, { "groom_occupation", "G_OCCU" },
+            { "groom_father", "GF_NAME" }, { "groom_father_birthplace", "GF_BIRT_PLAC" },
+            { "groom_mother", "GM_NAME" }, { "groom_mother_birthplace", "GM_BIRT_PLAC" },
+            { "bride", "B_NAME" }, { "bride_age", "B_AGE" }, { "bride_status", "B_STATUS" },
+            { "bride_residence", "B_RESI" }, { "bride_birthplace", "B_BIRT_PLAC" },
+            { "bride_occupation", "B_OCCU" }, { "bride_father", "BF_NAME" },
+            { "bride_father_birthplace", "BF_BIRT_PLAC" }, { "bride_mother", "BM_NAME" },
+            { "bride_mother_birthplace", "BM_BIRT_PLAC" }, { "date", "MARR_DATE" },
+            { "place", "MARR_PLAC" }, { "notes", "NOTE" }, { "n_id_g", "G_XREF_INDI" },
+            { "n_id_b", "B_XREF_INDI" } } },
+        { "NS Deaths (transcribed)", "DEAT", "ns_deaths_data", 3, true,
+          { { "Deathid", "KEY" }, { "name", "NAME" }, { "death_date", "DEAT_DATE" },
+            { "death_place", "DEAT_PLAC" }, { "death_age", "AGE" }, { "death_residence", "RESI" },
+            { "birth_date", "BIRT_DATE" }, { "birth_place", "BIRT_PLAC" },
+            { "mar_status", "STATUS" }, { "spouse", "S_NAME" }, { "father", "F_NAME" },
+            { "father_birthplace", "F_BIRT_PLAC" }, { "mother", "M_NAME" },
+            { "mother_birthplace", "M_BIRT_PLAC" }, { "informant", "" }, { "notes", "NOTE" },
+            { "n_id", "XREF_INDI" } } },
+        { "1871 Census", "CENS", "1871_census_data", 0, true,
+          { { "id", "KEY" }, { "surname", "SURN" }, { "given_name", "GIVN" }, { "sex", "SEX" },
+            { "age", "AGE" }, { "birthplace", "BIRT_PLAC" }, { "religion", "" }, { "origin", "" },
+            { "occupation", "OCCU" }, { "marital_status", "STATUS" }, { "remarks", "NOTE" } } }
+    };
+
+    tsv_file src_out(options.out_dir + "/z_sour.tsv");
+    tsv_file fld_out(options.out_dir + "/z_sour_field.tsv");
+
+    long field_id = 1;
+    for (size_t i = 0; i < sources.size(); i++)
+    {
+        const catalog_source& source = sources[i];
+
+        src_out.field((long)(i + 1));
+        src_out.field(source.name);
+        src_out.field(std::string("Synthetic ") + source.name + " data from gendat-gen");
+        src_out.field("1.0");
+        src_out.field(source.code);
+        src_out.field(source.db_table);
+        if (source.derived_from > 0)
+            src_out.field((long)source.derived_from);
+        else
+            src_out.null();
+        src_out.field(source.writable ? "yes" : "no");
+        src_out.end_row();
+
+        for (const catalog_field& field : source.fields)
+        {
+            fld_out.field(field_id++);
+            fld_out.field((long)(i + 1));
+            fld_out.field_or_null(field.code);
+            fld_out.field(field.db_field);
+            fld_out.field(field.db_field);
+            fld_out.field(source.writable ? "yes" : "no");
+            fld_out.end_row();
+        }
+    }
+
+    src_out.close();
+    fld_out.close();
+}
+
+
+
+static void write_places(const gen_options& options, const gen_model& model)
+{
+    tsv_file out(options.out_dir + "/ns_geonames.tsv");
+
+    for (size_t i = 0; i < model.places.size(); i++)
+    {
+        const place_def& place = model.places[i];
+
+        out.field((long)(i + 1));
+        out.field(place.name);
+        out.field(std::string("In ") + counties[place.county].name + " County");
+        out.field(counties[place.county].name);
+        out.field(place.generic);
+        out.field(place.lat, 5);
+        out.field(place.lon, 5);
+        out.end_row();
+    }
+
+    out.close();
+}
+
+
+
+//**************************************************************************************************
+// PhpGedView tables
+//**************************************************************************************************
+
+static void write_pgv(const gen_options& options, const gen_model& model, const gen_tree& tree)
+{
+    tsv_file indi_out(options.out_dir + "/pgv_individuals.tsv");
+    tsv_file name_out(options.out_dir + "/pgv_name.tsv");
+
+    std::string gedcom;
+    for (size_t i = 0; i < tree.persons.size(); i++)
+    {
+        const pgv_person& person  = tree.persons[i];
+        std::string       id      = gen_tree::indi_id((int32_t)i);
+        std::string       surname = tree.surname((int32_t)i);
+        std::string       given   = tree.given((int32_t)i);
+
+        gedcom  = "0 @" + id + "@ INDI\n";
+        gedcom += "1 NAME " + given + " /" + surname + "/\n";
+        gedcom += std::string("1 SEX ") + person.sex + "\n";
+        gedcom += "1 BIRT\n2 DATE " + std::to_string(person.birth_year) + "\n";
+        gedcom += "2 PLAC " + model.places[person.place].name + ", " +
+                  counties[model.places[person.place].county].name + ", Nova Scotia\n";
+        if (person.famc >= 0)
+            gedcom += "1 FAMC @" + gen_tree::fam_id(person.famc) + "@\n";
+        if (person.fams >= 0)
+            gedcom += "1 FAMS @" + gen_tree::fam_id(person.fams) + "@\n";
+
+        indi_out.field(id);
+        indi_out.field(1L);
+        indi_out.field(id);
+        indi_out.field((person.birth_year < 1920) ? 1L : 0L);
+        indi_out.field(std::string(1, person.sex));
+        indi_out.field(gedcom);
+        indi_out.end_row();
+
+        std::string upper_surname = surname;
+        std::transform(upper_surname.begin(), upper_surname.end(), upper_surname.begin(), ::toupper);
+
+        name_out.field(1L);
+        name_out.field(id);
+        name_out.field(0L);
+        name_out.field("NAME");
+        name_out.field(upper_surname + "," + given);
+        name_out.field(given + " " + surname);
+        name_out.field(surname);
+        name_out.field(given);
+        name_out.end_row();
+    }
+
+    indi_out.close();
+    name_out.close();
+
+    tsv_file fam_out(options.out_dir + "/pgv_families.tsv");
+
+    for (size_t i = 0; i < tree.families.size(); i++)
+    {
+        const pgv_family& family = tree.families[i];
+        std::string       id     = gen_tree::fam_id((int32_t)i);
+        std::string       husband = gen_tree::indi_id(family.husband);
+        std::string       wife    = gen_tree::indi_id(family.wife);
+        std::string       children;
+
+        gedcom  = "0 @" + id + "@ FAM\n";
+        gedcom += "1 HUSB @" + husband + "@\n";
+        gedcom += "1 WIFE @" + wife + "@\n";
+        gedcom += "1 MARR\n2 DATE " + std::to_string(family.year) + "\n";
+        gedcom += "2 PLAC " + model.places[family.place].name + ", " +
+                  counties[model.places[family.place].county].name + ", Nova Scotia\n";
+        for (int c = 0; c < family.num_children; c++)
+        {
+            std::string child = gen_tree::indi_id(family.first_child + c);
+            gedcom   += "1 CHIL @" + child + "@\n";
+            children += child + ";";
+        }
+
+        fam_out.field(id);
+        fam_out.field(1L);
+        fam_out.field(husband);
+        fam_out.field(wife);
+        fam_out.field(children);
+        fam_out.field(gedcom);
+        fam_out.field((long)family.num_children);
+        fam_out.end_row();
+    }
+
+    fam_out.close();
+}
+
+
+
+//**************************************************************************************************
+// Load script
+//**************************************************************************************************
+
+static void write_load_script(const gen_options& options, const std::vector<const gen_table*>& tables)
+{
+    std::string path = options.out_dir + "/load.sql";
+    FILE*       file = fopen(path.c_str(), "w");
+    if (file == nullptr)
+        throw std::runtime_error("Cannot create " + path + ": " + strerror(errno));
+
+    fprintf(file, "-- Synthetic GenDat data written by gendat-gen (rows %lu, seed %u).\n",
+            options.num_rows, options.seed);
+    fprintf(file, "-- Run from this directory: mysql --local-infile=1 DATABASE < load.sql\n");
+    fprintf(file, "-- or, for SQLite: "
+                  "gendat-cli --host sqlite:. --database DATABASE -- sql \"$(cat load.sql)\"\n\n");
+    fprintf(file, "SET UNIQUE_CHECKS = 0;\nSET FOREIGN_KEY_CHECKS = 0;\n\n");
+
+    for (const gen_table* table : tables)
+    {
+        if (table->in_pgv_db)
+        {
+            fprintf(file, "CREATE DATABASE IF NOT EXISTS `%s`;\n\n", options.pgv_db.c_str());
+            break;
+        }
+    }
+
+    for (const gen_table* table : tables)
+    {
+        std::string name = "`" + table->name + "`";
+        if (table->in_pgv_db)
+            name = "`" + options.pgv_db + "`." + name;
+
+        fprintf(file, "DROP TABLE IF EXISTS %s;\n", name.c_str());
+        fprintf(file, "CREATE TABLE %s (%s) DEFAULT CHARSET=utf8mb4;\n", name.c_str(), table->definition.c_str());
+        fprintf(file, "LOAD DATA LOCAL INFILE '%s.tsv' INTO TABLE %s CHARACTER SET utf8mb4;\n\n",
+                table->name.c_str(), name.c_str());
+    }
+
+    fprintf(file, "SET UNIQUE_CHECKS = 1;\nSET FOREIGN_KEY_CHECKS = 1;\n");
+
+    bool failed = (ferror(file) != 0);
+    failed |= (fclose(file) != 0);
+    if (failed)
+        throw std::runtime_error("Error writing " + path);
+}
+
+
+
+//**************************************************************************************************
+// Main program
+//**************************************************************************************************
+
+static void parse_options(int argc, char* argv[], gen_options& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+
+        if (arg == "help" || arg == "--help" || arg == "-h")
+        {
+            options.show_help = true;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+            throw usage_error("Missing value for " + arg);
+        std::string value = argv[++i];
+
+        if (arg == "--out")
+            options.out_dir = value;
+        else if (arg == "--rows")
+            options.num_rows = strtoul(value.c_str(), nullptr, 10);
+        else if (arg == "--seed")
+            options.seed = (unsigned int)strtoul(value.c_str(), nullptr, 10);
+        else if (arg == "--transcribed")
+            options.transcribed = atof(value.c_str());
+        else if (arg == "--linked")
+            options.linked = atof(value.c_str());
+        else if (arg == "--pgv-database")
+            options.pgv_db = value;
+        else if (arg == "--tables")
+        {
+            size_t start = 0;
+            while (start <= value.size())
+            {
+                size_t end = value.find(',', start);
+                if (end == std::string::npos)
+                    end = value.size();
+                std::string group = value.substr(start, end - start);
+                if (std::find(std::begin(table_groups), std::end(table_groups), group) == std::end(table_groups))
+                    throw usage_error("Unknown table group " + group);
+                options.tables.push_back(group);
+                start = end + 1;
+            }
+        }
+        else
+            throw usage_error("Unknown option " + arg);
+    }
+
+    if (options.show_help)
+        return;
+
+    if (options.num_rows == 0)
+        throw usage_error("The number of rows must be positive");
+    if (options.transcribed < 0 || options.transcribed > 1 || options.linked < 0 || options.linked > 1)
+        throw usage_error("Fractions must be between 0 and 1");
+}
+
+
+
+static bool wanted(const gen_options& options, const std::string& group)
+{
+    return options.tables.empty() ||
+           std::find(options.tables.begin(), options.tables.end(), group) != options.tables.end();
+}
+
+
+
+int main(int argc, char* argv[])
+{
+    gen_options options;
+
+    try
+    {
+        parse_options(argc, argv, options);
+        if (options.show_help)
+        {
+            show_usage(std::cout);
+            return 0;
+        }
+
+        if (mkdir(options.out_dir.c_str(), 0777) != 0 && errno != EEXIST)
+            throw std::runtime_error("Cannot create " + options.out_dir + ": " + strerror(errno));
+
+        // The names, places and family tree are shared by the tables, which are then written in
+        // parallel. Each table has its own random number generator, so that the output does not
+        // depend on the order in which the threads run.
+
+        std::mt19937 rng(options.seed);
+        gen_model    model;
+        gen_tree     tree;
+        model.build_names(rng);
+        model.build_places(rng);
+        tree.build(model, std::max(1UL, options.num_rows / 5), rng);
+
+        std::vector<std::function<void ()>> jobs;
+        const unsigned long rows = options.num_rows;
+
+        if (wanted(options, "births"))
+            jobs.push_back([&] { std::mt19937 r(options.seed + 1); write_births(options, model, tree, rows, r); });
+        if (wanted(options, "marriages"))
+            jobs.push_back([&] { std::mt19937 r(options.seed + 2); write_marriages(options, model, tree, rows * 2 / 5, r); });
+        if (wanted(options, "deaths"))
+            jobs.push_back([&] { std::mt19937 r(options.seed + 3); write_deaths(options, model, tree, rows * 3 / 5, r); });
+        if (wanted(options, "census"))
+            jobs.push_back([&] { std::mt19937 r(options.seed + 4); write_census(options, model, rows, r); });
+        if (wanted(options, "catalog"))
+            jobs.push_back([&] { write_catalog(options); });
+        if (wanted(options, "places"))
+            jobs.push_back([&] { write_places(options, model); });
+        if (wanted(options, "pgv"))
+            jobs.push_back([&] { write_pgv(options, model, tree); });
+
+        // An exception in a thread is passed on to the main thread.
+
+        std::vector<std::string>  errors(jobs.size());
+        std::vector<std::thread>  threads;
+        for (size_t i = 0; i < jobs.size(); i++)
+        {
+            threads.emplace_back([&jobs, &errors, i] ()
+            {
+                try
+                {
+                    jobs[i]();
+                }
+                catch (std::exception& exception)
+                {
+                    errors[i] = exception.what();
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+            thread.join();
+        for (const std::string& error : errors)
+            if (!error.empty())
+                throw std::runtime_error(error);
+
+        std::vector<const gen_table*> tables;
+        for (const gen_table& table : gen_tables)
+            if (wanted(options, table.group))
+                tables.push_back(&table);
+        write_load_script(options, tables);
+    }
+    catch (usage_error& exception)
+    {
+        std::cerr << "gendat-gen: " << exception.what() << "\n\n";
+        show_usage(std::cerr);
+        return 2;
+    }
+    catch (std::exception& exception)
+    {
+        std::cerr << "gendat-gen: " << exception.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
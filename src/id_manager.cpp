@@ -11,14 +11,27 @@
 /// then will allocate the required number of identifiers when it is constructed and release
 /// them again when the object is destroyed.
 ///
+/// The identifiers above the highest reserved block are all free. Gaps left below that point by
+/// released blocks are kept in two indexes: one ordered by first identifier, used to merge a
+/// released block with its neighbouring gaps, and one ordered by size, used to find the smallest
+/// gap that can hold a new block. Both reserving and releasing a block therefore take O(log n)
+/// time, where n is the number of gaps.
+///
+/// The pool is shared by all threads, and is protected by a mutex. Once a block has been
+/// reserved, alloc_id() may be called from several threads at once without taking the lock.
+///
 
 #include "id_manager.h"
 
 
 // Initialize the static variables.
 
-unsigned int                          id_manager::first_allowed_id = 1;
-std::map <unsigned int, unsigned int> id_manager::id_pool;
+std::mutex                                         id_manager::pool_mutex;
+unsigned int                                       id_manager::first_allowed_id = 1;
+unsigned int                                       id_manager::pool_end         = 1;
+unsigned int                                       id_manager::num_blocks       = 0;
+std::map <unsigned int, unsigned int>              id_manager::free_by_start;
+std::set <std::pair<unsigned int, unsigned int>>   id_manager::free_by_size;
 
 
 
@@ -52,6 +65,8 @@ id_manager::id_manager ()
 
 id_manager::id_manager (unsigned int num_required)
 {
+  std::lock_guard<std::mutex> lock (pool_mutex);
+
   do_reserve (num_required);
 }
 
@@ -67,7 +82,43 @@ id_manager::id_manager (unsigned int num_required)
 
 id_manager::~id_manager ()
 {
-  id_pool.erase (my_first_id);
+  if (my_num_reserved == 0)
+    return;
+
+  std::lock_guard<std::mutex> lock (pool_mutex);
+
+  num_blocks--;
+
+  // Merge the released block with any free gaps on either side of it.
+
+  unsigned int first = my_first_id;
+  unsigned int size  = my_num_reserved;
+
+  auto next = free_by_start.find (first + size);
+  if (next != free_by_start.end())
+    {
+      size += next->second;
+      remove_free (next->first, next->second);
+    }
+
+  auto prev = free_by_start.lower_bound (first);
+  if (prev != free_by_start.begin())
+    {
+      --prev;
+      if (prev->first + prev->second == first)
+        {
+          first  = prev->first;
+          size  += prev->second;
+          remove_free (prev->first, prev->second);
+        }
+    }
+
+  // A gap that reaches the end of the pool simply shortens the pool.
+
+  if (first + size == pool_end)
+    pool_end = first;
+  else
+    add_free (first, size);
 }
 
 
@@ -87,6 +138,8 @@ id_manager::~id_manager ()
 
 bool id_manager::reserve (unsigned int num_required)
 {
+  std::lock_guard<std::mutex> lock (pool_mutex);
+
   if (my_num_reserved == 0)
     {
       do_reserve (num_required);
@@ -104,20 +157,26 @@ bool id_manager::reserve (unsigned int num_required)
 ///
 /// \brief Allocate the next reserved identifier
 ///
+/// This member function does not lock the identifier pool, and may be called by several threads
+/// at once. Each call gets a different identifier.
+///
 /// \return   next reserved identifier, otherwise set to zero if not enough reserved identifiers 
 ///
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 unsigned int id_manager::alloc_id()
 {
-  if (my_num_used < my_num_reserved)
-    {
-      return my_first_id + my_num_used++;
-    }
-  else
+  unsigned int num_used = my_num_used.load (std::memory_order_relaxed);
+
+  // Claim the next identifier, unless another thread claims it first.
+
+  while (num_used < my_num_reserved)
     {
-      return 0;
+      if (my_num_used.compare_exchange_weak (num_used, num_used + 1, std::memory_order_relaxed))
+        return my_first_id + num_used;
     }
+
+  return 0;
 }
 
 
@@ -174,9 +233,12 @@ unsigned int id_manager::last_id() const
 
 bool id_manager::set_first_allowed_id (unsigned int id)
 {
-  if (id > 0 && id_pool.empty())
+  std::lock_guard<std::mutex> lock (pool_mutex);
+
+  if (id > 0 && num_blocks == 0)
     {
       first_allowed_id = id;
+      pool_end         = id;
       return true;
     }
   else
@@ -191,7 +253,8 @@ bool id_manager::set_first_allowed_id (unsigned int id)
 ///
 /// \brief Reserve identifiers
 ///
-/// This private member function reserves a block of sequential identifiers.
+/// This private member function reserves a block of sequential identifiers. The caller must
+/// hold the pool mutex.
 ///
 /// \param[in] num_required   number of identifiers required
 ///
@@ -199,46 +262,61 @@ bool id_manager::set_first_allowed_id (unsigned int id)
 
 void id_manager::do_reserve (unsigned int num_required)
 {
-  if (id_pool.empty())
+  my_first_id     = 0;
+  my_num_reserved = num_required;
+  my_num_used     = 0;
+
+  if (num_required == 0)
+    return;
+
+  // Use the smallest gap that is large enough, taking the lowest one if several are the same
+  // size. If there is no such gap, add the block to the end of the pool.
+
+  auto i = free_by_size.lower_bound (std::make_pair (num_required, 0u));
+  if (i != free_by_size.end())
     {
-    
-      // If the ID pool is empty, then just insert the new ID requirement.
-    
-      my_first_id = first_allowed_id;
+      unsigned int gap_size  = i->first;
+      unsigned int gap_first = i->second;
+
+      remove_free (gap_first, gap_size);
+      if (gap_size > num_required)
+        add_free (gap_first + num_required, gap_size - num_required);
+
+      my_first_id = gap_first;
     }
   else
     {
-    
-      // If there is room at the beginning of the ID pool, then add the new requirement
-      // ahead of whatever is currently in the pool.
-    
-      auto i = id_pool.begin();
-      if ((i->first - first_allowed_id) >= num_required)
-        {
-          my_first_id = first_allowed_id;
-        }
-      else
-        {
-      
-          // Search the ID pool for a gap of the required size. If there is a suitable
-          // gap, then insert the new requirement there. Otherwise, insert it at the
-          // end of the pool.
-      
-          my_first_id = i->first + i->second;
-          while (++i != id_pool.end())
-            {
-              if ((i->first - my_first_id) >= num_required) break;
-              my_first_id = i->first + i->second;
-            }
-        }
+      my_first_id = pool_end;
+      pool_end   += num_required;
     }
 
-  // Add the new ID requirement to the ID pool.
-  
-  id_pool[my_first_id] = num_required;
+  num_blocks++;
+}
 
-  // Initialize the other private variables.
-  
-  my_num_reserved = num_required;
-  my_num_used     = 0;
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Add a gap to both free-gap indexes.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void id_manager::add_free (unsigned int first, unsigned int size)
+{
+  free_by_start[first] = size;
+  free_by_size.insert (std::make_pair (size, first));
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Remove a gap from both free-gap indexes.
+//
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void id_manager::remove_free (unsigned int first, unsigned int size)
+{
+  free_by_start.erase (first);
+  free_by_size.erase (std::make_pair (size, first));
 }
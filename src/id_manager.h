@@ -5,7 +5,11 @@
 #ifndef ID_MANAGER_H
 #define ID_MANAGER_H
 
+#include <atomic>
 #include <map>
+#include <mutex>
+#include <set>
+#include <utility>
 
 class id_manager
 {
@@ -22,14 +26,20 @@ public:
   static bool set_first_allowed_id(unsigned int id);
   
 private:
+  static std::mutex   pool_mutex;
   static unsigned int first_allowed_id;
-  static std::map<unsigned int, unsigned int> id_pool;
+  static unsigned int pool_end;
+  static unsigned int num_blocks;
+  static std::map<unsigned int, unsigned int> free_by_start;
+  static std::set<std::pair<unsigned int, unsigned int>> free_by_size;
 
   void do_reserve(unsigned int num_required);
+  static void add_free    (unsigned int first, unsigned int size);
+  static void remove_free (unsigned int first, unsigned int size);
   
   unsigned int my_first_id;
   unsigned int my_num_reserved;
-  unsigned int my_num_used;
+  std::atomic<unsigned int> my_num_used;
   
 };
 
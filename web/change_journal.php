@@ -0,0 +1,81 @@
+<?php
+
+/**
+* @file
+*
+* @brief Record edits in the GenDat change journal.
+*
+* The derived search tables (such as the person mention table) are kept up to date by
+* `gendat-cli refresh`, which reads the keys of the altered records from the change journal
+* table. Pages that write to the source tables record each new or altered row here, in the
+* same transaction as the change itself, so that a committed change is never missing from
+* the journal.
+*
+* The journal is only written if the table named by `$change_journal` in config.php exists.
+* It is created with `gendat-cli create-journal`.
+*
+* @date 19 October 2026
+*
+*/
+
+include_once ('config.php');
+
+
+
+/**
+* @brief Determine if changes are to be recorded.
+*
+* @param[in,out] $db   MySQLi database object
+*
+* @returns       Returns `true` if `$change_journal` is set and the journal table exists.
+*
+*/
+
+function journal_enabled ($db)
+{
+	global $change_journal;
+	static $enabled = null;
+	
+	if ($enabled === null)
+	{
+		$enabled = false;
+		if (!empty($change_journal))
+		{
+			$query = "SELECT COUNT(*) AS result FROM information_schema.tables " .
+			         "WHERE table_schema = DATABASE() AND table_name = '" .
+			         $db->real_escape_string($change_journal) . "'";
+			if (!($result=$db->query($query))) die($db->error);
+			$enabled = ($result->fetch_object()->result > 0);
+		}
+	}
+	return $enabled;
+}
+
+
+
+/**
+* @brief Record one change in the change journal.
+*
+* This should be called inside the transaction that makes the change. It does nothing if the
+* journal is not enabled.
+*
+* @param[in,out] $db          MySQLi database object
+* @param[in]     $table       Table name
+* @param[in]     $key_value   Primary key data value of the row
+* @param[in]     $operation   'I' for a new row, or 'U' for an altered row
+*
+*/
+
+function journal_change ($db, $table, $key_value, $operation)
+{
+	global $change_journal;
+	
+	if (!journal_enabled($db)) return;
+	
+	$query = "INSERT INTO $change_journal (table_name, rec_key, operation) VALUES (?, ?, ?)";
+	if (!($stmt=$db->prepare($query))) die($db->error);
+	if (!$stmt->bind_param('sss', $table, $key_value, $operation)) die ('Bind failed');
+	if (!$stmt->execute()) die ('Execute failed');
+	$stmt->close();
+}
+?> 
@@ -28,6 +28,7 @@ function form_input ($my_field_name)
 
 include_once ('misc_functions.php');
 include_once ('pgv_connect.php');
+include_once ('change_journal.php');
 include_once ('config.php');
 
 // Generate the HTML page header.
@@ -148,12 +149,21 @@ if(isset($_POST['submit']))
 		if (${$field[$i]} == "") ${$field[$i]} = null;
 	}
 	
+	// The new record, the update and their change journal entries are written in one
+	// transaction. If the page dies part way through, the connection is closed and the
+	// server rolls the transaction back. Whether there is a journal is found out first,
+	// outside the transaction.
+	
+	journal_enabled($db);
+	if (!$db->begin_transaction()) die($db->error);
+	
 	// If this record is not already in the database, then create it.
 		
 	if ($_POST['new_record'] == 'true')
 	{
 		$query = "INSERT INTO ns_marriages_data (MarriageID) VALUES ($MarriageID)";
 		if (!$db->query($query)) die($db->error);
+		journal_change($db, 'ns_marriages_data', $MarriageID, 'I');
 	}
 	$new_record = 'false';
 
@@ -187,10 +197,16 @@ if(isset($_POST['submit']))
 	// --- Execute the prepare statement.
 	
 	if (!$stmt->execute()) die ("Execute failed");
+	$num_affected_rows = $stmt->affected_rows;
 	
 	// --- Release the prepared statement.
 	
 	$stmt->close();
+	
+	// Record the change, and commit.
+	
+	if ($num_affected_rows > 0) journal_change($db, 'ns_marriages_data', $MarriageID, 'U');
+	if (!$db->commit()) die($db->error);
 }
   else
 {
@@ -7,4 +7,10 @@ $db_name = 'gendat';
 
 $pgv_path   = '../../development/phpgedview/';
 $pgv_prefix = 'phpgedview.';
+
+// Name of the change journal table. Every row written by db_update_data() and db_insert_data()
+// is recorded in it, if it exists, so that the derived search tables can be refreshed. Set it
+// to '' to turn the journal off.
+
+$change_journal = 'z_change_journal';
 ?> 
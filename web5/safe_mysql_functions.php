@@ -92,6 +92,11 @@ function get_next_valid_key ($db, $table, $key_field, $key_value)
 *
 * @returns       Returns the number of affected rows.
 *
+* @note
+* If the change journal table named by `$change_journal` in config.php exists, then the table
+* name and key value of the altered row are also recorded in it, in the same transaction as the
+* update.
+*
 */
 
 function db_update_data ($db, $table, $data_fields, $data_values, $key_field, $key_value)
@@ -103,11 +108,24 @@ function db_update_data ($db, $table, $data_fields, $data_values, $key_field, $k
 		$query .= ", $data_fields[$i]=?";
 	$query .= " WHERE $key_field=?";
 	
-	// Run the query.
+	// Run the query, and record the change, in one transaction. If the script dies part way
+	// through, the connection is closed and the server rolls the transaction back.
+	
+	$journal = journal_enabled($db);
+	if ($journal && !$db->begin_transaction())
+		die("Begin transaction failed: (" . $db->errno . ") " . $db->error);
 	
 	$param_values = array_merge($data_values, array($key_value));
 	$num_affected_rows = safe_db_query_nr ($db, $query, $param_values);
 	
+	if ($journal)
+	{
+		if ($num_affected_rows > 0)
+			journal_change ($db, $table, $key_value, 'U');
+		if (!$db->commit())
+			die("Commit failed: (" . $db->errno . ") " . $db->error);
+	}
+	
 	return $num_affected_rows;
 }
 
@@ -122,12 +140,19 @@ function db_update_data ($db, $table, $data_fields, $data_values, $key_field, $k
 * @param[in]     $table        Table name
 * @param[in]     $data_fields  Array of field names
 * @param[in]     $data_values  Array of field data values
+* @param[in]     $key_field    Primary key field name (optional)
 *
 * @returns       Returns the number of affected rows.
 *
+* @note
+* If the change journal table named by `$change_journal` in config.php exists, then the new row
+* is also recorded in it, in the same transaction as the insert. Its key is the value given
+* for `$key_field`, or the AUTO_INCREMENT value of the new row if `$key_field` is not one of
+* the data fields.
+*
 */
 
-function db_insert_data ($db, $table, $data_fields, $data_values)
+function db_insert_data ($db, $table, $data_fields, $data_values, $key_field = null)
 {
 	// --- Create the template SQL query for the prepared statement.
 
@@ -135,15 +160,83 @@ function db_insert_data ($db, $table, $data_fields, $data_values)
 	for ($i=1; $i<count($data_fields); $i++)
 		$query .= ", $data_fields[$i]=?";
 	
-	// Run the query.
+	// Run the query, and record the new row, in one transaction.
+	
+	$journal = journal_enabled($db);
+	if ($journal && !$db->begin_transaction())
+		die("Begin transaction failed: (" . $db->errno . ") " . $db->error);
 	
 	$num_affected_rows = safe_db_query_nr ($db, $query, $data_values);
 	
+	if ($journal)
+	{
+		$i = ($key_field === null) ? false : array_search($key_field, $data_fields);
+		$key_value = ($i === false) ? $db->insert_id : $data_values[$i];
+		
+		if ($num_affected_rows > 0)
+			journal_change ($db, $table, $key_value, 'I');
+		if (!$db->commit())
+			die("Commit failed: (" . $db->errno . ") " . $db->error);
+	}
+	
 	return $num_affected_rows;
 }
 
 
 
+/**
+* @brief Determine if changes are to be recorded in the change journal.
+*
+* @param[in,out] $db   MySQLi database object
+*
+* @returns       Returns `true` if `$change_journal` is set in config.php and the journal table
+*                exists. The table is created with `gendat-cli create-journal`.
+*
+*/
+
+function journal_enabled ($db)
+{
+	global $change_journal;
+	static $enabled = null;
+	
+	if ($enabled === null)
+	{
+		$enabled = false;
+		if (!empty($change_journal))
+		{
+			$query = "SELECT COUNT(*) AS result FROM information_schema.tables " .
+			         "WHERE table_schema = DATABASE() AND table_name = ?";
+			$data_values = safe_db_select ($db, $query, array($change_journal));
+			$enabled = ($data_values[0]['result'] > 0);
+		}
+	}
+	return $enabled;
+}
+
+
+
+/**
+* @brief Record one change in the change journal.
+*
+* This should be called inside the transaction that makes the change.
+*
+* @param[in,out] $db          MySQLi database object
+* @param[in]     $table       Table name
+* @param[in]     $key_value   Primary key data value of the row
+* @param[in]     $operation   'I' for a new row, or 'U' for an altered row
+*
+*/
+
+function journal_change ($db, $table, $key_value, $operation)
+{
+	global $change_journal;
+	
+	$query = "INSERT INTO $change_journal (table_name, rec_key, operation) VALUES (?, ?, ?)";
+	safe_db_query_nr ($db, $query, array($table, $key_value, $operation));
+}
+
+
+
 /**
 * @brief Obtain data from the database.
 *